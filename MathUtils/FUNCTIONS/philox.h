@@ -0,0 +1,95 @@
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <cstdint>
+
+namespace MathUtils
+{
+    /// Counter-based pseudo-random generator Philox4x32-10, see (2011) Salmon, Moraes,
+    /// Dror, Shaw - Parallel Random Numbers: As Easy as 1, 2, 3.
+    /// The result depends on (counter, key) only, so numbers can be drawn in any order,
+    /// by any thread or OpenCL work item, and they are the same.
+    inline void philox4x32(
+            const uint32_t counter[4],
+            const uint32_t key[2],
+            uint32_t result[4]) noexcept
+    {
+        uint32_t _c0 = counter[0], _c1 = counter[1], _c2 = counter[2], _c3 = counter[3];
+        uint32_t _k0 = key[0], _k1 = key[1];
+        for(int r=0; r<10; ++r)
+        {
+            const uint64_t _p0 = (uint64_t)0xD2511F53u * _c0;
+            const uint64_t _p1 = (uint64_t)0xCD9E8D57u * _c2;
+            _c0 = (uint32_t)(_p1 >> 32) ^ _c1 ^ _k0;
+            _c1 = (uint32_t)_p1;
+            _c2 = (uint32_t)(_p0 >> 32) ^ _c3 ^ _k1;
+            _c3 = (uint32_t)_p0;
+            _k0 += 0x9E3779B9u;
+            _k1 += 0xBB67AE85u;
+        }
+        result[0] = _c0;
+        result[1] = _c1;
+        result[2] = _c2;
+        result[3] = _c3;
+    }
+
+    /// Number index of the stream (seed, stream), the block of 4 numbers
+    /// is generated at once, so the neighbouring indices share the counter
+    inline uint32_t randomBits(
+            const uint32_t seed,
+            const uint32_t stream,
+            const uint64_t index) noexcept
+    {
+        const uint32_t _counter[4] = {(uint32_t)(index >> 2), (uint32_t)(index >> 34), 0u, 0u};
+        const uint32_t _key[2] = {seed, stream};
+        uint32_t _result[4];
+        philox4x32(_counter, _key, _result);
+        return _result[index & 3];
+    }
+
+    /// Uniform float in [0,1), exact in float, so it is the same on OpenCL devices
+    inline float randomUniform(
+            const uint32_t seed,
+            const uint32_t stream,
+            const uint64_t index) noexcept
+    {
+        return (randomBits(seed, stream, index) >> 8) * (1.0f / 16777216.0f);
+    }
+
+    /// OpenCL C source of _randomBits() and _randomUniform(),
+    /// the same as randomBits() and randomUniform()
+    inline const char * philoxCLSource() noexcept
+    {
+        return "\
+        inline uint _randomBits(uint seed, uint stream, ulong index)\
+        {\
+            uint _c0 = (uint)(index >> 2);\
+            uint _c1 = (uint)(index >> 34);\
+            uint _c2 = 0;\
+            uint _c3 = 0;\
+            uint _k0 = seed;\
+            uint _k1 = stream;\
+            for(int r=0; r<10; ++r)\
+            {\
+                uint _hi0 = mul_hi(0xD2511F53u, _c0);\
+                uint _lo0 = 0xD2511F53u * _c0;\
+                uint _hi1 = mul_hi(0xCD9E8D57u, _c2);\
+                uint _lo1 = 0xCD9E8D57u * _c2;\
+                _c0 = _hi1 ^ _c1 ^ _k0;\
+                _c1 = _lo1;\
+                _c2 = _hi0 ^ _c3 ^ _k1;\
+                _c3 = _lo0;\
+                _k0 += 0x9E3779B9u;\
+                _k1 += 0xBB67AE85u;\
+            }\
+            uint _lane = index & 3;\
+            return _lane == 0 ? _c0 : _lane == 1 ? _c1 : _lane == 2 ? _c2 : _c3;\
+        }\
+        inline float _randomUniform(uint seed, uint stream, ulong index)\
+        {\
+            return (_randomBits(seed, stream, index) >> 8) * (1.0f / 16777216.0f);\
+        }\
+        ";
+    }
+}
+#endif // PHILOX_H
@@ -1,14 +1,60 @@
 #ifndef RAND_H
 #define RAND_H
 
+#include <atomic>
+#include <cmath>
+#include <type_traits>
+
+#include "philox.h"
+
 namespace MathUtils
 {
-    /// Get pseudo-random number in range
-    /// \todo make it thread safe with Qrand
+    /// Seed and number of the next draw of rand()
+    inline std::atomic<uint32_t> & _randSeed() noexcept
+    {
+        static std::atomic<uint32_t> _seed(0);
+        return _seed;
+    }
+    inline std::atomic<uint64_t> & _randCounter() noexcept
+    {
+        static std::atomic<uint64_t> _counter(0);
+        return _counter;
+    }
+
+    /// Restart rand() sequence with the given seed
+    inline void srand(const uint32_t seed) noexcept
+    {
+        _randSeed() = seed;
+        _randCounter() = 0;
+    }
+
+    template<typename _DimType_>
+    inline _DimType_ _randInRange(const _DimType_ a, const _DimType_ b, const double u,
+                                  std::true_type /*integral*/) noexcept
+    {
+        // Both bounds are included
+        const _DimType_ _offset = (_DimType_)std::floor(u * ((double)b - a + 1.0));
+        return a + (_offset > b - a ? b - a : _offset);
+    }
+
+    template<typename _DimType_>
+    inline _DimType_ _randInRange(const _DimType_ a, const _DimType_ b, const double u,
+                                  std::false_type /*integral*/) noexcept
+    {
+        // Calculated in double, but rounding to _DimType_ (e.g. float) can still give b
+        typedef typename std::common_type<_DimType_, double>::type _Type;
+        const _DimType_ _value = _DimType_((_Type)a + ((_Type)b - a) * u);
+        return _value != b ? _value : std::nextafter(b, a);
+    }
+
+    /// Get pseudo-random number in range, [a,b] for integral types, [a,b) otherwise.
+    /// Draws are numbered by the atomic counter (see philox4x32()), so it is thread safe,
+    /// but the order of draws of different threads isn't defined.
     template<typename _DimType_>
     inline _DimType_ rand(const _DimType_ a, const _DimType_ b) noexcept
     {
-        return a + std::rand()*(b-a)/RAND_MAX;
+        const double _u = randomBits(_randSeed(), 0u, _randCounter()++) * (1.0 / 4294967296.0);
+        return _randInRange(a, b, _u, std::is_integral<_DimType_>());
     }
 }
 #endif // RAND_H
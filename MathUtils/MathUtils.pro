@@ -60,6 +60,7 @@ HEADERS += \
     extendedreal.h \
     FUNCTIONS/factorial.h \
     FUNCTIONS/rand.h \
+    FUNCTIONS/philox.h \
     FUNCTIONS/round.h \
     FUNCTIONS/trunc.h \
     FUNCTIONS/calculatecircumspherecenter.h \
@@ -22,6 +22,53 @@ void Test_MathUtils::test_round()
     QVERIFY(_rez == -1e-7f);
 }
 
+void Test_MathUtils::test_philox()
+{
+    // Known answers of the reference implementation (Random123)
+    uint32_t _result[4];
+    const uint32_t _counter0[4] = {0u, 0u, 0u, 0u};
+    const uint32_t _key0[2] = {0u, 0u};
+    philox4x32(_counter0, _key0, _result);
+    QVERIFY(_result[0] == 0x6627e8d5u && _result[1] == 0xe169c58du &&
+            _result[2] == 0xbc57ac4cu && _result[3] == 0x9b00dbd8u);
+
+    const uint32_t _counter1[4] = {0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u};
+    const uint32_t _key1[2] = {0xa4093822u, 0x299f31d0u};
+    philox4x32(_counter1, _key1, _result);
+    QVERIFY(_result[0] == 0xd16cfe09u && _result[1] == 0x94fdccebu &&
+            _result[2] == 0x5001e420u && _result[3] == 0x24126ea1u);
+
+    // Lanes of the same counter
+    QVERIFY(randomBits(0u, 0u, 2) == 0xbc57ac4cu);
+    QVERIFY(randomUniform(0u, 0u, 0) == (0x6627e8d5u >> 8) / 16777216.0f);
+}
+
+void Test_MathUtils::test_rand()
+{
+    MathUtils::srand(7);
+    bool _hit[4] = {false, false, false, false};
+    for(int i=0; i<1000; ++i)
+    {
+        int _r = rand<int>(0,3);
+        QVERIFY(_r >= 0 && _r <= 3);
+        _hit[_r] = true;
+        float _f = rand<float>(-1.0f, 1.0f);
+        QVERIFY(_f >= -1.0f && _f < 1.0f);
+    }
+    QVERIFY(_hit[0] && _hit[1] && _hit[2] && _hit[3]);
+
+    // The largest draw is rounded to 1.0f, but the range is still half-open
+    const double _uMax = 4294967295.0 / 4294967296.0;
+    QVERIFY(_randInRange(-1.0f, 1.0f, _uMax, std::false_type()) < 1.0f);
+    QVERIFY(_randInRange(1.0f, -1.0f, _uMax, std::false_type()) > -1.0f);
+
+    // The same seed gives the same sequence
+    MathUtils::srand(7);
+    int _first = rand<int>(0,1000000);
+    MathUtils::srand(7);
+    QVERIFY(rand<int>(0,1000000) == _first);
+}
+
 void Test_MathUtils::test_trunc()
 {
     float _rez = MathUtils::trunc<float>(0.100025,1e-3);
@@ -9,6 +9,8 @@ class Test_MathUtils : public QObject
     Q_OBJECT
     private: Q_SLOT void test_factorial();
     private: Q_SLOT void test_round();
+    private: Q_SLOT void test_philox();
+    private: Q_SLOT void test_rand();
     private: Q_SLOT void test_trunc();
     private: Q_SLOT void test_simpleMatrix();
     private: Q_SLOT void test_calculateCircumSphereCenter();
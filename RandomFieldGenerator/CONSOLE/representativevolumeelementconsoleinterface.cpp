@@ -308,7 +308,10 @@ void _EditRVECommand::generateLayerRVE(
 }
 
 std::string RepresentativeVolumeElementConsoleInterface::createRVE(
-        const std::string &name, int size, float representationSize) noexcept
+        const std::string &name,
+        int size,
+        float representationSize,
+        const std::string &backingDirectory) noexcept
 {
     try
     {
@@ -319,7 +322,8 @@ std::string RepresentativeVolumeElementConsoleInterface::createRVE(
         }
         else if((size >= 2) && ((size & (size - 1)) == 0)) // check power o two
         {
-            RVEs.emplace(name, new RepresentativeVolumeElement(size, representationSize));
+            RVEs.emplace(name, new RepresentativeVolumeElement(
+                             size, representationSize, backingDirectory));
         }
         else
         {
@@ -338,14 +342,17 @@ std::string RepresentativeVolumeElementConsoleInterface::createRVE(
 int RepresentativeVolumeElementConsoleInterface::_CreateRVECommand::executeConsoleCommand(
         const std::vector<std::string> &argv)
 {
-    if(argv.size() < 2 || argv.size() > 3)
+    if(argv.size() < 2 || argv.size() > 4)
     {
         getConsole().writeToOutput("Error: wrong number of arguments.\n");
         return -1;
     }
     int _size;
     float representationSize = 1.0f;
-    if(argv.size() == 3)
+    std::string backingDirectory;
+    if(argv.size() == 4)
+        backingDirectory = argv[3];
+    if(argv.size() >= 3)
     {
         std::stringstream _str{argv[2]};
         if(!(_str >> representationSize))
@@ -356,7 +363,8 @@ int RepresentativeVolumeElementConsoleInterface::_CreateRVECommand::executeConso
     }
     std::stringstream _str{argv[1]};
     if(_str >> _size)
-        getConsole().writeToOutput(_manager.createRVE(argv[0], _size, representationSize));
+        getConsole().writeToOutput(_manager.createRVE(
+                                       argv[0], _size, representationSize, backingDirectory));
     else
     {
         getConsole().writeToOutput("Error: wrong <size> argument.\n");
@@ -241,7 +241,11 @@ class RepresentativeVolumeElementConsoleInterface : public QObject
     private: Console &_refToConsole;
 
     /// createRVE ----------------------------------------------------------------------------
-    public : std::string createRVE(const std::string &name, int size, float representationSize) noexcept;
+    public : std::string createRVE(
+            const std::string &name,
+            int size,
+            float representationSize,
+            const std::string &backingDirectory = "") noexcept;
     private: class _CreateRVECommand : public ConsoleCommand
     {
         private: RepresentativeVolumeElementConsoleInterface &_manager;
@@ -250,14 +254,16 @@ class RepresentativeVolumeElementConsoleInterface : public QObject
             ConsoleCommand(
             //  "--------------------------------------------------------------------------------"
                 "createRVE",
-                "createRVE <Name> <size> <representationSize>\n"
+                "createRVE <Name> <size> <representationSize> <backingDirectory>\n"
                 "Creates Representative Volume Element (RVE) object in RAM memory.\n"
                 "Arguments:\n"
                 "[string] <Name> - the name of RVE in RAM memory;\n"
                 "[int]    <size> - the discrete size of RVE, It should be equal to\n"
                 "           some power of two;\n"
                 "[float]  <representationSize> - (optional) represenation size of given RVE,\n"
-                "           default = 1.\n",
+                "           default = 1;\n"
+                "[string] <backingDirectory> - (optional) directory of temporary files,\n"
+                "           which keep RVE data out of RAM, for RVEs larger than RAM.\n",
                 console),
                 _manager(manager){}
         public: int executeConsoleCommand(const std::vector<std::string> &argv) override;
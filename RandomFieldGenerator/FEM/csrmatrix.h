@@ -0,0 +1,107 @@
+#ifndef CSRMATRIX
+#define CSRMATRIX
+
+#include <vector>
+#include <algorithm>
+
+namespace FEM
+{
+    /// Compressed sparse row matrix in the layout of viennacl::compressed_matrix::set()
+    /// Columns in each row are sorted
+    /// Built by AbstractProblem::assembleCSR()
+    struct CSRMatrix
+    {
+        public: unsigned rows = 0;
+        public: unsigned cols = 0;
+        public: std::vector<unsigned> rowPtr;
+        public: std::vector<unsigned> columns;
+        public: std::vector<float> values;
+
+        public: unsigned nonzeros() const noexcept {return columns.size();}
+
+        /// y = A*x, accumulated in _Scalar_ (e.g. double residuals of IterativeRefinement())
+        public: template<typename _Scalar_> void multiply(
+                const std::vector<_Scalar_> &x,
+                std::vector<_Scalar_> &y) const noexcept
+        {
+            y.resize(rows);
+            #pragma omp parallel for
+            for(long i=0; i<(long)rows; ++i)
+            {
+                _Scalar_ _sum = 0;
+                for(unsigned p=rowPtr[i]; p<rowPtr[i+1]; ++p)
+                    _sum += values[p] * x[columns[p]];
+                y[i] = _sum;
+            }
+        }
+
+        /// Operator interface of IterativeSolvers
+        public: long size() const noexcept {return rows;}
+        public: template<typename _Scalar_> void apply(
+                const std::vector<_Scalar_> &x,
+                std::vector<_Scalar_> &y) const noexcept {
+            multiply(x, y);}
+
+        public: CSRMatrix transpose() const
+        {
+            CSRMatrix _T;
+            _T.rows = cols;
+            _T.cols = rows;
+            _T.rowPtr.assign(cols + 1, 0);
+            for(unsigned p=0; p<nonzeros(); ++p)
+                ++_T.rowPtr[columns[p]+1];
+            for(unsigned i=0; i<cols; ++i)
+                _T.rowPtr[i+1] += _T.rowPtr[i];
+            _T.columns.resize(nonzeros());
+            _T.values.resize(nonzeros());
+            std::vector<unsigned> _pos(_T.rowPtr.begin(), _T.rowPtr.end()-1);
+            // Rows are visited in increasing order, so columns of _T stay sorted
+            for(unsigned i=0; i<rows; ++i)
+                for(unsigned p=rowPtr[i]; p<rowPtr[i+1]; ++p)
+                {
+                    _T.columns[_pos[columns[p]]] = i;
+                    _T.values[_pos[columns[p]]++] = values[p];
+                }
+            return _T;
+        }
+
+        /// this*B, Gustavson's row-by-row product
+        public: CSRMatrix multiply(const CSRMatrix &B) const
+        {
+            CSRMatrix _C;
+            _C.rows = rows;
+            _C.cols = B.cols;
+            _C.rowPtr.assign(rows + 1, 0);
+
+            std::vector<long> _marker(B.cols, -1);
+            std::vector<float> _accumulator(B.cols, 0.0f);
+            std::vector<unsigned> _rowColumns;
+            for(unsigned i=0; i<rows; ++i)
+            {
+                _rowColumns.clear();
+                for(unsigned p=rowPtr[i]; p<rowPtr[i+1]; ++p)
+                    for(unsigned q=B.rowPtr[columns[p]]; q<B.rowPtr[columns[p]+1]; ++q)
+                    {
+                        unsigned j = B.columns[q];
+                        if(_marker[j] != (long)i)
+                        {
+                            _marker[j] = i;
+                            _accumulator[j] = 0.0f;
+                            _rowColumns.push_back(j);
+                        }
+                        _accumulator[j] += values[p] * B.values[q];
+                    }
+                std::sort(_rowColumns.begin(), _rowColumns.end());
+                for(unsigned j : _rowColumns)
+                {
+                    _C.columns.push_back(j);
+                    _C.values.push_back(_accumulator[j]);
+                }
+                _C.rowPtr[i+1] = _C.columns.size();
+            }
+            return _C;
+        }
+    };
+}
+
+#endif // CSRMATRIX
@@ -0,0 +1,122 @@
+#ifndef DIRECTSOLVER
+#define DIRECTSOLVER
+
+#include "csrmatrix.h"
+
+#include <vector>
+#include <stdexcept>
+#include <Eigen/SparseCore>
+#include <Eigen/SparseCholesky>
+#include <Eigen/SparseLU>
+#include <Eigen/OrderingMethods>
+
+namespace FEM
+{
+    /// Sparse direct solver of the host CSRMatrix (see SolverConfiguration::DIRECT),
+    /// factorization is in double precision:
+    ///  symmetric matrices - LDL^T (Eigen::SimplicialLDLT, always AMD ordering),
+    ///  others (e.g. ThermoelasticityProblem) - LU (Eigen::SparseLU) with COLAMD ordering.
+    /// Symbolic factorization (ordering and elimination tree) depends only on the pattern,
+    /// which assembleCSR() builds from the mesh, not from materials or boundary conditions.
+    /// So it is kept and reused by the next factorize() of the matrix with the same pattern,
+    /// e.g. load cases or a sweep over materials of the RVE of the same size.
+    /// Matrix should be non-singular, i.e. Dirichlet conditions should fix rigid motions:
+    /// float matrix of the floating body is only nearly singular, so it is factorized,
+    /// but the solution is dominated by the rigid motion.
+    /// Rows of nodes without material (zero rows) get the unit diagonal
+    class DirectSolver
+    {
+        private: typedef Eigen::SparseMatrix<double> _MatrixType;
+
+        private: _MatrixType _A;
+        private: Eigen::SimplicialLDLT<_MatrixType, Eigen::Lower> _LDLT;
+        private: Eigen::SparseLU<_MatrixType, Eigen::COLAMDOrdering<int>> _LU;
+        private: bool _symmetric = true;
+        private: bool _analyzed = false;
+        private: bool _factorized = false;
+        /// Pattern of the analyzed matrix (columns of A)
+        private: std::vector<unsigned> _outerIndexes;
+        private: std::vector<unsigned> _innerIndexes;
+        private: long _analysesNum = 0;
+
+        public : bool isFactorized() const noexcept {return _factorized;}
+        public : long rows() const noexcept {return _A.rows();}
+        /// Number of symbolic factorizations, the rest of factorize() calls reused them
+        public : long analysesNum() const noexcept {return _analysesNum;}
+
+        /// Returns false, if the factorization breaks down (zero pivot)
+        public : bool factorize(const CSRMatrix &A, const bool symmetric = true)
+        {
+            // Column major storage of A is the CSR of A^T, it is A itself if A is symmetric
+            CSRMatrix _transposed;
+            if(!symmetric)
+                _transposed = A.transpose();
+            const CSRMatrix &_columns = symmetric ? A : _transposed;
+
+            const bool _samePattern = _analyzed && _symmetric == symmetric &&
+                    _outerIndexes == _columns.rowPtr && _innerIndexes == _columns.columns;
+
+            _A.resize(A.rows, A.cols);
+            _A.resizeNonZeros(A.nonzeros());
+            for(unsigned i=0; i<=A.cols; ++i)
+                _A.outerIndexPtr()[i] = _columns.rowPtr[i];
+            for(unsigned p=0; p<A.nonzeros(); ++p)
+            {
+                _A.innerIndexPtr()[p] = _columns.columns[p];
+                _A.valuePtr()[p] = _columns.values[p];
+            }
+            for(unsigned i=0; i<A.rows; ++i)
+            {
+                bool _zeroRow = true;
+                for(unsigned p=A.rowPtr[i]; p<A.rowPtr[i+1]; ++p)
+                    if(A.values[p] != 0.0f) _zeroRow = false;
+                if(_zeroRow)
+                    for(unsigned p=_columns.rowPtr[i]; p<_columns.rowPtr[i+1]; ++p)
+                        if(_columns.columns[p] == i) _A.valuePtr()[p] = 1.0;
+            }
+
+            if(!_samePattern)
+            {
+                if(symmetric) _LDLT.analyzePattern(_A);
+                else _LU.analyzePattern(_A);
+                _outerIndexes = _columns.rowPtr;
+                _innerIndexes = _columns.columns;
+                _symmetric = symmetric;
+                _analyzed = true;
+                ++_analysesNum;
+            }
+
+            if(symmetric)
+            {
+                _LDLT.factorize(_A);
+                _factorized = _LDLT.info() == Eigen::Success;
+            }
+            else
+            {
+                _LU.factorize(_A);
+                _factorized = _LU.info() == Eigen::Success;
+            }
+            return _factorized;
+        }
+
+        /// x = A^-1 * b
+        public : template<typename _Scalar_> void solve(
+                const std::vector<_Scalar_> &b,
+                std::vector<_Scalar_> &x) const
+        {
+            if(!_factorized)
+                throw(std::runtime_error("DirectSolver::solve(): matrix is not factorized"));
+            Eigen::VectorXd _b(b.size());
+            for(unsigned long i=0; i<b.size(); ++i)
+                _b[i] = b[i];
+            Eigen::VectorXd _x;
+            if(_symmetric) _x = _LDLT.solve(_b);
+            else _x = _LU.solve(_b);
+            x.resize(b.size());
+            for(unsigned long i=0; i<b.size(); ++i)
+                x[i] = _x[i];
+        }
+    };
+}
+
+#endif // DIRECTSOLVER
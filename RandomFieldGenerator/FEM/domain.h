@@ -2,6 +2,7 @@
 #define DOMAIN
 
 #include "representativevolumeelement.h"
+#include "phaselabels.h"
 
 #include <iomanip>
 #include <fstream>
@@ -71,14 +72,37 @@ namespace FEM
         public : long elementsNum() const noexcept {return _elementsNum;}
         public : long nodesNum() const noexcept {return _nodesNum;}
         public : std::vector<RVEMaterial> MaterialsVector;
+        /// Drops segmentation, see segment()
         public : void addMaterial(
                 float minIntensity, float maxIntensity, Characteristics ch) noexcept {
-            MaterialsVector.push_back(RVEMaterial{minIntensity, maxIntensity, ch});}
+            MaterialsVector.push_back(RVEMaterial{minIntensity, maxIntensity, ch});
+            _phases = PhaseLabels();}
         private: const RepresentativeVolumeElement &_refToRVE;
         public : float size() const noexcept {return _refToRVE.getRepresentationSize();}
         public : int discreteSize() const noexcept {return _refToRVE.getSize();}
+
+        private: PhaseLabels _phases;
+        public : const PhaseLabels & phases() const noexcept {return _phases;}
+        public : bool isSegmented() const noexcept {return !_phases.empty();}
+        /// Label each voxel by its material once (see materialIndex()), then elements,
+        /// volume concentrations and exporters take materials from the labels.
+        /// Labels are the snapshot of the RVE, so call it again after the RVE is changed.
+        /// If pack, two materials are packed into bits (see PhaseLabels)
+        public : void segment(const bool pack = true)
+        {
+            const float *_data = _refToRVE.getData();
+            _phases = PhaseLabels(
+                        _nodesNum, (int)MaterialsVector.size(),
+                        [&](const long index) -> int {return _intensityMaterialIndex(_data[index]);},
+                        pack);
+        }
+
+        /// Voxels of the material (voxels in the material interval, if not segmented)
+        /// divided by all voxels
         public : float getMaterialVolumeConcentration(const int materialID) const noexcept
         {
+            if(isSegmented())
+                return (float)_phases.count(materialID) / (float)_nodesNum;
             return (float)(_refToRVE.getRangeCellsNum(
                         MaterialsVector[materialID].minIntensity,
                         MaterialsVector[materialID].maxIntensity)) /
@@ -90,6 +114,41 @@ namespace FEM
             this->_elementsNum =
                      (_refToRVE.getSize()-1)*(_refToRVE.getSize()-1)*(_refToRVE.getSize()-1)*6;
         }
+        /// Returns index of the last material in MaterialsVector, which covers intensity,
+        /// or -1 if there is no such material
+        private: int _intensityMaterialIndex(const float intensity) const noexcept
+        {
+            int _materialIndex = -1;
+            for(unsigned m=0; m<MaterialsVector.size(); ++m)
+                if(intensity >= MaterialsVector[m].minIntensity &&
+                        intensity < MaterialsVector[m].maxIntensity)
+                    _materialIndex = m;
+            return _materialIndex;
+        }
+        /// Returns index of the last material in MaterialsVector, which covers intensity
+        /// of the voxel (i,j,k), or -1 if there is no such material.
+        /// If segmented, it is the label of the voxel
+        public : int materialIndex(const int i, const int j, const int k) const noexcept
+        {
+            if(isSegmented())
+            {
+                const long _size = _refToRVE.getSize();
+                const uint8_t _phase = _phases[i + j*_size + k*_size*_size];
+                return _phase == PhaseLabels::NO_PHASE ? -1 : _phase;
+            }
+            return _intensityMaterialIndex(_refToRVE.getData(i,j,k));
+        }
+        /// Index of the element material for exporters, starts from 1,
+        /// MaterialsVector.size()+1 if there is no material
+        private: int _exportMaterialIndex(const long element) const noexcept
+        {
+            const int _size = _refToRVE.getSize();
+            const int _materialIndex = materialIndex(
+                        element / 6 % (_size-1),
+                        element / 6 / (_size-1) % (_size-1),
+                        element / 6 / (_size-1) / (_size-1));
+            return _materialIndex < 0 ? MaterialsVector.size() + 1 : _materialIndex + 1;
+        }
         public : float fixedTetrahedronSideArea() const noexcept
         {
             return _refToRVE.getRepresentationSize() * _refToRVE.getRepresentationSize() /
@@ -105,10 +164,9 @@ namespace FEM
             int k = index / 6 / (size-1) / (size-1);
 
             const Characteristics *ch = nullptr;
-            float intensity = _refToRVE.getData(i,j,k);
-            for(auto RVEch = MaterialsVector.begin(); RVEch != MaterialsVector.end(); ++RVEch)
-                if(intensity >= (*RVEch).minIntensity && intensity < (*RVEch).maxIntensity)
-                    ch = &((*RVEch).characteristics);
+            int _materialIndex = materialIndex(i,j,k);
+            if(_materialIndex >= 0)
+                ch = &(MaterialsVector[_materialIndex].characteristics);
 
             float step = _refToRVE.getRepresentationSize() / (size-1.0);
 
@@ -224,12 +282,7 @@ namespace FEM
                     for(long el=0; el< _elementsNum; ++el)
                     {
                         FixedTetrahedron t = (*this)[el];
-                        int characteristicsIndex = 1; // starts from 1
-                        for(auto RVEch = MaterialsVector.begin(); RVEch != MaterialsVector.end(); ++RVEch)
-                            if(t.characteristics == &((*RVEch).characteristics))
-                                break;
-                            else
-                                ++characteristicsIndex;
+                        int characteristicsIndex = _exportMaterialIndex(el);
                         _DomainFileStream << "CTETRA,"
                                           << el + 1 << ',' // starts from 1
                                           << characteristicsIndex << ','
@@ -327,12 +380,7 @@ namespace FEM
                                 t.c[1]>=step*layerYBottom-delta && t.c[1]<=step*layerYTop+delta &&
                                 t.d[1]>=step*layerYBottom-delta && t.d[1]<=step*layerYTop+delta )
                         {
-                            int characteristicsIndex = 1; // starts from 1
-                            for(auto RVEch = MaterialsVector.begin(); RVEch != MaterialsVector.end(); ++RVEch)
-                                if(t.characteristics == &((*RVEch).characteristics))
-                                    break;
-                                else
-                                    ++characteristicsIndex;
+                            int characteristicsIndex = _exportMaterialIndex(el);
                             _DomainFileStream << "CTETRA,"
                                               << el + 1 << ',' // starts from 1
                                               << characteristicsIndex << ','
@@ -425,12 +473,7 @@ namespace FEM
                         long i,j,k;
                         if(t.isOnSide(1,_refToRVE.getRepresentationSize(),tmp))
                         {
-                            int characteristicsIndex = 1; // starts from 1
-                            for(auto RVEch = MaterialsVector.begin(); RVEch != MaterialsVector.end(); ++RVEch)
-                                if(t.characteristics == &((*RVEch).characteristics))
-                                    break;
-                                else
-                                    ++characteristicsIndex;
+                            int characteristicsIndex = _exportMaterialIndex(el);
                             switch(tmp)
                             {
                             case ABC: i=0;j=1;k=2;break;
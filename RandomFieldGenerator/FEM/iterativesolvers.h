@@ -0,0 +1,272 @@
+#ifndef ITERATIVESOLVERS
+#define ITERATIVESOLVERS
+
+#include <vector>
+#include <cmath>
+
+namespace FEM
+{
+    /// Host side Krylov solvers for operators, which are not stored as matrices
+    /// (see MatrixFreeOperator).
+    /// _Operator_ should provide:
+    ///  long size() const noexcept;
+    ///  void apply(const std::vector<float> &x, std::vector<float> &y) const noexcept; // y = A*x
+    /// Input x is used as initial guess.
+    /// Stop criterion and error are the same as in viennacl::linalg::cg_tag: |b - A*x| / |b|
+    namespace IterativeSolvers
+    {
+        /// Dot products are accumulated in double to keep the residual norm trustworthy
+        /// for systems with millions of unknowns
+        template<typename _Scalar_> inline double dot(
+                const std::vector<_Scalar_> &a,
+                const std::vector<_Scalar_> &b) noexcept
+        {
+            double _sum = 0.0;
+            #pragma omp parallel for reduction(+:_sum)
+            for(long i=0; i<(long)a.size(); ++i)
+                _sum += (double)a[i] * (double)b[i];
+            return _sum;
+        }
+
+        /// z = r, for unpreconditioned solvers
+        struct IdentityPreconditioner
+        {
+            public: void apply(const std::vector<float> &r, std::vector<float> &z) const noexcept {
+                z = r;}
+        };
+
+        /// Preconditioned conjugate gradient, for symmetric positive definite operators
+        /// _Preconditioner_ should provide (M^-1 should be symmetric too):
+        ///  void apply(const std::vector<float> &r, std::vector<float> &z) const; // z = M^-1 * r
+        /// residualHistory - relative residual before the first and after each iteration
+        /// Returns number of iterations
+        template<typename _Operator_, typename _Preconditioner_> long PCG(
+                const _Operator_ &A,
+                const _Preconditioner_ &M,
+                const std::vector<float> &b,
+                std::vector<float> &x,
+                const double eps,
+                const long maxIteration,
+                double *error = nullptr,
+                std::vector<double> *residualHistory = nullptr)
+        {
+            const unsigned long n = A.size();
+            if(x.size() != n) x.assign(n, 0.0f);
+
+            std::vector<float> r(n);
+            std::vector<float> z(n);
+            std::vector<float> p(n);
+            std::vector<float> Ap(n);
+
+            A.apply(x, Ap);
+            #pragma omp parallel for
+            for(long i=0; i<(long)n; ++i)
+                r[i] = b[i] - Ap[i];
+            M.apply(r, z);
+            p = z;
+
+            double _normB = std::sqrt(dot(b,b));
+            if(_normB == 0.0) _normB = 1.0;
+            double _rz = dot(r,z);
+            double _error = std::sqrt(dot(r,r)) / _normB;
+            if(residualHistory) residualHistory->assign(1, _error);
+
+            long _iteration = 0;
+            while(_iteration < maxIteration && _error > eps)
+            {
+                A.apply(p, Ap);
+                double _pAp = dot(p,Ap);
+                if(_pAp == 0.0) break;
+                float _alpha = _rz / _pAp;
+                #pragma omp parallel for
+                for(long i=0; i<(long)n; ++i)
+                {
+                    x[i] += _alpha * p[i];
+                    r[i] -= _alpha * Ap[i];
+                }
+                _error = std::sqrt(dot(r,r)) / _normB;
+                if(residualHistory) residualHistory->push_back(_error);
+                ++_iteration;
+                if(_error <= eps) break;
+
+                M.apply(r, z);
+                double _rzNew = dot(r,z);
+                float _beta = _rzNew / _rz;
+                _rz = _rzNew;
+                #pragma omp parallel for
+                for(long i=0; i<(long)n; ++i)
+                    p[i] = z[i] + _beta * p[i];
+            }
+
+            if(error) *error = _error;
+            return _iteration;
+        }
+
+        /// Conjugate gradient, for symmetric positive definite operators
+        /// Returns number of iterations
+        template<typename _Operator_> long CG(
+                const _Operator_ &A,
+                const std::vector<float> &b,
+                std::vector<float> &x,
+                const double eps,
+                const long maxIteration,
+                double *error = nullptr)
+        {
+            return PCG(A, IdentityPreconditioner(), b, x, eps, maxIteration, error);
+        }
+
+        /// Right-preconditioned stabilized bi-conjugate gradient, for non-symmetric operators
+        /// (e.g. ThermoelasticityProblem)
+        /// Returns number of iterations
+        template<typename _Operator_, typename _Preconditioner_> long PBiCGStab(
+                const _Operator_ &A,
+                const _Preconditioner_ &M,
+                const std::vector<float> &b,
+                std::vector<float> &x,
+                const double eps,
+                const long maxIteration,
+                double *error = nullptr,
+                std::vector<double> *residualHistory = nullptr)
+        {
+            const unsigned long n = A.size();
+            if(x.size() != n) x.assign(n, 0.0f);
+
+            std::vector<float> r(n);
+            std::vector<float> r0(n);
+            std::vector<float> p(n);
+            std::vector<float> pHat(n);
+            std::vector<float> v(n);
+            std::vector<float> s(n);
+            std::vector<float> sHat(n);
+            std::vector<float> t(n);
+
+            A.apply(x, v);
+            #pragma omp parallel for
+            for(long i=0; i<(long)n; ++i)
+            {
+                r[i] = b[i] - v[i];
+                r0[i] = r[i];
+                p[i] = r[i];
+            }
+
+            double _normB = std::sqrt(dot(b,b));
+            if(_normB == 0.0) _normB = 1.0;
+            double _rho = dot(r0,r);
+            double _error = std::sqrt(dot(r,r)) / _normB;
+            if(residualHistory) residualHistory->assign(1, _error);
+
+            long _iteration = 0;
+            while(_iteration < maxIteration && _error > eps)
+            {
+                M.apply(p, pHat);
+                A.apply(pHat, v);
+                double _r0v = dot(r0,v);
+                if(_r0v == 0.0) break;
+                float _alpha = _rho / _r0v;
+                #pragma omp parallel for
+                for(long i=0; i<(long)n; ++i)
+                    s[i] = r[i] - _alpha * v[i];
+
+                M.apply(s, sHat);
+                A.apply(sHat, t);
+                double _tt = dot(t,t);
+                float _omega = _tt == 0.0 ? 0.0f : dot(t,s) / _tt;
+                #pragma omp parallel for
+                for(long i=0; i<(long)n; ++i)
+                {
+                    x[i] += _alpha * pHat[i] + _omega * sHat[i];
+                    r[i] = s[i] - _omega * t[i];
+                }
+                _error = std::sqrt(dot(r,r)) / _normB;
+                if(residualHistory) residualHistory->push_back(_error);
+                ++_iteration;
+                if(_omega == 0.0f) break;
+
+                double _rhoNew = dot(r0,r);
+                float _beta = (_rhoNew / _rho) * (_alpha / _omega);
+                _rho = _rhoNew;
+                #pragma omp parallel for
+                for(long i=0; i<(long)n; ++i)
+                    p[i] = r[i] + _beta * (p[i] - _omega * v[i]);
+            }
+
+            if(error) *error = _error;
+            return _iteration;
+        }
+
+        /// Stabilized bi-conjugate gradient, for non-symmetric operators
+        /// (e.g. ThermoelasticityProblem)
+        /// Returns number of iterations
+        template<typename _Operator_> long BiCGStab(
+                const _Operator_ &A,
+                const std::vector<float> &b,
+                std::vector<float> &x,
+                const double eps,
+                const long maxIteration,
+                double *error = nullptr)
+        {
+            return PBiCGStab(A, IdentityPreconditioner(), b, x, eps, maxIteration, error);
+        }
+
+        /// Mixed precision iterative refinement.
+        /// Solution x and residual r = b - A*x are kept in _Scalar_ (e.g. double), only
+        /// corrections A*d = r/|r| are solved in float by innerSolver, to a modest accuracy.
+        /// So Krylov vectors, matrix and preconditioner stay in float, but accuracy
+        /// of x is limited by _Scalar_ (and the condition number), not by float.
+        /// _Operator_ should provide apply() for _Scalar_ vectors (see CSRMatrix)
+        /// _InnerSolver_ should provide (d is zero on input):
+        ///  long operator()(const std::vector<float> &r, std::vector<float> &d) const;
+        /// residualHistory - relative residual before each refinement step
+        /// Returns total number of inner iterations
+        template<typename _Scalar_, typename _Operator_, typename _InnerSolver_> long IterativeRefinement(
+                const _Operator_ &A,
+                const std::vector<_Scalar_> &b,
+                std::vector<_Scalar_> &x,
+                const _InnerSolver_ &innerSolver,
+                const double eps,
+                const long maxRefinements,
+                double *error = nullptr,
+                std::vector<double> *residualHistory = nullptr)
+        {
+            const unsigned long n = A.size();
+            if(x.size() != n) x.assign(n, 0);
+
+            std::vector<_Scalar_> r(n);
+            std::vector<float> rScaled(n);
+            std::vector<float> d(n);
+
+            double _normB = std::sqrt(dot(b,b));
+            if(_normB == 0.0) _normB = 1.0;
+            if(residualHistory) residualHistory->clear();
+
+            double _error = 0.0;
+            long _iterations = 0;
+            for(long _refinement=0; ; ++_refinement)
+            {
+                A.apply(x, r);
+                #pragma omp parallel for
+                for(long i=0; i<(long)n; ++i)
+                    r[i] = b[i] - r[i];
+                double _normR = std::sqrt(dot(r,r));
+                _error = _normR / _normB;
+                if(residualHistory) residualHistory->push_back(_error);
+                if(_error <= eps || _normR == 0.0 || _refinement == maxRefinements) break;
+
+                // Scaled to unit norm, so float range doesn't limit small corrections
+                #pragma omp parallel for
+                for(long i=0; i<(long)n; ++i)
+                    rScaled[i] = r[i] / _normR;
+                std::fill(d.begin(), d.end(), 0.0f);
+                _iterations += innerSolver(rScaled, d);
+                #pragma omp parallel for
+                for(long i=0; i<(long)n; ++i)
+                    x[i] += _normR * d[i];
+            }
+
+            if(error) *error = _error;
+            return _iterations;
+        }
+    }
+}
+
+#endif // ITERATIVESOLVERS
@@ -1,12 +1,12 @@
 #ifndef JACOBIMATRIX
 #define JACOBIMATRIX
 
-#include "matrix.h"
+#include "fixedmatrix.h"
 
 namespace FEM
 {
     /// 3D Jacobi matrix
-    class JacobiMatrix : public MathUtils::Matrix::StaticMatrix<float,3,3>
+    class JacobiMatrix : public MathUtils::Matrix::FixedMatrix<float,3,3>
     {
         public: JacobiMatrix(
                 const float *A,
@@ -24,10 +24,9 @@ namespace FEM
             (*this)(2,1) = C[1]-D[1];
             (*this)(2,2) = C[2]-D[2];
         }
-        public: ~JacobiMatrix() final {}
     };
 
-    class TetrahedronMatrix : public MathUtils::Matrix::StaticMatrix<float,4,4>
+    class TetrahedronMatrix : public MathUtils::Matrix::FixedMatrix<float,4,4>
     {
         public: TetrahedronMatrix(
                 const float *A,
@@ -52,7 +51,6 @@ namespace FEM
             (*this)(3,2) = D[1];
             (*this)(3,3) = D[2];
         }
-        public: ~TetrahedronMatrix() final {}
     };
 }
 
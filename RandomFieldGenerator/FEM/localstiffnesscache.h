@@ -0,0 +1,46 @@
+#ifndef LOCALSTIFFNESSCACHE
+#define LOCALSTIFFNESSCACHE
+
+#include "fixedmatrix.h"
+
+#include <vector>
+
+namespace FEM
+{
+    template<int _DegreesOfFreedom_> class AbstractProblem;
+
+    /// Table of local stiffness matrices keyed by (tetrahedron type, material).
+    /// On the structured Domain all tetrahedrons of the same type t = index % 6
+    /// (see Domain::operator[]) are congruent, so there are only
+    /// 6 * MaterialsVector.size() different local matrices.
+    /// Also stores material index of each voxel, so assembly is a lookup plus scatter.
+    /// Built by AbstractProblem::buildLocalStiffnessCache()
+    template<int _DegreesOfFreedom_> class LocalStiffnessCache
+    {
+        friend class AbstractProblem<_DegreesOfFreedom_>;
+
+        public : typedef MathUtils::Matrix::FixedMatrix<
+            float,4*_DegreesOfFreedom_,4*_DegreesOfFreedom_> LocalMatrix;
+        /// Voxel without material, it has zero stiffness
+        public : static const unsigned char NO_MATERIAL = 0xFF;
+
+        /// Material index for each voxel (size-1)^3
+        private: std::vector<unsigned char> _materials;
+        /// [materialIndex*6 + t]
+        private: std::vector<LocalMatrix> _localK;
+
+        public : unsigned char material(const long voxel) const noexcept {
+            return _materials[voxel];}
+        public : const LocalMatrix & localK(const unsigned char material, const int t) const noexcept {
+            return _localK[material*6 + t];}
+
+        /// Local matrix of the element, nullptr if there is no material
+        public : const LocalMatrix * operator [] (const long element) const noexcept
+        {
+            unsigned char m = _materials[element/6];
+            return m == NO_MATERIAL ? nullptr : &_localK[m*6 + element%6];
+        }
+    };
+}
+
+#endif // LOCALSTIFFNESSCACHE
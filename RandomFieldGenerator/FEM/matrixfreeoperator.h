@@ -0,0 +1,98 @@
+#ifndef MATRIXFREEOPERATOR
+#define MATRIXFREEOPERATOR
+
+#include "localstiffnesscache.h"
+#include "slabpartition.h"
+
+#include <vector>
+
+namespace FEM
+{
+    template<int _DegreesOfFreedom_> class AbstractProblem;
+
+    /// Global stiffness matrix of the structured Domain, which is never stored.
+    /// The global K*u is calculated on the fly from per-voxel material indexes
+    /// and local matrices of LocalStiffnessCache.
+    /// Memory is proportional to nodes number, not to nonzeros number.
+    /// Dirichlet boundary conditions are applied in the same way as in
+    /// AbstractProblem::assembleSLAE(): rows and columns of fixed DOFs contain only diagonal.
+    /// Built by AbstractProblem::assembleMatrixFree()
+    template<int _DegreesOfFreedom_> class MatrixFreeOperator
+    {
+        friend class AbstractProblem<_DegreesOfFreedom_>;
+
+        public : typedef typename LocalStiffnessCache<_DegreesOfFreedom_>::LocalMatrix LocalMatrix;
+
+        /// Discrete size of the domain (nodes per axis)
+        private: int _size = 0;
+        /// Voxel materials and local matrices
+        private: LocalStiffnessCache<_DegreesOfFreedom_> _cache;
+        /// Global node indexes of tetrahedron t of the voxel (0,0,0)
+        private: long _nodeOffsets[6][4];
+        /// Dirichlet-fixed DOFs
+        private: std::vector<char> _fixed;
+        /// Diagonal of the global matrix for the fixed DOFs
+        private: std::vector<float> _fixedDiagonal;
+
+        public : long size() const noexcept {return (long)_size*_size*_size*_DegreesOfFreedom_;}
+        public : bool isFixed(const long dof) const noexcept {return _fixed[dof];}
+
+        /// Ku = K*u
+        /// Voxels are processed in parallel, see SlabPartition: every thread walks the
+        /// voxel layers touching its own nodes and writes only their rows,
+        /// so no locks are needed and the result doesn't depend on the number of threads
+        public : void apply(const std::vector<float> &u, std::vector<float> &Ku) const noexcept
+        {
+            const int n = _size - 1;
+            const int _localSize = 4*_DegreesOfFreedom_;
+            Ku.assign(size(), 0.0f);
+
+            #pragma omp parallel
+            {
+                const SlabPartition _part = SlabPartition::currentThread(_size);
+                for(int k=_part.firstCubeLayer; k<_part.lastCubeLayer; ++k)
+                    for(int j=0; j<n; ++j)
+                        for(int i=0; i<n; ++i)
+                        {
+                            unsigned char m = _cache.material(i + j*n + (long)k*n*n);
+                            if(m == LocalStiffnessCache<_DegreesOfFreedom_>::NO_MATERIAL) continue;
+
+                            long nodeIndex = i + j*(long)_size + k*(long)_size*_size;
+                            for(int t=0; t<6; ++t)
+                            {
+                                const float *K = _cache.localK(m,t).data();
+                                long dofs[4*_DegreesOfFreedom_];
+                                float uLocal[4*_DegreesOfFreedom_];
+                                bool owned[4];
+                                for(int v=0; v<4; ++v)
+                                {
+                                    owned[v] = _part.owns(nodeIndex + _nodeOffsets[t][v]);
+                                    for(int p=0; p<_DegreesOfFreedom_; ++p)
+                                    {
+                                        long dof = (nodeIndex + _nodeOffsets[t][v])*
+                                                _DegreesOfFreedom_ + p;
+                                        dofs[v*_DegreesOfFreedom_+p] = dof;
+                                        uLocal[v*_DegreesOfFreedom_+p] = _fixed[dof] ? 0.0f : u[dof];
+                                    }
+                                }
+                                for(int r=0; r<_localSize; ++r)
+                                {
+                                    if(!owned[r/_DegreesOfFreedom_]) continue;
+                                    float _sum = 0.0f;
+                                    for(int c=0; c<_localSize; ++c)
+                                        _sum += K[r*_localSize + c] * uLocal[c];
+                                    Ku[dofs[r]] += _sum;
+                                }
+                            }
+                        }
+            }
+
+            #pragma omp parallel for
+            for(long dof=0; dof<size(); ++dof)
+                if(_fixed[dof])
+                    Ku[dof] = _fixedDiagonal[dof] * u[dof];
+        }
+    };
+}
+
+#endif // MATRIXFREEOPERATOR
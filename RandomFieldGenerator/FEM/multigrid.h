@@ -0,0 +1,224 @@
+#ifndef MULTIGRID
+#define MULTIGRID
+
+#include "csrmatrix.h"
+
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include <Eigen/Dense>
+#include <Eigen/LU>
+
+namespace FEM
+{
+    /// Geometric multigrid V-cycle preconditioner for the structured Domain
+    /// (size^3 nodes, degreesOfFreedom unknowns per node, see AbstractProblem::assembleCSR()).
+    /// Coarse grids take every second node of the fine one (and the last node, because
+    /// RepresentativeVolumeElement size is a power of two, so the number of voxels is odd),
+    /// prolongation is trilinear interpolation on nodes, restriction is its transpose.
+    /// Coarse operators are Galerkin products R*A*P, which coarsen the materials
+    /// (and boundary conditions) consistently, also for high contrast phases.
+    /// Smoother is Gauss-Seidel: forward before and backward after the coarse correction,
+    /// so the V-cycle is symmetric and can be used in PCG.
+    /// The coarsest system is solved by dense LU.
+    class GeometricMultigrid
+    {
+        private: struct Level
+        {
+            /// Nodes per axis
+            int size;
+            /// Own matrix of the coarse levels, the finest one is not copied
+            CSRMatrix A;
+            const CSRMatrix *ptrToA;
+            /// Interpolation from the next (coarser) level
+            CSRMatrix P;
+            CSRMatrix R;
+            std::vector<float> invDiagonal;
+            mutable std::vector<float> x;
+            mutable std::vector<float> b;
+            mutable std::vector<float> r;
+        };
+        private: std::vector<Level> _levels;
+        private: int _degreesOfFreedom;
+        private: int _preSmoothingSteps;
+        private: int _postSmoothingSteps;
+        private: Eigen::PartialPivLU<Eigen::MatrixXd> _coarsestLU;
+
+        public : int levelsNum() const noexcept {return _levels.size();}
+        public : const CSRMatrix & levelMatrix(const int level) const noexcept {
+            return *_levels[level].ptrToA;}
+
+        /// A - matrix of the fine grid, should live longer than the preconditioner
+        /// coarsestSize - maximum nodes per axis of the coarsest grid
+        public : GeometricMultigrid(
+                const CSRMatrix &A,
+                const int size,
+                const int degreesOfFreedom,
+                const int preSmoothingSteps = 2,
+                const int postSmoothingSteps = 2,
+                const int coarsestSize = 5) :
+            _degreesOfFreedom(degreesOfFreedom),
+            _preSmoothingSteps(preSmoothingSteps),
+            _postSmoothingSteps(postSmoothingSteps)
+        {
+            if((long)size*size*size*degreesOfFreedom != A.rows)
+                throw(std::runtime_error("GeometricMultigrid(): wrong matrix size"));
+
+            _levels.push_back(Level());
+            _levels.back().size = size;
+            _levels.back().ptrToA = &A;
+
+            while(_levels.back().size > coarsestSize)
+            {
+                Level &_fine = _levels.back();
+                int _coarseSize = _fine.size / 2 + 1;
+                _fine.P = _interpolation(_fine.size);
+                _fine.R = _fine.P.transpose();
+
+                Level _coarse;
+                _coarse.size = _coarseSize;
+                _coarse.A = _fine.R.multiply(_fine.ptrToA->multiply(_fine.P));
+                _levels.push_back(_coarse);
+                _levels.back().ptrToA = &_levels.back().A;
+            }
+            // Pointers to own matrices are invalidated by vector reallocation
+            for(unsigned l=1; l<_levels.size(); ++l)
+                _levels[l].ptrToA = &_levels[l].A;
+
+            for(Level &_level : _levels)
+            {
+                const CSRMatrix &_A = *_level.ptrToA;
+                _level.invDiagonal.assign(_A.rows, 0.0f);
+                for(unsigned i=0; i<_A.rows; ++i)
+                    for(unsigned p=_A.rowPtr[i]; p<_A.rowPtr[i+1]; ++p)
+                        if(_A.columns[p] == i && _A.values[p] != 0.0f)
+                            _level.invDiagonal[i] = 1.0f / _A.values[p];
+                _level.x.resize(_A.rows);
+                _level.b.resize(_A.rows);
+                _level.r.resize(_A.rows);
+            }
+
+            const CSRMatrix &_coarsestA = *_levels.back().ptrToA;
+            Eigen::MatrixXd _dense = Eigen::MatrixXd::Zero(_coarsestA.rows, _coarsestA.rows);
+            for(unsigned i=0; i<_coarsestA.rows; ++i)
+                for(unsigned p=_coarsestA.rowPtr[i]; p<_coarsestA.rowPtr[i+1]; ++p)
+                    _dense(i, _coarsestA.columns[p]) = _coarsestA.values[p];
+            _coarsestLU.compute(_dense);
+        }
+
+        /// Trilinear interpolation from the coarse nodes (fine nodes 0,2,4,...,last)
+        private: CSRMatrix _interpolation(const int fineSize) const
+        {
+            const int _coarseSize = fineSize / 2 + 1;
+            // 1D weights: fine node -> up to 2 (coarse node, weight)
+            std::vector<int> _c0(fineSize), _c1(fineSize);
+            std::vector<float> _w0(fineSize), _w1(fineSize);
+            for(int x=0; x<fineSize; ++x)
+            {
+                if(x % 2 == 0)          {_c0[x] = x/2;              _w0[x] = 1.0f; _w1[x] = 0.0f;}
+                else if(x == fineSize-1){_c0[x] = _coarseSize-1;    _w0[x] = 1.0f; _w1[x] = 0.0f;}
+                else                    {_c0[x] = (x-1)/2;          _w0[x] = 0.5f;
+                                         _c1[x] = (x+1)/2;          _w1[x] = 0.5f;}
+            }
+
+            CSRMatrix _P;
+            _P.rows = (long)fineSize*fineSize*fineSize*_degreesOfFreedom;
+            _P.cols = (long)_coarseSize*_coarseSize*_coarseSize*_degreesOfFreedom;
+            _P.rowPtr.reserve(_P.rows + 1);
+            _P.rowPtr.push_back(0);
+            for(int k=0; k<fineSize; ++k)
+                for(int j=0; j<fineSize; ++j)
+                    for(int i=0; i<fineSize; ++i)
+                        for(int p=0; p<_degreesOfFreedom; ++p)
+                        {
+                            // Columns are sorted, because c0 < c1
+                            for(int ck=0; ck<2; ++ck)
+                            {
+                                float wk = ck ? _w1[k] : _w0[k];
+                                if(wk == 0.0f) continue;
+                                int zk = ck ? _c1[k] : _c0[k];
+                                for(int cj=0; cj<2; ++cj)
+                                {
+                                    float wj = cj ? _w1[j] : _w0[j];
+                                    if(wj == 0.0f) continue;
+                                    int zj = cj ? _c1[j] : _c0[j];
+                                    for(int ci=0; ci<2; ++ci)
+                                    {
+                                        float wi = ci ? _w1[i] : _w0[i];
+                                        if(wi == 0.0f) continue;
+                                        int zi = ci ? _c1[i] : _c0[i];
+                                        long node = zi + (long)zj*_coarseSize +
+                                                (long)zk*_coarseSize*_coarseSize;
+                                        _P.columns.push_back(node*_degreesOfFreedom + p);
+                                        _P.values.push_back(wi*wj*wk);
+                                    }
+                                }
+                            }
+                            _P.rowPtr.push_back(_P.columns.size());
+                        }
+            return _P;
+        }
+
+        /// One Gauss-Seidel sweep, forward or backward
+        private: static void _smooth(
+                const CSRMatrix &A,
+                const std::vector<float> &invDiagonal,
+                const std::vector<float> &b,
+                std::vector<float> &x,
+                const bool forward) noexcept
+        {
+            for(long n=0; n<(long)A.rows; ++n)
+            {
+                long i = forward ? n : A.rows - 1 - n;
+                float _sum = b[i];
+                for(unsigned p=A.rowPtr[i]; p<A.rowPtr[i+1]; ++p)
+                    if(A.columns[p] != (unsigned)i)
+                        _sum -= A.values[p] * x[A.columns[p]];
+                x[i] = _sum * invDiagonal[i];
+            }
+        }
+
+        private: void _VCycle(const int level) const
+        {
+            const Level &_level = _levels[level];
+            const CSRMatrix &_A = *_level.ptrToA;
+
+            if(level == (int)_levels.size()-1)
+            {
+                Eigen::VectorXd _b(_A.rows);
+                for(unsigned i=0; i<_A.rows; ++i) _b(i) = _level.b[i];
+                Eigen::VectorXd _x = _coarsestLU.solve(_b);
+                for(unsigned i=0; i<_A.rows; ++i) _level.x[i] = _x(i);
+                return;
+            }
+
+            std::fill(_level.x.begin(), _level.x.end(), 0.0f);
+            for(int s=0; s<_preSmoothingSteps; ++s)
+                _smooth(_A, _level.invDiagonal, _level.b, _level.x, true);
+
+            _A.multiply(_level.x, _level.r);
+            for(unsigned i=0; i<_A.rows; ++i)
+                _level.r[i] = _level.b[i] - _level.r[i];
+
+            const Level &_coarse = _levels[level+1];
+            _level.R.multiply(_level.r, _coarse.b);
+            _VCycle(level+1);
+            _level.P.multiply(_coarse.x, _level.r);
+            for(unsigned i=0; i<_A.rows; ++i)
+                _level.x[i] += _level.r[i];
+
+            for(int s=0; s<_postSmoothingSteps; ++s)
+                _smooth(_A, _level.invDiagonal, _level.b, _level.x, false);
+        }
+
+        /// z = M^-1 * r, one V-cycle from zero initial guess
+        public : void apply(const std::vector<float> &r, std::vector<float> &z) const
+        {
+            _levels[0].b = r;
+            _VCycle(0);
+            z = _levels[0].x;
+        }
+    };
+}
+
+#endif // MULTIGRID
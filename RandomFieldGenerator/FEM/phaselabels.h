@@ -0,0 +1,118 @@
+#ifndef PHASELABELS
+#define PHASELABELS
+
+#include "parallelfor.h"
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+namespace FEM
+{
+    /// Segmented RVE: phase (material) index of each voxel, built once from the intensities
+    /// by Domain::segment(), so the FEM side doesn't compare intensities with material
+    /// intervals for every element.
+    /// One byte per voxel (4 times less than float data), or one bit per voxel
+    /// (32 times less) if there are at most two phases and every voxel has a phase.
+    /// Labels are indexed as RVE data, i + j*size + k*size*size.
+    class PhaseLabels
+    {
+        /// Voxel out of all phases
+        public : static const uint8_t NO_PHASE = 0xFF;
+
+        private: long _n = 0;
+        private: bool _packed = false;
+        private: std::vector<uint8_t> _labels;
+        private: std::vector<uint64_t> _bits;
+        /// Voxels number of each phase, the last one is NO_PHASE
+        private: std::vector<long> _counts;
+
+        public : long size() const noexcept {return _n;}
+        public : bool empty() const noexcept {return _n == 0;}
+        public : bool isPacked() const noexcept {return _packed;}
+        public : int phasesNum() const noexcept {return _counts.empty() ? 0 : _counts.size() - 1;}
+        public : long count(const int phase) const noexcept {return _counts[phase];}
+        public : long unlabeledNum() const noexcept {return _counts.back();}
+        /// Memory used by labels
+        public : long bytes() const noexcept {
+            return _labels.size() * sizeof(uint8_t) + _bits.size() * sizeof(uint64_t);}
+
+        public : uint8_t operator [] (const long index) const noexcept {
+            return _packed ? (uint8_t)((_bits[index >> 6] >> (index & 63)) & 1) : _labels[index];}
+
+        public : PhaseLabels() noexcept {}
+
+        /// classify(index) -> phase in [0, phasesNum), or -1 if the voxel is out of phases.
+        /// If pack, at most two phases are packed into bits, but if some voxel has no phase,
+        /// bytes are used
+        public : template<typename _Classify_> PhaseLabels(
+                const long n,
+                const int phasesNum,
+                const _Classify_ &classify,
+                const bool pack = true) : _n(n)
+        {
+            if(phasesNum >= NO_PHASE)
+                throw(std::runtime_error("PhaseLabels(): too many phases"));
+
+            typedef std::vector<long> _Counts;
+            const auto _join = [](const _Counts &a, const _Counts &b) -> _Counts {
+                _Counts _sum(a);
+                for(unsigned p=0; p<_sum.size(); ++p)
+                    _sum[p] += b[p];
+                return _sum;};
+
+            if(pack && phasesNum <= 2)
+            {
+                _bits.resize((n + 63) / 64);
+                // Blocks of whole words, so threads don't share words
+                _counts = Parallel::reduce(
+                            (long)_bits.size(), _Counts(phasesNum + 1, 0),
+                            [&](const long begin, const long end) -> _Counts {
+                                _Counts _partCounts(phasesNum + 1, 0);
+                                for(long w = begin; w < end; ++w)
+                                {
+                                    uint64_t _word = 0;
+                                    const long _last = std::min((w + 1) * 64, n);
+                                    for(long i = w * 64; i < _last; ++i)
+                                    {
+                                        const int _phase = classify(i);
+                                        if(_phase < 0)
+                                        {
+                                            // Can't be packed, it is enough to know this
+                                            ++_partCounts[phasesNum];
+                                            return _partCounts;
+                                        }
+                                        ++_partCounts[_phase];
+                                        _word |= (uint64_t)_phase << (i - w * 64);
+                                    }
+                                    _bits[w] = _word;
+                                }
+                                return _partCounts;},
+                            _join);
+                if(_counts[phasesNum] == 0)
+                {
+                    _packed = true;
+                    return;
+                }
+                std::vector<uint64_t>().swap(_bits);
+            }
+
+            _labels.resize(n);
+            _counts = Parallel::reduce(
+                        n, _Counts(phasesNum + 1, 0),
+                        [&](const long begin, const long end) -> _Counts {
+                            _Counts _partCounts(phasesNum + 1, 0);
+                            for(long i = begin; i < end; ++i)
+                            {
+                                const int _phase = classify(i);
+                                _labels[i] = _phase < 0 ? NO_PHASE : (uint8_t)_phase;
+                                ++_partCounts[_phase < 0 ? phasesNum : _phase];
+                            }
+                            return _partCounts;},
+                        _join);
+        }
+    };
+}
+
+#endif // PHASELABELS
@@ -0,0 +1,146 @@
+#ifndef PRECONDITIONERS
+#define PRECONDITIONERS
+
+#include "csrmatrix.h"
+
+#include <vector>
+#include <Eigen/Dense>
+#include <Eigen/LU>
+
+namespace FEM
+{
+    /// Host side preconditioners for IterativeSolvers, z = M^-1 * r
+    /// (see also GeometricMultigrid)
+    /// Matrix should live longer than the preconditioner
+
+    /// M = diag(A)
+    class JacobiPreconditioner
+    {
+        private: std::vector<float> _invDiagonal;
+
+        public : JacobiPreconditioner(const CSRMatrix &A)
+        {
+            _invDiagonal.assign(A.rows, 1.0f);
+            for(unsigned i=0; i<A.rows; ++i)
+                for(unsigned p=A.rowPtr[i]; p<A.rowPtr[i+1]; ++p)
+                    if(A.columns[p] == i && A.values[p] != 0.0f)
+                        _invDiagonal[i] = 1.0f / A.values[p];
+        }
+
+        public : void apply(const std::vector<float> &r, std::vector<float> &z) const noexcept
+        {
+            z.resize(r.size());
+            for(unsigned long i=0; i<r.size(); ++i)
+                z[i] = _invDiagonal[i] * r[i];
+        }
+    };
+
+    /// M = blockdiag(A), one block per node, blockSize = degrees of freedom,
+    /// so coupling of displacements (and temperature) in the node is kept
+    class BlockJacobiPreconditioner
+    {
+        private: int _blockSize;
+        private: std::vector<float> _invBlocks;
+
+        public : BlockJacobiPreconditioner(const CSRMatrix &A, const int blockSize) :
+            _blockSize(blockSize)
+        {
+            const long _blocksNum = A.rows / blockSize;
+            _invBlocks.assign(_blocksNum*blockSize*blockSize, 0.0f);
+            #pragma omp parallel for
+            for(long b=0; b<_blocksNum; ++b)
+            {
+                Eigen::MatrixXd _block = Eigen::MatrixXd::Zero(blockSize, blockSize);
+                for(int i=0; i<blockSize; ++i)
+                {
+                    unsigned row = b*blockSize + i;
+                    for(unsigned p=A.rowPtr[row]; p<A.rowPtr[row+1]; ++p)
+                        if(A.columns[p] >= b*blockSize && A.columns[p] < (b+1)*blockSize)
+                            _block(i, A.columns[p] - b*blockSize) = A.values[p];
+                    // Node without material
+                    if(_block(i,i) == 0.0) _block(i,i) = 1.0;
+                }
+                Eigen::MatrixXd _inv = _block.inverse();
+                for(int i=0; i<blockSize; ++i)
+                    for(int j=0; j<blockSize; ++j)
+                        _invBlocks[(b*blockSize + i)*blockSize + j] = _inv(i,j);
+            }
+        }
+
+        public : void apply(const std::vector<float> &r, std::vector<float> &z) const noexcept
+        {
+            z.resize(r.size());
+            const long _blocksNum = r.size() / _blockSize;
+            #pragma omp parallel for
+            for(long b=0; b<_blocksNum; ++b)
+                for(int i=0; i<_blockSize; ++i)
+                {
+                    float _sum = 0.0f;
+                    for(int j=0; j<_blockSize; ++j)
+                        _sum += _invBlocks[(b*_blockSize + i)*_blockSize + j] * r[b*_blockSize + j];
+                    z[b*_blockSize + i] = _sum;
+                }
+        }
+    };
+
+    /// Incomplete LU without fill-in, M = L*U on the pattern of A
+    class ILU0Preconditioner
+    {
+        private: const CSRMatrix &_A;
+        private: std::vector<float> _LU;
+        private: std::vector<unsigned> _diagonalPos;
+
+        public : ILU0Preconditioner(const CSRMatrix &A) : _A(A), _LU(A.values)
+        {
+            _diagonalPos.resize(A.rows);
+            for(unsigned i=0; i<A.rows; ++i)
+                for(unsigned p=A.rowPtr[i]; p<A.rowPtr[i+1]; ++p)
+                    if(A.columns[p] == i)
+                        _diagonalPos[i] = p;
+
+            std::vector<long> _posInRow(A.rows, -1);
+            for(unsigned i=0; i<A.rows; ++i)
+            {
+                for(unsigned p=A.rowPtr[i]; p<A.rowPtr[i+1]; ++p)
+                    _posInRow[A.columns[p]] = p;
+
+                for(unsigned p=A.rowPtr[i]; p<A.rowPtr[i+1] && A.columns[p] < i; ++p)
+                {
+                    unsigned k = A.columns[p];
+                    _LU[p] /= _LU[_diagonalPos[k]];
+                    for(unsigned q=_diagonalPos[k]+1; q<A.rowPtr[k+1]; ++q)
+                        if(_posInRow[A.columns[q]] >= 0)
+                            _LU[_posInRow[A.columns[q]]] -= _LU[p] * _LU[q];
+                }
+                // Node without material
+                if(_LU[_diagonalPos[i]] == 0.0f) _LU[_diagonalPos[i]] = 1.0f;
+
+                for(unsigned p=A.rowPtr[i]; p<A.rowPtr[i+1]; ++p)
+                    _posInRow[A.columns[p]] = -1;
+            }
+        }
+
+        public : void apply(const std::vector<float> &r, std::vector<float> &z) const noexcept
+        {
+            z.resize(r.size());
+            // L*y = r, unit diagonal
+            for(unsigned i=0; i<_A.rows; ++i)
+            {
+                float _sum = r[i];
+                for(unsigned p=_A.rowPtr[i]; p<_diagonalPos[i]; ++p)
+                    _sum -= _LU[p] * z[_A.columns[p]];
+                z[i] = _sum;
+            }
+            // U*z = y
+            for(long i=_A.rows-1; i>=0; --i)
+            {
+                float _sum = z[i];
+                for(unsigned p=_diagonalPos[i]+1; p<_A.rowPtr[i+1]; ++p)
+                    _sum -= _LU[p] * z[_A.columns[p]];
+                z[i] = _sum / _LU[_diagonalPos[i]];
+            }
+        }
+    };
+}
+
+#endif // PRECONDITIONERS
@@ -2,20 +2,33 @@
 #define PROBLEM
 
 #include "matrix.h"
+#include "fixedmatrix.h"
 #include "domain.h"
 
 #include "staticconstants.h"
 #include "jacobimatrix.h"
+#include "matrixfreeoperator.h"
+#include "csrmatrix.h"
+#include "slabpartition.h"
+#include "multigrid.h"
+#include "iterativesolvers.h"
+#include "preconditioners.h"
+#include "directsolver.h"
+#include "solverconfiguration.h"
 
+#include "stressfield.h"
 #include "timer.h"
 
 #include <map>
+#include <algorithm>
 
 #include <viennacl/compressed_matrix.hpp>
 #include <viennacl/vector.hpp>
 #include <viennacl/linalg/cg.hpp>
 #include <viennacl/linalg/bicgstab.hpp>
 #include <viennacl/linalg/gmres.hpp>
+#include <viennacl/linalg/jacobi_precond.hpp>
+#include <viennacl/linalg/ilu.hpp>
 
 /// \todo refactoring
 namespace FEM
@@ -39,6 +52,8 @@ namespace FEM
         };
         public : BoundaryCondition *NeumannBCs[6];
         public : BoundaryCondition *DirichletBCs[6];
+        /// Periodic axes: 0 - LEFT-RIGHT, 1 - TOP-BOTTOM, 2 - FRONT-BACK
+        public : bool PeriodicBCs[3];
         public : BoundaryConditionsManager() noexcept
         {
             for(int i=0; i<6; ++i)
@@ -46,6 +61,8 @@ namespace FEM
                 NeumannBCs[i] = nullptr;
                 DirichletBCs[i] = nullptr;
             }
+            for(int i=0; i<3; ++i)
+                PeriodicBCs[i] = false;
         }
         public : void addNeumannBC(const SIDES side, const std::initializer_list<float> val)
         {
@@ -57,6 +74,16 @@ namespace FEM
             BoundaryCondition *newBC = new BoundaryCondition(val);
             DirichletBCs[side]=newBC;
         }
+        /// The side and the opposite one are periodic, i.e. their nodes are the same
+        /// (see AbstractProblem::condensedNode()). These sides can't have other conditions
+        public : void addPeriodicBC(const SIDES side) noexcept
+        {
+            PeriodicBCs[(side == LEFT || side == RIGHT) ? 0 :
+                        (side == TOP || side == BOTTOM) ? 1 : 2] = true;
+        }
+        public : bool isPeriodic(const int axis) const noexcept {return PeriodicBCs[axis];}
+        public : bool isPeriodic() const noexcept {
+            return PeriodicBCs[0] || PeriodicBCs[1] || PeriodicBCs[2];}
         public : void cleanBCs() noexcept
         {
             for(int i=0; i<6; ++i)
@@ -72,6 +99,8 @@ namespace FEM
                     DirichletBCs[i] = nullptr;
                 }
             }
+            for(int i=0; i<3; ++i)
+                PeriodicBCs[i] = false;
         }
         public : ~BoundaryConditionsManager() noexcept
         {
@@ -88,7 +117,7 @@ namespace FEM
         /// need this because KM() and DM() are static
         private  : virtual inline void _assembleLocalK(
             const FixedTetrahedron &element,
-            MathUtils::Matrix::StaticMatrix<
+            MathUtils::Matrix::FixedMatrix<
                 float,4*_DegreesOfFreedom_,4*_DegreesOfFreedom_> &output
             ) noexcept = 0;
 
@@ -104,8 +133,8 @@ namespace FEM
         public   : static inline void applyLocalDirichletConditions(
                 int i,
                 const float u0,
-                MathUtils::Matrix::StaticMatrix<float,4*_DegreesOfFreedom_,4*_DegreesOfFreedom_> &K,
-                MathUtils::Matrix::StaticMatrix<float,4*_DegreesOfFreedom_,1> &f
+                MathUtils::Matrix::FixedMatrix<float,4*_DegreesOfFreedom_,4*_DegreesOfFreedom_> &K,
+                MathUtils::Matrix::FixedMatrix<float,4*_DegreesOfFreedom_,1> &f
                 ) noexcept
         {
             // push(K[i][i])
@@ -138,7 +167,7 @@ namespace FEM
                 const NODES_TRIPLET mask,
                 const int dimOffset,    // for vector fields 0 - fx, 1 - fy, 2 - fz
                 const float qA_3,       // flux * facet area / 3
-                MathUtils::Matrix::StaticMatrix<float,4*_DegreesOfFreedom_,1> &f
+                MathUtils::Matrix::FixedMatrix<float,4*_DegreesOfFreedom_,1> &f
                 ) noexcept
         {
             switch (mask) {
@@ -164,130 +193,741 @@ namespace FEM
                 break;
             }
         }
+        /// Axis and coordinate of the domain side, see assembleSLAE()
+        protected: int _sideAxis(const int side) const noexcept
+        {
+            switch (side) {
+            case TOP:    return 1;
+            case BOTTOM: return 1;
+            case LEFT:   return 0;
+            case RIGHT:  return 0;
+            case FRONT:  return 2;
+            case BACK:   return 2;
+            }
+            return 0;
+        }
+        protected: float _sideCoordinate(const int side) const noexcept
+        {
+            switch (side) {
+            case TOP:    return _domain.size();
+            case RIGHT:  return _domain.size();
+            case BACK:   return _domain.size();
+            }
+            return 0;
+        }
+
+        /// Neumann boundary conditions of the element
+        protected: void _applyNeumannBCs(
+                const FixedTetrahedron &element,
+                MathUtils::Matrix::FixedMatrix<float,4*_DegreesOfFreedom_,1> &f
+                ) const noexcept
+        {
+            NODES_TRIPLET triplet;
+            float _A_3 = _domain.fixedTetrahedronSideArea()/3.0;
+            // TOP, BOTTOM, LEFT, RIGHT, FRONT, BACK
+            for(int side=0; side<6; ++side)
+                if(BCManager.NeumannBCs[side] &&
+                        element.isOnSide(_sideAxis(side),_sideCoordinate(side),triplet))
+                    for(int i=0; i<_DegreesOfFreedom_; ++i)
+                        if(!BCManager.NeumannBCs[side]->isVoid(i))
+                            applyLocalNeumannConditions(
+                                        triplet,i,BCManager.NeumannBCs[side]->c(i)*_A_3,f);
+        }
+
+        /// Dirichlet boundary conditions of the element
+        /// fixedMask (if given) marks local DOFs, which are fixed
+        protected: void _applyDirichletBCs(
+                const FixedTetrahedron &element,
+                MathUtils::Matrix::FixedMatrix<float,4*_DegreesOfFreedom_,4*_DegreesOfFreedom_> &K,
+                MathUtils::Matrix::FixedMatrix<float,4*_DegreesOfFreedom_,1> &f,
+                bool *fixedMask = nullptr
+                ) const noexcept
+        {
+            // TOP, BOTTOM, LEFT, RIGHT, FRONT, BACK
+            for(int side=0; side<6; ++side)
+                for(int i=0; i<4; ++i)
+                    if(BCManager.DirichletBCs[side] &&
+                            element[i][_sideAxis(side)] == _sideCoordinate(side))
+                        for(int j=0; j<_DegreesOfFreedom_; ++j)
+                            if(!BCManager.DirichletBCs[side]->isVoid(j))
+                            {
+                                applyLocalDirichletConditions(
+                                            i*_DegreesOfFreedom_+j,
+                                            BCManager.DirichletBCs[side]->c(j),K,f);
+                                if(fixedMask) fixedMask[i*_DegreesOfFreedom_+j] = true;
+                            }
+        }
+
+        /// Local matrices are calculated only for the voxel (0,0,0), see LocalStiffnessCache
+        public : void buildLocalStiffnessCache(LocalStiffnessCache<_DegreesOfFreedom_> &cache)
+        {
+            if(_domain.MaterialsVector.size() >= LocalStiffnessCache<_DegreesOfFreedom_>::NO_MATERIAL)
+                throw(std::runtime_error("buildLocalStiffnessCache(): too many materials"));
+
+            cache._localK.resize(_domain.MaterialsVector.size()*6);
+            for(int t=0; t<6; ++t)
+            {
+                FixedTetrahedron element = _domain[t];
+                for(unsigned m=0; m<_domain.MaterialsVector.size(); ++m)
+                {
+                    element.characteristics = &_domain.MaterialsVector[m].characteristics;
+                    _assembleLocalK(element, cache._localK[m*6 + t]);
+                }
+            }
+
+            int n = _domain.discreteSize() - 1;
+            cache._materials.resize((long)n*n*n);
+            #pragma omp parallel for
+            for(int k=0; k<n; ++k)
+                for(int j=0; j<n; ++j)
+                    for(int i=0; i<n; ++i)
+                    {
+                        int m = _domain.materialIndex(i,j,k);
+                        cache._materials[i + j*n + (long)k*n*n] = m < 0 ?
+                                    LocalStiffnessCache<_DegreesOfFreedom_>::NO_MATERIAL : m;
+                    }
+        }
+        /// Copy of the cached local matrix, zero if there is no material
+        protected: static inline void _cachedLocalK(
+                const LocalStiffnessCache<_DegreesOfFreedom_> &cache,
+                const long element,
+                MathUtils::Matrix::FixedMatrix<float,4*_DegreesOfFreedom_,4*_DegreesOfFreedom_> &output
+                ) noexcept
+        {
+            const auto *_localK = cache[element];
+            if(_localK)
+                output = *_localK;
+            else
+                for(int i=0; i<16*_DegreesOfFreedom_*_DegreesOfFreedom_; ++i)
+                    output.data()[i] = 0;
+        }
+
+        /// Elements are processed in parallel, see SlabPartition
         public: void assembleSLAE(
             std::vector<std::map<long, float>> &sparseMatrix,
-            std::vector< float > &loads) noexcept
+            std::vector< float > &loads)
         {
-            for(long el=0; el< _domain.elementsNum(); ++el)
+            if(BCManager.isPeriodic())
+                throw(std::runtime_error("assembleSLAE(): periodic conditions are not supported, "
+                                         "use assembleCSR()"));
+
+            LocalStiffnessCache<_DegreesOfFreedom_> _cache;
+            buildLocalStiffnessCache(_cache);
+
+            const long _layerElementsNum = _domain.elementsNum() / (_domain.discreteSize()-1);
+            #pragma omp parallel
             {
-                const FixedTetrahedron element = _domain[el];
+                const SlabPartition _part = SlabPartition::currentThread(_domain.discreteSize());
+                for(long el=_part.firstCubeLayer*_layerElementsNum;
+                    el<_part.lastCubeLayer*_layerElementsNum; ++el)
+                {
+                    const FixedTetrahedron element = _domain[el];
+
+                    MathUtils::Matrix::FixedMatrix<float,4*_DegreesOfFreedom_,4*_DegreesOfFreedom_> K;
+                    MathUtils::Matrix::FixedMatrix<float,4*_DegreesOfFreedom_,1> f;
+                    for(int i=0; i<4*_DegreesOfFreedom_; ++i) f(i,0)=0;
 
-                MathUtils::Matrix::StaticMatrix<float,4*_DegreesOfFreedom_,4*_DegreesOfFreedom_> K;
-                MathUtils::Matrix::StaticMatrix<float,4*_DegreesOfFreedom_,1> f;
-                for(int i=0; i<4*_DegreesOfFreedom_; ++i) f(i,0)=0;
+                    _cachedLocalK(_cache, el, K);
+
+                    _applyNeumannBCs(element,f);
+
+                    _applyDirichletBCs(element,K,f);
+
+                    // Add local matrices to global
+                    for(long i=0; i<4; ++i)
+                    {
+                        if(!_part.owns(element.indexes[i])) continue;
+                        for(long j=0; j<4; ++j)
+                            for(long p=0; p<_DegreesOfFreedom_; ++p)
+                                for(long q=0; q<_DegreesOfFreedom_; ++q)
+                                    if(K(i*_DegreesOfFreedom_+p,j*_DegreesOfFreedom_+q) != 0)
+                                        sparseMatrix[element.indexes[i]*_DegreesOfFreedom_+p]
+                                                [element.indexes[j]*_DegreesOfFreedom_+q] +=
+                                                K(i*_DegreesOfFreedom_+p,j*_DegreesOfFreedom_+q);
+                        for(long p=0; p<_DegreesOfFreedom_; ++p)
+                            loads[element.indexes[i]*_DegreesOfFreedom_+p] +=
+                                    f(i*_DegreesOfFreedom_+p,0);
+                    }
+                }
+            }
+        }
+        /// Two-pass assembly straight into CSR, without std::map rows.
+        /// The matrix is the same as in assembleSLAE() (local matrices are scattered
+        /// in the same order), but it also stores structural zeros.
+        /// Symbolic pass: on the structured Domain the node is connected only to some
+        /// of its 26 neighbours, so the row pattern is a 27-bit mask of neighbour offsets,
+        /// bit = (dx+1) + 3*(dy+1) + 9*(dz+1). Columns are sorted, because the bits are.
+        /// Numeric pass: position of the (node, neighbour) block is the number of lower bits.
+        /// With periodic conditions the system is condensed, see _assembleCondensed()
+        public : void assembleCSR(CSRMatrix &K, std::vector<float> &loads)
+        {
+            if(BCManager.isPeriodic())
+            {
+                _assembleCondensed(BCManager.PeriodicBCs, &K, loads);
+                return;
+            }
 
-                _assembleLocalK(element,K);
+            const int size = _domain.discreteSize();
+            const int n = size - 1;
+            const long nodesNum = _domain.nodesNum();
 
-                // Neumann boundary conditions
+            // Neighbour bits of the local nodes pairs for each tetrahedron type
+            long nodeOffsets[6][4];
+            int neighbourBits[6][4][4];
+            for(int t=0; t<6; ++t)
+            {
+                const FixedTetrahedron element = _domain[t];
+                for(int a=0; a<4; ++a)
+                    nodeOffsets[t][a] = element.indexes[a];
+                for(int a=0; a<4; ++a)
+                    for(int b=0; b<4; ++b)
+                    {
+                        long ia = element.indexes[a];
+                        long ib = element.indexes[b];
+                        int dx = ib % size - ia % size;
+                        int dy = ib / size % size - ia / size % size;
+                        int dz = ib / size / size - ia / size / size;
+                        neighbourBits[t][a][b] = (dx+1) + 3*(dy+1) + 9*(dz+1);
+                    }
+            }
+
+            // Symbolic pass
+            std::vector<unsigned> masks(nodesNum, 0);
+            #pragma omp parallel
+            {
+                const SlabPartition _part = SlabPartition::currentThread(size);
+                for(long cube=(long)_part.firstCubeLayer*n*n; cube<(long)_part.lastCubeLayer*n*n; ++cube)
                 {
-                    NODES_TRIPLET triplet;
-                    float _A_3 = _domain.fixedTetrahedronSideArea()/3.0;
-                    // TOP
-                    if(BCManager.NeumannBCs[TOP] && element.isOnSide(1,_domain.size(),triplet))
-                        for(int i=0; i<_DegreesOfFreedom_; ++i)
-                            if(!BCManager.NeumannBCs[TOP]->isVoid(i))
-                                applyLocalNeumannConditions(
-                                            triplet,i,BCManager.NeumannBCs[TOP]->c(i)*_A_3,f);
-                    // BOTTOM
-                    if(BCManager.NeumannBCs[BOTTOM] && element.isOnSide(1,0,triplet))
-                        for(int i=0; i<_DegreesOfFreedom_; ++i)
-                            if(!BCManager.NeumannBCs[BOTTOM]->isVoid(i))
-                                applyLocalNeumannConditions(
-                                            triplet,i,BCManager.NeumannBCs[BOTTOM]->c(i)*_A_3,f);
-                    // LEFT
-                    if(BCManager.NeumannBCs[LEFT] && element.isOnSide(0,0,triplet))
-                        for(int i=0; i<_DegreesOfFreedom_; ++i)
-                            if(!BCManager.NeumannBCs[LEFT]->isVoid(i))
-                                applyLocalNeumannConditions(
-                                            triplet,i,BCManager.NeumannBCs[LEFT]->c(i)*_A_3,f);
-                    // RIGHT
-                    if(BCManager.NeumannBCs[RIGHT] && element.isOnSide(0,_domain.size(),triplet))
-                        for(int i=0; i<_DegreesOfFreedom_; ++i)
-                            if(!BCManager.NeumannBCs[RIGHT]->isVoid(i))
-                                applyLocalNeumannConditions(
-                                            triplet,i,BCManager.NeumannBCs[RIGHT]->c(i)*_A_3,f);
-                    // FRONT
-                    if(BCManager.NeumannBCs[FRONT] && element.isOnSide(2,0,triplet))
-                        for(int i=0; i<_DegreesOfFreedom_; ++i)
-                            if(!BCManager.NeumannBCs[FRONT]->isVoid(i))
-                                applyLocalNeumannConditions(
-                                            triplet,i,BCManager.NeumannBCs[FRONT]->c(i)*_A_3,f);
-                    // BACK
-                    if(BCManager.NeumannBCs[BACK] && element.isOnSide(2,_domain.size(),triplet))
-                        for(int i=0; i<_DegreesOfFreedom_; ++i)
-                            if(!BCManager.NeumannBCs[BACK]->isVoid(i))
-                                applyLocalNeumannConditions(
-                                            triplet,i,BCManager.NeumannBCs[BACK]->c(i)*_A_3,f);
+                    long nodeIndex = cube % n + cube / n % n * size + cube / n / n * size * size;
+                    for(int t=0; t<6; ++t)
+                        for(int a=0; a<4; ++a)
+                            if(_part.owns(nodeIndex + nodeOffsets[t][a]))
+                                for(int b=0; b<4; ++b)
+                                    masks[nodeIndex + nodeOffsets[t][a]] |=
+                                            1u << neighbourBits[t][a][b];
                 }
+            }
+
+            K.rows = nodesNum * _DegreesOfFreedom_;
+            K.cols = K.rows;
+            K.rowPtr.resize(K.rows + 1);
+            K.rowPtr[0] = 0;
+            for(long node=0; node<nodesNum; ++node)
+                for(int p=0; p<_DegreesOfFreedom_; ++p)
+                    K.rowPtr[node*_DegreesOfFreedom_+p+1] = K.rowPtr[node*_DegreesOfFreedom_+p] +
+                            __builtin_popcount(masks[node]) * _DegreesOfFreedom_;
 
-                // Dirichlet boundary conditions
+            K.columns.resize(K.rowPtr[K.rows]);
+            K.values.assign(K.rowPtr[K.rows], 0.0f);
+            #pragma omp parallel for
+            for(long node=0; node<nodesNum; ++node)
+                for(int p=0; p<_DegreesOfFreedom_; ++p)
                 {
-                    // TOP
-                    for(int i=0; i<4; ++i)
-                        if(BCManager.DirichletBCs[TOP] && element[i][1] == _domain.size())
-                            for(int j=0; j<_DegreesOfFreedom_; ++j)
-                                if(!BCManager.DirichletBCs[TOP]->isVoid(j))
-                                    applyLocalDirichletConditions(
-                                                i*_DegreesOfFreedom_+j,
-                                                BCManager.DirichletBCs[TOP]->c(j),K,f);
-                    // BOTTOM
-                    for(int i=0; i<4; ++i)
-                        if(BCManager.DirichletBCs[BOTTOM] && element[i][1] == 0)
-                            for(int j=0; j<_DegreesOfFreedom_; ++j)
-                                if(!BCManager.DirichletBCs[BOTTOM]->isVoid(j))
-                                    applyLocalDirichletConditions(
-                                                i*_DegreesOfFreedom_+j,
-                                                BCManager.DirichletBCs[BOTTOM]->c(j),K,f);
-                    // LEFT
-                    for(int i=0; i<4; ++i)
-                        if(BCManager.DirichletBCs[LEFT] && element[i][0] == 0)
-                            for(int j=0; j<_DegreesOfFreedom_; ++j)
-                                if(!BCManager.DirichletBCs[LEFT]->isVoid(j))
-                                    applyLocalDirichletConditions(
-                                                i*_DegreesOfFreedom_+j,
-                                                BCManager.DirichletBCs[LEFT]->c(j),K,f);
-                    // RIGHT
-                    for(int i=0; i<4; ++i)
-                        if(BCManager.DirichletBCs[RIGHT] && element[i][0] == _domain.size())
-                            for(int j=0; j<_DegreesOfFreedom_; ++j)
-                                if(!BCManager.DirichletBCs[RIGHT]->isVoid(j))
-                                    applyLocalDirichletConditions(
-                                                i*_DegreesOfFreedom_+j,
-                                                BCManager.DirichletBCs[RIGHT]->c(j),K,f);
-                    // FRONT
-                    for(int i=0; i<4; ++i)
-                        if(BCManager.DirichletBCs[FRONT] && element[i][2] == 0)
-                            for(int j=0; j<_DegreesOfFreedom_; ++j)
-                                if(!BCManager.DirichletBCs[FRONT]->isVoid(j))
-                                    applyLocalDirichletConditions(
-                                                i*_DegreesOfFreedom_+j,
-                                                BCManager.DirichletBCs[FRONT]->c(j),K,f);
-                    // BACK
-                    for(int i=0; i<4; ++i)
-                        if(BCManager.DirichletBCs[BACK] && element[i][2] == _domain.size())
-                            for(int j=0; j<_DegreesOfFreedom_; ++j)
-                                if(!BCManager.DirichletBCs[BACK]->isVoid(j))
-                                    applyLocalDirichletConditions(
-                                                i*_DegreesOfFreedom_+j,
-                                                BCManager.DirichletBCs[BACK]->c(j),K,f);
+                    unsigned pos = K.rowPtr[node*_DegreesOfFreedom_+p];
+                    for(int bit=0; bit<27; ++bit)
+                        if(masks[node] & (1u << bit))
+                        {
+                            long neighbour = node + (bit%3-1) + (bit/3%3-1)*size +
+                                    (bit/9-1)*size*size;
+                            for(int q=0; q<_DegreesOfFreedom_; ++q)
+                                K.columns[pos++] = neighbour*_DegreesOfFreedom_+q;
+                        }
                 }
 
-                // Add local matrices to global
-                for(long i=0; i<4; ++i)
+            // Numeric pass
+            LocalStiffnessCache<_DegreesOfFreedom_> _cache;
+            buildLocalStiffnessCache(_cache);
+
+            loads.assign(K.rows, 0.0f);
+            const long _layerElementsNum = (long)n*n*6;
+            #pragma omp parallel
+            {
+                const SlabPartition _part = SlabPartition::currentThread(size);
+                for(long el=_part.firstCubeLayer*_layerElementsNum;
+                    el<_part.lastCubeLayer*_layerElementsNum; ++el)
                 {
-                    for(long j=0; j<4; ++j)
+                    const FixedTetrahedron element = _domain[el];
+                    const int t = el % 6;
+
+                    MathUtils::Matrix::FixedMatrix<float,4*_DegreesOfFreedom_,4*_DegreesOfFreedom_> localK;
+                    MathUtils::Matrix::FixedMatrix<float,4*_DegreesOfFreedom_,1> f;
+                    for(int i=0; i<4*_DegreesOfFreedom_; ++i) f(i,0)=0;
+
+                    _cachedLocalK(_cache, el, localK);
+
+                    _applyNeumannBCs(element,f);
+
+                    _applyDirichletBCs(element,localK,f);
+
+                    for(long i=0; i<4; ++i)
+                    {
+                        if(!_part.owns(element.indexes[i])) continue;
+                        unsigned mask = masks[element.indexes[i]];
+                        for(long j=0; j<4; ++j)
+                        {
+                            unsigned blockPos = __builtin_popcount(
+                                        mask & ((1u << neighbourBits[t][i][j]) - 1)) * _DegreesOfFreedom_;
+                            for(long p=0; p<_DegreesOfFreedom_; ++p)
+                            {
+                                unsigned pos = K.rowPtr[element.indexes[i]*_DegreesOfFreedom_+p] + blockPos;
+                                for(long q=0; q<_DegreesOfFreedom_; ++q)
+                                    K.values[pos+q] += localK(i*_DegreesOfFreedom_+p,j*_DegreesOfFreedom_+q);
+                            }
+                        }
+                        for(long p=0; p<_DegreesOfFreedom_; ++p)
+                            loads[element.indexes[i]*_DegreesOfFreedom_+p] +=
+                                    f(i*_DegreesOfFreedom_+p,0);
+                    }
+                }
+            }
+        }
+
+        /// Loads vector of assembleCSR() without the matrix. Matrix depends only on
+        /// materials and on which DOFs are fixed, so it can be reused, when only Neumann
+        /// conditions or values of Dirichlet conditions are changed (several load cases)
+        public : void assembleLoads(std::vector<float> &loads)
+        {
+            if(BCManager.isPeriodic())
+            {
+                _assembleCondensed(BCManager.PeriodicBCs, nullptr, loads);
+                return;
+            }
+
+            const int size = _domain.discreteSize();
+            const int n = size - 1;
+
+            LocalStiffnessCache<_DegreesOfFreedom_> _cache;
+            buildLocalStiffnessCache(_cache);
+
+            loads.assign(_domain.nodesNum() * _DegreesOfFreedom_, 0.0f);
+            const long _layerElementsNum = (long)n*n*6;
+            #pragma omp parallel
+            {
+                const SlabPartition _part = SlabPartition::currentThread(size);
+                for(long el=_part.firstCubeLayer*_layerElementsNum;
+                    el<_part.lastCubeLayer*_layerElementsNum; ++el)
+                {
+                    const FixedTetrahedron element = _domain[el];
+
+                    MathUtils::Matrix::FixedMatrix<float,4*_DegreesOfFreedom_,4*_DegreesOfFreedom_> localK;
+                    MathUtils::Matrix::FixedMatrix<float,4*_DegreesOfFreedom_,1> f;
+                    for(int i=0; i<4*_DegreesOfFreedom_; ++i) f(i,0)=0;
+
+                    _applyNeumannBCs(element,f);
+
+                    // Only elements on fixed sides contribute K*u0 to the loads
+                    bool _onFixedSide = false;
+                    for(int side=0; side<6; ++side)
+                        if(BCManager.DirichletBCs[side])
+                            for(int i=0; i<4; ++i)
+                                if(element[i][_sideAxis(side)] == _sideCoordinate(side))
+                                    _onFixedSide = true;
+                    if(_onFixedSide)
+                    {
+                        _cachedLocalK(_cache, el, localK);
+                        _applyDirichletBCs(element,localK,f);
+                    }
+
+                    for(long i=0; i<4; ++i)
+                    {
+                        if(!_part.owns(element.indexes[i])) continue;
+                        for(long p=0; p<_DegreesOfFreedom_; ++p)
+                            loads[element.indexes[i]*_DegreesOfFreedom_+p] +=
+                                    f(i*_DegreesOfFreedom_+p,0);
+                    }
+                }
+            }
+        }
+
+        /// Nodes along the axis of the condensed mesh: along the periodic axis nodes of the
+        /// last layer are the same as nodes of the first one, so there are discreteSize-1 nodes
+        public : int condensedSize(const int axis) const noexcept {
+            return _condensedSize(BCManager.PeriodicBCs, axis);}
+        public : long condensedNodesNum() const noexcept {
+            return _condensedNodesNum(BCManager.PeriodicBCs);}
+        /// Condensed node of the domain node (i,j,k), coordinates can be out of the mesh
+        /// along periodic axes. Without periodic conditions it is the node itself
+        public : long condensedNode(const int i, const int j, const int k) const noexcept {
+            return _condensedNode(BCManager.PeriodicBCs, i, j, k);}
+        /// Solution of the condensed system (see assembleCSR()) for all nodes of the domain
+        public : void expandCondensed(
+                const std::vector<float> &condensed,
+                std::vector<float> &out) const
+        {
+            const int size = _domain.discreteSize();
+            out.resize(_domain.nodesNum() * _DegreesOfFreedom_);
+            #pragma omp parallel for
+            for(long node=0; node<_domain.nodesNum(); ++node)
+            {
+                const long _condensedNode = condensedNode(
+                            node % size, node / size % size, node / size / size);
+                for(long p=0; p<_DegreesOfFreedom_; ++p)
+                    out[node*_DegreesOfFreedom_+p] = condensed[_condensedNode*_DegreesOfFreedom_+p];
+            }
+        }
+
+        /// Condensed mesh of the given periodic axes (see condensedNode()). It is shared by
+        /// the periodic conditions of BCManager and by assemblePeriodicCSR(), where all
+        /// axes are periodic (see _allPeriodic())
+        protected: int _condensedSize(const bool periodic[3], const int axis) const noexcept {
+            return _domain.discreteSize() - (periodic[axis] ? 1 : 0);}
+        protected: long _condensedNodesNum(const bool periodic[3]) const noexcept {
+            return (long)_condensedSize(periodic, 0) * _condensedSize(periodic, 1) *
+                    _condensedSize(periodic, 2);}
+        protected: int _condensedCoordinate(
+                const bool periodic[3],
+                const int axis,
+                const int i) const noexcept
+        {
+            const int n = _condensedSize(periodic, axis);
+            return (i % n + n) % n;
+        }
+        protected: long _condensedNode(
+                const bool periodic[3],
+                const int i,
+                const int j,
+                const int k) const noexcept
+        {
+            const long nx = _condensedSize(periodic, 0);
+            const long ny = _condensedSize(periodic, 1);
+            return _condensedCoordinate(periodic, 0, i) + _condensedCoordinate(periodic, 1, j) * nx +
+                    _condensedCoordinate(periodic, 2, k) * nx * ny;
+        }
+        protected: static const bool *_allPeriodic() noexcept
+        {
+            static const bool _periodic[3] = {true, true, true};
+            return _periodic;
+        }
+
+        /// Calls function(el, t, a) for all elements el around all images of the condensed
+        /// node, a - local index of the image in the element, t - type of the element.
+        /// Node has up to 8 images (the corner node with three periodic axes)
+        private: template<typename _Function_> void _forEachCondensedElement(
+                const bool periodic[3],
+                const long node,
+                const int offsets[6][4][3],
+                const _Function_ &function) const
+        {
+            const int n = _domain.discreteSize() - 1;
+            const int nx = _condensedSize(periodic, 0);
+            const int ny = _condensedSize(periodic, 1);
+            const int coordinates[3] = {int(node % nx), int(node / nx % ny), int(node / nx / ny)};
+            int images[3][2];
+            int imagesNum[3];
+            for(int axis=0; axis<3; ++axis)
+            {
+                images[axis][0] = coordinates[axis];
+                imagesNum[axis] = 1;
+                if(periodic[axis] && coordinates[axis] == 0)
+                    images[axis][imagesNum[axis]++] = n;
+            }
+            for(int ii=0; ii<imagesNum[0]; ++ii)
+                for(int jj=0; jj<imagesNum[1]; ++jj)
+                    for(int kk=0; kk<imagesNum[2]; ++kk)
+                        for(int t=0; t<6; ++t)
+                            for(int a=0; a<4; ++a)
+                            {
+                                const int ci = images[0][ii] - offsets[t][a][0];
+                                const int cj = images[1][jj] - offsets[t][a][1];
+                                const int ck = images[2][kk] - offsets[t][a][2];
+                                if(ci < 0 || cj < 0 || ck < 0 || ci >= n || cj >= n || ck >= n)
+                                    continue;
+                                function((ci + (long)cj*n + (long)ck*n*n)*6 + t, t, a);
+                            }
+        }
+
+        /// assembleCSR() and assembleLoads() (if K is nullptr) with periodic conditions
+        /// along the given axes, also assemblePeriodicCSR().
+        /// Nodes of periodic sides are condensed into the nodes of the opposite sides, so
+        /// the system is smaller and rows and columns are _condensedNode() indexes.
+        /// Row of the condensed node gathers elements around all its images, so rows are
+        /// assembled in parallel without partitioning. Pattern is still the 27-bit mask of
+        /// neighbour offsets (see assembleCSR()), but neighbours are wrapped by periodic
+        /// axes, so columns are sorted for each row.
+        /// Domain without Dirichlet conditions is defined up to a constant (a rigid motion),
+        /// as in assembleCSR()
+        private: void _assembleCondensed(
+                const bool periodic[3],
+                CSRMatrix *K,
+                std::vector<float> &loads)
+        {
+            const int n = _domain.discreteSize() - 1;
+            for(int axis=0; axis<3; ++axis)
+                if(periodic[axis])
+                {
+                    if(n < 3)
+                        throw(std::runtime_error("assembleCSR(): RVE is too small for periodic conditions"));
+                    for(int side=0; side<6; ++side)
+                        if(_sideAxis(side) == axis &&
+                                (BCManager.NeumannBCs[side] || BCManager.DirichletBCs[side]))
+                            throw(std::runtime_error("assembleCSR(): periodic side can't have "
+                                                     "other boundary conditions"));
+                }
+
+            int offsets[6][4][3];
+            _periodicOffsets(offsets);
+            int neighbourBits[6][4][4];
+            for(int t=0; t<6; ++t)
+                for(int a=0; a<4; ++a)
+                    for(int b=0; b<4; ++b)
+                        neighbourBits[t][a][b] = (offsets[t][b][0] - offsets[t][a][0] + 1) +
+                                3*(offsets[t][b][1] - offsets[t][a][1] + 1) +
+                                9*(offsets[t][b][2] - offsets[t][a][2] + 1);
+            const long nodesNum = _condensedNodesNum(periodic);
+            const int nx = _condensedSize(periodic, 0);
+            const int ny = _condensedSize(periodic, 1);
+
+            // Symbolic pass
+            std::vector<unsigned> masks;
+            if(K)
+            {
+                masks.assign(nodesNum, 0);
+                #pragma omp parallel for
+                for(long node=0; node<nodesNum; ++node)
+                    _forEachCondensedElement(periodic, node, offsets, [&](const long, const int t, const int a){
+                        for(int b=0; b<4; ++b)
+                            masks[node] |= 1u << neighbourBits[t][a][b];});
+
+                K->rows = nodesNum * _DegreesOfFreedom_;
+                K->cols = K->rows;
+                K->rowPtr.resize(K->rows + 1);
+                K->rowPtr[0] = 0;
+                for(long node=0; node<nodesNum; ++node)
+                    for(int p=0; p<_DegreesOfFreedom_; ++p)
+                        K->rowPtr[node*_DegreesOfFreedom_+p+1] = K->rowPtr[node*_DegreesOfFreedom_+p] +
+                                __builtin_popcount(masks[node]) * _DegreesOfFreedom_;
+                K->columns.resize(K->rowPtr[K->rows]);
+                K->values.assign(K->rowPtr[K->rows], 0.0f);
+            }
+
+            // Numeric pass
+            LocalStiffnessCache<_DegreesOfFreedom_> _cache;
+            buildLocalStiffnessCache(_cache);
+
+            loads.assign(nodesNum * _DegreesOfFreedom_, 0.0f);
+            #pragma omp parallel for
+            for(long node=0; node<nodesNum; ++node)
+            {
+                // Position of the neighbour block in the sorted row
+                int blockPos[27];
+                if(K)
+                {
+                    const int i = node % nx, j = node / nx % ny, k = node / nx / ny;
+                    std::pair<long,int> _neighbours[27];
+                    int _neighboursNum = 0;
+                    for(int bit=0; bit<27; ++bit)
+                        if(masks[node] & (1u << bit))
+                            _neighbours[_neighboursNum++] = std::make_pair(
+                                        _condensedNode(periodic, i + bit%3-1, j + bit/3%3-1, k + bit/9-1), bit);
+                    std::sort(_neighbours, _neighbours + _neighboursNum);
+                    for(int s=0; s<_neighboursNum; ++s)
+                    {
+                        blockPos[_neighbours[s].second] = s * _DegreesOfFreedom_;
                         for(long p=0; p<_DegreesOfFreedom_; ++p)
                             for(long q=0; q<_DegreesOfFreedom_; ++q)
-                                if(K(i*_DegreesOfFreedom_+p,j*_DegreesOfFreedom_+q) != 0)
-                                    sparseMatrix[element.indexes[i]*_DegreesOfFreedom_+p]
-                                            [element.indexes[j]*_DegreesOfFreedom_+q] +=
-                                            K(i*_DegreesOfFreedom_+p,j*_DegreesOfFreedom_+q);
+                                K->columns[K->rowPtr[node*_DegreesOfFreedom_+p] + s*_DegreesOfFreedom_ + q] =
+                                        _neighbours[s].first*_DegreesOfFreedom_+q;
+                    }
+                }
+
+                _forEachCondensedElement(periodic, node, offsets, [&](const long el, const int t, const int a){
+                    const FixedTetrahedron element = _domain[el];
+
+                    MathUtils::Matrix::FixedMatrix<float,4*_DegreesOfFreedom_,4*_DegreesOfFreedom_> localK;
+                    MathUtils::Matrix::FixedMatrix<float,4*_DegreesOfFreedom_,1> f;
+                    for(int i=0; i<4*_DegreesOfFreedom_; ++i) f(i,0)=0;
+
+                    _cachedLocalK(_cache, el, localK);
+
+                    _applyNeumannBCs(element,f);
+
+                    _applyDirichletBCs(element,localK,f);
+
                     for(long p=0; p<_DegreesOfFreedom_; ++p)
-                        loads[element.indexes[i]*_DegreesOfFreedom_+p] +=
-                                f(i*_DegreesOfFreedom_+p,0);
+                    {
+                        loads[node*_DegreesOfFreedom_+p] += f(a*_DegreesOfFreedom_+p,0);
+                        if(!K) continue;
+                        for(long b=0; b<4; ++b)
+                        {
+                            unsigned pos = K->rowPtr[node*_DegreesOfFreedom_+p] +
+                                    blockPos[neighbourBits[t][a][b]];
+                            for(long q=0; q<_DegreesOfFreedom_; ++q)
+                                K->values[pos+q] += localK(a*_DegreesOfFreedom_+p,b*_DegreesOfFreedom_+q);
+                        }
+                    }});
+            }
+        }
+
+        /// Periodic fluctuation problem of homogenization: u = G*x + v, where G is the
+        /// macroscopic gradient (of temperature, or strain) and v is periodic.
+        /// It is the condensed system (see _assembleCondensed()) with all axes periodic, so
+        /// the mesh has n^3 nodes, n = discreteSize-1, node (i,j,k) -> i%n + (j%n)*n + (k%n)*n*n.
+        /// Matrix doesn't depend on G, so all load cases share it (see assemblePeriodicLoads()).
+        /// v is defined up to a constant, so DOFs of the node 0 are fixed (v = 0).
+        /// BCManager should not have other conditions
+        public : void assemblePeriodicCSR(CSRMatrix &K)
+        {
+            if(_domain.discreteSize() - 1 < 3)
+                throw(std::runtime_error("assemblePeriodicCSR(): RVE is too small"));
+
+            std::vector<float> _loads;
+            _assembleCondensed(_allPeriodic(), &K, _loads);
+
+            // v = 0 at the node 0
+            #pragma omp parallel for
+            for(long row=0; row<(long)K.rows; ++row)
+                for(unsigned pos=K.rowPtr[row]; pos<K.rowPtr[row+1]; ++pos)
+                    if((row < _DegreesOfFreedom_ || K.columns[pos] < _DegreesOfFreedom_) &&
+                            K.columns[pos] != row)
+                        K.values[pos] = 0.0f;
+        }
+
+        /// Loads of the periodic problem (see assemblePeriodicCSR()): f = -[K]*(G*x)
+        /// gradient - G, row per DOF
+        public : void assemblePeriodicLoads(
+                const MathUtils::Matrix::FixedMatrix<float,_DegreesOfFreedom_,3> &gradient,
+                std::vector<float> &loads)
+        {
+            const int n = _domain.discreteSize() - 1;
+            const float step = _domain.size() / n;
+
+            int offsets[6][4][3];
+            _periodicOffsets(offsets);
+            const long nodesNum = (long)n*n*n;
+
+            LocalStiffnessCache<_DegreesOfFreedom_> _cache;
+            buildLocalStiffnessCache(_cache);
+
+            loads.assign(nodesNum*_DegreesOfFreedom_, 0.0f);
+            #pragma omp parallel for
+            for(long node=0; node<nodesNum; ++node)
+            {
+                const int i = node % n, j = node / n % n, k = node / n / n;
+                for(int t=0; t<6; ++t)
+                    for(int a=0; a<4; ++a)
+                    {
+                        const int ci = _periodicCoordinate(i - offsets[t][a][0]);
+                        const int cj = _periodicCoordinate(j - offsets[t][a][1]);
+                        const int ck = _periodicCoordinate(k - offsets[t][a][2]);
+                        const auto *localK = _cache[_periodicNode(ci, cj, ck)*6 + t];
+                        if(!localK) continue;
+                        for(int b=0; b<4; ++b)
+                        {
+                            // Coordinates of the element itself, [K] doesn't feel translations
+                            const float x = step * (ci + offsets[t][b][0]);
+                            const float y = step * (cj + offsets[t][b][1]);
+                            const float z = step * (ck + offsets[t][b][2]);
+                            for(long q=0; q<_DegreesOfFreedom_; ++q)
+                            {
+                                float u0 = gradient(q,0)*x + gradient(q,1)*y + gradient(q,2)*z;
+                                for(long p=0; p<_DegreesOfFreedom_; ++p)
+                                    loads[node*_DegreesOfFreedom_+p] -= (*localK)(
+                                                a*_DegreesOfFreedom_+p, b*_DegreesOfFreedom_+q) * u0;
+                            }
+                        }
+                    }
+            }
+            for(long p=0; p<_DegreesOfFreedom_; ++p)
+                loads[p] = 0.0f;
+        }
+
+        /// Averaged energy products of the periodic load cases:
+        /// products[i*N+j] = 1/V * I{(grad u_i)^T [D] grad u_j}dV, u_i = G_i*x + v_i
+        /// e.g. for the unit temperature gradients it is the effective conductivity tensor
+        public : void periodicEnergyProducts(
+                const std::vector<MathUtils::Matrix::FixedMatrix<float,_DegreesOfFreedom_,3>> &gradients,
+                const std::vector<std::vector<float>> &fluctuations,
+                std::vector<double> &products)
+        {
+            const int n = _domain.discreteSize() - 1;
+            const float step = _domain.size() / n;
+            const int N = gradients.size();
+
+            int offsets[6][4][3];
+            _periodicOffsets(offsets);
+
+            LocalStiffnessCache<_DegreesOfFreedom_> _cache;
+            buildLocalStiffnessCache(_cache);
+
+            products.assign(N*N, 0.0);
+            #pragma omp parallel
+            {
+                std::vector<double> _products(N*N, 0.0);
+                std::vector<MathUtils::Matrix::FixedMatrix<float,4*_DegreesOfFreedom_,1>> u(N);
+                MathUtils::Matrix::FixedMatrix<float,4*_DegreesOfFreedom_,1> Ku;
+
+                #pragma omp for
+                for(long cube=0; cube<(long)n*n*n; ++cube)
+                {
+                    const int ci = cube % n, cj = cube / n % n, ck = cube / n / n;
+                    for(int t=0; t<6; ++t)
+                    {
+                        const auto *localK = _cache[cube*6 + t];
+                        if(!localK) continue;
+                        for(int c=0; c<N; ++c)
+                            for(int b=0; b<4; ++b)
+                            {
+                                const long node = _periodicNode(ci + offsets[t][b][0],
+                                                                cj + offsets[t][b][1],
+                                                                ck + offsets[t][b][2]);
+                                const float x = step * (ci + offsets[t][b][0]);
+                                const float y = step * (cj + offsets[t][b][1]);
+                                const float z = step * (ck + offsets[t][b][2]);
+                                for(long q=0; q<_DegreesOfFreedom_; ++q)
+                                    u[c](b*_DegreesOfFreedom_+q,0) =
+                                            gradients[c](q,0)*x + gradients[c](q,1)*y +
+                                            gradients[c](q,2)*z +
+                                            fluctuations[c][node*_DegreesOfFreedom_+q];
+                            }
+                        for(int c2=0; c2<N; ++c2)
+                        {
+                            Ku = (*localK) * u[c2];
+                            for(int c1=0; c1<=c2; ++c1)
+                            {
+                                double _sum = 0.0;
+                                for(int i=0; i<4*_DegreesOfFreedom_; ++i)
+                                    _sum += (double)u[c1](i,0) * Ku(i,0);
+                                _products[c1*N + c2] += _sum;
+                            }
+                        }
+                    }
                 }
+
+                #pragma omp critical
+                for(int i=0; i<N*N; ++i)
+                    products[i] += _products[i];
             }
+
+            const double V = (double)_domain.size() * _domain.size() * _domain.size();
+            for(int c2=0; c2<N; ++c2)
+                for(int c1=0; c1<=c2; ++c1)
+                {
+                    products[c1*N + c2] /= V;
+                    products[c2*N + c1] = products[c1*N + c2];
+                }
         }
+
+        /// See assemblePeriodicCSR()
+        protected: int _periodicCoordinate(const int i) const noexcept {
+            return _condensedCoordinate(_allPeriodic(), 0, i);}
+        protected: long _periodicNode(const int i, const int j, const int k) const noexcept {
+            return _condensedNode(_allPeriodic(), i, j, k);}
+        /// Local nodes offsets (dx,dy,dz) of the tetrahedron types in the cube
+        protected: void _periodicOffsets(int offsets[6][4][3]) const
+        {
+            const int size = _domain.discreteSize();
+            for(int t=0; t<6; ++t)
+            {
+                const FixedTetrahedron element = _domain[t];
+                for(int a=0; a<4; ++a)
+                {
+                    offsets[t][a][0] = element.indexes[a] % size;
+                    offsets[t][a][1] = element.indexes[a] / size % size;
+                    offsets[t][a][2] = element.indexes[a] / size / size;
+                }
+            }
+        }
+
         public : void solve(
             const double eps,
             const int maxIteration,
@@ -295,67 +935,500 @@ namespace FEM
             const bool useBiCG = false,
             double *error = nullptr,
             long *iterations = nullptr,
-            std::chrono::duration<double> *time = nullptr) noexcept
+            std::chrono::duration<double> *time = nullptr,
+            const bool useMultigrid = false)
+        {
+            SolverConfiguration _configuration;
+            _configuration.eps = eps;
+            _configuration.maxIteration = maxIteration;
+            _configuration.solver = useBiCG ?
+                        SolverConfiguration::BICGSTAB : SolverConfiguration::CG;
+            _configuration.preconditioner = useMultigrid ?
+                        SolverConfiguration::GEOMETRIC_MULTIGRID : SolverConfiguration::NONE;
+
+            SolverStatistics _statistics;
+            solve(_configuration, out, &_statistics);
+
+            if(error)*error = _statistics.error;
+            if(iterations)*iterations = _statistics.iterations;
+            if(time) *time = _statistics.totalTime();
+        }
+
+        public : void solve(
+            const SolverConfiguration &configuration,
+            std::vector<float> &out,
+            SolverStatistics *statistics = nullptr)
         {
             /// \todo remove cout
             std::cout << "Solving problem:\n";
             std::cout << " Assembling SLAE...";
 
-            Timer _calculationTimer;
-            _calculationTimer.start();
+            Timer _timer;
+            _timer.start();
 
             int size = _domain.discreteSize();
-            viennacl::compressed_matrix<float>  K(size*size*size*_DegreesOfFreedom_,
-                                                  size*size*size*_DegreesOfFreedom_);
-            viennacl::vector<float>             f(size*size*size*_DegreesOfFreedom_);
-            viennacl::vector<float>             u(size*size*size*_DegreesOfFreedom_);
+            CSRMatrix cpu_sparse_matrix;
+            std::vector<std::vector<float>> cpu_loads(1);
 
-            std::vector<std::map<long, float>> cpu_sparse_matrix(size*size*size*_DegreesOfFreedom_);
-            std::vector<float> cpu_loads(size*size*size*_DegreesOfFreedom_);
+            assembleCSR(cpu_sparse_matrix, cpu_loads[0]);
 
-            assembleSLAE(cpu_sparse_matrix, cpu_loads);
+            _timer.stop();
 
             /// \todo remove cout
             std::cout << " assembled:\n  " << size*size*size << " nodes;\n  "
                       << _DegreesOfFreedom_ << " degrees of freedom\n  "
                       << (size-1)*(size-1)*(size-1)*6 << " elements\n";
 
-            viennacl::copy(cpu_sparse_matrix, K);
-            viennacl::copy(cpu_loads.begin(), cpu_loads.end(), f.begin());
-
-            /// \todo remove cout
-            std::cout << " Solving SLAE...";
-            if(useBiCG)
+            std::vector<std::vector<float>> _out(1);
+            if(!BCManager.isPeriodic())
+                _out[0].swap(out);
+            else if(configuration.useInitialGuess &&
+                    out.size() == (unsigned long)_domain.nodesNum() * _DegreesOfFreedom_)
             {
-                viennacl::linalg::bicgstab_tag solverBiCG(eps, maxIteration);
-                u = viennacl::linalg::solve(K, f, solverBiCG);
-                /// \todo remove cout
-                std::cout << " solved: "
-                          << "  error = "<< solverBiCG.error()
-                          << "  iterations = " << solverBiCG.iters() << "\n";
-                if(error)*error = solverBiCG.error();
-                if(iterations)*iterations = solverBiCG.iters();
+                // Condensed nodes are the domain nodes with the same coordinates
+                const int nx = condensedSize(0);
+                const int ny = condensedSize(1);
+                _out[0].resize(cpu_sparse_matrix.rows);
+                for(long node=0; node<condensedNodesNum(); ++node)
+                    for(long p=0; p<_DegreesOfFreedom_; ++p)
+                        _out[0][node*_DegreesOfFreedom_+p] = out[
+                                (node % nx + node / nx % ny * size +
+                                 node / nx / ny * size * size)*_DegreesOfFreedom_+p];
             }
+            std::vector<SolverStatistics> _statistics;
+            solve(configuration, cpu_sparse_matrix, cpu_loads, _out, &_statistics);
+            if(!BCManager.isPeriodic())
+                out.swap(_out[0]);
             else
+                expandCondensed(_out[0], out);
+
+            _statistics[0].assemblyTime = _timer.getTimeSpan();
+            if(statistics) *statistics = _statistics[0];
+        }
+
+        /// Solves K*out[i] = loads[i] for several load cases with the same matrix
+        /// (see assembleLoads()), preconditioner (or factorization) is built once, its
+        /// setup time is reported in the first statistics.
+        /// If configuration.useInitialGuess, out[i] of proper size is the initial guess
+        /// (it isn't needed by the DIRECT backend)
+        public : void solve(
+            const SolverConfiguration &configuration,
+            const CSRMatrix &K,
+            const std::vector<std::vector<float>> &loads,
+            std::vector<std::vector<float>> &out,
+            std::vector<SolverStatistics> *statistics = nullptr) const
+        {
+            out.resize(loads.size());
+            std::vector<SolverStatistics> _statistics(loads.size());
+
+            const bool _direct = configuration.backend == SolverConfiguration::DIRECT ||
+                    (configuration.backend == SolverConfiguration::AUTO &&
+                     K.rows <= configuration.directMaxRowsPerLoadCase * loads.size());
+            bool _solved = false;
+            if(_direct)
             {
-                viennacl::linalg::cg_tag solverCG(eps, maxIteration);
-                u = viennacl::linalg::solve(K, f, solverCG);
-                /// \todo remove cout
-                std::cout << " solved: "
-                          << "  error = "<< solverCG.error()
-                          << "  iterations = " << solverCG.iters() << "\n";
-                if(error)*error = solverCG.error();
-                if(iterations)*iterations = solverCG.iters();
+                const DIRECT_STATUS _status = _solveDirect(configuration, K, loads, out, _statistics);
+                _solved = _status == DIRECT_SOLVED;
+                if(configuration.backend == SolverConfiguration::DIRECT)
+                {
+                    if(_status == DIRECT_SINGULAR)
+                        throw(std::runtime_error("solve(): factorization failed, matrix is singular"));
+                    if(_status == DIRECT_INACCURATE)
+                        throw(std::runtime_error("solve(): residual of the direct solution is above eps, "
+                                                 "matrix is ill-conditioned"));
+                }
+            }
+            if(!_solved)
+            {
+                if(configuration.backend == SolverConfiguration::HOST ||
+                        configuration.precision == SolverConfiguration::MIXED ||
+                        configuration.preconditioner == SolverConfiguration::BLOCK_JACOBI ||
+                        configuration.preconditioner == SolverConfiguration::GEOMETRIC_MULTIGRID)
+                    _solveOnHost(configuration, K, loads, out, _statistics);
+                else
+                    _solveOnDevice(configuration, K, loads, out, _statistics);
             }
 
-            if(out.size() != u.size())out.resize(u.size());
+            if(statistics) *statistics = _statistics;
+        }
 
-            viennacl::copy(u.begin(), u.end(), out.data());
+        /// Result of _solveDirect(), the backend falls back to the iterative solver
+        /// (for SolverConfiguration::AUTO), unless it is DIRECT_SOLVED
+        private: enum DIRECT_STATUS{
+            DIRECT_SOLVED       = 0,
+            DIRECT_SINGULAR     = 1,    // factorization breaks down (zero pivot)
+            DIRECT_INACCURATE   = 2     // residual is above eps, it is kept in statistics[i].error
+        };
 
-            _calculationTimer.stop();
+        private: static DIRECT_STATUS _solveDirect(
+                const SolverConfiguration &configuration,
+                const CSRMatrix &K,
+                const std::vector<std::vector<float>> &loads,
+                std::vector<std::vector<float>> &out,
+                std::vector<SolverStatistics> &statistics)
+        {
+            DirectSolver _localSolver;
+            DirectSolver &_solver = configuration.directSolver ?
+                        *configuration.directSolver : _localSolver;
 
-            /// \todo remove cout
-            std::cout << " Time = " << _calculationTimer.getTimeSpanAsString() << " seconds\n";
+            Timer _timer;
+            _timer.start();
+            const bool _factorized = _solver.factorize(
+                        K, configuration.solver != SolverConfiguration::BICGSTAB);
+            _timer.stop();
+            if(!_factorized) return DIRECT_SINGULAR;
+            if(!statistics.empty()) statistics[0].setupTime = _timer.getTimeSpan();
+
+            // Residual of the double solution, float output only rounds it
+            std::vector<double> _b;
+            std::vector<double> _x;
+            std::vector<double> _residual;
+            std::vector<std::vector<float>> _solutions(loads.size());
+            for(unsigned i=0; i<loads.size(); ++i)
+            {
+                _timer.start();
+                _b.assign(loads[i].begin(), loads[i].end());
+                _solver.solve(_b, _x);
+                _timer.stop();
+                statistics[i].solveTime = _timer.getTimeSpan();
+
+                K.multiply(_x, _residual);
+                double _normF = std::sqrt(IterativeSolvers::dot(_b, _b));
+                if(_normF == 0.0) _normF = 1.0;
+                for(unsigned j=0; j<_residual.size(); ++j)
+                    _residual[j] = _b[j] - _residual[j];
+                statistics[i].error = std::sqrt(IterativeSolvers::dot(_residual, _residual)) / _normF;
+                // Breakdown of the factorization is not the only sign of a singular
+                // matrix, all out[i] are kept for the iterative solver then
+                if(!(statistics[i].error <= configuration.eps)) return DIRECT_INACCURATE;
+                _solutions[i].assign(_x.begin(), _x.end());
+            }
+            for(unsigned i=0; i<loads.size(); ++i)
+                out[i].swap(_solutions[i]);
+            return DIRECT_SOLVED;
+        }
+
+        private: template<typename _Preconditioner_> static void _solveOnHost(
+                const SolverConfiguration &configuration,
+                const CSRMatrix &K,
+                const std::vector<std::vector<float>> &loads,
+                const _Preconditioner_ &M,
+                std::vector<std::vector<float>> &out,
+                std::vector<SolverStatistics> &statistics)
+        {
+            for(unsigned i=0; i<loads.size(); ++i)
+            {
+                Timer _timer;
+                _timer.start();
+                if(!configuration.useInitialGuess || out[i].size() != K.rows)
+                    out[i].assign(K.rows, 0.0f);
+                if(configuration.precision == SolverConfiguration::MIXED)
+                {
+                    std::vector<double> _b(loads[i].begin(), loads[i].end());
+                    std::vector<double> _x(out[i].begin(), out[i].end());
+                    auto _innerSolver = [&](const std::vector<float> &r, std::vector<float> &d) -> long
+                    {
+                        if(configuration.solver == SolverConfiguration::BICGSTAB)
+                            return IterativeSolvers::PBiCGStab(
+                                        K, M, r, d, configuration.innerEps, configuration.maxIteration);
+                        else
+                            return IterativeSolvers::PCG(
+                                        K, M, r, d, configuration.innerEps, configuration.maxIteration);
+                    };
+                    statistics[i].iterations = IterativeSolvers::IterativeRefinement(
+                                K, _b, _x, _innerSolver, configuration.eps, configuration.maxRefinements,
+                                &statistics[i].error, &statistics[i].residualHistory);
+                    out[i].assign(_x.begin(), _x.end());
+                }
+                else if(configuration.solver == SolverConfiguration::BICGSTAB)
+                    statistics[i].iterations = IterativeSolvers::PBiCGStab(
+                                K, M, loads[i], out[i], configuration.eps, configuration.maxIteration,
+                                &statistics[i].error, &statistics[i].residualHistory);
+                else
+                    statistics[i].iterations = IterativeSolvers::PCG(
+                                K, M, loads[i], out[i], configuration.eps, configuration.maxIteration,
+                                &statistics[i].error, &statistics[i].residualHistory);
+                _timer.stop();
+                statistics[i].solveTime = _timer.getTimeSpan();
+            }
+        }
+
+        private: void _solveOnHost(
+                const SolverConfiguration &configuration,
+                const CSRMatrix &K,
+                const std::vector<std::vector<float>> &loads,
+                std::vector<std::vector<float>> &out,
+                std::vector<SolverStatistics> &statistics) const
+        {
+            Timer _timer;
+            _timer.start();
+            switch (configuration.preconditioner)
+            {
+            case SolverConfiguration::NONE:
+            {
+                _timer.stop();
+                _solveOnHost(configuration, K, loads, IterativeSolvers::IdentityPreconditioner(), out, statistics);
+                break;
+            }
+            case SolverConfiguration::JACOBI:
+            {
+                JacobiPreconditioner _M(K);
+                _timer.stop();
+                _solveOnHost(configuration, K, loads, _M, out, statistics);
+                break;
+            }
+            case SolverConfiguration::BLOCK_JACOBI:
+            {
+                BlockJacobiPreconditioner _M(K, _DegreesOfFreedom_);
+                _timer.stop();
+                _solveOnHost(configuration, K, loads, _M, out, statistics);
+                break;
+            }
+            case SolverConfiguration::ILU0:
+            {
+                ILU0Preconditioner _M(K);
+                _timer.stop();
+                _solveOnHost(configuration, K, loads, _M, out, statistics);
+                break;
+            }
+            case SolverConfiguration::GEOMETRIC_MULTIGRID:
+            {
+                if(BCManager.isPeriodic())
+                    throw(std::runtime_error("solve(): multigrid doesn't support periodic conditions"));
+                GeometricMultigrid _M(K, _domain.discreteSize(), _DegreesOfFreedom_);
+                _timer.stop();
+                _solveOnHost(configuration, K, loads, _M, out, statistics);
+                break;
+            }
+            default:
+                throw(std::runtime_error("solve(): preconditioner is not supported by the host backend"));
+            }
+            if(!statistics.empty()) statistics[0].setupTime = _timer.getTimeSpan();
+        }
+
+        /// ViennaCL 1.6 solvers always start from zero, so for the initial guess u0
+        /// the correction is solved: K*du = f - K*u0, with tolerance scaled to |f|
+        private: template<typename _Preconditioner_> static void _solveOnDevice(
+                const SolverConfiguration &configuration,
+                const CSRMatrix &cpu_sparse_matrix,
+                const viennacl::compressed_matrix<float> &K,
+                const std::vector<std::vector<float>> &loads,
+                const _Preconditioner_ &M,
+                std::vector<std::vector<float>> &out,
+                std::vector<SolverStatistics> &statistics)
+        {
+            viennacl::vector<float> f(cpu_sparse_matrix.rows);
+            viennacl::vector<float> u(cpu_sparse_matrix.rows);
+            std::vector<float> _rhs;
+            for(unsigned i=0; i<loads.size(); ++i)
+            {
+                Timer _timer;
+                _timer.start();
+
+                double _normF = std::sqrt(IterativeSolvers::dot(loads[i], loads[i]));
+                if(_normF == 0.0) _normF = 1.0;
+                double _normRHS = _normF;
+                const bool _warmStart = configuration.useInitialGuess &&
+                        out[i].size() == cpu_sparse_matrix.rows;
+                if(_warmStart)
+                {
+                    cpu_sparse_matrix.multiply(out[i], _rhs);
+                    for(unsigned j=0; j<_rhs.size(); ++j)
+                        _rhs[j] = loads[i][j] - _rhs[j];
+                    _normRHS = std::sqrt(IterativeSolvers::dot(_rhs, _rhs));
+                    if(_normRHS <= configuration.eps * _normF)
+                    {
+                        _timer.stop();
+                        statistics[i].error = _normRHS / _normF;
+                        statistics[i].solveTime = _timer.getTimeSpan();
+                        continue;
+                    }
+                }
+                else
+                    _rhs = loads[i];
+                viennacl::copy(_rhs.begin(), _rhs.end(), f.begin());
+
+                const double _eps = configuration.eps * _normF / _normRHS;
+                if(configuration.solver == SolverConfiguration::BICGSTAB)
+                {
+                    viennacl::linalg::bicgstab_tag solverBiCG(_eps, configuration.maxIteration);
+                    u = viennacl::linalg::solve(K, f, solverBiCG, M);
+                    statistics[i].error = solverBiCG.error() * _normRHS / _normF;
+                    statistics[i].iterations = solverBiCG.iters();
+                }
+                else
+                {
+                    viennacl::linalg::cg_tag solverCG(_eps, configuration.maxIteration);
+                    u = viennacl::linalg::solve(K, f, solverCG, M);
+                    statistics[i].error = solverCG.error() * _normRHS / _normF;
+                    statistics[i].iterations = solverCG.iters();
+                }
+
+                viennacl::copy(u.begin(), u.end(), _rhs.data());
+                if(_warmStart)
+                    for(unsigned j=0; j<_rhs.size(); ++j)
+                        out[i][j] += _rhs[j];
+                else
+                    out[i].swap(_rhs);
+
+                _timer.stop();
+                statistics[i].solveTime = _timer.getTimeSpan();
+            }
+        }
+
+        private: void _solveOnDevice(
+                const SolverConfiguration &configuration,
+                const CSRMatrix &cpu_sparse_matrix,
+                const std::vector<std::vector<float>> &loads,
+                std::vector<std::vector<float>> &out,
+                std::vector<SolverStatistics> &statistics) const
+        {
+            typedef viennacl::compressed_matrix<float> MatrixType;
+            MatrixType K(cpu_sparse_matrix.rows, cpu_sparse_matrix.rows);
+
+            K.set(cpu_sparse_matrix.rowPtr.data(),
+                  cpu_sparse_matrix.columns.data(),
+                  cpu_sparse_matrix.values.data(),
+                  cpu_sparse_matrix.rows,
+                  cpu_sparse_matrix.rows,
+                  cpu_sparse_matrix.nonzeros());
+
+            Timer _timer;
+            _timer.start();
+            switch (configuration.preconditioner)
+            {
+            case SolverConfiguration::NONE:
+            {
+                _timer.stop();
+                _solveOnDevice(configuration, cpu_sparse_matrix, K, loads,
+                               viennacl::linalg::no_precond(), out, statistics);
+                break;
+            }
+            case SolverConfiguration::JACOBI:
+            {
+                viennacl::linalg::jacobi_precond<MatrixType> _M(K, viennacl::linalg::jacobi_tag());
+                _timer.stop();
+                _solveOnDevice(configuration, cpu_sparse_matrix, K, loads, _M, out, statistics);
+                break;
+            }
+            case SolverConfiguration::ILU0:
+            {
+                viennacl::linalg::ilu0_precond<MatrixType> _M(K, viennacl::linalg::ilu0_tag());
+                _timer.stop();
+                _solveOnDevice(configuration, cpu_sparse_matrix, K, loads, _M, out, statistics);
+                break;
+            }
+            case SolverConfiguration::ILUT:
+            {
+                viennacl::linalg::ilut_precond<MatrixType> _M(K, viennacl::linalg::ilut_tag(
+                            configuration.ILUTEntriesPerRow, configuration.ILUTDropTolerance));
+                _timer.stop();
+                _solveOnDevice(configuration, cpu_sparse_matrix, K, loads, _M, out, statistics);
+                break;
+            }
+            default:
+                throw(std::runtime_error("solve(): preconditioner is not supported by the device backend"));
+            }
+            if(!statistics.empty()) statistics[0].setupTime = _timer.getTimeSpan();
+        }
+
+        /// Builds the operator for solveMatrixFree() and global loads vector
+        /// (loads are the same as in assembleSLAE())
+        public : void assembleMatrixFree(
+                MatrixFreeOperator<_DegreesOfFreedom_> &K,
+                std::vector<float> &loads)
+        {
+            if(BCManager.isPeriodic())
+                throw(std::runtime_error("assembleMatrixFree(): periodic conditions are not supported, "
+                                         "use assembleCSR()"));
+
+            int size = _domain.discreteSize();
+            int n = size - 1;
+            K._size = size;
+
+            buildLocalStiffnessCache(K._cache);
+            for(int t=0; t<6; ++t)
+            {
+                const FixedTetrahedron element = _domain[t];
+                for(int v=0; v<4; ++v)
+                    K._nodeOffsets[t][v] = element.indexes[v];
+            }
+
+            K._fixed.assign(K.size(), 0);
+            K._fixedDiagonal.assign(K.size(), 0.0f);
+            loads.assign(K.size(), 0.0f);
+
+            // Only loads and diagonal of fixed DOFs are needed here
+            const long _layerElementsNum = (long)n*n*6;
+            #pragma omp parallel
+            {
+                const SlabPartition _part = SlabPartition::currentThread(size);
+                for(long el=_part.firstCubeLayer*_layerElementsNum;
+                    el<_part.lastCubeLayer*_layerElementsNum; ++el)
+                {
+                    const FixedTetrahedron element = _domain[el];
+
+                    MathUtils::Matrix::FixedMatrix<float,4*_DegreesOfFreedom_,4*_DegreesOfFreedom_> localK;
+                    MathUtils::Matrix::FixedMatrix<float,4*_DegreesOfFreedom_,1> f;
+                    for(int i=0; i<4*_DegreesOfFreedom_; ++i) f(i,0)=0;
+
+                    _cachedLocalK(K._cache, el, localK);
+
+                    _applyNeumannBCs(element,f);
+
+                    bool fixedMask[4*_DegreesOfFreedom_] = {false};
+                    _applyDirichletBCs(element,localK,f,fixedMask);
+
+                    for(long i=0; i<4; ++i)
+                    {
+                        if(!_part.owns(element.indexes[i])) continue;
+                        for(long p=0; p<_DegreesOfFreedom_; ++p)
+                        {
+                            long dof = element.indexes[i]*_DegreesOfFreedom_+p;
+                            loads[dof] += f(i*_DegreesOfFreedom_+p,0);
+                            if(fixedMask[i*_DegreesOfFreedom_+p])
+                            {
+                                K._fixed[dof] = 1;
+                                K._fixedDiagonal[dof] +=
+                                        localK(i*_DegreesOfFreedom_+p,i*_DegreesOfFreedom_+p);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        /// Same as solve(), but the global matrix is never assembled (see MatrixFreeOperator),
+        /// SLAE is solved on the host. Statistics are reported through error, iterations and time
+        public : void solveMatrixFree(
+            const double eps,
+            const int maxIteration,
+            std::vector<float> &out,
+            const bool useBiCG = false,
+            double *error = nullptr,
+            long *iterations = nullptr,
+            std::chrono::duration<double> *time = nullptr)
+        {
+            Timer _calculationTimer;
+            _calculationTimer.start();
+
+            MatrixFreeOperator<_DegreesOfFreedom_> K;
+            std::vector<float> f;
+
+            assembleMatrixFree(K, f);
+
+            out.assign(K.size(), 0.0f);
+
+            double _error = 0.0;
+            long _iterations = 0;
+            if(useBiCG)
+                _iterations = IterativeSolvers::BiCGStab(K, f, out, eps, maxIteration, &_error);
+            else
+                _iterations = IterativeSolvers::CG(K, f, out, eps, maxIteration, &_error);
+            if(error)*error = _error;
+            if(iterations)*iterations = _iterations;
+
+            _calculationTimer.stop();
             if(time) *time = _calculationTimer.getTimeSpan();
         }
 
@@ -370,13 +1443,13 @@ namespace FEM
             AbstractProblem<1>(domain){}
 
         /// [D]
-        public : static inline MathUtils::Matrix::StaticMatrix<float,3,3> DM(
+        public : static inline MathUtils::Matrix::FixedMatrix<float,3,3> DM(
                 const Characteristics *ch) noexcept
         {
-            return MathUtils::Matrix::StaticMatrix<float,3,3>(
-            {ch->heatConductionCoefficient, 0, 0,
-             0, ch->heatConductionCoefficient, 0,
-             0, 0, ch->heatConductionCoefficient});
+            return MathUtils::Matrix::FixedMatrix<float,3,3>{
+                ch->heatConductionCoefficient, 0, 0,
+                0, ch->heatConductionCoefficient, 0,
+                0, 0, ch->heatConductionCoefficient};
         }
         /// [K] = I{([L][N])^T[D][L][N]}dV = 1/3!*|[Jac]|([Jac]^-1[L][N])^T[D][Jac]^-1[L][N]
         public : static inline void KM(
@@ -384,19 +1457,20 @@ namespace FEM
                 const float *b,
                 const float *c,
                 const float *d,
-                const MathUtils::Matrix::StaticMatrix<float,3,3> &D,
-                MathUtils::Matrix::StaticMatrix<float,4,4> &output
+                const MathUtils::Matrix::FixedMatrix<float,3,3> &D,
+                MathUtils::Matrix::FixedMatrix<float,4,4> &output
                 ) noexcept
         {
             JacobiMatrix JacInv(a,b,c,d);
             float volume = - JacInv.inverse3x3() / 6.0f;
-            MathUtils::Matrix::StaticMatrix<float,3,4> JacInvGradN_SI1 = JacInv * gradN_SI1;
-            output = volume * JacInvGradN_SI1.T() * D * JacInvGradN_SI1;
+            MathUtils::Matrix::FixedMatrix<float,3,4> JacInvGradN_SI1;
+            JacInvGradN_SI1 = JacInv * gradN_SI1;
+            output = volume * (JacInvGradN_SI1.T() * D * JacInvGradN_SI1);
         }
 
         private  : inline void _assembleLocalK(
             const FixedTetrahedron &element,
-            MathUtils::Matrix::StaticMatrix<float,4,4> &output
+            MathUtils::Matrix::FixedMatrix<float,4,4> &output
             ) noexcept final
         {
             KM(element.a, element.b, element.c, element.d,
@@ -413,38 +1487,27 @@ namespace FEM
             AbstractProblem<3>(domain){}
 
         /// [D]
-        public : static inline MathUtils::Matrix::StaticMatrix<float,6,6> DM(
+        public : static inline MathUtils::Matrix::FixedMatrix<float,6,6> DM(
                 const Characteristics *ch) noexcept
         {
             const float &E = ch->elasticModulus;
             const float &v = ch->PoissonsRatio;
             const float c = E / (1 + v) / (1 - 2*v);
-            return MathUtils::Matrix::StaticMatrix<float,6,6>(
-            {c*(1-v),     c*v,     c*v,           0,           0,           0,
-                 c*v, c*(1-v),     c*v,           0,           0,           0,
-                 c*v,     c*v, c*(1-v),           0,           0,           0,
-                   0,       0,       0, c*(1-2*v)/2,           0,           0,
-                   0,       0,       0,           0, c*(1-2*v)/2,           0,
-                   0,       0,       0,           0,           0, c*(1-2*v)/2});
+            return MathUtils::Matrix::FixedMatrix<float,6,6>{
+                c*(1-v),     c*v,     c*v,           0,           0,           0,
+                    c*v, c*(1-v),     c*v,           0,           0,           0,
+                    c*v,     c*v, c*(1-v),           0,           0,           0,
+                      0,       0,       0, c*(1-2*v)/2,           0,           0,
+                      0,       0,       0,           0, c*(1-2*v)/2,           0,
+                      0,       0,       0,           0,           0, c*(1-2*v)/2};
         }
-        /// [K] = I{([L][N])^T[D][L][N]}dV = 1/3!*V[B]^T[D][B]
-        public : static inline void KM(
-                const float *a,
-                const float *b,
-                const float *c,
-                const float *d,
-                const MathUtils::Matrix::StaticMatrix<float,6,6> &D,
-                MathUtils::Matrix::StaticMatrix<float,12,12> &output
+        /// [B] = [L][N] by the inverse of TetrahedronMatrix
+        public : static inline void BM(
+                const TetrahedronMatrix &CInv,
+                MathUtils::Matrix::FixedMatrix<float,6,12> &B
                 ) noexcept
         {
-            TetrahedronMatrix CInv(a,b,c,d);
-            // [a0 a1 a2 a3]
-            // [b0 b1 b2 b3]
-            // [c0 c1 c2 c3]
-            // [d0 d1 d2 d3]
-            float volume = CInv.inverse4x4() / 6.0;
-            MathUtils::Matrix::StaticMatrix<float,6,12> B;
-            for(int i=0; i<6*12; ++i) B.data()[i]=0;
+            B.setZero();
             // [b0  0  0 | b1  0  0 | b2  0  0 | b3  0  0]
             // [ 0 c0  0 |  0 c1  0 |  0 c2  0 |  0 c3  0]
             // [ 0  0 d0 |  0  0 d1 |  0  0 d2 |  0  0 d3]
@@ -460,60 +1523,141 @@ namespace FEM
             B(4,2) = CInv(1,0); B(4,5) = CInv(1,1); B(4,8) = CInv(1,2); B(4,11) = CInv(1,3);
             B(5,1) = CInv(3,0); B(5,4) = CInv(3,1); B(5,7) = CInv(3,2); B(5,10) = CInv(3,3);
             B(5,2) = CInv(2,0); B(5,5) = CInv(2,1); B(5,8) = CInv(2,2); B(5,11) = CInv(2,3);
-            output = volume * B.T() * D * B;
+        }
+        /// [K] = I{([L][N])^T[D][L][N]}dV = 1/3!*V[B]^T[D][B]
+        public : static inline void KM(
+                const float *a,
+                const float *b,
+                const float *c,
+                const float *d,
+                const MathUtils::Matrix::FixedMatrix<float,6,6> &D,
+                MathUtils::Matrix::FixedMatrix<float,12,12> &output
+                ) noexcept
+        {
+            TetrahedronMatrix CInv(a,b,c,d);
+            // [a0 a1 a2 a3]
+            // [b0 b1 b2 b3]
+            // [c0 c1 c2 c3]
+            // [d0 d1 d2 d3]
+            float volume = CInv.inverse4x4() / 6.0;
+            MathUtils::Matrix::FixedMatrix<float,6,12> B;
+            BM(CInv, B);
+            output = volume * (B.T() * D * B);
         }
 
         private  : inline void _assembleLocalK(
             const FixedTetrahedron &element,
-            MathUtils::Matrix::StaticMatrix<float,12,12> &output
+            MathUtils::Matrix::FixedMatrix<float,12,12> &output
             ) noexcept final
         {
             KM(element.a, element.b, element.c, element.d,
                DM(element.characteristics),output);
         }
-////////////////////////////////////////////////////////////////////////////////////////////
-        /// \todo TEST!!!
-        /// [stress] = [D][L][N]{u}
+
+        /// [strain] = [B]{u}, [stress] = [D][strain] of all elements in one pass, averaged
+        /// over nodes with element volumes as weights, then von Mises and principal stresses
+        /// of the averaged tensors. Elements without material are skipped, nodes without
+        /// material get zeros.
+        /// All tetrahedrons of the same type t = index % 6 are congruent (see
+        /// LocalStiffnessCache), so [B] is calculated only 6 times.
+        /// Parallel by SlabPartition: every thread sums into its own nodes only, in the serial
+        /// order, so the result doesn't depend on the number of threads.
         /// displacement - is the output from 'solve()' function
-        /// axis - 0..5 {x,y,z,xy,yz,xz}
-        public : void calculateStress(
+        public : void calculateStressField(
                 const std::vector<float> &displacement,
-                const int axis,
-                std::vector<float> &stress) noexcept
+                StressField &field) const
         {
-            stress.resize(_domain.discreteSize()*_domain.discreteSize()*_domain.discreteSize());
-            for(long el=0; el< _domain.elementsNum(); ++el)
-            {
-                const FixedTetrahedron element = _domain[el];
-
-                MathUtils::Matrix::StaticMatrix<float,12,1> u;
-                for(long i=0; i<4; ++i)
-                    for(long p=0; p<3; ++p)
-                        u(i*3+p,0) = displacement[element.indexes[i]*3+p];
+            const int size = _domain.discreteSize();
+            const int n = size - 1;
+            const long nodesNum = _domain.nodesNum();
 
+            MathUtils::Matrix::FixedMatrix<float,6,12> B[6];
+            float volume[6];
+            long nodeOffsets[6][4];
+            for(int t=0; t<6; ++t)
+            {
+                const FixedTetrahedron element = _domain[t];
                 TetrahedronMatrix CInv(element.a,element.b,element.c,element.d);
-                //float volume = CInv.inverse4x4() / 6.0;
-                CInv.inverse4x4();
+                volume[t] = std::fabs(CInv.inverse4x4()) / 6.0f;
+                BM(CInv, B[t]);
+                for(int v=0; v<4; ++v)
+                    nodeOffsets[t][v] = element.indexes[v];
+            }
 
-                MathUtils::Matrix::StaticMatrix<float,6,12> B;
-                for(int i=0; i<6*12; ++i) B.data()[i]=0;
-                B(0,0) = CInv(1,0); B(0,3) = CInv(1,1); B(0,6) = CInv(1,2); B(0,9)  = CInv(1,3);
-                B(1,1) = CInv(2,0); B(1,4) = CInv(2,1); B(1,7) = CInv(2,2); B(1,10) = CInv(2,3);
-                B(2,2) = CInv(3,0); B(2,5) = CInv(3,1); B(2,8) = CInv(3,2); B(2,11) = CInv(3,3);
-                B(3,0) = CInv(2,0); B(3,3) = CInv(2,1); B(3,6) = CInv(2,2); B(3,9)  = CInv(2,3);
-                B(3,1) = CInv(1,0); B(3,4) = CInv(1,1); B(3,7) = CInv(1,2); B(3,10) = CInv(1,3);
-                B(4,0) = CInv(3,0); B(4,3) = CInv(3,1); B(4,6) = CInv(3,2); B(4,9)  = CInv(3,3);
-                B(4,2) = CInv(1,0); B(4,5) = CInv(1,1); B(4,8) = CInv(1,2); B(4,11) = CInv(1,3);
-                B(5,1) = CInv(3,0); B(5,4) = CInv(3,1); B(5,7) = CInv(3,2); B(5,10) = CInv(3,3);
-                B(5,2) = CInv(2,0); B(5,5) = CInv(2,1); B(5,8) = CInv(2,2); B(5,11) = CInv(2,3);
+            std::vector<MathUtils::Matrix::FixedMatrix<float,6,6>> D(_domain.MaterialsVector.size());
+            for(unsigned m=0; m<D.size(); ++m)
+                D[m] = DM(&_domain.MaterialsVector[m].characteristics);
 
-                MathUtils::Matrix::StaticMatrix<float,6,1> localStress;
-                //localStress = volume * DM(element.characteristics) * B * u;
-                localStress = DM(element.characteristics) * B * u;
+            field.assign(nodesNum);
+            std::vector<float> weights(nodesNum, 0.0f);
+            #pragma omp parallel
+            {
+                const SlabPartition _part = SlabPartition::currentThread(size);
+                MathUtils::Matrix::FixedMatrix<float,12,1> u;
+                MathUtils::Matrix::FixedMatrix<float,6,1> strain;
+                MathUtils::Matrix::FixedMatrix<float,6,1> stress;
+                for(int k=_part.firstCubeLayer; k<_part.lastCubeLayer; ++k)
+                    for(int j=0; j<n; ++j)
+                        for(int i=0; i<n; ++i)
+                        {
+                            const int m = _domain.materialIndex(i,j,k);
+                            if(m < 0) continue;
+                            const long base = i + (long)j*size + (long)k*size*size;
+                            for(int t=0; t<6; ++t)
+                            {
+                                for(int v=0; v<4; ++v)
+                                    for(int p=0; p<3; ++p)
+                                        u(v*3+p,0) = displacement[(base + nodeOffsets[t][v])*3+p];
+                                strain = B[t] * u;
+                                stress = D[m] * strain;
+                                for(int v=0; v<4; ++v)
+                                {
+                                    const long node = base + nodeOffsets[t][v];
+                                    if(!_part.owns(node)) continue;
+                                    weights[node] += volume[t];
+                                    for(int c=0; c<6; ++c)
+                                    {
+                                        field.stress[c][node] += volume[t] * stress(c,0);
+                                        field.strain[c][node] += volume[t] * strain(c,0);
+                                    }
+                                }
+                            }
+                        }
+            }
 
-                for(long i=0; i<4; ++i) stress[element.indexes[i]] = std::fabs(localStress(axis,0));
+            #pragma omp parallel for
+            for(long node=0; node<nodesNum; ++node)
+            {
+                if(weights[node] == 0.0f) continue;
+                float _stress[6];
+                float _principal[3];
+                for(int c=0; c<6; ++c)
+                {
+                    field.stress[c][node] /= weights[node];
+                    field.strain[c][node] /= weights[node];
+                    _stress[c] = field.stress[c][node];
+                }
+                field.vonMises[node] = StressField::calculateVonMises(_stress);
+                StressField::calculatePrincipal(_stress, _principal);
+                for(int c=0; c<3; ++c)
+                    field.principal[c][node] = _principal[c];
             }
         }
+
+        /// Absolute value of one stress component, see calculateStressField()
+        /// displacement - is the output from 'solve()' function
+        /// axis - 0..5 {x,y,z,xy,xz,yz}
+        public : void calculateStress(
+                const std::vector<float> &displacement,
+                const int axis,
+                std::vector<float> &stress) const
+        {
+            StressField _field;
+            calculateStressField(displacement, _field);
+            stress.swap(_field.stress[axis]);
+            for(float &_value : stress)
+                _value = std::fabs(_value);
+        }
 ////////////////////////////////////////////////////////////////////////////////////////////
         public : ~ElasticityProblem() noexcept final {}
     };
@@ -534,7 +1678,7 @@ namespace FEM
                 const float *c,
                 const float *d,
                 const Characteristics *ch,
-                MathUtils::Matrix::StaticMatrix<float,16,16> &output
+                MathUtils::Matrix::FixedMatrix<float,16,16> &output
                 ) noexcept
         {
             TetrahedronMatrix CInv(a,b,c,d);
@@ -543,8 +1687,8 @@ namespace FEM
             // [c0 c1 c2 c3]
             // [d0 d1 d2 d3]
             float volume = CInv.inverse4x4() / 6.0;
-            MathUtils::Matrix::StaticMatrix<float,9,16> B;
-            for(int i=0; i<9*16; ++i) B.data()[i]=0;
+            MathUtils::Matrix::FixedMatrix<float,9,16> B;
+            B.setZero();
             //     0  1  2  3    4  5  6  7    8  9 10 11   12 13 14 15
             // 0 [b0  0  0  0 | b1  0  0  0 | b2  0  0  0 | b3  0  0  0]
             // 1 [c0  0  0  0 | c1  0  0  0 | c2  0  0  0 | c3  0  0  0]
@@ -576,8 +1720,8 @@ namespace FEM
             float q = E*v/(1+v)/(1-2*v);
             float r = E/(2+2*v);
             float s = E*al/(1-2*v);
-            MathUtils::Matrix::StaticMatrix<float,9,9> D(
-                {h, 0, 0, 0, 0, 0, 0, 0, 0,
+            MathUtils::Matrix::FixedMatrix<float,9,9> D = {
+                 h, 0, 0, 0, 0, 0, 0, 0, 0,
                  0, h, 0, 0, 0, 0, 0, 0, 0,
                  0, 0, h, 0, 0, 0, 0, 0, 0,
                  0, 0, 0, p, q, q, 0, 0, 0,
@@ -585,7 +1729,7 @@ namespace FEM
                  0, 0, 0, q, q, p, 0, 0, 0,
                  0, 0, 0, 0, 0, 0, r, 0, 0,
                  0, 0, 0, 0, 0, 0, 0, r, 0,
-                 0, 0, 0, 0, 0, 0, 0, 0, r});
+                 0, 0, 0, 0, 0, 0, 0, 0, r};
 
             // [ 0 b0 c0 d0 |  0 b1 c1 d1 | ...]
             // [b0  0  0  0 | b1  0  0  0 | ...]
@@ -598,8 +1742,8 @@ namespace FEM
             // [d0  0  0  0 | d1  0  0  0 | ...]
             // ---------------------------------
             // [...         | ...         | ...]
-            MathUtils::Matrix::StaticMatrix<float,16,16> J; // = I{[N]^T[L]^T[J][N]}dV;
-            for(int i=0; i<16*16; ++i) J.data()[i]=0;
+            MathUtils::Matrix::FixedMatrix<float,16,16> J; // = I{[N]^T[L]^T[J][N]}dV;
+            J.setZero();
             for(int i=0; i<4; ++i)
                 for(int j=0; j<4; ++j)
                 {
@@ -617,7 +1761,7 @@ namespace FEM
 
         private  : inline void _assembleLocalK(
             const FixedTetrahedron &element,
-            MathUtils::Matrix::StaticMatrix<float,16,16> &output
+            MathUtils::Matrix::FixedMatrix<float,16,16> &output
             ) noexcept final
         {
             KM(element.a, element.b, element.c, element.d, element.characteristics, output);
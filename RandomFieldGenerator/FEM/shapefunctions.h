@@ -0,0 +1,125 @@
+#ifndef SHAPEFUNCTIONS
+#define SHAPEFUNCTIONS
+
+#include "fixedmatrix.h"
+
+namespace FEM
+{
+    /// Point of the tetrahedron in barycentric coordinates {L1, L2, L3, L4}.
+    /// Reference coordinates are x = L1, y = L2, z = L3, L4 = 1 - x - y - z,
+    /// so d/dx = d/dL1 - d/dL4 etc.
+    class BarycentricPoint
+    {
+        public : float L[4];
+    };
+
+    static constexpr BarycentricPoint SIMPLEX_CENTROID = {{0.25f, 0.25f, 0.25f, 0.25f}};
+
+    /// Shape functions of simplex (tetrahedron) elements and their derivatives by
+    /// barycentric coordinates. Everything is constexpr, so reference operators
+    /// (see SimplexReferenceOperators) are built by the compiler, not at start-up.
+    template <int _order_> class SimplexShapeFunctions;
+
+    /// Linear, nodes are vertices, N_i = L_i
+    template <> class SimplexShapeFunctions<1>
+    {
+        public : static const int nodesNum = 4;
+
+        public : static constexpr float coordinate(const int node, const int m) noexcept {
+            return node == m ? 1.0f : 0.0f;}
+        public : static constexpr float value(const int node, const BarycentricPoint &p) noexcept {
+            return p.L[node];}
+        /// dN_node/dL_m
+        public : static constexpr float dL(
+                const int node, const int m, const BarycentricPoint &) noexcept {
+            return node == m ? 1.0f : 0.0f;}
+    };
+
+    /// Quadratic, nodes 0..3 are vertices, N_i = L_i(2L_i - 1),
+    /// nodes 4..9 are middles of edges 01, 12, 02, 03, 13, 23 (VTK order), N_ab = 4L_aL_b
+    template <> class SimplexShapeFunctions<2>
+    {
+        public : static const int nodesNum = 10;
+
+        /// Vertices of the edge node, end = 0, 1
+        public : static constexpr int edgeVertex(const int node, const int end) noexcept
+        {
+            return end == 0 ?
+                        (node == 5 || node == 8 ? 1 : node == 9 ? 2 : 0) :
+                        (node == 4 ? 1 : node == 5 || node == 6 ? 2 : 3);
+        }
+        public : static constexpr float coordinate(const int node, const int m) noexcept
+        {
+            return node < 4 ? (node == m ? 1.0f : 0.0f) :
+                              (edgeVertex(node,0) == m || edgeVertex(node,1) == m ? 0.5f : 0.0f);
+        }
+        public : static constexpr float value(const int node, const BarycentricPoint &p) noexcept
+        {
+            return node < 4 ? p.L[node] * (2.0f * p.L[node] - 1.0f) :
+                              4.0f * p.L[edgeVertex(node,0)] * p.L[edgeVertex(node,1)];
+        }
+        public : static constexpr float dL(
+                const int node, const int m, const BarycentricPoint &p) noexcept
+        {
+            return node < 4 ? (node == m ? 4.0f * p.L[m] - 1.0f : 0.0f) :
+                   edgeVertex(node,0) == m ? 4.0f * p.L[edgeVertex(node,1)] :
+                   edgeVertex(node,1) == m ? 4.0f * p.L[edgeVertex(node,0)] : 0.0f;
+        }
+    };
+
+    template <int... _indexes_> class IndexSequence {};
+    template <int _n_, int... _indexes_> class MakeIndexSequence :
+            public MakeIndexSequence<_n_ - 1, _n_ - 1, _indexes_...> {};
+    template <int... _indexes_> class MakeIndexSequence<0, _indexes_...>
+    {
+        public : typedef IndexSequence<_indexes_...> type;
+    };
+
+    /// Reference operators of the element, [grad][N] and [strain][N], i.e. [L][N]
+    /// in the reference coordinates, see Jacobi matrix for the mapping to the real ones.
+    /// Linear operators are constant, others depend on the point (e.g. quadrature point)
+    template <typename _ShapeFunctions_> class SimplexReferenceOperators
+    {
+        public : static const int nodesNum = _ShapeFunctions_::nodesNum;
+        public : typedef MathUtils::Matrix::FixedMatrix<float,3,nodesNum> GradientMatrix;
+        public : typedef MathUtils::Matrix::FixedMatrix<float,6,3*nodesNum> StrainMatrix;
+
+        /// dN_node/dx_axis
+        public : static constexpr float gradient(
+                const int axis, const int node, const BarycentricPoint &p) noexcept {
+            return _ShapeFunctions_::dL(node, axis, p) - _ShapeFunctions_::dL(node, 3, p);}
+
+        /// Strain of the node displacement, for vector fields {ux, uy, uz} per node
+        /// Strain tensor    [d/dx    0    0]
+        ///                  [   0 d/dy    0]
+        ///                  [   0    0 d/dz]
+        ///                  [d/dy d/dx    0]
+        ///                  [d/dz    0 d/dx]
+        ///                  [   0 d/dz d/dy]
+        public : static constexpr float strain(
+                const int row, const int col, const BarycentricPoint &p) noexcept
+        {
+            return row < 3 ? (col % 3 == row ? gradient(row, col / 3, p) : 0.0f) :
+                   row == 3 ? (col % 3 == 0 ? gradient(1, col / 3, p) :
+                               col % 3 == 1 ? gradient(0, col / 3, p) : 0.0f) :
+                   row == 4 ? (col % 3 == 0 ? gradient(2, col / 3, p) :
+                               col % 3 == 2 ? gradient(0, col / 3, p) : 0.0f) :
+                              (col % 3 == 1 ? gradient(2, col / 3, p) :
+                               col % 3 == 2 ? gradient(1, col / 3, p) : 0.0f);
+        }
+
+        public : static constexpr GradientMatrix gradientN(const BarycentricPoint &p) noexcept {
+            return _gradientN(p, typename MakeIndexSequence<3*nodesNum>::type());}
+        public : static constexpr StrainMatrix strainN(const BarycentricPoint &p) noexcept {
+            return _strainN(p, typename MakeIndexSequence<18*nodesNum>::type());}
+
+        private: template <int... _indexes_> static constexpr GradientMatrix _gradientN(
+                const BarycentricPoint &p, IndexSequence<_indexes_...>) noexcept {
+            return GradientMatrix{{gradient(_indexes_ / nodesNum, _indexes_ % nodesNum, p)...}};}
+        private: template <int... _indexes_> static constexpr StrainMatrix _strainN(
+                const BarycentricPoint &p, IndexSequence<_indexes_...>) noexcept {
+            return StrainMatrix{{strain(_indexes_ / (3*nodesNum), _indexes_ % (3*nodesNum), p)...}};}
+    };
+}
+
+#endif // SHAPEFUNCTIONS
@@ -0,0 +1,53 @@
+#ifndef SLABPARTITION
+#define SLABPARTITION
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace FEM
+{
+    /// Owner-computes partition of the element loop on the structured grid
+    /// (size^3 nodes, (size-1)^3 voxels of 6 tetrahedrons), used by the parallel assembly.
+    /// Each part owns the nodes of z-layers [firstNodeLayer, lastNodeLayer) and walks
+    /// the voxel layers [firstCubeLayer, lastCubeLayer), which touch them, in the
+    /// increasing element order, but writes only rows of its own nodes.
+    /// So no locks are needed, and every row receives local contributions in the same
+    /// order as in the serial loop, i.e. the result is bit-identical for any number of threads.
+    /// (Graph coloring would also avoid conflicts, but changes summation order)
+    /// Only one voxel layer per part is calculated twice.
+    struct SlabPartition
+    {
+        public: int firstNodeLayer;
+        public: int lastNodeLayer;
+        public: int firstCubeLayer;
+        public: int lastCubeLayer;
+        public: long firstNode;
+        public: long lastNode;
+
+        public: SlabPartition(const int size, const int part, const int partsNum) noexcept
+        {
+            firstNodeLayer = (long)size * part / partsNum;
+            lastNodeLayer = (long)size * (part+1) / partsNum;
+            firstCubeLayer = firstNodeLayer > 0 ? firstNodeLayer-1 : 0;
+            lastCubeLayer = lastNodeLayer < size-1 ? lastNodeLayer : size-1;
+            if(firstNodeLayer == lastNodeLayer) lastCubeLayer = firstCubeLayer;
+            firstNode = (long)firstNodeLayer * size * size;
+            lastNode = (long)lastNodeLayer * size * size;
+        }
+        public: bool owns(const long node) const noexcept {
+            return node >= firstNode && node < lastNode;}
+
+        /// Partition for the current thread (call it inside of the parallel region)
+        public: static SlabPartition currentThread(const int size) noexcept
+        {
+#ifdef _OPENMP
+            return SlabPartition(size, omp_get_thread_num(), omp_get_num_threads());
+#else
+            return SlabPartition(size, 0, 1);
+#endif
+        }
+    };
+}
+
+#endif // SLABPARTITION
@@ -0,0 +1,87 @@
+#ifndef SOLVERCONFIGURATION
+#define SOLVERCONFIGURATION
+
+#include <vector>
+#include <chrono>
+
+namespace FEM
+{
+    class DirectSolver;
+
+    /// Parameters of AbstractProblem::solve()
+    struct SolverConfiguration
+    {
+        public: enum SOLVER{
+            CG          = 0,    // symmetric problems
+            BICGSTAB    = 1     // non-symmetric problems, e.g. ThermoelasticityProblem
+        };
+        public: enum PRECONDITIONER{
+            NONE                = 0,
+            JACOBI              = 1,    // diagonal
+            BLOCK_JACOBI        = 2,    // inverse of the DOFxDOF block of each node, host only
+            ILU0                = 3,
+            ILUT                = 4,    // device only
+            GEOMETRIC_MULTIGRID = 5     // see GeometricMultigrid, host only
+        };
+        public: enum PRECISION{
+            SINGLE  = 0,
+            MIXED   = 1     // float solver inside double iterative refinement, host only
+        };
+        public: enum BACKEND{
+            DEVICE  = 0,    // ViennaCL solvers and preconditioners
+            HOST    = 1,    // IterativeSolvers, the only one which records residual history
+            DIRECT  = 2,    // DirectSolver on the host, LDL^T for CG, LU for BICGSTAB
+            AUTO    = 3     // DIRECT for small problems (see directMaxRowsPerLoadCase),
+                            // iterative (DEVICE) for larger ones
+        };
+
+        public: SOLVER solver = CG;
+        public: PRECONDITIONER preconditioner = NONE;
+        /// Float solvers stagnate about eps = 1e-7, MIXED reaches 1e-8 and below
+        /// (see IterativeSolvers::IterativeRefinement())
+        public: PRECISION precision = SINGLE;
+        /// Host-only preconditioners and MIXED precision switch the backend to HOST
+        public: BACKEND backend = DEVICE;
+        public: double eps = 1e-6;
+        public: long maxIteration = 10000;
+        /// Solution vector of proper size, given to solve(), is used as initial guess
+        /// (e.g. the previous step of a parameter sweep)
+        public: bool useInitialGuess = false;
+        /// MIXED precision parameters, maxIteration limits each inner solve
+        public: double innerEps = 1e-4;
+        public: long maxRefinements = 20;
+        /// ILUT parameters
+        public: int ILUTEntriesPerRow = 20;
+        public: double ILUTDropTolerance = 1e-4;
+        /// AUTO backend factorizes matrices up to directMaxRowsPerLoadCase * (load cases):
+        /// simplicial factorization of 3D meshes costs about rows^2.4, CG about rows^1.3,
+        /// but triangular solves are cheap, so the factorization pays off only for small
+        /// matrices or many load cases. E.g. ElasticityProblem of RVE 8^3 (1536 rows) is
+        /// factorized as fast as CG solves it, RVE 16^3 pays off from ~17 load cases.
+        /// AUTO also falls back to the iterative solver, if the factorization breaks down
+        /// or its residual is above eps
+        public: long directMaxRowsPerLoadCase = 1000;
+        /// DIRECT backend: if given, the factorization is kept there, so the next solve()
+        /// with the matrix of the same pattern reuses its symbolic part (see DirectSolver)
+        public: DirectSolver *directSolver = nullptr;
+    };
+
+    /// Output of AbstractProblem::solve()
+    struct SolverStatistics
+    {
+        public: long iterations = 0;
+        /// |b - A*x| / |b|
+        public: double error = 0.0;
+        /// Relative residual before the first and after each iteration (HOST backend),
+        /// or before each refinement step (MIXED precision, iterations are the inner ones)
+        public: std::vector<double> residualHistory;
+        public: std::chrono::duration<double> assemblyTime = std::chrono::duration<double>(0);
+        /// Preconditioner construction
+        public: std::chrono::duration<double> setupTime = std::chrono::duration<double>(0);
+        public: std::chrono::duration<double> solveTime = std::chrono::duration<double>(0);
+        public: std::chrono::duration<double> totalTime() const noexcept {
+            return assemblyTime + setupTime + solveTime;}
+    };
+}
+
+#endif // SOLVERCONFIGURATION
@@ -1,44 +1,32 @@
 #ifndef STATICCONSTANTS
 #define STATICCONSTANTS
 
-#include "derivative.h"
-#include "weakoperator.h"
-#include "fespacesimplex.h"
+#include "shapefunctions.h"
 
-/// Need this to avoid "static initialization order fiasco"
-/// see https://isocpp.org/wiki/faq/ctors#static-init-order
-/// \todo test it
+/// Reference operators of the elements, they are constexpr, so there is no
+/// "static initialization order fiasco" and nothing is calculated at start-up
+/// (see symbolicconstants.h for their symbolic derivation)
 namespace FEM
 {
-    static const Polynomial::Variable L1(/*L1_literal,*/ L1_id);
-    static const Polynomial::Variable L2(/*L2_literal,*/ L2_id);
-    static const Polynomial::Variable L3(/*L3_literal,*/ L3_id);
-    static const Polynomial::Variable L4(/*L4_literal,*/ L4_id);
+    typedef SimplexReferenceOperators<SimplexShapeFunctions<1>> LinearSimplexOperators;
+    typedef SimplexReferenceOperators<SimplexShapeFunctions<2>> QuadraticSimplexOperators;
 
-    static const Derivative d_dL1(L1);
-    static const Derivative d_dL2(L2);
-    static const Derivative d_dL3(L3);
-    static const Derivative d_dL4(L4);
-
-    static const DerivativeMapped d_dx(d_dL1, d_dL4);
-    static const DerivativeMapped d_dy(d_dL2, d_dL4);
-    static const DerivativeMapped d_dz(d_dL3, d_dL4);
-
-    static const Gradient grad(d_dx, d_dy, d_dz);
-    static const StrainTensor strain(d_dx, d_dy, d_dz);
-
-    // N - Interpolation functions
     // S - Simplex (topology)
     // I - Isoparametric element
     // number - Nodal degrees of freedom
-    // L - Linear differential operator
-    /// \todo make arguments input
-    static const SimplexIsoparametricFESpace<1>::LinearInterpolationFunctions N_SI1;
-    static const SimplexIsoparametricFESpace<3>::LinearInterpolationFunctions N_SI3;
-
-    static const SimplexIsoparametrixGradientN gradN_SI1(grad, N_SI1);
-    static const SimplexIsoparametrixStrainN strainN_SI3(strain, N_SI3);
+    // [1 0 0 -1]
+    // [0 1 0 -1]
+    // [0 0 1 -1]
+    static constexpr LinearSimplexOperators::GradientMatrix gradN_SI1 =
+            LinearSimplexOperators::gradientN(SIMPLEX_CENTROID);
+    // [1 0 0 0 0 0 0 0 0 -1  0  0]
+    // [0 0 0 0 1 0 0 0 0  0 -1  0]
+    // [0 0 0 0 0 0 0 0 1  0  0 -1]
+    // [0 1 0 1 0 0 0 0 0 -1 -1  0]
+    // [0 0 1 0 0 0 1 0 0 -1  0 -1]
+    // [0 0 0 0 0 1 0 1 0  0 -1 -1]
+    static constexpr LinearSimplexOperators::StrainMatrix strainN_SI3 =
+            LinearSimplexOperators::strainN(SIMPLEX_CENTROID);
 }
 
 #endif // STATICCONSTANTS
-
@@ -0,0 +1,76 @@
+#ifndef STRESSFIELD
+#define STRESSFIELD
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+namespace FEM
+{
+    /// Nodal fields of the elasticity solution, structure of arrays, one value per node.
+    /// Components are in the notation of ElasticityProblem::DM(): {xx, yy, zz, xy, xz, yz},
+    /// shear strains are engineering ones (2*e_xy), shear stresses are tensor ones.
+    /// Built by ElasticityProblem::calculateStressField()
+    struct StressField
+    {
+        public: std::vector<float> stress[6];
+        public: std::vector<float> strain[6];
+        public: std::vector<float> vonMises;
+        /// Principal stresses, principal[0] >= principal[1] >= principal[2]
+        public: std::vector<float> principal[3];
+
+        public: long size() const noexcept {return vonMises.size();}
+
+        /// All fields are set to zeros
+        public: void assign(const long nodesNum)
+        {
+            for(int c=0; c<6; ++c)
+            {
+                stress[c].assign(nodesNum, 0.0f);
+                strain[c].assign(nodesNum, 0.0f);
+            }
+            vonMises.assign(nodesNum, 0.0f);
+            for(int c=0; c<3; ++c)
+                principal[c].assign(nodesNum, 0.0f);
+        }
+
+        /// s = {xx, yy, zz, xy, xz, yz}
+        public: static float calculateVonMises(const float *s) noexcept
+        {
+            return std::sqrt(0.5f * ((s[0]-s[1])*(s[0]-s[1]) +
+                                     (s[1]-s[2])*(s[1]-s[2]) +
+                                     (s[2]-s[0])*(s[2]-s[0])) +
+                             3.0f * (s[3]*s[3] + s[4]*s[4] + s[5]*s[5]));
+        }
+
+        /// Eigenvalues of the symmetric tensor s = {xx, yy, zz, xy, xz, yz} in descending order,
+        /// closed form (trigonometric solution of the characteristic equation)
+        public: static void calculatePrincipal(const float *s, float *principal) noexcept
+        {
+            const double _offDiagonal = (double)s[3]*s[3] + (double)s[4]*s[4] + (double)s[5]*s[5];
+            if(_offDiagonal == 0.0)
+            {
+                for(int c=0; c<3; ++c)
+                    principal[c] = s[c];
+                std::sort(principal, principal + 3, [](float a, float b){return a > b;});
+                return;
+            }
+            const double _mean = ((double)s[0] + s[1] + s[2]) / 3.0;
+            const double _xx = s[0] - _mean, _yy = s[1] - _mean, _zz = s[2] - _mean;
+            const double _p = std::sqrt((_xx*_xx + _yy*_yy + _zz*_zz + 2.0*_offDiagonal) / 6.0);
+            // det((s - mean*I)/p) / 2
+            const double _r = (_xx * (_yy*_zz - (double)s[5]*s[5]) -
+                               s[3] * ((double)s[3]*_zz - (double)s[5]*s[4]) +
+                               s[4] * ((double)s[3]*s[5] - _yy*s[4])) / (2.0 * _p*_p*_p);
+            const double _phi = std::acos(std::max(-1.0, std::min(1.0, _r))) / 3.0;
+            const double _2pi_3 = 2.0943951023931957;
+            const double _max = _mean + 2.0 * _p * std::cos(_phi);
+            const double _min = _mean + 2.0 * _p * std::cos(_phi + _2pi_3);
+            principal[0] = _max;
+            principal[1] = 3.0 * _mean - _max - _min;
+            principal[2] = _min;
+        }
+    };
+}
+
+#endif // STRESSFIELD
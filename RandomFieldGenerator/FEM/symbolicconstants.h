@@ -0,0 +1,39 @@
+#ifndef SYMBOLICCONSTANTS
+#define SYMBOLICCONSTANTS
+
+#include "derivative.h"
+#include "weakoperator.h"
+#include "fespacesimplex.h"
+
+/// Symbolic derivation of the linear simplex operators by Polynomial and Derivative.
+/// Numeric operators are built at compile time (see staticconstants.h and shapefunctions.h),
+/// these are kept only to verify them (see TESTS), so don't include it into the FEM code:
+/// polynomial lists are built at the static initialization
+namespace FEM
+{
+    static const Polynomial::Variable L1(/*L1_literal,*/ L1_id);
+    static const Polynomial::Variable L2(/*L2_literal,*/ L2_id);
+    static const Polynomial::Variable L3(/*L3_literal,*/ L3_id);
+    static const Polynomial::Variable L4(/*L4_literal,*/ L4_id);
+
+    static const Derivative d_dL1(L1);
+    static const Derivative d_dL2(L2);
+    static const Derivative d_dL3(L3);
+    static const Derivative d_dL4(L4);
+
+    static const DerivativeMapped d_dx(d_dL1, d_dL4);
+    static const DerivativeMapped d_dy(d_dL2, d_dL4);
+    static const DerivativeMapped d_dz(d_dL3, d_dL4);
+
+    static const Gradient grad(d_dx, d_dy, d_dz);
+    static const StrainTensor strain(d_dx, d_dy, d_dz);
+
+    // N - Interpolation functions
+    // S - Simplex (topology)
+    // I - Isoparametric element
+    // number - Nodal degrees of freedom
+    static const SimplexIsoparametricFESpace<1>::LinearInterpolationFunctions N_SI1;
+    static const SimplexIsoparametricFESpace<3>::LinearInterpolationFunctions N_SI3;
+}
+
+#endif // SYMBOLICCONSTANTS
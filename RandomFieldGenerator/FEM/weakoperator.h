@@ -22,23 +22,6 @@ namespace FEM
         public: ~Gradient() noexcept final {}
     };
 
-    class SimplexIsoparametrixGradientN : public MathUtils::Matrix::StaticMatrix<float,3,4>
-    {
-        // [1 0 0 -1]
-        // [0 1 0 -1]
-        // [0 0 1 -1]
-        public: SimplexIsoparametrixGradientN(
-                const Gradient &grad,
-                const SimplexIsoparametricFESpace<1>::LinearInterpolationFunctions &N) noexcept
-        {
-            MathUtils::Matrix::StaticMatrix<Polynomial,3,4> gradN = grad * N;
-            for(int i=0; i<3; ++i)
-                for(int j=0; j<4; ++j)
-                    (*this)(i,j) = gradN(i,j).calculate();
-        }
-        public: ~SimplexIsoparametrixGradientN() noexcept final {}
-    };
-
     // Strain tensor    [d/dx    0    0]
     //                  [   0 d/dy    0]
     //                  [   0    0 d/dz]
@@ -64,26 +47,6 @@ namespace FEM
         }
         public: ~StrainTensor() noexcept final {}
     };
-
-    // [1 0 0 0 0 0 0 0 0 -1  0  0]
-    // [0 0 0 0 1 0 0 0 0  0 -1  0]
-    // [0 0 0 0 0 0 0 0 1  0  0 -1]
-    // [0 1 0 1 0 0 0 0 0 -1 -1  0]
-    // [0 0 1 0 0 0 1 0 0 -1  0 -1]
-    // [0 0 0 0 0 1 0 1 0  0 -1 -1]
-    class SimplexIsoparametrixStrainN : public MathUtils::Matrix::StaticMatrix<float,6,12>
-    {
-        public: SimplexIsoparametrixStrainN(
-                const StrainTensor &strain,
-                const SimplexIsoparametricFESpace<3>::LinearInterpolationFunctions &N) noexcept
-        {
-            MathUtils::Matrix::StaticMatrix<Polynomial,6,12> strainN = strain * N;
-            for(int i=0; i<6; ++i)
-                for(int j=0; j<12; ++j)
-                    (*this)(i,j) = strainN(i,j).calculate();
-        }
-        public: ~SimplexIsoparametrixStrainN() noexcept final {}
-    };
 }
 
 #endif // WEAKOPERATOR
@@ -44,6 +44,10 @@ win32{
 DEFINES += VIENNACL_WITH_OPENCL
 INCLUDEPATH += E:\ViennaCL\ViennaCL-1.6.2\
 
+#OpenMP (parallel assembly, see FEM/slabpartition.h)
+QMAKE_CXXFLAGS += -fopenmp
+LIBS += -fopenmp
+
 #For debugging
 CONFIG(debug, release|debug):DEFINES += _DEBUG_MODE
 
@@ -111,11 +115,13 @@ SOURCES += main.cpp \
     TESTS/test_fespacesimplex.cpp \
     TESTS/test_problem.cpp \
     TESTS/test_domain.cpp \
+    TESTS/test_representativevolumeelement.cpp \
     TESTS/test_synthesis.cpp
 
 HEADERS += \
     CLMANAGER/clmanager.h \
     TESTS/tests_runner.h \
+    TESTS/benchmarks_runner.h \
     TESTS/test_clmanager.h \
     UI/volumeglrender.h \
     representativevolumeelement.h \
@@ -144,7 +150,14 @@ HEADERS += \
     UI/inclusionpreviewglrender.h \
     UI/curvepreviewglrender.h \
     timer.h \
+    parallelfor.h \
+    fft.h \
+    bucketgrid.h \
+    distancetransform.h \
+    rvefile.h \
+    backingstore.h \
     matrix.h \
+    fixedmatrix.h \
     TESTS/test_matrix.h \
     FEM/weakoperator.h \
     FEM/derivative.h \
@@ -155,10 +168,24 @@ HEADERS += \
     FEM/jacobimatrix.h \
     TESTS/test_fespacesimplex.h \
     FEM/domain.h \
+    FEM/phaselabels.h \
     FEM/problem.h \
+    FEM/matrixfreeoperator.h \
+    FEM/iterativesolvers.h \
+    FEM/csrmatrix.h \
+    FEM/slabpartition.h \
+    FEM/localstiffnesscache.h \
+    FEM/multigrid.h \
+    FEM/preconditioners.h \
+    FEM/solverconfiguration.h \
+    FEM/directsolver.h \
     FEM/staticconstants.h \
+    FEM/symbolicconstants.h \
+    FEM/shapefunctions.h \
+    FEM/stressfield.h \
     TESTS/test_problem.h \
     TESTS/test_domain.h \
+    TESTS/test_representativevolumeelement.h \
     SYNTHESIS/synthesis.h \
     TESTS/test_synthesis.h \
     _SIMULATIONS/al_sic.h \
@@ -12,14 +12,28 @@
 
 namespace Synthesis
 {
-    /// \todo some bug, if accuracy is 1e-8f
+    /// Float solvers stagnate about 1e-7, so smaller eps switches to the mixed precision
+    inline FEM::SolverConfiguration _solverConfiguration(const double eps, const int maxIteration)
+    {
+        FEM::SolverConfiguration configuration;
+        configuration.eps = eps;
+        configuration.maxIteration = maxIteration;
+        if(eps < 1e-6)
+            configuration.precision = FEM::SolverConfiguration::MIXED;
+        return configuration;
+    }
+
+    /// periodicSides - TOP-BOTTOM and FRONT-BACK sides are periodic (see
+    /// BoundaryConditionsManager::addPeriodicBC()) instead of insulated, so the effective
+    /// coefficient of the periodic RVE converges with smaller RVE size
     inline void getEffectiveHeatConductionCharacteristic(
             const FEM::Domain &RVEDomain,
             float &effHeatConductionCoefficient,
             float &minHeatConductionCoefficient,
             float &maxHeatConductionCoefficient,
             const double eps = 1e-6,
-            const int maxIteration = 10000) noexcept
+            const int maxIteration = 10000,
+            const bool periodicSides = false) noexcept
     {
         // need this to get into corresponding floating point numbers
         float _maxCoeff = RVEDomain.MaterialsVector[0].characteristics.heatConductionCoefficient;
@@ -31,8 +45,13 @@ namespace Synthesis
         FEM::HeatConductionProblem problem(RVEDomain);
         problem.BCManager.addNeumannBC(FEM::LEFT, {flux});
         problem.BCManager.addDirichletBC(FEM::RIGHT,{_T0});
+        if(periodicSides)
+        {
+            problem.BCManager.addPeriodicBC(FEM::TOP);
+            problem.BCManager.addPeriodicBC(FEM::FRONT);
+        }
         std::vector<float> temperature;
-        problem.solve(eps,maxIteration,temperature);
+        problem.solve(_solverConfiguration(eps, maxIteration),temperature);
 
         // h = d/R = d*q/dT
         float effdT = 0.0f;
@@ -59,7 +78,8 @@ namespace Synthesis
         maxHeatConductionCoefficient = flux * RVEDomain.size() / mindT;
     }
 
-    /// \todo some bug, if accuracy is 1e-8f
+    /// displacement - solution of the previous call (e.g. previous step of the sweep,
+    /// where RVE is slightly changed) is used as initial guess, and it is replaced by the new one
     inline void getEffectiveElasticityCharacteristics(
             const FEM::Domain &RVEDomain,
             float &effElasticModulus,
@@ -68,8 +88,9 @@ namespace Synthesis
             float &effPoissonsRatio,
             float &minPoissonsRatio,
             float &maxPoissonsRatio,
+            std::vector<float> &displacement,   // each three numbers are nodal ux, uy and uz
             const double eps = 1e-6,
-            const int maxIteration = 10000) noexcept
+            const int maxIteration = 10000)
     {
         // need this to get into corresponding floating point numbers
         // q = dux*E/d
@@ -86,8 +107,9 @@ namespace Synthesis
         problem.BCManager.addDirichletBC(FEM::RIGHT,{_U0,0,0});
         problem.BCManager.DirichletBCs[FEM::RIGHT]->setFloating(1); // uy0
         problem.BCManager.DirichletBCs[FEM::RIGHT]->setFloating(2); // uz0
-        std::vector<float> displacement;    // each three numbers are nodal ux, uy and uz
-        problem.solve(eps,maxIteration,displacement);
+        FEM::SolverConfiguration configuration = _solverConfiguration(eps, maxIteration);
+        configuration.useInitialGuess = true;
+        problem.solve(configuration,displacement);
 
         // E = d*q/dux
         float effdux = 0.0f;
@@ -132,8 +154,121 @@ namespace Synthesis
         minPoissonsRatio = minduy / maxdux;
         maxPoissonsRatio = maxduy / mindux;
     }
-    /// \todo some bug, if accuracy is 1e-8f
+    inline void getEffectiveElasticityCharacteristics(
+            const FEM::Domain &RVEDomain,
+            float &effElasticModulus,
+            float &minElasticModulus,
+            float &maxElasticModulus,
+            float &effPoissonsRatio,
+            float &minPoissonsRatio,
+            float &maxPoissonsRatio,
+            const double eps = 1e-6,
+            const int maxIteration = 10000) noexcept
+    {
+        std::vector<float> displacement;
+        getEffectiveElasticityCharacteristics(
+                    RVEDomain,
+                    effElasticModulus, minElasticModulus, maxElasticModulus,
+                    effPoissonsRatio, minPoissonsRatio, maxPoissonsRatio,
+                    displacement, eps, maxIteration);
+    }
+
+    /// Elastic moduli and Poisson's ratios for the loads along x, y and z.
+    /// Symmetry conditions ux=0 (RIGHT), uy=0 (TOP) and uz=0 (BACK) are the same
+    /// for all load cases, so the matrix and the preconditioner are built once,
+    /// only the loads (LEFT, BOTTOM or FRONT side) are reassembled.
+    /// effPoissonsRatio[d] = |du[(d+1)%3]| / |du[d]| for the load along d
+    /// displacements - initial guess and output, see getEffectiveElasticityCharacteristics()
+    /// Symmetry conditions fix rigid motions, so small problems are factorized
+    /// (see SolverConfiguration::AUTO), directSolver (if given) keeps the factorization
+    /// between calls, e.g. its symbolic part is reused by the sweep over materials
+    inline void getEffectiveElasticityCharacteristicsXYZ(
+            const FEM::Domain &RVEDomain,
+            float effElasticModulus[3],
+            float effPoissonsRatio[3],
+            std::vector<std::vector<float>> &displacements,
+            const double eps = 1e-6,
+            const int maxIteration = 10000,
+            FEM::DirectSolver *directSolver = nullptr)
+    {
+        float _maxCoeff = RVEDomain.MaterialsVector[0].characteristics.elasticModulus;
+        for(auto &curMaterial : RVEDomain.MaterialsVector)
+            if(curMaterial.characteristics.elasticModulus > _maxCoeff)
+                _maxCoeff = curMaterial.characteristics.elasticModulus;
+        float flux = _DELTA_U * _maxCoeff / RVEDomain.size();
+
+        const FEM::SIDES _loadedSides[3] = {FEM::LEFT, FEM::BOTTOM, FEM::FRONT};
+        FEM::ElasticityProblem problem(RVEDomain);
+        auto _setBCs = [&](const int direction)
+        {
+            problem.BCManager.cleanBCs();
+            problem.BCManager.addDirichletBC(FEM::RIGHT,{_U0,0,0});
+            problem.BCManager.DirichletBCs[FEM::RIGHT]->setFloating(1);
+            problem.BCManager.DirichletBCs[FEM::RIGHT]->setFloating(2);
+            problem.BCManager.addDirichletBC(FEM::TOP,{0,_U0,0});
+            problem.BCManager.DirichletBCs[FEM::TOP]->setFloating(0);
+            problem.BCManager.DirichletBCs[FEM::TOP]->setFloating(2);
+            problem.BCManager.addDirichletBC(FEM::BACK,{0,0,_U0});
+            problem.BCManager.DirichletBCs[FEM::BACK]->setFloating(0);
+            problem.BCManager.DirichletBCs[FEM::BACK]->setFloating(1);
+            switch (direction) {
+            case 0: problem.BCManager.addNeumannBC(_loadedSides[0], {flux,0,0}); break;
+            case 1: problem.BCManager.addNeumannBC(_loadedSides[1], {0,flux,0}); break;
+            case 2: problem.BCManager.addNeumannBC(_loadedSides[2], {0,0,flux}); break;
+            }
+        };
+
+        FEM::CSRMatrix K;
+        std::vector<std::vector<float>> loads(3);
+        _setBCs(0);
+        problem.assembleCSR(K, loads[0]);
+        for(int d=1; d<3; ++d)
+        {
+            _setBCs(d);
+            problem.assembleLoads(loads[d]);
+        }
+
+        FEM::SolverConfiguration configuration = _solverConfiguration(eps, maxIteration);
+        configuration.useInitialGuess = true;
+        configuration.backend = FEM::SolverConfiguration::AUTO;
+        configuration.directSolver = directSolver;
+        problem.solve(configuration, K, loads, displacements);
+
+        int discreteSize = RVEDomain.discreteSize();
+        auto _node = [discreteSize](const int c[3]) -> long {
+            return c[0] + (long)c[1]*discreteSize + (long)c[2]*discreteSize*discreteSize;};
+        for(int d=0; d<3; ++d)
+        {
+            const std::vector<float> &displacement = displacements[d];
+            const int e = (d+1) % 3;
+            const int t = (d+2) % 3;
+
+            // E = d*q/du, du on the loaded side
+            float effdu = 0.0f;
+            // v = |due|/du, due between the sides, normal to e
+            float effdue = 0.0f;
+            int c[3];
+            for(int a=0; a<discreteSize; ++a)
+                for(int b=0; b<discreteSize; ++b)
+                {
+                    c[d] = 0; c[e] = a; c[t] = b;
+                    effdu += displacement[_node(c)*3 + d];
+
+                    c[d] = a; c[e] = 0; c[t] = b;
+                    float _due = displacement[_node(c)*3 + e];
+                    c[e] = discreteSize-1;
+                    effdue += std::fabs(_due - displacement[_node(c)*3 + e]);
+                }
+            effdu /= discreteSize*discreteSize;
+            effdue /= discreteSize*discreteSize;
+            effdu = (effdu - _U0);
+            effElasticModulus[d] = flux * RVEDomain.size() / effdu;
+            effPoissonsRatio[d] = effdue / effdu;
+        }
+    }
     /// note that matrix in this problem is non symmetric
+    /// temperatureDisplacement - initial guess and output,
+    /// see getEffectiveElasticityCharacteristics()
     inline void getEffectiveThermoElasticityCharacteristics(
             const FEM::Domain &RVEDomain,
             float &effHeatConductionCoefficient,
@@ -142,8 +277,9 @@ namespace Synthesis
             float &effLinearTemperatureExpansionCoefficient,
             float &minLinearTemperatureExpansionCoefficient,
             float &maxLinearTemperatureExpansionCoefficient,
+            std::vector<float> &temperatureDisplacement,    // each four numbers are nodal T, ux, uy and uz
             const double eps = 1e-6,
-            const int maxIteration = 10000) noexcept
+            const int maxIteration = 10000)
     {
         // a = dux/(d*dT)
         // q = dT*h/d = (dux*h)/(a*d*d)
@@ -180,8 +316,10 @@ namespace Synthesis
 
         problem.BCManager.addDirichletBC(FEM::RIGHT,{_T0,0,0,0});
 
-        std::vector<float> temperatureDisplacement; // each four numbers are nodal T, ux, uy and uz
-        problem.solve(eps,maxIteration,temperatureDisplacement,true); // using BiCGStab
+        FEM::SolverConfiguration configuration = _solverConfiguration(eps, maxIteration);
+        configuration.solver = FEM::SolverConfiguration::BICGSTAB;
+        configuration.useInitialGuess = true;
+        problem.solve(configuration,temperatureDisplacement);
 
         // h = d*q/dT
         // a = dux/(d*dT)
@@ -223,6 +361,107 @@ namespace Synthesis
         minLinearTemperatureExpansionCoefficient = std::fabs(mindux / (RVEDomain.size() * maxdT));
         maxLinearTemperatureExpansionCoefficient = std::fabs(maxdux / (RVEDomain.size() * mindT));
     }
+    /// note that matrix in this problem is non symmetric
+    inline void getEffectiveThermoElasticityCharacteristics(
+            const FEM::Domain &RVEDomain,
+            float &effHeatConductionCoefficient,
+            float &minHeatConductionCoefficient,
+            float &maxHeatConductionCoefficient,
+            float &effLinearTemperatureExpansionCoefficient,
+            float &minLinearTemperatureExpansionCoefficient,
+            float &maxLinearTemperatureExpansionCoefficient,
+            const double eps = 1e-6,
+            const int maxIteration = 10000) noexcept
+    {
+        std::vector<float> temperatureDisplacement;
+        getEffectiveThermoElasticityCharacteristics(
+                    RVEDomain,
+                    effHeatConductionCoefficient,
+                    minHeatConductionCoefficient,
+                    maxHeatConductionCoefficient,
+                    effLinearTemperatureExpansionCoefficient,
+                    minLinearTemperatureExpansionCoefficient,
+                    maxLinearTemperatureExpansionCoefficient,
+                    temperatureDisplacement, eps, maxIteration);
+    }
+
+    /// Effective tensor by the periodic homogenization (see AbstractProblem::assemblePeriodicCSR()),
+    /// matrix and preconditioner (or factorization, see SolverConfiguration::AUTO)
+    /// are shared by all load cases
+    template<typename _Problem_, int _DegreesOfFreedom_> inline void _getEffectivePeriodicTensor(
+            const FEM::Domain &RVEDomain,
+            const std::vector<MathUtils::Matrix::FixedMatrix<float,_DegreesOfFreedom_,3>> &gradients,
+            std::vector<double> &effTensor,
+            const double eps,
+            const int maxIteration,
+            FEM::DirectSolver *directSolver)
+    {
+        _Problem_ problem(RVEDomain);
+        FEM::CSRMatrix K;
+        problem.assemblePeriodicCSR(K);
+        std::vector<std::vector<float>> loads(gradients.size());
+        for(unsigned c=0; c<gradients.size(); ++c)
+            problem.assemblePeriodicLoads(gradients[c], loads[c]);
+
+        FEM::SolverConfiguration configuration = _solverConfiguration(eps, maxIteration);
+        configuration.preconditioner = FEM::SolverConfiguration::JACOBI;
+        configuration.backend = FEM::SolverConfiguration::AUTO;
+        configuration.directSolver = directSolver;
+        std::vector<std::vector<float>> fluctuations;
+        problem.solve(configuration, K, loads, fluctuations);
+
+        problem.periodicEnergyProducts(gradients, fluctuations, effTensor);
+    }
+
+    /// Full effective heat conduction tensor, h_ij = 1/V * I{(grad T_i)^T [h] grad T_j}dV,
+    /// where T_i is the periodic solution for the unit temperature gradient along axis i
+    /// directSolver - see getEffectiveElasticityCharacteristicsXYZ()
+    inline void getEffectiveHeatConductionTensor(
+            const FEM::Domain &RVEDomain,
+            float effTensor[3][3],
+            const double eps = 1e-6,
+            const int maxIteration = 10000,
+            FEM::DirectSolver *directSolver = nullptr)
+    {
+        std::vector<MathUtils::Matrix::FixedMatrix<float,1,3>> gradients = {
+            MathUtils::Matrix::FixedMatrix<float,1,3>{1,0,0},
+            MathUtils::Matrix::FixedMatrix<float,1,3>{0,1,0},
+            MathUtils::Matrix::FixedMatrix<float,1,3>{0,0,1}};
+        std::vector<double> _tensor;
+        _getEffectivePeriodicTensor<FEM::HeatConductionProblem,1>(
+                    RVEDomain, gradients, _tensor, eps, maxIteration, directSolver);
+        for(int i=0; i<3; ++i)
+            for(int j=0; j<3; ++j)
+                effTensor[i][j] = _tensor[i*3 + j];
+    }
+
+    /// Full effective stiffness tensor in the notation of ElasticityProblem::DM():
+    /// {xx, yy, zz, xy, xz, yz}, shear strains are engineering ones (2*e_xy).
+    /// C_ij = 1/V * I{e_i^T [D] e_j}dV, where e_i is the strain of the periodic solution
+    /// for the unit macroscopic strain i
+    /// directSolver - see getEffectiveElasticityCharacteristicsXYZ()
+    inline void getEffectiveElasticityTensor(
+            const FEM::Domain &RVEDomain,
+            float effTensor[6][6],
+            const double eps = 1e-6,
+            const int maxIteration = 10000,
+            FEM::DirectSolver *directSolver = nullptr)
+    {
+        // Displacement gradients, row per displacement
+        std::vector<MathUtils::Matrix::FixedMatrix<float,3,3>> gradients = {
+            MathUtils::Matrix::FixedMatrix<float,3,3>{1,0,0, 0,0,0, 0,0,0},
+            MathUtils::Matrix::FixedMatrix<float,3,3>{0,0,0, 0,1,0, 0,0,0},
+            MathUtils::Matrix::FixedMatrix<float,3,3>{0,0,0, 0,0,0, 0,0,1},
+            MathUtils::Matrix::FixedMatrix<float,3,3>{0,0.5,0, 0.5,0,0, 0,0,0},
+            MathUtils::Matrix::FixedMatrix<float,3,3>{0,0,0.5, 0,0,0, 0.5,0,0},
+            MathUtils::Matrix::FixedMatrix<float,3,3>{0,0,0, 0,0,0.5, 0,0.5,0}};
+        std::vector<double> _tensor;
+        _getEffectivePeriodicTensor<FEM::ElasticityProblem,3>(
+                    RVEDomain, gradients, _tensor, eps, maxIteration, directSolver);
+        for(int i=0; i<6; ++i)
+            for(int j=0; j<6; ++j)
+                effTensor[i][j] = _tensor[i*6 + j];
+    }
 }
 
 #endif // SYNTHESIS_H
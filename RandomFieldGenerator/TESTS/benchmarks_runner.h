@@ -0,0 +1,214 @@
+#ifndef BENCHMARKS_RUNNER_H
+#define BENCHMARKS_RUNNER_H
+
+#include <iostream>
+#include <functional>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "timer.h"
+#include "parallelfor.h"
+#include "representativevolumeelement.h"
+#include "FEM/problem.h"
+
+/// Performance comparisons, they print timings only and don't verify anything
+/// (see tests_runner.h for the unit tests)
+
+/// Old (std::map rows) vs new (two-pass CSR) SLAE assembly
+inline void run_benchmark_assembly(const int size)
+{
+    std::cout << "Assembly benchmark, RVE" << size << ":\n";
+
+    RepresentativeVolumeElement _RVE(size,1);
+    for(long i=0; i<(long)size*size*size; ++i)
+        _RVE.getData()[i] = (i*37%11)/11.0f;
+
+    FEM::Domain _domain(_RVE);
+    _domain.addMaterial(0,0.5,FEM::Characteristics{1, 100, 0.3, 0, 0});
+    _domain.addMaterial(0.5,1,FEM::Characteristics{10, 2000, 0.2, 0, 0});
+
+    FEM::ElasticityProblem _problem(_domain);
+    _problem.BCManager.addNeumannBC(FEM::LEFT, {100,0,0});
+    _problem.BCManager.addDirichletBC(FEM::RIGHT, {0,0,0});
+
+    Timer _timer;
+    {
+        std::cout << "  std::map assembly...  ";
+        _timer.start();
+        std::vector<std::map<long, float>> _sparseMatrix(_domain.nodesNum()*3);
+        std::vector<float> _loads(_domain.nodesNum()*3);
+        _problem.assembleSLAE(_sparseMatrix, _loads);
+        _timer.stop();
+        std::cout << "Done " << _timer.getTimeSpanAsString() << " seconds" << std::endl;
+    }
+    {
+        std::cout << "  CSR assembly...       ";
+        _timer.start();
+        FEM::CSRMatrix _K;
+        std::vector<float> _loads;
+        _problem.assembleCSR(_K, _loads);
+        _timer.stop();
+        std::cout << "Done " << _timer.getTimeSpanAsString() << " seconds ("
+                  << _K.nonzeros() << " nonzeros)" << std::endl;
+    }
+}
+
+/// Voxel sweeps of RepresentativeVolumeElement, one thread vs all threads
+/// (see Parallel::forRange() and Parallel::reduce())
+inline void run_benchmark_voxelOperations(const int size)
+{
+    std::cout << "Voxel operations benchmark, RVE" << size << ", "
+              << Parallel::threadsNum() << " threads:\n";
+
+    RepresentativeVolumeElement _RVE(size,1);
+    auto _fill = [&](){
+        for(long i=0; i<(long)size*size*size; ++i)
+            _RVE.getData()[i] = (i*37%11)/11.0f;};
+
+    std::vector<std::pair<std::string, std::function<void()>>> _operations = {
+        {"getRangeCellsNum     ", [&](){_RVE.getRangeCellsNum(0.2f, 0.7f);}},
+        {"findUnMaskedMinAndMax", [&](){float _min, _max; _RVE.findUnMaskedMinAndMax(_min, _max);}},
+        {"scaleUnMasked        ", [&](){_RVE.scaleUnMasked(0.1f, 0.9f);}},
+        {"normalize            ", [&](){_RVE.normalize();}},
+        {"normalizeUnMasked    ", [&](){_RVE.normalizeUnMasked();}},
+        {"invertUnMasked       ", [&](){_RVE.invertUnMasked();}},
+        {"applyTwoCutMaskInside", [&](){_RVE.applyTwoCutMaskInside(0.3f, 0.6f);}},
+        {"cleanMask            ", [&](){_RVE.cleanMask();}},
+        {"cleanUnMaskedData    ", [&](){_RVE.cleanUnMaskedData(0.5f);}}};
+
+    const int _maxThreads = Parallel::threadsNum();
+    Timer _timer;
+    for(const auto &_operation : _operations)
+    {
+        double _times[2];
+        for(int t=0; t<2; ++t)
+        {
+#ifdef _OPENMP
+            omp_set_num_threads(t == 0 ? 1 : _maxThreads);
+#endif
+            _fill();
+            _timer.start();
+            _operation.second();
+            _timer.stop();
+            _times[t] = _timer.getTimeSpan().count();
+        }
+        std::cout << "  " << _operation.first << "  serial " << _times[0]
+                  << "  parallel " << _times[1] << " seconds" << std::endl;
+    }
+#ifdef _OPENMP
+    omp_set_num_threads(_maxThreads);
+#endif
+}
+
+/// Separated CPU filter vs FFT filter
+inline void run_benchmark_GaussianFilter(const int size, const int radius)
+{
+    std::cout << "Gaussian filter benchmark, RVE" << size << " R=" << radius << ":\n";
+
+    RepresentativeVolumeElement _RVE(size,1);
+    Timer _timer;
+    {
+        for(long i=0; i<(long)size*size*size; ++i)
+            _RVE.getData()[i] = (i*37%11)/11.0f;
+        _timer.start();
+        _RVE.applyGaussianFilter(radius);
+        _timer.stop();
+        std::cout << "  applyGaussianFilter()    " << _timer.getTimeSpanAsString()
+                  << " seconds" << std::endl;
+    }
+    {
+        for(long i=0; i<(long)size*size*size; ++i)
+            _RVE.getData()[i] = (i*37%11)/11.0f;
+        _timer.start();
+        _RVE.applyGaussianFilterFFT(radius);
+        _timer.stop();
+        std::cout << "  applyGaussianFilterFFT() " << _timer.getTimeSpanAsString()
+                  << " seconds" << std::endl;
+    }
+}
+
+/// Local stiffness matrices per second: the virtual StaticMatrix chain (as KM() was)
+/// vs FixedMatrix expressions (see fixedmatrix.h)
+inline void run_benchmark_localMatrices(const long matricesNum)
+{
+    std::cout << "Local matrices benchmark, " << matricesNum << " matrices:\n";
+
+    FEM::Characteristics _ch{4, 480, 1.0/3.0, 1e-5, 0};
+    const float a[] = {2,3,4}, b[] = {6,3,2}, c[] = {2,5,1}, d[] = {4,3,6};
+    Timer _timer;
+    float _checkSum = 0.0f;
+    auto _report = [&](const char *name) {
+        std::cout << "  " << name << _timer.getTimeSpanAsString() << " seconds, "
+                  << matricesNum / _timer.getTimeSpan().count() << " matrices/s" << std::endl;};
+    {
+        const FEM::TetrahedronMatrix _C(a,b,c,d);
+        MathUtils::Matrix::StaticMatrix<float,6,6> D;
+        const auto _D = FEM::ElasticityProblem::DM(&_ch);
+        for(int i=0; i<36; ++i) D.data()[i] = _D.data()[i];
+        MathUtils::Matrix::StaticMatrix<float,12,12> K;
+        _timer.start();
+        for(long m=0; m<matricesNum; ++m)
+        {
+            FEM::TetrahedronMatrix CInv(_C);
+            CInv(0,0) += m * 1e-12f;
+            float volume = CInv.inverse4x4() / 6.0;
+            MathUtils::Matrix::StaticMatrix<float,6,12> B;
+            for(int i=0; i<6*12; ++i) B.data()[i]=0;
+            for(int n=0; n<4; ++n)
+            {
+                B(0,n*3+0) = CInv(1,n); B(1,n*3+1) = CInv(2,n); B(2,n*3+2) = CInv(3,n);
+                B(3,n*3+0) = CInv(2,n); B(3,n*3+1) = CInv(1,n);
+                B(4,n*3+0) = CInv(3,n); B(4,n*3+2) = CInv(1,n);
+                B(5,n*3+1) = CInv(3,n); B(5,n*3+2) = CInv(2,n);
+            }
+            K = volume * B.T() * D * B;
+            _checkSum += K(m%12, m%11);
+        }
+        _timer.stop();
+        _report("Elasticity, StaticMatrix      ");
+    }
+    {
+        const auto D = FEM::ElasticityProblem::DM(&_ch);
+        MathUtils::Matrix::FixedMatrix<float,12,12> K;
+        float _a[] = {a[0], a[1], a[2]};
+        _timer.start();
+        for(long m=0; m<matricesNum; ++m)
+        {
+            _a[0] = a[0] + m * 1e-12f;
+            FEM::ElasticityProblem::KM(_a,b,c,d,D,K);
+            _checkSum += K(m%12, m%11);
+        }
+        _timer.stop();
+        _report("Elasticity, FixedMatrix       ");
+    }
+    {
+        MathUtils::Matrix::FixedMatrix<float,16,16> K;
+        float _a[] = {a[0], a[1], a[2]};
+        _timer.start();
+        for(long m=0; m<matricesNum; ++m)
+        {
+            _a[0] = a[0] + m * 1e-12f;
+            FEM::ThermoelasticityProblem::KM(_a,b,c,d,&_ch,K);
+            _checkSum += K(m%16, m%15);
+        }
+        _timer.stop();
+        _report("Thermoelasticity, FixedMatrix ");
+    }
+    // Keeps the loops from being optimized away
+    std::cout << "  (check sum " << _checkSum << ")" << std::endl;
+}
+
+inline void run_benchmarks_all()
+{
+    run_benchmark_GaussianFilter(128, 8);
+    run_benchmark_GaussianFilter(256, 128);
+    run_benchmark_voxelOperations(128);
+    run_benchmark_voxelOperations(256);
+    run_benchmark_assembly(64);
+    run_benchmark_assembly(128);
+    run_benchmark_localMatrices(1000000);
+}
+
+#endif // BENCHMARKS_RUNNER_H
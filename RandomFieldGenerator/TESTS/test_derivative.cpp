@@ -1,6 +1,6 @@
 #include "test_derivative.h"
 
-#include "FEM/staticconstants.h"
+#include "FEM/symbolicconstants.h"
 
 using namespace FEM;
 
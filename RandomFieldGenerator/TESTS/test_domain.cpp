@@ -24,3 +24,56 @@ void Test_Domain::test_RVEDomain()
             _DomRVE4[0].indexes[3] == _RVE4.getSize()*_RVE4.getSize() &&
             _DomRVE4[0].characteristics == nullptr);
 }
+
+void Test_Domain::test_segment()
+{
+    RepresentativeVolumeElement _RVE(16,1);
+    for(long i=0; i<16*16*16; ++i)
+        _RVE.getData()[i] = (i * 37 % 101) / 100.0f;
+    Domain _Dom(_RVE);
+    _Dom.addMaterial(0,0.3,Characteristics{1, 100, 0.3, 0, 0});
+    _Dom.addMaterial(0.3,2,Characteristics{10, 2000, 0.2, 0, 0});
+
+    std::vector<int> _materials(16*16*16);
+    std::vector<FixedTetrahedron> _elements;
+    for(int k=0; k<16; ++k)
+        for(int j=0; j<16; ++j)
+            for(int i=0; i<16; ++i)
+                _materials[i + j*16 + k*16*16] = _Dom.materialIndex(i,j,k);
+    for(long el=0; el<_Dom.elementsNum(); ++el)
+        _elements.push_back(_Dom[el]);
+    float _concentration = _Dom.getMaterialVolumeConcentration(1);
+
+    // Two materials cover everything, so labels are packed
+    _Dom.segment();
+    QVERIFY(_Dom.isSegmented());
+    QVERIFY(_Dom.phases().isPacked());
+    QVERIFY(_Dom.phases().bytes() == 16*16*16/8);
+    QVERIFY(_Dom.phases().count(0) + _Dom.phases().count(1) == 16*16*16);
+    QCOMPARE(_Dom.getMaterialVolumeConcentration(1), _concentration);
+    bool _equal = true;
+    for(int k=0; k<16; ++k)
+        for(int j=0; j<16; ++j)
+            for(int i=0; i<16; ++i)
+                _equal &= _Dom.materialIndex(i,j,k) == _materials[i + j*16 + k*16*16];
+    for(long el=0; el<_Dom.elementsNum(); ++el)
+        _equal &= _Dom[el].characteristics == _elements[el].characteristics;
+    QVERIFY(_equal);
+
+    // Masked voxels have no material, so labels are bytes
+    _RVE.getData()[5] = -0.5f;
+    _RVE.getData()[16*16*16-1] = -0.5f;
+    _Dom.segment();
+    QVERIFY(!_Dom.phases().isPacked());
+    QVERIFY(_Dom.phases().bytes() == 16*16*16);
+    QVERIFY(_Dom.phases().unlabeledNum() == 2);
+    QVERIFY(_Dom.materialIndex(5,0,0) == -1);
+    QVERIFY(_Dom[5*6].characteristics == nullptr);
+    QVERIFY(_Dom.materialIndex(15,15,15) == -1);
+    QVERIFY(_Dom.materialIndex(6,0,0) == _materials[6]);
+
+    // Materials are changed, so labels are dropped
+    _Dom.addMaterial(2,3,Characteristics{1, 1, 0.3, 0, 0});
+    QVERIFY(!_Dom.isSegmented());
+    QVERIFY(_Dom.materialIndex(5,0,0) == -1);
+}
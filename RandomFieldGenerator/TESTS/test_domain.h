@@ -10,6 +10,7 @@ class Test_Domain : public QObject
 {
     Q_OBJECT
     private: Q_SLOT void test_RVEDomain();
+    private: Q_SLOT void test_segment();
 };
 
 #endif // TEST_DOMAIN_H
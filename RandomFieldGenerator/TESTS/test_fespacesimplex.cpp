@@ -1,6 +1,9 @@
 #include "test_fespacesimplex.h"
 
 #include "FEM/staticconstants.h"
+#include "FEM/symbolicconstants.h"
+
+#include <cmath>
 //#include <iostream>
 
 using namespace FEM;
@@ -53,3 +56,64 @@ void Test_FESpaceSimplex::test_SimplexElement()
 //        std::cout << "\n";
 //    }
 }
+
+void Test_FESpaceSimplex::test_ShapeFunctions()
+{
+    // Built by the compiler
+    constexpr QuadraticSimplexOperators::GradientMatrix _gradN2Centroid =
+            QuadraticSimplexOperators::gradientN(SIMPLEX_CENTROID);
+    static_assert(gradN_SI1(0,3) == -1 && strainN_SI3(5,10) == -1 &&
+                  _gradN2Centroid(0,4) == 1 && _gradN2Centroid(0,0) == 0,
+                  "operators should be constexpr");
+
+    // Same as the symbolic derivation
+    MathUtils::Matrix::StaticMatrix<Polynomial,3,4> gradN = grad * N_SI1;
+    MathUtils::Matrix::StaticMatrix<Polynomial,6,12> strainN = strain * N_SI3;
+    for(int i=0; i<3; ++i)
+        for(int j=0; j<4; ++j)
+            QVERIFY(gradN(i,j).calculate() == gradN_SI1(i,j));
+    for(int i=0; i<6; ++i)
+        for(int j=0; j<12; ++j)
+            QVERIFY(strainN(i,j).calculate() == strainN_SI3(i,j));
+
+    // Kronecker delta at nodes, partition of unity and zero sum of gradients
+    // (constant field has no gradient), quadratic gradients vs finite differences
+    const BarycentricPoint _p = {{0.1f, 0.2f, 0.3f, 0.4f}};
+    const float _h = 1e-2f;
+    const BarycentricPoint _px = {{0.1f + _h, 0.2f, 0.3f, 0.4f - _h}};
+    for(int n=0; n<10; ++n)
+    {
+        const BarycentricPoint _node = {{SimplexShapeFunctions<2>::coordinate(n,0),
+                                         SimplexShapeFunctions<2>::coordinate(n,1),
+                                         SimplexShapeFunctions<2>::coordinate(n,2),
+                                         SimplexShapeFunctions<2>::coordinate(n,3)}};
+        for(int i=0; i<10; ++i)
+            QVERIFY(SimplexShapeFunctions<2>::value(i, _node) == (i == n ? 1.0f : 0.0f));
+        if(n < 4)
+            for(int i=0; i<4; ++i)
+                QVERIFY(SimplexShapeFunctions<1>::value(i, _node) == (i == n ? 1.0f : 0.0f));
+    }
+    const auto _gradN2 = QuadraticSimplexOperators::gradientN(_p);
+    float _sum = 0.0f, _gradSum[3] = {0.0f, 0.0f, 0.0f};
+    for(int i=0; i<10; ++i)
+    {
+        _sum += SimplexShapeFunctions<2>::value(i, _p);
+        for(int k=0; k<3; ++k)
+            _gradSum[k] += _gradN2(k,i);
+        // Quadratic, so central differences are exact up to rounding
+        const BarycentricPoint _mx = {{0.1f - _h, 0.2f, 0.3f, 0.4f + _h}};
+        const float _dNdx = (SimplexShapeFunctions<2>::value(i, _px) -
+                             SimplexShapeFunctions<2>::value(i, _mx)) / (2.0f * _h);
+        QVERIFY(std::fabs(_dNdx - _gradN2(0,i)) < 1e-3f);
+    }
+    QVERIFY(std::fabs(_sum - 1.0f) < 1e-6f);
+    for(int k=0; k<3; ++k)
+        QVERIFY(std::fabs(_gradSum[k]) < 1e-6f);
+
+    // Strain of the quadratic element is made of the same gradients
+    const auto _strainN2 = QuadraticSimplexOperators::strainN(_p);
+    for(int i=0; i<10; ++i)
+        QVERIFY(_strainN2(0,i*3) == _gradN2(0,i) && _strainN2(3,i*3) == _gradN2(1,i) &&
+                _strainN2(3,i*3+1) == _gradN2(0,i) && _strainN2(5,i*3+2) == _gradN2(1,i) &&
+                _strainN2(0,i*3+1) == 0.0f);
+}
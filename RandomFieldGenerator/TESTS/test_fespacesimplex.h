@@ -10,6 +10,7 @@ class Test_FESpaceSimplex : public QObject
 {
     Q_OBJECT
     private: Q_SLOT void test_SimplexElement();
+    private: Q_SLOT void test_ShapeFunctions();
 };
 
 #endif // TEST_FESPACESIMPLEX_H
@@ -1,5 +1,6 @@
 #include "test_matrix.h"
 #include <iostream>
+#include <algorithm>
 using namespace MathUtils;
 
 void Test_Matrix::test_Matrix()
@@ -301,3 +302,74 @@ void Test_Matrix::test_JacobiMatrix()
         }
     QVERIFY(_maxError < 1e-4f);
 }
+
+void Test_Matrix::test_FixedMatrix()
+{
+    static_assert(std::is_trivially_copyable<Matrix::FixedMatrix<float,12,12>>::value &&
+                  sizeof(Matrix::FixedMatrix<float,12,12>) == 12*12*sizeof(float),
+                  "FixedMatrix should be a plain array");
+    {
+        Matrix::FixedMatrix<float,3,2> A = { 1, -1,
+                                             2, -3,
+                                             3, -2};
+        Matrix::FixedMatrix<float,2,2> C;
+        C = A.T() * A;
+        QVERIFY(C(0,0) == 14 && C(0,1) == -13 && C(1,0) == -13 && C(1,1) == 14);
+        Matrix::FixedMatrix<float,2,3> AT;
+        AT = A.T();
+        QVERIFY(AT(0,2) == 3 && AT(1,0) == -1 && AT.rows() == 2 && AT.cols() == 3);
+    }
+    {
+        Matrix::FixedMatrix<float,2,2> A = {1, 2,
+                                            3, 4};
+        Matrix::FixedMatrix<float,2,1> B = {2, 1};
+        Matrix::FixedMatrix<float,1,2> C = {1, 3};
+        Matrix::FixedMatrix<float,2,1> rez;
+        rez = 2.0f * A * B * C * B - 10.0f * B;
+        QVERIFY(rez(0,0) == 20 && rez(1,0) == 90);
+        rez += B;
+        QVERIFY(rez(0,0) == 22 && rez(1,0) == 91);
+    }
+    {
+        // A^T*D*C by the triple product vs by two products
+        Matrix::FixedMatrix<float,3,4> A = {1, 0, 2, -1,
+                                            0, 3, 0,  1,
+                                            2, 0, 0,  4};
+        Matrix::FixedMatrix<float,3,3> D = {2, 1, 0,
+                                            1, 3, 0,
+                                            0, 0, 5};
+        Matrix::FixedMatrix<float,3,4> C = {0, 1, 1, 2,
+                                           -1, 0, 2, 0,
+                                            3, 1, 0, 1};
+        Matrix::FixedMatrix<float,4,4> K, KTrue, _diff;
+        Matrix::FixedMatrix<float,3,4> _DC;
+        _DC = D * C;
+        KTrue = A.T() * _DC;
+        K = 0.5f * (A.T() * D * C);
+        float _maxError = 0.0f;
+        for(int i=0; i<4; ++i)
+            for(int j=0; j<4; ++j)
+                _maxError = std::max(_maxError, std::fabs(K(i,j) - 0.5f * KTrue(i,j)));
+        QVERIFY(_maxError < 1e-5f);
+        _diff = A.T() * D * C - KTrue;
+        _maxError = 0.0f;
+        for(int i=0; i<16; ++i)
+            _maxError = std::max(_maxError, std::fabs(_diff.data()[i]));
+        QVERIFY(_maxError < 1e-5f);
+    }
+    {
+        Matrix::FixedMatrix<float,3,3> C = {  0,   0, -0.1f,
+                                           0.1f,   0, -0.1f,
+                                              0, 0.1f, -0.1f};
+        Matrix::FixedMatrix<float,3,3> True = {-10, 10,  0,
+                                               -10,  0, 10,
+                                               -10,  0,  0};
+        QVERIFY(std::fabs(C.determinant() + 0.001f) < 1e-7f);
+        float det = C.inverse();
+        float _maxError = 0.0f;
+        for(int i=0; i<9; ++i)
+            _maxError = std::max(_maxError, std::fabs(C.data()[i] - True.data()[i]));
+        QVERIFY(_maxError < 1e-3f);
+        QVERIFY(std::fabs(det + 0.001f) < 1e-7f);
+    }
+}
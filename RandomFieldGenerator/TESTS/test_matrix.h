@@ -2,6 +2,7 @@
 #define TEST_SIMPLEMATRIX_H
 
 #include "matrix.h"
+#include "fixedmatrix.h"
 #include "FEM/jacobimatrix.h"
 #include <QTest>
 
@@ -13,6 +14,7 @@ class Test_Matrix : public QObject
     private: Q_SLOT void test_Matrix();
     private: Q_SLOT void test_MatrixExpression();
     private: Q_SLOT void test_JacobiMatrix();
+    private: Q_SLOT void test_FixedMatrix();
 };
 
 #endif // TEST_SIMPLEMATRIX_H
@@ -6,7 +6,7 @@ using namespace FEM;
 void Test_Problem::test_HeatConduction_constructLocalStiffnessMatrix()
 {
     Characteristics ch{3,0,0,0,0};
-    MathUtils::Matrix::StaticMatrix<float,4,4> K;
+    MathUtils::Matrix::FixedMatrix<float,4,4> K;
     float a[] = {0,0,0};
     float b[] = {0.1,0,0};
     float c[] = {0,0.1,0};
@@ -36,20 +36,20 @@ void Test_Problem::test_HeatConduction_constructLocalStiffnessMatrix()
 
 void Test_Problem::test_HeatConduction_applyLocalDirichletConditions()
 {
-    MathUtils::Matrix::StaticMatrix<float,4,4> K = {
+    MathUtils::Matrix::FixedMatrix<float,4,4> K = {
           0.15f, -0.05f, -0.05f, -0.05f,
          -0.05f,  0.05f,   0.0f,   0.0f,
          -0.05f,   0.0f,  0.05f,   0.0f,
          -0.05f,   0.0f,   0.0f,  0.05f};
-    MathUtils::Matrix::StaticMatrix<float,4,1> f = {10.0f, 20.0f, 30.0f, 40.0f};
+    MathUtils::Matrix::FixedMatrix<float,4,1> f = {10.0f, 20.0f, 30.0f, 40.0f};
     HeatConductionProblem::applyLocalDirichletConditions(0, 10.0f, K, f);
     HeatConductionProblem::applyLocalDirichletConditions(2, 10.0f, K, f);
-    MathUtils::Matrix::StaticMatrix<float,4,4> KTrue = {
+    MathUtils::Matrix::FixedMatrix<float,4,4> KTrue = {
          0.15f,   0.0f,   0.0f,   0.0f,
           0.0f,  0.05f,   0.0f,   0.0f,
           0.0f,   0.0f,  0.05f,   0.0f,
           0.0f,   0.0f,   0.0f,  0.05f};
-    MathUtils::Matrix::StaticMatrix<float,4,1> fTrue = {1.5f, 20.0f + 0.5f, 0.5f, 40.0f + 0.5f};
+    MathUtils::Matrix::FixedMatrix<float,4,1> fTrue = {1.5f, 20.0f + 0.5f, 0.5f, 40.0f + 0.5f};
     float _maxError = 0.0f;
     for(int i=0; i<4; ++i)
         for(int j=0; j<4; ++j)
@@ -75,9 +75,9 @@ void Test_Problem::test_HeatConduction_applyLocalDirichletConditions()
 
 void Test_Problem::test_HeatConduction_applyLocalNeumannConditions()
 {
-    MathUtils::Matrix::StaticMatrix<float,4,1> f = {1e6f, 2e6f, 3e6f, 4e6f};
+    MathUtils::Matrix::FixedMatrix<float,4,1> f = {1e6f, 2e6f, 3e6f, 4e6f};
     HeatConductionProblem::applyLocalNeumannConditions(ACD, 0, 1e6f, f);
-    MathUtils::Matrix::StaticMatrix<float,4,1> fTrue = {1e6f + 1e6f, 2e6f , 3e6f + 1e6f, 4e6f + 1e6f};
+    MathUtils::Matrix::FixedMatrix<float,4,1> fTrue = {1e6f + 1e6f, 2e6f , 3e6f + 1e6f, 4e6f + 1e6f};
     float _maxError = 0.0f;
     for(int i=0; i<4; ++i)
     {
@@ -124,7 +124,7 @@ void Test_Problem::test_HeatConduction_fullCycle()
 void Test_Problem::test_Elasticity_constructLocalStiffnessMatrix()
 {
     Characteristics ch{0,480,1.0/3.0,0,0};
-    MathUtils::Matrix::StaticMatrix<float,12,12> K;
+    MathUtils::Matrix::FixedMatrix<float,12,12> K;
     float a[] = {2,3,4};
     float b[] = {6,3,2};
     float c[] = {2,5,1};
@@ -162,7 +162,7 @@ void Test_Problem::test_Elasticity_constructLocalStiffnessMatrix()
 
 void Test_Problem::test_Elasticity_applyLocalDirichletConditions()
 {
-    MathUtils::Matrix::StaticMatrix<float,12,12> K = {
+    MathUtils::Matrix::FixedMatrix<float,12,12> K = {
          745,   540,  120,   -5,   30,   60, -270,  -240,    0, -470,  -330, -180,
          540,  1720,  270, -120,  520,  210, -120, -1080,  -60, -300, -1160, -420,
          120,   270,  565,    0,  150,  175,    0,  -120, -270, -120,  -300, -470,
@@ -175,12 +175,12 @@ void Test_Problem::test_Elasticity_applyLocalDirichletConditions()
         -470,  -300, -120,  -50,    0,    0,  180,   120,    0,  340,   180,  120,
         -330, -1160, -300,   90, -380, -180,   60,   720,  120,  180,   820,  360,
         -180,  -420, -470,   60, -180, -230,    0,   240,  180,  120,   360,  520};
-    MathUtils::Matrix::StaticMatrix<float,12,1> f = {
+    MathUtils::Matrix::FixedMatrix<float,12,1> f = {
          745,   540,  120,   -5,   30,   60, -270,  -240,    0, -470,  -330, -180};
     ElasticityProblem::applyLocalDirichletConditions(0, 5.0f, K, f);
     ElasticityProblem::applyLocalDirichletConditions(1, 4.0f, K, f);
     ElasticityProblem::applyLocalDirichletConditions(2, 3.0f, K, f);
-    MathUtils::Matrix::StaticMatrix<float,12,12> KTrue = {
+    MathUtils::Matrix::FixedMatrix<float,12,12> KTrue = {
         745,     0,    0,    0,    0,    0,    0,     0,    0,    0,     0,    0,
           0,  1720,    0,    0,    0,    0,    0,     0,    0,    0,     0,    0,
           0,     0,  565,    0,    0,    0,    0,     0,    0,    0,     0,    0,
@@ -193,7 +193,7 @@ void Test_Problem::test_Elasticity_applyLocalDirichletConditions()
           0,     0,    0,  -50,    0,    0,  180,   120,    0,  340,   180,  120,
           0,     0,    0,   90, -380, -180,   60,   720,  120,  180,   820,  360,
           0,     0,    0,   60, -180, -230,    0,   240,  180,  120,   360,  520};
-    MathUtils::Matrix::StaticMatrix<float,12,1> fTrue = {
+    MathUtils::Matrix::FixedMatrix<float,12,1> fTrue = {
         3.725e3, 6.880e3, 1.695e3, 500.000, -2.650e3, -1.605e3,
         1.560e3, 5.640e3, 1.050e3, 3.440e3,  6.860e3,  3.810e3};
     float _maxError = 0.0f;
@@ -221,10 +221,10 @@ void Test_Problem::test_Elasticity_applyLocalDirichletConditions()
 
 void Test_Problem::test_Elasticity_applyLocalNeumannConditions()
 {
-    MathUtils::Matrix::StaticMatrix<float,12,1> f = {
+    MathUtils::Matrix::FixedMatrix<float,12,1> f = {
         1e6f, 2e6f, 3e6f, 4e6f, 5e6f, 6e6f, 7e6f, 8e6f, 9e6f, 9.5e6f, 8.5e6f, 7.5e6f};
     ElasticityProblem::applyLocalNeumannConditions(ACD, 0, 1e6f, f);
-    MathUtils::Matrix::StaticMatrix<float,12,1> fTrue = {
+    MathUtils::Matrix::FixedMatrix<float,12,1> fTrue = {
         1e6f + 1e6f, 2e6f, 3e6f, 4e6f, 5e6f, 6e6f, 7e6f + 1e6f, 8e6f, 9e6f, 9.5e6f+ 1e6f, 8.5e6f, 7.5e6f};
     float _maxError = 0.0f;
     for(int i=0; i<12; ++i)
@@ -300,7 +300,7 @@ void Test_Problem::test_Elasticity_fullCycle()
 void Test_Problem::test_Thermoelasticity_constructLocalStiffnessMatrix()
 {
     Characteristics ch{200,480,1.0/3.0,1.0/600.0,0};
-    MathUtils::Matrix::StaticMatrix<float,16,16> K;
+    MathUtils::Matrix::FixedMatrix<float,16,16> K;
     float a[] = {2,3,4};
     float b[] = {6,3,2};
     float c[] = {2,5,1};
@@ -345,7 +345,7 @@ void Test_Problem::test_Thermoelasticity_constructLocalStiffnessMatrix()
 
 void Test_Problem::test_Thermoelasticity_applyLocalDirichletConditions()
 {
-    MathUtils::Matrix::StaticMatrix<float,16,16> K = {
+    MathUtils::Matrix::FixedMatrix<float,16,16> K = {
         561.1111, 0.8, 1.8, 0.4, 127.7778, -0.4, 0.6, 0.4, -300, 0, -1.2, 0, -388.8889, -0.4, -1.2, -0.8,
         0.8, 745, 540, 120, -0.4, -5, 30, 60, 0, -270, -240, 0, -0.4, -470, -330, -180,
         1.8, 540, 1720, 270, 0.6, -120, 520, 210, -1.2, -120, -1080, -60, -1.2, -300, -1160, -420,
@@ -362,13 +362,13 @@ void Test_Problem::test_Thermoelasticity_applyLocalDirichletConditions()
         0.8, -470, -300, -120, -0.4, -50, 0, 0, 0, 180, 120, 0, -0.4, 340, 180, 120,
         1.8, -330, -1160, -300, 0.6, 90, -380, -180, -1.2, 60, 720, 120, -1.2, 180, 820, 360,
         0.4, -180, -420, -470, 0.4, 60, -180, -230, 0, 0, 240, 180, -0.8, 120, 360, 520};
-    MathUtils::Matrix::StaticMatrix<float,16,1> f = {
+    MathUtils::Matrix::FixedMatrix<float,16,1> f = {
          745,   540,  120,   -5,   30,   60, -270,  -240,    0, -470,  -330, -180, 100, 200, 300, 400};
     ThermoelasticityProblem::applyLocalDirichletConditions(0, 5.0f, K, f);
     ThermoelasticityProblem::applyLocalDirichletConditions(1, 4.0f, K, f);
     ThermoelasticityProblem::applyLocalDirichletConditions(2, 3.0f, K, f);
     ThermoelasticityProblem::applyLocalDirichletConditions(3, 2.0f, K, f);
-    MathUtils::Matrix::StaticMatrix<float,16,16> KTrue = {
+    MathUtils::Matrix::FixedMatrix<float,16,16> KTrue = {
         561.1111, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
         0, 745, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
         0, 0, 1720, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
@@ -385,7 +385,7 @@ void Test_Problem::test_Thermoelasticity_applyLocalDirichletConditions()
         0, 0, 0, 0, -0.4, -50, 0, 0, 0, 180, 120, 0, -0.4, 340, 180, 120,
         0, 0, 0, 0, 0.6, 90, -380, -180, -1.2, 60, 720, 120, -1.2, 180, 820, 360,
         0, 0, 0, 0, 0.4, 60, -180, -230, 0, 0, 240, 180, -0.8, 120, 360, 520};
-    MathUtils::Matrix::StaticMatrix<float,16,1> fTrue = {
+    MathUtils::Matrix::FixedMatrix<float,16,1> fTrue = {
         2805.5555, 2980, 5160, 1130,  -618.289,  436, -2259, -1462,
            1490.6,  966, 4101,  538, 2035.0445, 3216,  5691,  3318};
     float _maxError = 0.0f;
@@ -413,10 +413,10 @@ void Test_Problem::test_Thermoelasticity_applyLocalDirichletConditions()
 
 void Test_Problem::test_Thermoelasticity_applyLocalNeumannConditions()
 {
-    MathUtils::Matrix::StaticMatrix<float,16,1> f = {
+    MathUtils::Matrix::FixedMatrix<float,16,1> f = {
         745,   540,  120,   -5,   30,   60, -270,  -240,    0, -470,  -330, -180, 100, 200, 300, 400};
     ThermoelasticityProblem::applyLocalNeumannConditions(ACD, 0, 500, f);
-    MathUtils::Matrix::StaticMatrix<float,16,1> fTrue = {
+    MathUtils::Matrix::FixedMatrix<float,16,1> fTrue = {
         745+500,   540,  120,   -5,   30,   60, -270,  -240,    0+500, -470,  -330, -180, 100+500, 200, 300, 400};
     float _maxError = 0.0f;
     for(int i=0; i<16; ++i)
@@ -435,3 +435,738 @@ void Test_Problem::test_Thermoelasticity_fullCycle()
 
 }
 
+
+void Test_Problem::test_Elasticity_matrixFree()
+{
+    RepresentativeVolumeElement _RVE(8,1);
+    for(int k=0; k<8; ++k)
+        for(int j=0; j<8; ++j)
+            for(int i=0; i<8; ++i)
+                _RVE.getData()[i + j*8 + k*8*8] =
+                        (i>1 && i<5 && j>1 && j<6 && k>2 && k<6) ? 0.75f : 0.25f;
+
+    Domain RVEDomain(_RVE);
+    RVEDomain.addMaterial(0,0.5,Characteristics{0, 100, 0.3, 0, 0});
+    RVEDomain.addMaterial(0.5,1,Characteristics{0, 2000, 0.2, 0, 0});
+
+    ElasticityProblem problem(RVEDomain);
+    problem.BCManager.addDirichletBC(LEFT, {0,0,0});
+    problem.BCManager.addNeumannBC(RIGHT, {10,5,0});
+    problem.BCManager.addDirichletBC(TOP, {0.01f,0,0});
+    problem.BCManager.DirichletBCs[TOP]->setFloating(1);
+    problem.BCManager.DirichletBCs[TOP]->setFloating(2);
+
+    std::vector<float> assembled;
+    std::vector<float> matrixFree;
+    problem.solve(1e-7f,10000,assembled);
+    problem.solveMatrixFree(1e-7f,10000,matrixFree);
+
+    QVERIFY(assembled.size() == matrixFree.size());
+    float _maxU = 0, _maxError = 0;
+    for(unsigned i=0; i<assembled.size(); ++i)
+    {
+        _maxU = std::max(_maxU, std::fabs(assembled[i]));
+        _maxError = std::max(_maxError, std::fabs(assembled[i] - matrixFree[i]));
+    }
+    QVERIFY(_maxError < 1e-4f * _maxU);
+}
+
+void Test_Problem::test_Thermoelasticity_matrixFree()
+{
+    RepresentativeVolumeElement _RVE(8,1);
+    for(int k=0; k<8; ++k)
+        for(int j=0; j<8; ++j)
+            for(int i=0; i<8; ++i)
+                _RVE.getData()[i + j*8 + k*8*8] = (i+j+k)%3 ? 0.25f : 0.75f;
+
+    Domain RVEDomain(_RVE);
+    RVEDomain.addMaterial(0,0.5,Characteristics{10, 100, 0.3, 1e-3, 0});
+    RVEDomain.addMaterial(0.5,1,Characteristics{200, 400, 0.25, 1e-4, 0});
+
+    ThermoelasticityProblem problem(RVEDomain);
+    problem.BCManager.addDirichletBC(LEFT, {10,0,0,0});
+    problem.BCManager.addDirichletBC(RIGHT, {20,0,0,0});
+    problem.BCManager.DirichletBCs[RIGHT]->setFloating(1);
+    problem.BCManager.DirichletBCs[RIGHT]->setFloating(2);
+    problem.BCManager.DirichletBCs[RIGHT]->setFloating(3);
+
+    std::vector<float> assembled;
+    std::vector<float> matrixFree;
+    problem.solve(1e-7f,10000,assembled,true);
+    problem.solveMatrixFree(1e-7f,10000,matrixFree,true);
+
+    QVERIFY(assembled.size() == matrixFree.size());
+    float _maxU = 0, _maxError = 0;
+    for(unsigned i=0; i<assembled.size(); ++i)
+    {
+        _maxU = std::max(_maxU, std::fabs(assembled[i]));
+        _maxError = std::max(_maxError, std::fabs(assembled[i] - matrixFree[i]));
+    }
+    QVERIFY(_maxError < 1e-4f * _maxU);
+}
+
+void Test_Problem::test_Elasticity_assembleCSR()
+{
+    RepresentativeVolumeElement _RVE(8,1);
+    for(int i=0; i<8*8*8; ++i)
+        _RVE.getData()[i] = (i*37%11)/11.0f;
+
+    Domain RVEDomain(_RVE);
+    RVEDomain.addMaterial(0,0.5,Characteristics{0, 100, 0.3, 0, 0});
+    RVEDomain.addMaterial(0.5,1,Characteristics{0, 2000, 0.2, 0, 0});
+
+    ElasticityProblem problem(RVEDomain);
+    problem.BCManager.addDirichletBC(LEFT, {0,0,0});
+    problem.BCManager.addNeumannBC(RIGHT, {10,5,0});
+    problem.BCManager.addDirichletBC(TOP, {0.01f,0,0});
+    problem.BCManager.DirichletBCs[TOP]->setFloating(1);
+
+    std::vector<std::map<long, float>> sparseMatrix(8*8*8*3);
+    std::vector<float> loads(8*8*8*3);
+    problem.assembleSLAE(sparseMatrix, loads);
+
+    CSRMatrix K;
+    std::vector<float> loadsCSR;
+    problem.assembleCSR(K, loadsCSR);
+
+    QVERIFY(K.rows == sparseMatrix.size());
+    QVERIFY(loadsCSR == loads);
+    for(unsigned i=0; i<K.rows; ++i)
+    {
+        std::map<long, float> row;
+        for(unsigned p=K.rowPtr[i]; p<K.rowPtr[i+1]; ++p)
+        {
+            if(p>K.rowPtr[i]) QVERIFY(K.columns[p-1] < K.columns[p]);
+            if(K.values[p] != 0.0f) row[K.columns[p]] = K.values[p];
+        }
+        for(auto it = sparseMatrix[i].begin(); it != sparseMatrix[i].end(); ++it)
+            if(it->second == 0.0f) QVERIFY(row.count(it->first) == 0);
+            else QVERIFY(row.count(it->first) && row[it->first] == it->second);
+        for(auto it = row.begin(); it != row.end(); ++it)
+            QVERIFY(sparseMatrix[i].count(it->first));
+    }
+}
+
+void Test_Problem::test_Elasticity_parallelAssembly()
+{
+#ifdef _OPENMP
+    RepresentativeVolumeElement _RVE(16,1);
+    for(int i=0; i<16*16*16; ++i)
+        _RVE.getData()[i] = (i*37%11)/11.0f;
+
+    Domain RVEDomain(_RVE);
+    RVEDomain.addMaterial(0,0.5,Characteristics{0, 100, 0.3, 0, 0});
+    RVEDomain.addMaterial(0.5,1,Characteristics{0, 2000, 0.2, 0, 0});
+
+    ElasticityProblem problem(RVEDomain);
+    problem.BCManager.addDirichletBC(LEFT, {0,0,0});
+    problem.BCManager.addNeumannBC(RIGHT, {10,5,0});
+
+    int _threadsNum = omp_get_max_threads();
+
+    omp_set_num_threads(1);
+    CSRMatrix serialK;
+    std::vector<float> serialLoads;
+    problem.assembleCSR(serialK, serialLoads);
+    std::vector<std::map<long, float>> serialMatrix(16*16*16*3);
+    std::vector<float> serialMatrixLoads(16*16*16*3);
+    problem.assembleSLAE(serialMatrix, serialMatrixLoads);
+
+    // More threads than z-layers is also valid
+    for(int threadsNum : {3, 7, 32})
+    {
+        omp_set_num_threads(threadsNum);
+        CSRMatrix K;
+        std::vector<float> loads;
+        problem.assembleCSR(K, loads);
+        QVERIFY(K.rowPtr == serialK.rowPtr);
+        QVERIFY(K.columns == serialK.columns);
+        QVERIFY(K.values == serialK.values);
+        QVERIFY(loads == serialLoads);
+
+        std::vector<std::map<long, float>> sparseMatrix(16*16*16*3);
+        std::vector<float> sparseMatrixLoads(16*16*16*3);
+        problem.assembleSLAE(sparseMatrix, sparseMatrixLoads);
+        QVERIFY(sparseMatrix == serialMatrix);
+        QVERIFY(sparseMatrixLoads == serialMatrixLoads);
+    }
+
+    omp_set_num_threads(_threadsNum);
+#endif
+}
+
+void Test_Problem::test_Elasticity_localStiffnessCache()
+{
+    RepresentativeVolumeElement _RVE(8,2);
+    for(int i=0; i<8*8*8; ++i)
+        _RVE.getData()[i] = (i*37%11)/11.0f;
+
+    Domain RVEDomain(_RVE);
+    RVEDomain.addMaterial(0,0.5,Characteristics{0, 100, 0.3, 0, 0});
+    RVEDomain.addMaterial(0.5,0.9,Characteristics{0, 2000, 0.2, 0, 0});
+
+    ElasticityProblem problem(RVEDomain);
+    LocalStiffnessCache<3> cache;
+    problem.buildLocalStiffnessCache(cache);
+
+    float _maxError = 0.0f;
+    for(long el=0; el<RVEDomain.elementsNum(); ++el)
+    {
+        const FixedTetrahedron element = RVEDomain[el];
+        if(!element.characteristics)
+        {
+            QVERIFY(cache[el] == nullptr);
+            continue;
+        }
+        QVERIFY(cache[el] != nullptr);
+
+        MathUtils::Matrix::FixedMatrix<float,12,12> K;
+        ElasticityProblem::KM(element.a, element.b, element.c, element.d,
+                              ElasticityProblem::DM(element.characteristics), K);
+        for(int i=0; i<12*12; ++i)
+        {
+            float err = std::fabs(K.data()[i] - cache[el]->data()[i]);
+            if(std::fabs(K.data()[i]) > 1e-3f)
+                err /= std::fabs(K.data()[i]);
+            if(err>_maxError)
+                _maxError = err;
+        }
+    }
+    // Direct KM() loses some float precision far from the origin
+    QVERIFY(_maxError < 1e-3f);
+}
+
+void Test_Problem::test_Elasticity_multigrid()
+{
+    RepresentativeVolumeElement _RVE(16,1);
+    for(int k=0; k<16; ++k)
+        for(int j=0; j<16; ++j)
+            for(int i=0; i<16; ++i)
+                _RVE.getData()[i + j*16 + k*16*16] =
+                        ((i/4 + j/4 + k/4) % 2) ? 0.75f : 0.25f;
+
+    Domain RVEDomain(_RVE);
+    RVEDomain.addMaterial(0,0.5,Characteristics{0, 10, 0.3, 0, 0});
+    RVEDomain.addMaterial(0.5,1,Characteristics{0, 1000, 0.2, 0, 0});
+
+    ElasticityProblem problem(RVEDomain);
+    problem.BCManager.addDirichletBC(LEFT, {0,0,0});
+    problem.BCManager.addNeumannBC(RIGHT, {10,5,0});
+
+    std::vector<float> plain;
+    std::vector<float> multigrid;
+    long plainIterations = 0;
+    long multigridIterations = 0;
+    problem.solve(1e-6f,10000,plain,false,nullptr,&plainIterations);
+    problem.solve(1e-6f,10000,multigrid,false,nullptr,&multigridIterations,nullptr,true);
+
+    float _maxU = 0, _maxError = 0;
+    for(unsigned i=0; i<plain.size(); ++i)
+    {
+        _maxU = std::max(_maxU, std::fabs(plain[i]));
+        _maxError = std::max(_maxError, std::fabs(plain[i] - multigrid[i]));
+    }
+    QVERIFY(_maxError < 1e-3f * _maxU);
+    QVERIFY(multigridIterations * 5 < plainIterations);
+}
+
+void Test_Problem::test_Elasticity_preconditioners()
+{
+    RepresentativeVolumeElement _RVE(16,1);
+    for(int k=0; k<16; ++k)
+        for(int j=0; j<16; ++j)
+            for(int i=0; i<16; ++i)
+                _RVE.getData()[i + j*16 + k*16*16] =
+                        ((i/4 + j/4 + k/4) % 2) ? 0.75f : 0.25f;
+
+    Domain RVEDomain(_RVE);
+    RVEDomain.addMaterial(0,0.5,Characteristics{0, 10, 0.3, 0, 0});
+    RVEDomain.addMaterial(0.5,1,Characteristics{0, 1000, 0.2, 0, 0});
+
+    ElasticityProblem problem(RVEDomain);
+    problem.BCManager.addDirichletBC(LEFT, {0,0,0});
+    problem.BCManager.addNeumannBC(RIGHT, {10,5,0});
+
+    SolverConfiguration configuration;
+    configuration.backend = SolverConfiguration::HOST;
+    configuration.eps = 1e-6;
+    configuration.maxIteration = 10000;
+
+    std::vector<float> plain;
+    SolverStatistics plainStatistics;
+    problem.solve(configuration, plain, &plainStatistics);
+    QVERIFY(plainStatistics.residualHistory.size() == (unsigned)plainStatistics.iterations + 1);
+    QVERIFY(plainStatistics.residualHistory.back() == plainStatistics.error);
+    QVERIFY(plainStatistics.error <= 1e-6);
+
+    float _maxU = 0;
+    for(float u : plain)
+        _maxU = std::max(_maxU, std::fabs(u));
+
+    for(SolverConfiguration::PRECONDITIONER preconditioner : {
+        SolverConfiguration::JACOBI,
+        SolverConfiguration::BLOCK_JACOBI,
+        SolverConfiguration::ILU0})
+    {
+        configuration.preconditioner = preconditioner;
+        std::vector<float> preconditioned;
+        SolverStatistics statistics;
+        problem.solve(configuration, preconditioned, &statistics);
+
+        float _maxError = 0;
+        for(unsigned i=0; i<plain.size(); ++i)
+            _maxError = std::max(_maxError, std::fabs(plain[i] - preconditioned[i]));
+        QVERIFY(_maxError < 1e-3f * _maxU);
+        QVERIFY(statistics.iterations < plainStatistics.iterations);
+        QVERIFY(statistics.residualHistory.size() == (unsigned)statistics.iterations + 1);
+    }
+
+    // ILUT is provided by ViennaCL only
+    configuration.preconditioner = SolverConfiguration::ILUT;
+    bool _thrown = false;
+    try
+    {
+        std::vector<float> preconditioned;
+        problem.solve(configuration, preconditioned);
+    }
+    catch(std::runtime_error &)
+    {
+        _thrown = true;
+    }
+    QVERIFY(_thrown);
+}
+
+void Test_Problem::test_Elasticity_multipleLoads()
+{
+    RepresentativeVolumeElement _RVE(8,1);
+    _RVE.addRandomNoise();
+
+    Domain RVEDomain(_RVE);
+    RVEDomain.addMaterial(0,0.5,Characteristics{0, 10, 0.3, 0, 0});
+    RVEDomain.addMaterial(0.5,2,Characteristics{0, 100, 0.2, 0, 0});
+
+    ElasticityProblem problem(RVEDomain);
+    problem.BCManager.addDirichletBC(LEFT, {0,0,0});
+    problem.BCManager.addNeumannBC(RIGHT, {10,5,0});
+
+    SolverConfiguration configuration;
+    configuration.eps = 1e-6;
+    configuration.maxIteration = 10000;
+
+    std::vector<float> single[2];
+    problem.solve(configuration, single[0]);
+
+    CSRMatrix K;
+    std::vector<std::vector<float>> loads(2);
+    problem.assembleCSR(K, loads[0]);
+    std::vector<float> reassembled;
+    problem.assembleLoads(reassembled);
+    QVERIFY(reassembled == loads[0]);
+
+    // Only loads are changed
+    problem.BCManager.cleanBCs();
+    problem.BCManager.addDirichletBC(LEFT, {0.01f,0,0});
+    problem.BCManager.addNeumannBC(TOP, {0,-5,0});
+    problem.BCManager.addNeumannBC(RIGHT, {1,0,0});
+    problem.solve(configuration, single[1]);
+    problem.assembleLoads(loads[1]);
+
+    for(SolverConfiguration::BACKEND backend : {
+        SolverConfiguration::DEVICE,
+        SolverConfiguration::HOST})
+    {
+        configuration.backend = backend;
+        configuration.useInitialGuess = false;
+        std::vector<std::vector<float>> multiple;
+        std::vector<SolverStatistics> coldStatistics;
+        problem.solve(configuration, K, loads, multiple, &coldStatistics);
+        QVERIFY(multiple.size() == 2);
+        for(int l=0; l<2; ++l)
+        {
+            float _maxU = 0, _maxError = 0;
+            for(unsigned i=0; i<single[l].size(); ++i)
+            {
+                _maxU = std::max(_maxU, std::fabs(single[l][i]));
+                _maxError = std::max(_maxError, std::fabs(single[l][i] - multiple[l][i]));
+            }
+            QVERIFY(_maxError < 1e-3f * _maxU);
+        }
+
+        // Warm start from the solution, only float round-off is left
+        configuration.useInitialGuess = true;
+        std::vector<SolverStatistics> statistics;
+        problem.solve(configuration, K, loads, multiple, &statistics);
+        for(int l=0; l<2; ++l)
+        {
+            QVERIFY(statistics[l].iterations * 5 < coldStatistics[l].iterations);
+            QVERIFY(statistics[l].error <= 1e-6);
+        }
+    }
+}
+
+void Test_Problem::test_Elasticity_mixedPrecision()
+{
+    RepresentativeVolumeElement _RVE(8,1);
+    _RVE.addRandomNoise();
+
+    Domain RVEDomain(_RVE);
+    RVEDomain.addMaterial(0,0.5,Characteristics{0, 10, 0.3, 0, 0});
+    RVEDomain.addMaterial(0.5,2,Characteristics{0, 1000, 0.2, 0, 0});
+
+    ElasticityProblem problem(RVEDomain);
+    problem.BCManager.addDirichletBC(LEFT, {0,0,0});
+    problem.BCManager.addNeumannBC(RIGHT, {10,5,0});
+
+    SolverConfiguration configuration;
+    configuration.eps = 1e-9;
+    configuration.maxIteration = 10000;
+    configuration.precision = SolverConfiguration::MIXED;
+    configuration.preconditioner = SolverConfiguration::JACOBI;
+
+    std::vector<float> displacement;
+    SolverStatistics statistics;
+    problem.solve(configuration, displacement, &statistics);
+    QVERIFY(statistics.error <= 1e-9);
+    QVERIFY(statistics.residualHistory.size() > 2);
+    for(unsigned i=1; i<statistics.residualHistory.size(); ++i)
+        QVERIFY(statistics.residualHistory[i] < statistics.residualHistory[i-1]);
+
+    // Double solution, accuracy is limited only by double
+    CSRMatrix K;
+    std::vector<float> loads;
+    problem.assembleCSR(K, loads);
+    std::vector<double> b(loads.begin(), loads.end());
+    std::vector<double> x;
+    JacobiPreconditioner M(K);
+    double error = 1;
+    IterativeSolvers::IterativeRefinement(
+                K, b, x,
+                [&](const std::vector<float> &r, std::vector<float> &d) -> long {
+                    return IterativeSolvers::PCG(K, M, r, d, 1e-4, 10000);},
+                1e-12, 20, &error);
+    QVERIFY(error <= 1e-12);
+
+    float _maxU = 0, _maxError = 0;
+    for(unsigned i=0; i<x.size(); ++i)
+    {
+        _maxU = std::max(_maxU, std::fabs((float)x[i]));
+        _maxError = std::max(_maxError, std::fabs((float)x[i] - displacement[i]));
+    }
+    QVERIFY(_maxError < 1e-5f * _maxU);
+}
+
+void Test_Problem::test_Elasticity_stressField()
+{
+    const int size = 8;
+    RepresentativeVolumeElement _RVE(size,1);
+    for(int i=0; i<size*size*size; ++i)
+        _RVE.getData()[i] = 0.5f;
+
+    Domain RVEDomain(_RVE);
+    RVEDomain.addMaterial(0,1,Characteristics{0, 1000, 0.25, 0, 0});
+    ElasticityProblem problem(RVEDomain);
+    const MathUtils::Matrix::FixedMatrix<float,6,6> D =
+            ElasticityProblem::DM(&RVEDomain.MaterialsVector[0].characteristics);
+
+    std::vector<float> coordinates(RVEDomain.nodesNum()*3);
+    for(long el=0; el<RVEDomain.elementsNum(); ++el)
+    {
+        const FixedTetrahedron element = RVEDomain[el];
+        const float *vertexes[] = {element.a, element.b, element.c, element.d};
+        for(int v=0; v<4; ++v)
+            for(int p=0; p<3; ++p)
+                coordinates[element.indexes[v]*3+p] = vertexes[v][p];
+    }
+
+    // Uniform tension, u = {e*x, 0, 0}
+    const float e = 1e-3f;
+    std::vector<float> displacement(RVEDomain.nodesNum()*3, 0.0f);
+    for(long node=0; node<RVEDomain.nodesNum(); ++node)
+        displacement[node*3] = e * coordinates[node*3];
+
+    StressField field;
+    problem.calculateStressField(displacement, field);
+    QVERIFY(field.size() == RVEDomain.nodesNum());
+    float _maxError = 0.0f;
+    for(long node=0; node<field.size(); ++node)
+    {
+        for(int c=0; c<6; ++c)
+        {
+            _maxError = std::max(_maxError, std::fabs(
+                                     field.strain[c][node] - (c == 0 ? e : 0.0f)) / e);
+            _maxError = std::max(_maxError, std::fabs(
+                                     field.stress[c][node] - D(c,0)*e) / (D(0,0)*e));
+        }
+        const float _s[] = {D(0,0)*e, D(1,0)*e, D(2,0)*e, 0, 0, 0};
+        _maxError = std::max(_maxError, std::fabs(
+                                 field.vonMises[node] - (_s[0] - _s[1])) / _s[0]);
+        _maxError = std::max(_maxError, std::fabs(field.principal[0][node] - _s[0]) / _s[0]);
+        _maxError = std::max(_maxError, std::fabs(field.principal[1][node] - _s[1]) / _s[0]);
+        _maxError = std::max(_maxError, std::fabs(field.principal[2][node] - _s[2]) / _s[0]);
+    }
+    QVERIFY(_maxError < 1e-3f);
+
+    std::vector<float> stressXX;
+    problem.calculateStress(displacement, 0, stressXX);
+    for(long node=0; node<field.size(); ++node)
+        QVERIFY(stressXX[node] == std::fabs(field.stress[0][node]));
+
+    // Simple shear, u = {g*y, 0, 0}, principal stresses are +-G*g
+    const float g = 1e-3f;
+    for(long node=0; node<RVEDomain.nodesNum(); ++node)
+        displacement[node*3] = g * coordinates[node*3+1];
+    problem.calculateStressField(displacement, field);
+    const float Gg = D(3,3)*g;
+    _maxError = 0.0f;
+    for(long node=0; node<field.size(); ++node)
+    {
+        for(int c=0; c<6; ++c)
+            _maxError = std::max(_maxError, std::fabs(
+                                     field.stress[c][node] - (c == 3 ? Gg : 0.0f)) / Gg);
+        _maxError = std::max(_maxError, std::fabs(
+                                 field.vonMises[node] - std::sqrt(3.0f)*Gg) / Gg);
+        _maxError = std::max(_maxError, std::fabs(field.principal[0][node] - Gg) / Gg);
+        _maxError = std::max(_maxError, std::fabs(field.principal[1][node]) / Gg);
+        _maxError = std::max(_maxError, std::fabs(field.principal[2][node] + Gg) / Gg);
+    }
+    QVERIFY(_maxError < 1e-3f);
+}
+
+void Test_Problem::test_Elasticity_periodicConditions()
+{
+    const int size = 8;
+    RepresentativeVolumeElement _RVE(size,1);
+    for(int i=0; i<size*size*size; ++i)
+        _RVE.getData()[i] = (i*37%11)/11.0f;
+
+    Domain RVEDomain(_RVE);
+    RVEDomain.addMaterial(0,0.5,Characteristics{0, 100, 0.3, 0, 0});
+    RVEDomain.addMaterial(0.5,1,Characteristics{0, 2000, 0.2, 0, 0});
+
+    ElasticityProblem problem(RVEDomain);
+    problem.BCManager.addDirichletBC(LEFT, {0,0,0});
+    problem.BCManager.addNeumannBC(RIGHT, {10,5,0});
+
+    CSRMatrix K;
+    std::vector<float> loads;
+    problem.assembleCSR(K, loads);
+
+    problem.BCManager.addPeriodicBC(TOP);
+    problem.BCManager.addPeriodicBC(BACK);
+    QVERIFY(problem.condensedNodesNum() == size*(size-1)*(size-1));
+    CSRMatrix KCondensed;
+    std::vector<float> loadsCondensed;
+    problem.assembleCSR(KCondensed, loadsCondensed);
+    QVERIFY(KCondensed.rows == problem.condensedNodesNum()*3);
+    QVERIFY(loadsCondensed.size() == KCondensed.rows);
+
+    std::vector<float> loadsOnly;
+    problem.assembleLoads(loadsOnly);
+    QVERIFY(loadsOnly == loadsCondensed);
+
+    // KCondensed = P^T K P, P maps condensed nodes to their images
+    const long rows = KCondensed.rows;
+    std::vector<double> KTrue(rows*rows, 0.0);
+    std::vector<double> loadsTrue(rows, 0.0);
+    float _maxK = 0.0f;
+    for(long node=0; node<RVEDomain.nodesNum(); ++node)
+    {
+        const long c = problem.condensedNode(node%size, node/size%size, node/size/size);
+        for(int p=0; p<3; ++p)
+        {
+            const long row = node*3+p;
+            loadsTrue[c*3+p] += loads[row];
+            for(unsigned pos=K.rowPtr[row]; pos<K.rowPtr[row+1]; ++pos)
+            {
+                const long column = K.columns[pos]/3;
+                const long cColumn = problem.condensedNode(
+                            column%size, column/size%size, column/size/size);
+                KTrue[(c*3+p)*rows + cColumn*3 + K.columns[pos]%3] += K.values[pos];
+                _maxK = std::max(_maxK, std::fabs(K.values[pos]));
+            }
+        }
+    }
+
+    float _maxError = 0.0f;
+    for(long row=0; row<rows; ++row)
+    {
+        _maxError = std::max(_maxError, std::fabs(loadsCondensed[row] - (float)loadsTrue[row]));
+        for(unsigned pos=KCondensed.rowPtr[row]; pos<KCondensed.rowPtr[row+1]; ++pos)
+        {
+            if(pos>KCondensed.rowPtr[row]) QVERIFY(KCondensed.columns[pos-1] < KCondensed.columns[pos]);
+            double &_true = KTrue[row*rows + KCondensed.columns[pos]];
+            _maxError = std::max(_maxError, std::fabs(KCondensed.values[pos] - (float)_true) / _maxK);
+            _true = 0.0;
+        }
+    }
+    QVERIFY(_maxError < 1e-5f);
+    // Nothing is lost by the pattern
+    for(long i=0; i<rows*rows; ++i)
+        QVERIFY(std::fabs(KTrue[i]) < 1e-5f * _maxK);
+
+    // Periodic side can't be fixed
+    problem.BCManager.addDirichletBC(TOP, {0,0,0});
+    bool _thrown = false;
+    try
+    {
+        problem.assembleCSR(KCondensed, loadsCondensed);
+    }
+    catch(std::runtime_error &)
+    {
+        _thrown = true;
+    }
+    QVERIFY(_thrown);
+}
+
+void Test_Problem::test_HeatConduction_periodicConditions()
+{
+    const int size = 8;
+    RepresentativeVolumeElement _RVE(size,1);
+    for(int i=0; i<size*size*size; ++i)
+        _RVE.getData()[i] = 0.5f;
+
+    Domain RVEDomain(_RVE);
+    RVEDomain.addMaterial(0,1,Characteristics{4, 0, 0, 0, 0});
+
+    // Periodic lateral sides don't change 1D solution of the homogeneous material
+    HeatConductionProblem problem(RVEDomain);
+    problem.BCManager.addNeumannBC(LEFT, {8});
+    problem.BCManager.addDirichletBC(RIGHT, {1});
+    problem.BCManager.addPeriodicBC(BOTTOM);
+    problem.BCManager.addPeriodicBC(FRONT);
+
+    SolverConfiguration configuration;
+    configuration.eps = 1e-6;
+    configuration.maxIteration = 1000;
+    configuration.backend = SolverConfiguration::HOST;
+    std::vector<float> temperature;
+    problem.solve(configuration, temperature);
+    QVERIFY((long)temperature.size() == RVEDomain.nodesNum());
+
+    // T = T0 + q/h*(size - x)
+    const float step = RVEDomain.size() / (size-1);
+    float _maxError = 0.0f;
+    for(long node=0; node<RVEDomain.nodesNum(); ++node)
+        _maxError = std::max(_maxError, std::fabs(
+                                 temperature[node] - (1.0f + 2.0f*(RVEDomain.size() - step*(node%size)))));
+    QVERIFY(_maxError < 1e-4f);
+
+    // Multigrid needs the whole mesh
+    configuration.preconditioner = SolverConfiguration::GEOMETRIC_MULTIGRID;
+    bool _thrown = false;
+    try
+    {
+        problem.solve(configuration, temperature);
+    }
+    catch(std::runtime_error &)
+    {
+        _thrown = true;
+    }
+    QVERIFY(_thrown);
+}
+
+void Test_Problem::test_Elasticity_directSolver()
+{
+    RepresentativeVolumeElement _RVE(8,1);
+    for(int k=0; k<8; ++k)
+        for(int j=0; j<8; ++j)
+            for(int i=0; i<8; ++i)
+                _RVE.getData()[i + j*8 + k*8*8] = ((i/2 + j/2 + k/2) % 2) ? 0.75f : 0.25f;
+
+    Domain RVEDomain(_RVE);
+    RVEDomain.addMaterial(0,0.5,Characteristics{0, 10, 0.3, 0, 0});
+    RVEDomain.addMaterial(0.5,1,Characteristics{0, 1000, 0.2, 0, 0});
+
+    ElasticityProblem problem(RVEDomain);
+    problem.BCManager.addDirichletBC(LEFT, {0,0,0});
+    problem.BCManager.addNeumannBC(RIGHT, {10,5,0});
+
+    SolverConfiguration configuration;
+    configuration.backend = SolverConfiguration::HOST;
+    configuration.precision = SolverConfiguration::MIXED;
+    configuration.eps = 1e-8;
+    configuration.maxIteration = 10000;
+    std::vector<float> iterative;
+    problem.solve(configuration, iterative);
+
+    float _maxU = 0;
+    for(float u : iterative)
+        _maxU = std::max(_maxU, std::fabs(u));
+
+    // LDL^T for CG and LU for BiCGStab
+    DirectSolver directSolver;
+    configuration.backend = SolverConfiguration::DIRECT;
+    configuration.directSolver = &directSolver;
+    for(SolverConfiguration::SOLVER solver : {SolverConfiguration::CG, SolverConfiguration::BICGSTAB})
+    {
+        configuration.solver = solver;
+        std::vector<float> direct;
+        SolverStatistics statistics;
+        problem.solve(configuration, direct, &statistics);
+        QVERIFY(statistics.iterations == 0);
+        QVERIFY(statistics.error < 1e-5);
+
+        float _maxError = 0;
+        for(unsigned i=0; i<iterative.size(); ++i)
+            _maxError = std::max(_maxError, std::fabs(iterative[i] - direct[i]));
+        QVERIFY(_maxError < 1e-5f * _maxU);
+    }
+    QVERIFY(directSolver.analysesNum() == 2);
+
+    // The same pattern, only the numeric factorization is repeated
+    configuration.solver = SolverConfiguration::CG;
+    problem.BCManager.cleanBCs();
+    problem.BCManager.addDirichletBC(BOTTOM, {0,0,0});
+    problem.BCManager.addNeumannBC(TOP, {0,5,0});
+    std::vector<float> direct;
+    SolverStatistics statistics;
+    problem.solve(configuration, direct, &statistics);
+    QVERIFY(statistics.error < 1e-5);
+    problem.solve(configuration, direct, &statistics);
+    QVERIFY(directSolver.analysesNum() == 3);
+
+    // Unreachable tolerance is not reported as a singular matrix
+    configuration.eps = 0;
+    std::string _message;
+    try
+    {
+        problem.solve(configuration, direct, &statistics);
+    }
+    catch(std::runtime_error &e)
+    {
+        _message = e.what();
+    }
+    QVERIFY(_message.find("residual") != std::string::npos);
+
+    // AUTO: iterative for large problems
+    configuration.backend = SolverConfiguration::AUTO;
+    configuration.directSolver = nullptr;
+    configuration.directMaxRowsPerLoadCase = 100;
+    configuration.precision = SolverConfiguration::SINGLE;
+    configuration.eps = 1e-6;
+    problem.solve(configuration, direct, &statistics);
+    QVERIFY(statistics.iterations > 0);
+    configuration.directMaxRowsPerLoadCase = 1536;
+    problem.solve(configuration, direct, &statistics);
+    QVERIFY(statistics.iterations == 0);
+
+    // AUTO falls back to the iterative solver, if the direct residual of any load case
+    // is above eps. The zero load case is solved exactly, the second one isn't,
+    // so the fallback should start from the initial guesses of both
+    CSRMatrix K;
+    std::vector<std::vector<float>> loads(2);
+    problem.assembleCSR(K, loads[1]);
+    loads[0].assign(loads[1].size(), 0.0f);
+    std::vector<std::vector<float>> initialGuesses(2);
+    initialGuesses[0].assign(K.rows, 1.0f);
+    initialGuesses[1].assign(K.rows, 2.0f);
+    std::vector<std::vector<float>> multiple = initialGuesses;
+    configuration.eps = 0;
+    configuration.maxIteration = 0;
+    configuration.useInitialGuess = true;
+    configuration.preconditioner = SolverConfiguration::BLOCK_JACOBI;
+    std::vector<SolverStatistics> multipleStatistics;
+    problem.solve(configuration, K, loads, multiple, &multipleStatistics);
+    QVERIFY(multipleStatistics[0].iterations == 0);
+    QVERIFY(multiple == initialGuesses);
+}
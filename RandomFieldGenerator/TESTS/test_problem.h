@@ -4,6 +4,10 @@
 #include "FEM/problem.h"
 #include <QTest>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace FEM;
 
 class Test_Problem : public QObject
@@ -21,6 +25,19 @@ class Test_Problem : public QObject
     private: Q_SLOT void test_Thermoelasticity_applyLocalDirichletConditions();
     private: Q_SLOT void test_Thermoelasticity_applyLocalNeumannConditions();
     private: Q_SLOT void test_Thermoelasticity_fullCycle();
+    private: Q_SLOT void test_Elasticity_matrixFree();
+    private: Q_SLOT void test_Thermoelasticity_matrixFree();
+    private: Q_SLOT void test_Elasticity_assembleCSR();
+    private: Q_SLOT void test_Elasticity_parallelAssembly();
+    private: Q_SLOT void test_Elasticity_localStiffnessCache();
+    private: Q_SLOT void test_Elasticity_multigrid();
+    private: Q_SLOT void test_Elasticity_preconditioners();
+    private: Q_SLOT void test_Elasticity_multipleLoads();
+    private: Q_SLOT void test_Elasticity_mixedPrecision();
+    private: Q_SLOT void test_Elasticity_stressField();
+    private: Q_SLOT void test_Elasticity_periodicConditions();
+    private: Q_SLOT void test_HeatConduction_periodicConditions();
+    private: Q_SLOT void test_Elasticity_directSolver();
 };
 
 #endif // TEST_PROBLEM_H
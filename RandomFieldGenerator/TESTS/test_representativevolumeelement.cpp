@@ -0,0 +1,404 @@
+#include "test_representativevolumeelement.h"
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "rvefile.h"
+
+void Test_RepresentativeVolumeElement::test_applyGaussianFilterFFT()
+{
+    const int _size = 16;
+    const long _volume = (long)_size * _size * _size;
+    RepresentativeVolumeElement _RVESpatial(_size,1);
+    RepresentativeVolumeElement _RVEFFT(_size,1);
+    for(long i=0; i<_volume; ++i)
+        _RVESpatial.getData()[i] = _RVEFFT.getData()[i] = (i*37%11)/11.0f;
+
+    _RVESpatial.applyGaussianFilter(3, 1.0f, 0.5f, 0.8f);
+    _RVEFFT.applyGaussianFilterFFT(3, 1.0f, 0.5f, 0.8f);
+    for(long i=0; i<_volume; ++i)
+        QVERIFY(std::fabs(_RVESpatial.getData()[i] - _RVEFFT.getData()[i]) < 1e-4);
+
+    // Kernel is wider than the period and wrapped, the filtered field is almost flat,
+    // so round-off errors are amplified by normalization
+    for(long i=0; i<_volume; ++i)
+        _RVESpatial.getData()[i] = _RVEFFT.getData()[i] = (i*37%11)/11.0f;
+
+    _RVESpatial.applyGaussianFilter(9);
+    _RVEFFT.applyGaussianFilterFFT(9);
+    for(long i=0; i<_volume; ++i)
+        QVERIFY(std::fabs(_RVESpatial.getData()[i] - _RVEFFT.getData()[i]) < 1e-3);
+
+    bool _thrown = false;
+    try
+    {
+        _RVEFFT.applyGaussianFilterFFT(0);
+    }
+    catch(std::runtime_error &)
+    {
+        _thrown = true;
+    }
+    QVERIFY(_thrown);
+}
+
+void Test_RepresentativeVolumeElement::test_applyGaussianFilterFFT_rotations()
+{
+    const int _size = 8;
+    const long _volume = (long)_size * _size * _size;
+    RepresentativeVolumeElement _RVESpatial(_size,1);
+    RepresentativeVolumeElement _RVEFFT(_size,1);
+    for(long i=0; i<_volume; ++i)
+        _RVESpatial.getData()[i] = _RVEFFT.getData()[i] = (i*37%11)/11.0f;
+
+    _RVESpatial.applyGaussianFilter(2, 1.0f, 0.4f, 0.7f, false, 1.0f, true, 0.3f, 1.1f, 2.0f);
+    _RVEFFT.applyGaussianFilterFFT(2, 1.0f, 0.4f, 0.7f, false, 1.0f, true, 0.3f, 1.1f, 2.0f);
+    for(long i=0; i<_volume; ++i)
+        QVERIFY(std::fabs(_RVESpatial.getData()[i] - _RVEFFT.getData()[i]) < 1e-4);
+}
+
+void Test_RepresentativeVolumeElement::test_generateVoronoiRandomCells()
+{
+    // Seeds are checked in buckets around the voxel only, compare with all seeds
+    const int _size = 16;
+    for(float _squeezeFactorZ : {1.0f, 3.0f, 0.5f})
+    {
+        std::vector<MathUtils::Node<3,float>> _seeds;
+        for(int c=0; c<15; ++c)
+            _seeds.push_back(MathUtils::Node<3,float>(c*7%_size, c*11%_size, c*c%_size));
+
+        RepresentativeVolumeElement _RVE(_size,1);
+        _RVE.generateVoronoiRandomCells(_seeds.size(), _squeezeFactorZ, &_seeds);
+
+        std::vector<float> _expected(_size*_size*_size);
+        for(int i=0; i<_size; ++i)
+            for(int j=0; j<_size; ++j)
+                for(int k=0; k<_size; ++k)
+                {
+                    std::vector<float> _distances;
+                    for(const auto &_seed : _seeds)
+                    {
+                        float _d[3] = {_seed[0] - k, _seed[1] - j, _seed[2] - i};
+                        for(float &_di : _d)
+                            _di = std::min(std::fabs(_di), _size - std::fabs(_di));
+                        _distances.push_back(std::sqrt(
+                                    _d[0]*_d[0] + _d[1]*_d[1] + _d[2]*_d[2]/_squeezeFactorZ));
+                    }
+                    std::sort(_distances.begin(), _distances.end());
+                    _expected[i*_size*_size + j*_size + k] = _distances[1] - _distances[0];
+                }
+        float _min = *std::min_element(_expected.begin(), _expected.end());
+        float _max = *std::max_element(_expected.begin(), _expected.end());
+        for(unsigned i=0; i<_expected.size(); ++i)
+            QVERIFY(std::fabs(_RVE.getData()[i] - (_expected[i] - _min) / (_max - _min)) < 1e-4);
+    }
+}
+
+void Test_RepresentativeVolumeElement::test_getMaskDistances()
+{
+    const int _size = 16;
+    RepresentativeVolumeElement _RVE(_size,1);
+    std::vector<float> _distances;
+    _RVE.getMaskDistances(_distances);
+    for(float _d : _distances)
+        QVERIFY(std::isinf(_d));
+
+    std::vector<int> _masked;
+    for(int m=0; m<9; ++m)
+        _masked.push_back((m*5%_size)*_size*_size + (m*m%_size)*_size + m*3%_size);
+    for(int _index : _masked)
+        _RVE.getData()[_index] = -1.0f;
+    _RVE.getMaskDistances(_distances);
+
+    for(int i=0; i<_size; ++i)
+        for(int j=0; j<_size; ++j)
+            for(int k=0; k<_size; ++k)
+            {
+                float _expected = std::numeric_limits<float>::max();
+                for(int _index : _masked)
+                {
+                    float _d[3] = {
+                        (float)(_index % _size - k),
+                        (float)((_index / _size) % _size - j),
+                        (float)(_index / (_size*_size) - i)};
+                    for(float &_di : _d)
+                        _di = std::min(std::fabs(_di), _size - std::fabs(_di));
+                    _expected = std::min(_expected,
+                                         std::sqrt(_d[0]*_d[0] + _d[1]*_d[1] + _d[2]*_d[2]));
+                }
+                QVERIFY(std::fabs(_distances[i*_size*_size + j*_size + k] - _expected) < 1e-5);
+            }
+}
+
+void Test_RepresentativeVolumeElement::test_getNearestSeeds()
+{
+    const int _size = 16;
+    for(float _squeezeFactorZ : {1.0f, 3.0f})
+    {
+        std::vector<MathUtils::Node<3,float>> _seeds;
+        for(int c=0; c<15; ++c)
+            _seeds.push_back(MathUtils::Node<3,float>(c*7%_size, c*11%_size, c*c%_size));
+
+        RepresentativeVolumeElement _RVE(_size,1);
+        std::vector<int> _nearest, _secondNearest;
+        _RVE.getNearestSeeds(_seeds, _nearest, _secondNearest, _squeezeFactorZ);
+
+        // Seeds can be equidistant, so distances are compared
+        for(int i=0; i<_size; ++i)
+            for(int j=0; j<_size; ++j)
+                for(int k=0; k<_size; ++k)
+                {
+                    std::vector<float> _distances;
+                    for(const auto &_seed : _seeds)
+                    {
+                        float _d[3] = {_seed[0] - k, _seed[1] - j, _seed[2] - i};
+                        for(float &_di : _d)
+                            _di = std::min(std::fabs(_di), _size - std::fabs(_di));
+                        _distances.push_back(std::sqrt(
+                                    _d[0]*_d[0] + _d[1]*_d[1] + _d[2]*_d[2]/_squeezeFactorZ));
+                    }
+                    const int _index = i*_size*_size + j*_size + k;
+                    QVERIFY(_nearest[_index] >= 0 && _secondNearest[_index] >= 0);
+                    QVERIFY(_nearest[_index] != _secondNearest[_index]);
+                    const float _nearestDistance = _distances[_nearest[_index]];
+                    const float _secondDistance = _distances[_secondNearest[_index]];
+                    std::sort(_distances.begin(), _distances.end());
+                    QVERIFY(std::fabs(_nearestDistance - _distances[0]) < 1e-4);
+                    QVERIFY(std::fabs(_secondDistance - _distances[1]) < 1e-4);
+                }
+    }
+
+    bool _thrown = false;
+    try
+    {
+        RepresentativeVolumeElement _RVE(_size,1);
+        std::vector<int> _nearest, _secondNearest;
+        _RVE.getNearestSeeds({}, _nearest, _secondNearest);
+    }
+    catch(std::runtime_error &)
+    {
+        _thrown = true;
+    }
+    QVERIFY(_thrown);
+}
+
+void Test_RepresentativeVolumeElement::test_randomSeed()
+{
+    // The same seed and the same operations give the same RVE
+    const int _size = 16;
+    const long _volume = (long)_size * _size * _size;
+    RepresentativeVolumeElement _RVE1(_size,1);
+    RepresentativeVolumeElement _RVE2(_size,1);
+    QVERIFY(_RVE1.getRandomSeed() != _RVE2.getRandomSeed());
+    _RVE1.setRandomSeed(5);
+    _RVE2.setRandomSeed(5);
+    for(RepresentativeVolumeElement *_RVE : {&_RVE1, &_RVE2})
+    {
+        _RVE->generateVoronoiRandomCells(10);
+        _RVE->addRandomNoise();
+    }
+    for(long i=0; i<_volume; ++i)
+        QVERIFY(_RVE1.getData()[i] == _RVE2.getData()[i]);
+
+    // The next operation takes the next stream
+    _RVE1.cleanData();
+    _RVE2.cleanData();
+    _RVE1.addRandomNoise();
+    _RVE2.setRandomSeed(5);
+    _RVE2.addRandomNoise();
+    long _same = 0;
+    for(long i=0; i<_volume; ++i)
+    {
+        QVERIFY(_RVE1.getData()[i] >= 0.0f && _RVE1.getData()[i] < 1.0f);
+        _same += _RVE1.getData()[i] == _RVE2.getData()[i];
+    }
+    QVERIFY(_same < _volume / 100);
+}
+
+void Test_RepresentativeVolumeElement::test_saveLoadRVEFile()
+{
+    const int _size = 32;
+    const long _volume = (long)_size * _size * _size;
+    const std::string _fileName = "test_saveLoadRVEFile.RVE";
+
+    // Two-phase RVE with mask is compressed, noise is stored raw
+    RepresentativeVolumeElement _twoPhase(_size,2);
+    _twoPhase.setRandomSeed(1);
+    _twoPhase.generateVoronoiRandomCells(20);
+    for(long i=0; i<_volume; ++i)
+        _twoPhase.getData()[i] = _twoPhase.getData()[i] < 0.2f ? 1.0f : 0.0f;
+    RepresentativeVolumeElement _noise(_size,3);
+    _noise.setRandomSeed(2);
+    _noise.addRandomNoise();
+
+    for(RepresentativeVolumeElement *_RVE : {&_twoPhase, &_noise})
+        for(bool _legacyFormat : {false, true})
+        {
+            _RVE->saveRVEToFile(_fileName, _legacyFormat);
+            RepresentativeVolumeElement _loaded(8,1);
+            _loaded.loadRVEFromFile(_fileName);
+            QVERIFY(_loaded.getSize() == _size);
+            QVERIFY(_loaded.getRepresentationSize() == _RVE->getRepresentationSize());
+            QVERIFY(std::memcmp(_loaded.getData(), _RVE->getData(), _volume*sizeof(float)) == 0);
+
+            std::ifstream _file(_fileName, std::ios::binary | std::ios::ate);
+            const long _fileSize = _file.tellg();
+            if(_legacyFormat)
+                QVERIFY(_fileSize == (long)(sizeof(int) + sizeof(float) + _volume*sizeof(float)));
+            else if(_RVE == &_twoPhase)
+                QVERIFY(_fileSize < (long)(_volume*sizeof(float)) / 4);
+        }
+
+    // Slabs are read from the chunks, which they cross
+    RVEFile::write(_fileName, _size, 2.0f, _twoPhase.getData(), 8);
+    {
+        RVEFile::Reader _reader(_fileName);
+        QVERIFY(!_reader.isLegacy() && _reader.chunksPerAxis() == 4);
+        std::vector<float> _slab(5 * _size * _size);
+        _reader.readSlab(3, 8, _slab.data());
+        QVERIFY(std::memcmp(_slab.data(), _twoPhase.getData() + 3 * _size * _size,
+                            _slab.size()*sizeof(float)) == 0);
+    }
+
+    // Truncated file
+    {
+        std::ifstream _file(_fileName, std::ios::binary);
+        std::vector<char> _bytes((std::istreambuf_iterator<char>(_file)),
+                                 std::istreambuf_iterator<char>());
+        _file.close();
+        std::ofstream _truncated(_fileName, std::ios::binary | std::ios::trunc);
+        _truncated.write(_bytes.data(), _bytes.size() - 3);
+    }
+    bool _thrown = false;
+    try
+    {
+        RepresentativeVolumeElement _loaded(8,1);
+        _loaded.loadRVEFromFile(_fileName);
+    }
+    catch(std::runtime_error &)
+    {
+        _thrown = true;
+    }
+    QVERIFY(_thrown);
+
+    std::remove(_fileName.c_str());
+}
+
+void Test_RepresentativeVolumeElement::test_outOfCore()
+{
+    // File backed RVE gives the same results as the RVE in RAM
+    const int _size = 32;
+    const long _volume = (long)_size * _size * _size;
+    RepresentativeVolumeElement _inRAM(_size,1);
+    RepresentativeVolumeElement _outOfCore(_size,1,".");
+    QVERIFY(!_inRAM.isOutOfCore() && _outOfCore.isOutOfCore());
+    for(RepresentativeVolumeElement *_RVE : {&_inRAM, &_outOfCore})
+    {
+        _RVE->setRandomSeed(3);
+        _RVE->generateOverlappingRandomEllipsoidsIntense(20, 2, 6, 0.5f);
+        _RVE->applyGaussianFilter(3, 1.0f, 0.5f, 1.0f, true);
+        _RVE->applyTwoCutMaskOutside(0.3f, 0.7f);
+    }
+    QVERIFY(std::memcmp(_inRAM.getData(), _outOfCore.getData(), _volume*sizeof(float)) == 0);
+
+    const std::string _fileName = "test_outOfCore.RVE";
+    _inRAM.saveRVEToFile(_fileName);
+    RepresentativeVolumeElement _loaded(8,1,".");
+    _loaded.loadRVEFromFile(_fileName);
+    QVERIFY(_loaded.isOutOfCore() && _loaded.getSize() == _size);
+    QVERIFY(std::memcmp(_inRAM.getData(), _loaded.getData(), _volume*sizeof(float)) == 0);
+    std::remove(_fileName.c_str());
+
+    bool _thrown = false;
+    try
+    {
+        RepresentativeVolumeElement _RVE(_size,1,"./there/is/no/such/directory");
+    }
+    catch(std::runtime_error &)
+    {
+        _thrown = true;
+    }
+    QVERIFY(_thrown);
+}
+
+void Test_RepresentativeVolumeElement::test_packingSession()
+{
+    // Ellipsoids added one by one are the same as generated by the whole RVE pass,
+    // and voxels numbers are the same as counted from scratch
+    const int _size = 32;
+    const long _volume = (long)_size * _size * _size;
+    RepresentativeVolumeElement _RVE1(_size,1);
+    RepresentativeVolumeElement _RVE2(_size,1);
+    _RVE1.setRandomSeed(11);
+    _RVE2.setRandomSeed(11);
+    for(RepresentativeVolumeElement *_RVE : {&_RVE1, &_RVE2})
+    {
+        _RVE->cleanData();
+        _RVE->getData()[100] = -1.0f;
+    }
+    const std::vector<std::pair<float,float>> _intervals = {{0.5f, 2.0f}, {0.0f, 0.25f}};
+    _RVE2.startPackingSession(_intervals);
+    QVERIFY(_RVE2.getPackingCellsNum(0) == 0);
+    QVERIFY(_RVE2.getPackingCellsNum(1) == _volume - 1);
+
+    for(int n=0; n<12; ++n)
+    {
+        // Big ellipsoids are wrapped around the whole RVE
+        const int _maxRadius = n < 10 ? 9 : 20;
+        _RVE1.generateOverlappingRandomEllipsoidsIntense(
+                    1, 3, _maxRadius, 0.5f, 1.0f, 0.7f, 0.5f, true);
+        _RVE2.addPackedRandomEllipsoidIntense(
+                    3, _maxRadius, 0.5f, 1.0f, 0.7f, 0.5f, true);
+        for(unsigned p=0; p<_intervals.size(); ++p)
+            QCOMPARE(_RVE2.getPackingCellsNum(p),
+                     _RVE2.getRangeCellsNum(_intervals[p].first, _intervals[p].second));
+    }
+    QVERIFY(_RVE2.getPackingCellsNum(0) > 0);
+    QVERIFY(_RVE2.getData()[100] == -1.0f);
+    bool _equal = true;
+    for(long i=0; i<_volume; ++i)
+        _equal &= _RVE1.getData()[i] == _RVE2.getData()[i];
+    QVERIFY(_equal);
+}
+
+void Test_RepresentativeVolumeElement::test_deviceDataSynchronization()
+{
+    // device operation -> host read -> host change -> device operation,
+    // the last one should see the host change, as if data were set from the host
+    const int _size = 16;
+    const long _volume = (long)_size * _size * _size;
+    RepresentativeVolumeElement _RVE(_size,1);
+    for(long i=0; i<_volume; ++i)
+        _RVE.getData()[i] = (i*37%11)/11.0f;
+    QVERIFY(!_RVE.isOnDevice());
+
+    _RVE.applyGaussianFilterCL(2);
+    QVERIFY(_RVE.isOnDevice());
+
+    const RepresentativeVolumeElement &_constRVE = _RVE;
+    const float _value = _constRVE.getData(1,2,3);
+    QVERIFY(!_RVE.isOnDevice());
+    QVERIFY(_value >= 0.0f && _value <= 1.0f);
+
+    _RVE.invertUnMasked();
+    for(long i=0; i<_volume; ++i)
+        _RVE.getData()[i] *= 0.5f;
+    // Host data is read and not changed, then normalized on the host
+    _constRVE.getRangeCellsNum(0.0f, 1.0f);
+    _RVE.normalize();
+    QVERIFY(!_RVE.isOnDevice());
+    std::vector<float> _hostData(_constRVE.getData(), _constRVE.getData() + _volume);
+    QVERIFY(*std::max_element(_hostData.begin(), _hostData.end()) == 1.0f);
+
+    RepresentativeVolumeElement _RVEReference(_size,1);
+    _RVEReference.setData(_hostData.data());
+
+    _RVE.applyGaussianFilterCL(2);
+    _RVEReference.applyGaussianFilterCL(2);
+    QVERIFY(_RVE.isOnDevice());
+    for(long i=0; i<_volume; ++i)
+        QVERIFY(_constRVE.getData()[i] == _RVEReference.getData()[i]);
+}
@@ -0,0 +1,22 @@
+#ifndef TEST_REPRESENTATIVEVOLUMEELEMENT_H
+#define TEST_REPRESENTATIVEVOLUMEELEMENT_H
+
+#include "representativevolumeelement.h"
+#include <QTest>
+
+class Test_RepresentativeVolumeElement : public QObject
+{
+    Q_OBJECT
+    private: Q_SLOT void test_applyGaussianFilterFFT();
+    private: Q_SLOT void test_applyGaussianFilterFFT_rotations();
+    private: Q_SLOT void test_generateVoronoiRandomCells();
+    private: Q_SLOT void test_getMaskDistances();
+    private: Q_SLOT void test_getNearestSeeds();
+    private: Q_SLOT void test_randomSeed();
+    private: Q_SLOT void test_saveLoadRVEFile();
+    private: Q_SLOT void test_outOfCore();
+    private: Q_SLOT void test_packingSession();
+    private: Q_SLOT void test_deviceDataSynchronization();
+};
+
+#endif // TEST_REPRESENTATIVEVOLUMEELEMENT_H
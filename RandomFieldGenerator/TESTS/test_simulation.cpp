@@ -88,3 +88,34 @@ void Test_Simulation::applyLocalNeumannConditions()
     }
     QVERIFY(_maxError < 1e-4f);
 }
+
+void Test_Simulation::parallelAssembleSiffnessMatrix()
+{
+#ifdef _OPENMP
+    const int size = 16;
+    std::vector<float> data(size*size*size);
+    for(int i=0; i<size*size*size; ++i)
+        data[i] = (i*37%11)/11.0f;
+
+    int _threadsNum = omp_get_max_threads();
+
+    omp_set_num_threads(1);
+    std::vector<std::map<long, float>> serialMatrix(size*size*size);
+    std::vector<float> serialLoads(size*size*size);
+    Simulation::assembleSiffnessMatrix(
+                1.0f, size, data.data(), 1.0f, 10.0f, 0.0f, 1.0f, 0.5f, serialMatrix, serialLoads);
+
+    for(int threadsNum : {3, 7, 32})
+    {
+        omp_set_num_threads(threadsNum);
+        std::vector<std::map<long, float>> sparseMatrix(size*size*size);
+        std::vector<float> loads(size*size*size);
+        Simulation::assembleSiffnessMatrix(
+                    1.0f, size, data.data(), 1.0f, 10.0f, 0.0f, 1.0f, 0.5f, sparseMatrix, loads);
+        QVERIFY(sparseMatrix == serialMatrix);
+        QVERIFY(loads == serialLoads);
+    }
+
+    omp_set_num_threads(_threadsNum);
+#endif
+}
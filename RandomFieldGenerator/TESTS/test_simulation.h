@@ -4,6 +4,10 @@
 #include "simulation.h"
 #include <QTest>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace FEM;
 
 class Test_Simulation : public QObject
@@ -12,6 +16,7 @@ class Test_Simulation : public QObject
     private: Q_SLOT void constructLocalStiffnessMatrix();
     private: Q_SLOT void applyLocalDirichletConditions();
     private: Q_SLOT void applyLocalNeumannConditions();
+    private: Q_SLOT void parallelAssembleSiffnessMatrix();
 };
 
 #endif // TEST_SIMULATION_H
@@ -17,6 +17,12 @@ void Test_Synthesis::test_getEffectiveHeatConductionCharacteristic()
         float minCoef;
         getEffectiveHeatConductionCharacteristic(RVEDomain,effCoef,minCoef,maxCoef);
 
+        QVERIFY(std::fabs(effCoef - 4)/4 < 1e-4 &&
+                std::fabs(minCoef - 4)/4 < 1e-4 &&
+                std::fabs(maxCoef - 4)/4 < 1e-4);
+
+        getEffectiveHeatConductionCharacteristic(RVEDomain,effCoef,minCoef,maxCoef,1e-6,10000,true);
+
         QVERIFY(std::fabs(effCoef - 4)/4 < 1e-4 &&
                 std::fabs(minCoef - 4)/4 < 1e-4 &&
                 std::fabs(maxCoef - 4)/4 < 1e-4);
@@ -38,6 +44,12 @@ void Test_Synthesis::test_getEffectiveHeatConductionCharacteristic()
         QVERIFY(effCoef < maxCoef &&
                 effCoef > minCoef &&
                 maxCoef < 8 && minCoef > 4 );
+
+        float effCoefPeriodic;
+        getEffectiveHeatConductionCharacteristic(
+                    RVEDomain,effCoefPeriodic,minCoef,maxCoef,1e-6,10000,true);
+
+        QVERIFY(effCoefPeriodic < 8 && effCoefPeriodic > 4);
     }
 }
 
@@ -159,3 +171,127 @@ void Test_Synthesis::test_getEffectiveThermoElasticityCharacteristics()
                   << effa << " " << mina << " " << maxa << "\n";
     }
 }
+
+void Test_Synthesis::test_getEffectiveElasticityCharacteristicsXYZ()
+{
+    RepresentativeVolumeElement _RVE(16,2);
+    _RVE.addRandomNoise();
+    {
+        FEM::Characteristics ch{4, 500, 1.0/4.0, 1.0/500.0, 0};
+
+        FEM::Domain RVEDomain(_RVE);
+        RVEDomain.addMaterial(0,1,ch);
+
+        float effE[3];
+        float effV[3];
+        std::vector<std::vector<float>> displacements;
+        getEffectiveElasticityCharacteristicsXYZ(RVEDomain, effE, effV, displacements);
+
+        for(int d=0; d<3; ++d)
+            QVERIFY(std::fabs(effE[d] - 500)/500 < 1e-4 &&
+                    std::fabs(effV[d] - 0.25)/0.25 < 1e-4);
+    }
+    {
+        FEM::Characteristics ch1{4, 1000, 1.0/8.0, 2.0/500.0, 0};
+        FEM::Characteristics ch2{8, 500, 1.0/4.0, 1.0/500.0, 0};
+        FEM::Domain RVEDomain(_RVE);
+        RVEDomain.addMaterial(0,0.5,ch1);
+        RVEDomain.addMaterial(0.5,2,ch2);
+
+        float effE[3];
+        float effV[3];
+        std::vector<std::vector<float>> displacements;
+        getEffectiveElasticityCharacteristicsXYZ(RVEDomain, effE, effV, displacements);
+
+        for(int d=0; d<3; ++d)
+            QVERIFY(effE[d] < 1000 && effE[d] > 500 &&
+                    effV[d] < 1.0/4.0 && effV[d] > 1.0/8.0);
+
+        // Warm start from the previous solution gives the same result
+        float warmE[3];
+        float warmV[3];
+        getEffectiveElasticityCharacteristicsXYZ(RVEDomain, warmE, warmV, displacements);
+        for(int d=0; d<3; ++d)
+            QVERIFY(std::fabs(warmE[d] - effE[d])/effE[d] < 1e-3 &&
+                    std::fabs(warmV[d] - effV[d])/effV[d] < 1e-3);
+    }
+}
+
+void Test_Synthesis::test_getEffectiveHeatConductionTensor()
+{
+    // Layers along x, voxels 0..n-1 are used by the elements
+    const int size = 16;
+    const int n = size - 1;
+    RepresentativeVolumeElement _RVE(size,2);
+    int _layersA = 0;
+    for(int k=0; k<size; ++k)
+        for(int j=0; j<size; ++j)
+            for(int i=0; i<size; ++i)
+                _RVE.getData()[i + j*size + k*size*size] = (i < 5) ? 0.25f : 0.75f;
+    for(int i=0; i<n; ++i)
+        if(i < 5) ++_layersA;
+
+    const float hA = 10, hB = 1;
+    FEM::Domain RVEDomain(_RVE);
+    RVEDomain.addMaterial(0,0.5,FEM::Characteristics{hA, 0, 0, 0, 0});
+    RVEDomain.addMaterial(0.5,1,FEM::Characteristics{hB, 0, 0, 0, 0});
+
+    float effTensor[3][3];
+    getEffectiveHeatConductionTensor(RVEDomain, effTensor, 1e-7);
+
+    // Series along the layers normal, parallel along the layers
+    float cA = (float)_layersA / n;
+    float hSeries = 1.0f / (cA/hA + (1-cA)/hB);
+    float hParallel = cA*hA + (1-cA)*hB;
+    QVERIFY(std::fabs(effTensor[0][0] - hSeries)/hSeries < 1e-3);
+    QVERIFY(std::fabs(effTensor[1][1] - hParallel)/hParallel < 1e-3);
+    QVERIFY(std::fabs(effTensor[2][2] - hParallel)/hParallel < 1e-3);
+    for(int i=0; i<3; ++i)
+        for(int j=0; j<3; ++j)
+            if(i != j)
+                QVERIFY(std::fabs(effTensor[i][j]) < 1e-3 * hSeries);
+}
+
+void Test_Synthesis::test_getEffectiveElasticityTensor()
+{
+    RepresentativeVolumeElement _RVE(16,2);
+    _RVE.addRandomNoise();
+    {
+        FEM::Characteristics ch{4, 500, 1.0/4.0, 1.0/500.0, 0};
+
+        FEM::Domain RVEDomain(_RVE);
+        RVEDomain.addMaterial(0,1,ch);
+
+        float effTensor[6][6];
+        getEffectiveElasticityTensor(RVEDomain, effTensor);
+
+        MathUtils::Matrix::FixedMatrix<float,6,6> D = FEM::ElasticityProblem::DM(&ch);
+        for(int i=0; i<6; ++i)
+            for(int j=0; j<6; ++j)
+                QVERIFY(std::fabs(effTensor[i][j] - D(i,j)) < 1e-4 * D(0,0));
+    }
+    {
+        FEM::Characteristics ch1{4, 1000, 1.0/8.0, 2.0/500.0, 0};
+        FEM::Characteristics ch2{8, 500, 1.0/4.0, 1.0/500.0, 0};
+        FEM::Domain RVEDomain(_RVE);
+        RVEDomain.addMaterial(0,0.5,ch1);
+        RVEDomain.addMaterial(0.5,2,ch2);
+
+        float effTensor[6][6];
+        getEffectiveElasticityTensor(RVEDomain, effTensor);
+
+        MathUtils::Matrix::FixedMatrix<float,6,6> D1 = FEM::ElasticityProblem::DM(&ch1);
+        MathUtils::Matrix::FixedMatrix<float,6,6> D2 = FEM::ElasticityProblem::DM(&ch2);
+        // Between Reuss and Voigt bounds for the diagonal, almost isotropic
+        for(int i=0; i<6; ++i)
+        {
+            QVERIFY(effTensor[i][i] < std::max(D1(i,i), D2(i,i)) &&
+                    effTensor[i][i] > std::min(D1(i,i), D2(i,i)));
+            for(int j=0; j<6; ++j)
+                QVERIFY(effTensor[i][j] == effTensor[j][i]);
+        }
+        QVERIFY(std::fabs(effTensor[0][0] - effTensor[1][1]) < 0.1 * effTensor[0][0]);
+        QVERIFY(std::fabs(effTensor[0][0] - effTensor[2][2]) < 0.1 * effTensor[0][0]);
+        QVERIFY(std::fabs(effTensor[0][3]) < 0.05 * effTensor[0][0]);
+    }
+}
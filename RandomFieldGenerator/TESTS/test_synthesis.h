@@ -11,7 +11,10 @@ class Test_Synthesis : public QObject
     Q_OBJECT
     private: Q_SLOT void test_getEffectiveHeatConductionCharacteristic();
     private: Q_SLOT void test_getEffectiveElasticityCharacteristics();
+    private: Q_SLOT void test_getEffectiveElasticityCharacteristicsXYZ();
     private: Q_SLOT void test_getEffectiveThermoElasticityCharacteristics();
+    private: Q_SLOT void test_getEffectiveHeatConductionTensor();
+    private: Q_SLOT void test_getEffectiveElasticityTensor();
 };
 
 #endif // TEST_SYNTHESIS_H
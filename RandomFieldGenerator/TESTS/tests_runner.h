@@ -10,6 +10,7 @@
 #include "test_matrix.h"
 #include "test_fespacesimplex.h"
 #include "test_domain.h"
+#include "test_representativevolumeelement.h"
 #include "test_problem.h"
 #include "test_synthesis.h"
 #include "test_simulation.h"
@@ -54,6 +55,11 @@ void run_tests_Domain()
     Test_Domain _myTest_Domain;
     QTest::qExec(&_myTest_Domain, arguments);
 }
+void run_tests_RepresentativeVolumeElement()
+{
+    Test_RepresentativeVolumeElement _myTest_RepresentativeVolumeElement;
+    QTest::qExec(&_myTest_RepresentativeVolumeElement, arguments);
+}
 void run_tests_Problem()
 {
     Test_Problem _myTest_Problem;
@@ -78,6 +84,7 @@ void run_tests_all()
     run_tests_Matrix();
     run_tests_FESpaceSimplex();
     run_tests_Domain();
+    run_tests_RepresentativeVolumeElement();
     run_tests_Problem();
     run_tests_Synthesis();
     run_tests_Simulation();
@@ -134,6 +134,7 @@ namespace Simulation
             FEM::Domain RVEDomain(*RVE);
             RVEDomain.addMaterial(cutting,2,matrixMat);
             RVEDomain.addMaterial(0,cutting,phaseMat);
+            RVEDomain.segment();
             float PhaseVol = RVEDomain.getMaterialVolumeConcentration(1)*100.0f;
 
             float _maxCoeff = RVEDomain.MaterialsVector[0].characteristics.heatConductionCoefficient;
@@ -284,6 +285,7 @@ namespace Simulation
                 FEM::Domain RVEDomain(*RVE);
                 RVEDomain.addMaterial(cutting,2,matrixMat);
                 RVEDomain.addMaterial(0,cutting,phaseMat);
+                RVEDomain.segment();
                 float PhaseVol = RVEDomain.getMaterialVolumeConcentration(1)*100.0f;
 
                 float _maxCoeff = RVEDomain.MaterialsVector[0].characteristics.heatConductionCoefficient;
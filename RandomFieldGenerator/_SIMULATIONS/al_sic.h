@@ -59,6 +59,8 @@ namespace Simulation
         for(int i=0; i<=RVEDiscreteSize/2; ++i)
         {
             RVE.cleanData();
+            RVE.startPackingSession({{RVEDomain.MaterialsVector[1].minIntensity,
+                                      RVEDomain.MaterialsVector[1].maxIntensity}});
 
             float effh, minh, maxh;
             float effE, minE, maxE;
@@ -69,6 +71,10 @@ namespace Simulation
             int n=0;
             float PhaseVol = 0;
 
+            // Solutions of the previous step are initial guesses for the next one
+            std::vector<float> displacement;
+            std::vector<float> temperatureDisplacement;
+
             for(int j=0; j<=volumeIterations; ++j)
             {
                 float targetVol=(float)(j)/volumeIterations;
@@ -77,9 +83,9 @@ namespace Simulation
                 {
                     for(;;)
                     {
-                        RVE.generateOverlappingRandomEllipsoidsIntenseCL(1,R,R,0);
+                        RVE.addPackedRandomEllipsoidIntense(R,R,0);
                         ++n;
-                        PhaseVol = RVEDomain.getMaterialVolumeConcentration(1.0f);
+                        PhaseVol = (float)RVE.getPackingCellsNum(0) / RVEDomain.nodesNum();
                         //std::cout << n << " " << PhaseVol << " " << targetVol << "\n";
                         if(PhaseVol >= targetVol || PhaseVol >= 0.975) break;
                     }
@@ -90,11 +96,14 @@ namespace Simulation
                     RVE.cleanData();
                     RVE.cleanUnMaskedData(1);
                 }
+                RVEDomain.segment();
 
                 Synthesis::getEffectiveElasticityCharacteristics(
-                            RVEDomain, effE, minE, maxE, effv, minv, maxv,1e-5);
+                            RVEDomain, effE, minE, maxE, effv, minv, maxv,
+                            displacement, 1e-5);
                 Synthesis::getEffectiveThermoElasticityCharacteristics(
-                            RVEDomain, effh, minh, maxh, effa, mina, maxa,1e-5);
+                            RVEDomain, effh, minh, maxh, effa, mina, maxa,
+                            temperatureDisplacement, 1e-5);
 
                 std::cout << "[" << i << "][" << n << "] R=" << (float)R/RVEDiscreteSize*RVEPhysicalLength << " vol=" << PhaseVol
                           << " effh=" << effh << " minh=" << minh << " maxh=" << maxh << "\n"
@@ -167,14 +176,17 @@ namespace Simulation
             n=0;
             PhaseVol = 0;
             targetVol = 0.61;
+            RVE.startPackingSession({{RVEDomain.MaterialsVector[1].minIntensity,
+                                      RVEDomain.MaterialsVector[1].maxIntensity}});
             for(;;)
             {
-                RVE.generateOverlappingRandomEllipsoidsIntenseCL(1,R_LD8110,R_LD8110,0);
+                RVE.addPackedRandomEllipsoidIntense(R_LD8110,R_LD8110,0);
                 ++n;
-                PhaseVol = RVEDomain.getMaterialVolumeConcentration(1.0f);
+                PhaseVol = (float)RVE.getPackingCellsNum(0) / RVEDomain.nodesNum();
                 std::cout << n << " " << PhaseVol << " " << targetVol << "\n";
                 if(PhaseVol >= targetVol) break;
             }
+            RVEDomain.segment();
             Synthesis::getEffectiveHeatConductionCharacteristic(
                         RVEDomain, effh, minh, maxh, 1e-5);
             std::cout << "[" << n << "] vol=" << PhaseVol
@@ -192,14 +204,17 @@ namespace Simulation
             n=0;
             PhaseVol = 0;
             targetVol = 0.62;
+            RVE.startPackingSession({{RVEDomain.MaterialsVector[1].minIntensity,
+                                      RVEDomain.MaterialsVector[1].maxIntensity}});
             for(;;)
             {
-                RVE.generateOverlappingRandomEllipsoidsIntenseCL(1,R_LD8120,R_LD8120,0);
+                RVE.addPackedRandomEllipsoidIntense(R_LD8120,R_LD8120,0);
                 ++n;
-                PhaseVol = RVEDomain.getMaterialVolumeConcentration(1.0f);
+                PhaseVol = (float)RVE.getPackingCellsNum(0) / RVEDomain.nodesNum();
                 std::cout << n << " " << PhaseVol << " " << targetVol << "\n";
                 if(PhaseVol >= targetVol) break;
             }
+            RVEDomain.segment();
             Synthesis::getEffectiveHeatConductionCharacteristic(
                         RVEDomain, effh, minh, maxh, 1e-5);
             std::cout << "[" << n << "] vol=" << PhaseVol
@@ -217,14 +232,17 @@ namespace Simulation
             n=0;
             PhaseVol = 0;
             targetVol = 0.65;
+            RVE.startPackingSession({{RVEDomain.MaterialsVector[1].minIntensity,
+                                      RVEDomain.MaterialsVector[1].maxIntensity}});
             for(;;)
             {
-                RVE.generateOverlappingRandomEllipsoidsIntenseCL(1,R_LD8160,R_LD8160,0);
+                RVE.addPackedRandomEllipsoidIntense(R_LD8160,R_LD8160,0);
                 ++n;
-                PhaseVol = RVEDomain.getMaterialVolumeConcentration(1.0f);
+                PhaseVol = (float)RVE.getPackingCellsNum(0) / RVEDomain.nodesNum();
                 std::cout << n << " " << PhaseVol << " " << targetVol << "\n";
                 if(PhaseVol >= targetVol) break;
             }
+            RVEDomain.segment();
             Synthesis::getEffectiveHeatConductionCharacteristic(
                         RVEDomain, effh, minh, maxh, 1e-5);
             std::cout << "[" << n << "] vol=" << PhaseVol
@@ -0,0 +1,126 @@
+#ifndef BACKINGSTORE
+#define BACKINGSTORE
+
+#include <string>
+#include <utility>
+#include <cstdint>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <stdlib.h>
+#include <unistd.h>
+#endif
+
+/// Storage of n floats in RAM, or in the temporary file in the given directory,
+/// which is mapped into memory.
+/// File backed storage is paged by the OS: only the pages in use are kept in RAM and
+/// the rest is written back to the file, so RVE can be larger than RAM. The sweeps of
+/// RepresentativeVolumeElement go over contiguous blocks (see Parallel::forRange),
+/// so pages are streamed.
+/// The file is removed at once after mapping (POSIX) or when it is closed (Windows).
+/// File backed storage is initialized by zeros, RAM one isn't initialized.
+class BackingStore
+{
+    private: float *_data = nullptr;
+    private: long _n = 0;
+    private: bool _fileBacked = false;
+#ifdef _WIN32
+    private: HANDLE _file = INVALID_HANDLE_VALUE;
+    private: HANDLE _mapping = NULL;
+#endif
+
+    public : float * data() noexcept {return _data;}
+    public : const float * data() const noexcept {return _data;}
+    public : long size() const noexcept {return _n;}
+    public : bool isFileBacked() const noexcept {return _fileBacked;}
+
+    public : BackingStore() noexcept {}
+
+    /// directory - empty for RAM storage
+    public : BackingStore(const long n, const std::string &directory = "") : _n(n)
+    {
+        if(directory.empty())
+        {
+            _data = new float[n];
+            return;
+        }
+        _fileBacked = true;
+        const uint64_t _bytes = (uint64_t)n * sizeof(float);
+#ifdef _WIN32
+        char _fileName[MAX_PATH];
+        if(!GetTempFileNameA(directory.c_str(), "RVE", 0, _fileName))
+            throw(std::runtime_error("BackingStore(): can't create file in " + directory + "\n"));
+        _file = CreateFileA(_fileName, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+        if(_file == INVALID_HANDLE_VALUE)
+            throw(std::runtime_error("BackingStore(): can't create file in " + directory + "\n"));
+        _mapping = CreateFileMappingA(_file, NULL, PAGE_READWRITE,
+                                      (DWORD)(_bytes >> 32), (DWORD)_bytes, NULL);
+        if(_mapping)
+            _data = (float *)MapViewOfFile(_mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+        if(!_data)
+        {
+            if(_mapping)
+                CloseHandle(_mapping);
+            CloseHandle(_file);
+            throw(std::runtime_error("BackingStore(): can't map file in " + directory + "\n"));
+        }
+#else
+        std::string _fileName = directory + "/RVE_XXXXXX";
+        const int _fd = mkstemp(&_fileName[0]);
+        if(_fd < 0)
+            throw(std::runtime_error("BackingStore(): can't create file in " + directory + "\n"));
+        // The file lives while it is mapped
+        unlink(_fileName.c_str());
+        void *_map = MAP_FAILED;
+        if(ftruncate(_fd, _bytes) == 0)
+            _map = mmap(nullptr, _bytes, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+        close(_fd);
+        if(_map == MAP_FAILED)
+            throw(std::runtime_error("BackingStore(): can't map file in " + directory + "\n"));
+        _data = (float *)_map;
+#endif
+    }
+
+    public : BackingStore(const BackingStore &) = delete;
+    public : BackingStore & operator = (const BackingStore &) = delete;
+
+    public : BackingStore(BackingStore &&other) noexcept {_swap(other);}
+    public : BackingStore & operator = (BackingStore &&other) noexcept
+    {
+        _swap(other);
+        return *this;
+    }
+
+    private: void _swap(BackingStore &other) noexcept
+    {
+        std::swap(_data, other._data);
+        std::swap(_n, other._n);
+        std::swap(_fileBacked, other._fileBacked);
+#ifdef _WIN32
+        std::swap(_file, other._file);
+        std::swap(_mapping, other._mapping);
+#endif
+    }
+
+    public : ~BackingStore()
+    {
+        if(!_fileBacked)
+        {
+            delete [] _data;
+            return;
+        }
+#ifdef _WIN32
+        UnmapViewOfFile(_data);
+        CloseHandle(_mapping);
+        CloseHandle(_file);
+#else
+        munmap(_data, (uint64_t)_n * sizeof(float));
+#endif
+    }
+};
+
+#endif // BACKINGSTORE
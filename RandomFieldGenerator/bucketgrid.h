@@ -0,0 +1,137 @@
+#ifndef BUCKETGRID
+#define BUCKETGRID
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+/// Uniform grid of buckets over the periodic cube [0,size)^3 of RepresentativeVolumeElement.
+/// Object (inclusion or seed) is stored in every bucket, which its periodic bounding box
+/// overlaps, so the voxel has to be tested only against the objects of its own bucket.
+/// Coordinates are (x,y,z) = (k,j,i) of the voxel, as in _distanceOnRepeatedSides(),
+/// bucket index is x + y*cellsPerAxis + z*cellsPerAxis^2.
+/// Buckets are stored as CSR (cellStart, objects), object indices in the bucket are
+/// ascending, so objects are applied in the order of generation.
+/// cellsPerAxis is the power of 2, so buckets are aligned with voxels.
+class BucketGrid
+{
+    private: int _size;
+    private: int _cellsPerAxis;
+    private: float _cellSize;
+    private: std::vector<int> _cellStart;
+    private: std::vector<int> _objects;
+
+    public : int cellsPerAxis() const noexcept {return _cellsPerAxis;}
+    public : float cellSize() const noexcept {return _cellSize;}
+    public : const std::vector<int> & cellStart() const noexcept {return _cellStart;}
+    public : const std::vector<int> & objects() const noexcept {return _objects;}
+
+    /// The largest power of 2 number of buckets per axis (up to maxCellsPerAxis),
+    /// for which the bucket is not smaller than minCellSize
+    public : static int cellsPerAxisFor(
+            const int size,
+            const float minCellSize,
+            const int maxCellsPerAxis = 64) noexcept
+    {
+        int _cellsPerAxis = 1;
+        while(_cellsPerAxis*2 <= std::min(size, maxCellsPerAxis) &&
+              (float)size / (_cellsPerAxis*2) >= minCellSize)
+            _cellsPerAxis *= 2;
+        return _cellsPerAxis;
+    }
+
+    public : BucketGrid(const int size, const int cellsPerAxis) :
+        _size(size),
+        _cellsPerAxis(cellsPerAxis),
+        _cellSize((float)size / cellsPerAxis)
+    {
+        if(cellsPerAxis < 1 || cellsPerAxis > size || (cellsPerAxis & (cellsPerAxis-1)))
+            throw(std::runtime_error("BucketGrid(): wrong cellsPerAxis.\n"));
+    }
+
+    /// Bucket of the point, coordinates are wrapped on the period
+    public : int cellCoordinate(const float x) const noexcept
+    {
+        float _x = x - _size * std::floor(x / _size);
+        return std::min((int)(_x / _cellSize), _cellsPerAxis-1);
+    }
+
+    public : int cellIndex(const float x, const float y, const float z) const noexcept
+    {
+        return cellCoordinate(x) +
+                cellCoordinate(y) * _cellsPerAxis +
+                cellCoordinate(z) * _cellsPerAxis * _cellsPerAxis;
+    }
+
+    /// Range of (unwrapped) bucket coordinates, overlapped by [x-halfExtent, x+halfExtent]
+    private: void _cellRange(
+            const float x,
+            const float halfExtent,
+            int &begin,
+            int &end) const noexcept
+    {
+        if(2.0f * halfExtent + 1.0f >= _size)
+        {
+            begin = 0;
+            end = _cellsPerAxis;
+            return;
+        }
+        begin = (int)std::floor((x - halfExtent) / _cellSize);
+        end = (int)std::floor((x + halfExtent) / _cellSize) + 1;
+        if(end - begin > _cellsPerAxis)
+        {
+            begin = 0;
+            end = _cellsPerAxis;
+        }
+    }
+
+    /// centres - x,y,z of objects, halfExtents - half sizes of their bounding boxes
+    /// (cubes, so the rotations of objects can be ignored)
+    public : void build(const std::vector<float> &centres, const std::vector<float> &halfExtents)
+    {
+        const int _objectsNum = halfExtents.size();
+        const long _cellsNum = (long)_cellsPerAxis * _cellsPerAxis * _cellsPerAxis;
+        _cellStart.assign(_cellsNum + 1, 0);
+
+        // Two passes, as CSR assembly: count, then fill
+        for(int _pass = 0; _pass < 2; ++_pass)
+        {
+            std::vector<int> _fill;
+            if(_pass == 1)
+            {
+                for(long c = 0; c < _cellsNum; ++c)
+                    _cellStart[c+1] += _cellStart[c];
+                _objects.resize(_cellStart[_cellsNum]);
+                _fill.assign(_cellStart.begin(), _cellStart.end() - 1);
+            }
+            for(int o = 0; o < _objectsNum; ++o)
+            {
+                int _begin[3], _end[3];
+                for(int a = 0; a < 3; ++a)
+                    _cellRange(centres[o*3 + a], halfExtents[o], _begin[a], _end[a]);
+                for(int z = _begin[2]; z < _end[2]; ++z)
+                    for(int y = _begin[1]; y < _end[1]; ++y)
+                        for(int x = _begin[0]; x < _end[0]; ++x)
+                        {
+                            long _cell =
+                                    (x & (_cellsPerAxis-1)) +
+                                    (y & (_cellsPerAxis-1)) * _cellsPerAxis +
+                                    (long)(z & (_cellsPerAxis-1)) * _cellsPerAxis * _cellsPerAxis;
+                            if(_pass == 0)
+                                ++_cellStart[_cell+1];
+                            else
+                                _objects[_fill[_cell]++] = o;
+                        }
+            }
+        }
+    }
+
+    /// Points are stored in the single bucket each (see Voronoi cells search)
+    public : void build(const std::vector<float> &points)
+    {
+        build(points, std::vector<float>(points.size() / 3, 0.0f));
+    }
+};
+
+#endif // BUCKETGRID
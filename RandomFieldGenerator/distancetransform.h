@@ -0,0 +1,135 @@
+#ifndef DISTANCETRANSFORM
+#define DISTANCETRANSFORM
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+#include "parallelfor.h"
+
+/// Exact squared Euclidean distance transform of the periodic grid of size^3 voxels,
+/// index i*size^2 + j*size + k, see (2012) Felzenszwalb, Huttenlocher - Distance Transforms
+/// of Sampled Functions.
+/// It is separable: 1D transform along k, then j, then i, each is the lower envelope
+/// of parabolas, so it is linear in the number of voxels.
+/// Period is taken into account by the envelope over three periods of the line,
+/// the nearest feature is always within the half of the period.
+/// Axes can be weighted: distance^2 = wk*dk^2 + wj*dj^2 + wi*di^2.
+namespace DistanceTransform
+{
+    inline float infinity() noexcept {return std::numeric_limits<float>::infinity();}
+
+    /// 1D transform of the periodic line, labels can be nullptr.
+    /// vertices, values, bounds - temporary storage of the envelope
+    inline void _transformLine(
+            const float *f,
+            const int *labels,
+            const long n,
+            const double weight,
+            float *distances,
+            int *nearestLabels,
+            std::vector<long> &vertices,
+            std::vector<float> &values,
+            std::vector<double> &bounds) noexcept
+    {
+        vertices.resize(3*n);
+        values.resize(3*n);
+        bounds.resize(3*n+1);
+        long _k = -1;
+        for(long _period = 0; _period < 3; ++_period)
+            for(long x = 0; x < n; ++x)
+            {
+                const float _fx = f[x];
+                if(_fx == infinity())
+                    continue;
+                const long q = x + _period*n;
+                double _s = 0.0;
+                while(_k >= 0)
+                {
+                    const long _v = vertices[_k];
+                    _s = ((_fx + weight*q*q) - (values[_k] + weight*_v*_v)) / (2.0*weight*(q - _v));
+                    if(_s <= bounds[_k])
+                        --_k;
+                    else
+                        break;
+                }
+                ++_k;
+                vertices[_k] = q;
+                values[_k] = _fx;
+                bounds[_k] = _k == 0 ? -infinity() : _s;
+                bounds[_k+1] = infinity();
+            }
+
+        if(_k < 0)
+        {
+            std::fill(distances, distances + n, infinity());
+            if(nearestLabels)
+                std::fill(nearestLabels, nearestLabels + n, -1);
+            return;
+        }
+        long _j = 0;
+        for(long x = 0; x < n; ++x)
+        {
+            const long _q = x + n;
+            while(bounds[_j+1] < _q)
+                ++_j;
+            const long _v = vertices[_j];
+            distances[x] = weight*(_q - _v)*(_q - _v) + values[_j];
+            if(nearestLabels)
+                nearestLabels[x] = labels[_v % n];
+        }
+    }
+
+    /// distances - 0 at features, +inf elsewhere on input,
+    /// squared distance to the nearest feature on output (+inf if there are no features).
+    /// labels - nullptr, or labels of features on input, label of the nearest feature on output
+    inline void squaredPeriodic(
+            std::vector<float> &distances,
+            std::vector<int> *labels,
+            const long size,
+            const float weightK = 1.0f,
+            const float weightJ = 1.0f,
+            const float weightI = 1.0f)
+    {
+        if((long)distances.size() != size*size*size ||
+                (labels && (long)labels->size() != size*size*size))
+            throw(std::runtime_error("DistanceTransform::squaredPeriodic(): wrong size.\n"));
+
+        const float _weights[3] = {weightK, weightJ, weightI};
+        const long _strides[3] = {1, size, size*size};
+        for(int _axis = 0; _axis < 3; ++_axis)
+        {
+            const long _stride = _strides[_axis];
+            Parallel::forRange(size*size, [&](const long begin, const long end){
+                std::vector<float> _f(size), _d(size);
+                std::vector<int> _l(size), _nl(size);
+                std::vector<long> _vertices;
+                std::vector<float> _values;
+                std::vector<double> _bounds;
+                for(long t = begin; t < end; ++t)
+                {
+                    // Line start: t enumerates the other two coordinates
+                    const long _base =
+                            _axis == 0 ? t*size :
+                            _axis == 1 ? (t / size)*size*size + t % size :
+                                         t;
+                    for(long x = 0; x < size; ++x)
+                        _f[x] = distances[_base + x*_stride];
+                    if(labels)
+                        for(long x = 0; x < size; ++x)
+                            _l[x] = (*labels)[_base + x*_stride];
+                    _transformLine(_f.data(), labels ? _l.data() : nullptr, size,
+                                   _weights[_axis], _d.data(), labels ? _nl.data() : nullptr,
+                                   _vertices, _values, _bounds);
+                    for(long x = 0; x < size; ++x)
+                        distances[_base + x*_stride] = _d[x];
+                    if(labels)
+                        for(long x = 0; x < size; ++x)
+                            (*labels)[_base + x*_stride] = _nl[x];
+                }});
+        }
+    }
+}
+
+#endif // DISTANCETRANSFORM
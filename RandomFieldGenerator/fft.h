@@ -0,0 +1,144 @@
+#ifndef FFT
+#define FFT
+
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <stdexcept>
+
+#include "parallelfor.h"
+
+/// Radix-2 fast Fourier transform of the cubic periodic grid of size^3 real values,
+/// size should be the power of 2 (as RepresentativeVolumeElement size).
+/// Real data index is x + y*size + z*size^2, its spectrum is stored for the half
+/// of the first axis only (the rest is complex conjugate): (size/2+1) x size x size,
+/// index u + y*(size/2+1) + z*(size/2+1)*size.
+namespace FastFourierTransform
+{
+    typedef std::complex<float> Complex;
+
+    /// exp(-2*pi*i*m/n) for m in [0,n/2), or exp(+...) for inverse transform
+    inline std::vector<Complex> twiddles(const long n, const bool inverse)
+    {
+        std::vector<Complex> _twiddles(n/2);
+        for(long m=0; m<n/2; ++m)
+            _twiddles[m] = std::polar(1.0, (inverse ? 2.0 : -2.0) * M_PI * m / n);
+        return _twiddles;
+    }
+
+    /// In-place 1D transform of n values, inverse transform is not scaled
+    inline void transform(Complex *line, const long n, const Complex *twiddles) noexcept
+    {
+        for(long i=1, j=0; i<n; ++i)
+        {
+            long _bit = n >> 1;
+            for(; j & _bit; _bit >>= 1)
+                j ^= _bit;
+            j ^= _bit;
+            if(i < j)
+                std::swap(line[i], line[j]);
+        }
+        for(long _length=2; _length<=n; _length <<= 1)
+        {
+            const long _step = n / _length;
+            for(long i=0; i<n; i+=_length)
+                for(long j=0; j<_length/2; ++j)
+                {
+                    Complex _u = line[i+j];
+                    Complex _v = line[i+j+_length/2] * twiddles[j*_step];
+                    line[i+j] = _u + _v;
+                    line[i+j+_length/2] = _u - _v;
+                }
+        }
+    }
+
+    /// 1D transforms along y and z axes of the spectrum
+    inline void _transformYZ(std::vector<Complex> &spectrum, const long size, const bool inverse)
+    {
+        const long _half = size/2 + 1;
+        const std::vector<Complex> _twiddles = twiddles(size, inverse);
+        for(int _axis=0; _axis<2; ++_axis)
+        {
+            const long _stride = _axis == 0 ? _half : _half*size;
+            Parallel::forRange(_half*size, [&](const long begin, const long end){
+                std::vector<Complex> _line(size);
+                for(long t=begin; t<end; ++t)
+                {
+                    const long _base = (t % _half) + (t / _half) * (_axis == 0 ? _half*size : _half);
+                    for(long m=0; m<size; ++m)
+                        _line[m] = spectrum[_base + m*_stride];
+                    transform(_line.data(), size, _twiddles.data());
+                    for(long m=0; m<size; ++m)
+                        spectrum[_base + m*_stride] = _line[m];
+                }});
+        }
+    }
+
+    /// Real data to its half spectrum.
+    /// Two real lines are transformed at once, as real and imaginary parts
+    /// of the single complex line.
+    inline void forward3D(const float *data, const long size, std::vector<Complex> &spectrum)
+    {
+        if(size < 2 || (size & (size-1)))
+            throw(std::runtime_error("FastFourierTransform::forward3D(): "
+                                     "size is not the power of 2.\n"));
+        const long _half = size/2 + 1;
+        spectrum.resize(_half*size*size);
+        const std::vector<Complex> _twiddles = twiddles(size, false);
+
+        Parallel::forRange(size*size/2, [&](const long begin, const long end){
+            std::vector<Complex> _line(size);
+            for(long t=begin; t<end; ++t)
+            {
+                const float *_a = data + 2*t*size;
+                const float *_b = _a + size;
+                for(long x=0; x<size; ++x)
+                    _line[x] = Complex(_a[x], _b[x]);
+                transform(_line.data(), size, _twiddles.data());
+                for(long u=0; u<_half; ++u)
+                {
+                    Complex _z = _line[u];
+                    Complex _zc = std::conj(_line[(size-u) & (size-1)]);
+                    spectrum[u + 2*t*_half] = (_z + _zc) * 0.5f;
+                    spectrum[u + (2*t+1)*_half] = (_z - _zc) * Complex(0.0f, -0.5f);
+                }
+            }});
+
+        _transformYZ(spectrum, size, false);
+    }
+
+    /// Half spectrum to real data, scaled by 1/size^3, i.e. inverse of forward3D().
+    /// Spectrum is destroyed.
+    inline void inverse3D(std::vector<Complex> &spectrum, const long size, float *data)
+    {
+        if(size < 2 || (size & (size-1)) || (long)spectrum.size() != (size/2 + 1)*size*size)
+            throw(std::runtime_error("FastFourierTransform::inverse3D(): "
+                                     "wrong size.\n"));
+        const long _half = size/2 + 1;
+        _transformYZ(spectrum, size, true);
+
+        const std::vector<Complex> _twiddles = twiddles(size, true);
+        const float _scale = 1.0f / ((float)size*size*size);
+        Parallel::forRange(size*size/2, [&](const long begin, const long end){
+            std::vector<Complex> _line(size);
+            for(long t=begin; t<end; ++t)
+            {
+                const Complex *_A = spectrum.data() + 2*t*_half;
+                const Complex *_B = _A + _half;
+                for(long u=0; u<_half; ++u)
+                    _line[u] = _A[u] + Complex(0.0f, 1.0f) * _B[u];
+                for(long u=_half; u<size; ++u)
+                    _line[u] = std::conj(_A[size-u]) + Complex(0.0f, 1.0f) * std::conj(_B[size-u]);
+                transform(_line.data(), size, _twiddles.data());
+                float *_a = data + 2*t*size;
+                float *_b = _a + size;
+                for(long x=0; x<size; ++x)
+                {
+                    _a[x] = _line[x].real() * _scale;
+                    _b[x] = _line[x].imag() * _scale;
+                }
+            }});
+    }
+}
+
+#endif // FFT
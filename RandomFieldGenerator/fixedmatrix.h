@@ -0,0 +1,394 @@
+#ifndef FIXEDMATRIX_H
+#define FIXEDMATRIX_H
+
+#include <type_traits>
+
+#include <Eigen/Dense>
+#include <Eigen/LU>
+
+namespace MathUtils
+{
+    namespace Matrix
+    {
+        /// Numeric small matrices with dimensions known at compile time (local matrices of FEM).
+        /// Unlike StaticMatrix (see matrix.h), FixedMatrix is an aggregate: no vtable and no
+        /// pointer to itself, copy is a plain copy of values, all loops have constant bounds.
+        /// Operators don't calculate anything, they build expressions, which are calculated
+        /// when assigned to FixedMatrix, e.g.
+        ///  K = volume * (B.T() * D * B);
+        /// is calculated by one pass over rows of B, without intermediate matrices
+        /// (see TransposedTripleProduct).
+        /// Expressions keep references to operands, so don't store them, assign them at once.
+        /// Destination shouldn't be an operand of the assigned expression.
+        template <typename _DimType_, int _rows_, int _cols_> class FixedMatrix;
+        template <typename _MatrixType_> class Transposed;
+        template <typename _ExpressionType_> class Scaled;
+        template <typename _LeftType_, typename _RightType_, int _sign_> class Sum;
+        template <typename _LeftType_, typename _RightType_> class Product;
+        template <typename _LeftType_, typename _MiddleType_, typename _RightType_>
+        class TransposedTripleProduct;
+
+        /// 16 bytes alignment if the matrix is made of whole 16 bytes blocks (SSE),
+        /// larger alignment isn't guaranteed by std::vector before C++17
+        template <typename _DimType_, int _size_> class FixedMatrixAlignment
+        {
+            public : static const int value =
+                    (_size_ * sizeof(_DimType_)) % 16 == 0 ? 16 : alignof(_DimType_);
+        };
+
+        /// All expressions and matrices have isDirect member,
+        /// direct ones have cheap operator()(i,j)
+        template <typename _Type_> class IsExpression
+        {
+            private: template <typename _T_> static std::true_type _test(
+                    typename std::remove_reference<decltype(_T_::isDirect)>::type *);
+            private: template <typename _T_> static std::false_type _test(...);
+            public : static const bool value =
+                    decltype(_test<typename std::decay<_Type_>::type>(nullptr))::value;
+        };
+
+        /// How expressions keep operands: matrices by reference, direct expressions by value,
+        /// other ones are calculated into FixedMatrix once
+        template <typename _ExpressionType_,
+                  bool _isMatrix_ = _ExpressionType_::isMatrix,
+                  bool _isDirect_ = _ExpressionType_::isDirect>
+        class Nested
+        {
+            public : typedef _ExpressionType_ type;
+            public : static type make(const _ExpressionType_ &e) noexcept {return e;}
+        };
+        template <typename _ExpressionType_, bool _isDirect_>
+        class Nested<_ExpressionType_, true, _isDirect_>
+        {
+            public : typedef const _ExpressionType_ & type;
+            public : static type make(const _ExpressionType_ &e) noexcept {return e;}
+        };
+        template <typename _ExpressionType_>
+        class Nested<_ExpressionType_, false, false>
+        {
+            public : typedef FixedMatrix<typename _ExpressionType_::value_type,
+                    _ExpressionType_::rowsNum, _ExpressionType_::colsNum> type;
+            public : static type make(const _ExpressionType_ &e) noexcept
+            {
+                type _m;
+                _m = e;
+                return _m;
+            }
+        };
+
+        /// How expressions keep operands, which aren't accessed by elements (see Scaled, Sum):
+        /// matrices by reference, expressions by value, nothing is calculated
+        template <typename _ExpressionType_, bool _isMatrix_ = _ExpressionType_::isMatrix>
+        class Lazy
+        {
+            public : typedef _ExpressionType_ type;
+        };
+        template <typename _ExpressionType_>
+        class Lazy<_ExpressionType_, true>
+        {
+            public : typedef const _ExpressionType_ & type;
+        };
+
+        template <typename _DimType_, int _rows_, int _cols_> class FixedMatrix
+        {
+            public : typedef _DimType_ value_type;
+            public : static const int rowsNum = _rows_;
+            public : static const int colsNum = _cols_;
+            public : static const bool isMatrix = true;
+            public : static const bool isDirect = true;
+
+            /// Row-major values, public to keep the class aggregate:
+            /// FixedMatrix<float,2,2> A = {1, 2,
+            ///                             3, 4};
+            public : alignas(FixedMatrixAlignment<_DimType_, _rows_ * _cols_>::value)
+                _DimType_ values[_rows_ * _cols_];
+
+            public : static constexpr int rows() noexcept {return _rows_;}
+            public : static constexpr int cols() noexcept {return _cols_;}
+            public : constexpr const _DimType_ * data() const noexcept {return values;}
+            public : _DimType_ * data() noexcept {return values;}
+            public : constexpr const _DimType_ & operator () (
+                    const int rowIndex, const int colIndex) const noexcept {
+                return values[colIndex + rowIndex * _cols_];}
+            public : _DimType_ & operator () (const int rowIndex, const int colIndex) noexcept {
+                return values[colIndex + rowIndex * _cols_];}
+
+            public : void setZero() noexcept
+            {
+                for(int i=0; i<_rows_ * _cols_; ++i)
+                    values[i] = _DimType_();
+            }
+            public : static FixedMatrix Zero() noexcept
+            {
+                FixedMatrix _rez;
+                _rez.setZero();
+                return _rez;
+            }
+
+            public : Transposed<FixedMatrix> T() const noexcept {
+                return Transposed<FixedMatrix>(*this);}
+
+            /// out += scale * this
+            public : template <typename _OutType_>
+            void addTo(_OutType_ &out, const _DimType_ scale) const noexcept
+            {
+                _DimType_ *_out = out.data();
+                for(int i=0; i<_rows_ * _cols_; ++i)
+                    _out[i] += scale * values[i];
+            }
+
+            public : template <typename _ExpressionType_>
+            typename std::enable_if<IsExpression<_ExpressionType_>::value, FixedMatrix &>::type
+            operator = (const _ExpressionType_ &e) noexcept
+            {
+                static_assert(_ExpressionType_::rowsNum == _rows_ &&
+                              _ExpressionType_::colsNum == _cols_, "size mismatch");
+                setZero();
+                e.addTo(*this, _DimType_(1));
+                return *this;
+            }
+            public : template <typename _ExpressionType_>
+            typename std::enable_if<IsExpression<_ExpressionType_>::value, FixedMatrix &>::type
+            operator += (const _ExpressionType_ &e) noexcept
+            {
+                static_assert(_ExpressionType_::rowsNum == _rows_ &&
+                              _ExpressionType_::colsNum == _cols_, "size mismatch");
+                e.addTo(*this, _DimType_(1));
+                return *this;
+            }
+
+            /// Only for 3x3 and 4x4
+            public : _DimType_ determinant() const noexcept
+            {
+                static_assert(_rows_ == _cols_ && (_rows_ == 3 || _rows_ == 4), "3x3 or 4x4 only");
+                return Eigen::Map<const Eigen::Matrix<_DimType_,_rows_,_cols_,Eigen::RowMajor>>(
+                            values).determinant();
+            }
+            /// Inverse in place, returns determinant of the original matrix
+            public : _DimType_ inverse() noexcept
+            {
+                static_assert(_rows_ == _cols_ && (_rows_ == 3 || _rows_ == 4), "3x3 or 4x4 only");
+                Eigen::Map<Eigen::Matrix<_DimType_,_rows_,_cols_,Eigen::RowMajor>> _map(values);
+                const Eigen::Matrix<_DimType_,_rows_,_cols_,Eigen::RowMajor> _tmp(_map);
+                _map = _tmp.inverse();
+                return _tmp.determinant();
+            }
+            /// Same names as in AbstractMatrix
+            public : _DimType_ determinant3x3() const noexcept {return determinant();}
+            public : _DimType_ determinant4x4() const noexcept {return determinant();}
+            public : _DimType_ inverse3x3() noexcept {return inverse();}
+            public : _DimType_ inverse4x4() noexcept {return inverse();}
+        };
+
+        template <typename _MatrixType_> class Transposed
+        {
+            public : typedef typename _MatrixType_::value_type value_type;
+            public : static const int rowsNum = _MatrixType_::colsNum;
+            public : static const int colsNum = _MatrixType_::rowsNum;
+            public : static const bool isMatrix = false;
+            public : static const bool isDirect = true;
+
+            private: const _MatrixType_ &_m;
+
+            public : explicit Transposed(const _MatrixType_ &m) noexcept : _m(m) {}
+            public : const _MatrixType_ & matrix() const noexcept {return _m;}
+            public : value_type operator () (const int rowIndex, const int colIndex) const noexcept {
+                return _m(colIndex, rowIndex);}
+
+            public : template <typename _OutType_>
+            void addTo(_OutType_ &out, const value_type scale) const noexcept
+            {
+                for(int i=0; i<rowsNum; ++i)
+                    for(int j=0; j<colsNum; ++j)
+                        out(i,j) += scale * _m(j,i);
+            }
+        };
+
+        template <typename _ExpressionType_> class Scaled
+        {
+            public : typedef typename _ExpressionType_::value_type value_type;
+            public : static const int rowsNum = _ExpressionType_::rowsNum;
+            public : static const int colsNum = _ExpressionType_::colsNum;
+            public : static const bool isMatrix = false;
+            public : static const bool isDirect = _ExpressionType_::isDirect;
+
+            private: const value_type _scale;
+            private: typename Lazy<_ExpressionType_>::type _e;
+
+            public : Scaled(const value_type scale, const _ExpressionType_ &e) noexcept :
+                _scale(scale), _e(e) {}
+            public : value_type operator () (const int rowIndex, const int colIndex) const noexcept {
+                return _scale * _e(rowIndex, colIndex);}
+
+            public : template <typename _OutType_>
+            void addTo(_OutType_ &out, const value_type scale) const noexcept {
+                _e.addTo(out, scale * _scale);}
+        };
+
+        /// A + B for _sign_ = 1, A - B for _sign_ = -1
+        template <typename _LeftType_, typename _RightType_, int _sign_> class Sum
+        {
+            public : typedef typename _LeftType_::value_type value_type;
+            public : static const int rowsNum = _LeftType_::rowsNum;
+            public : static const int colsNum = _LeftType_::colsNum;
+            public : static const bool isMatrix = false;
+            public : static const bool isDirect = _LeftType_::isDirect && _RightType_::isDirect;
+
+            private: typename Lazy<_LeftType_>::type _a;
+            private: typename Lazy<_RightType_>::type _b;
+
+            public : Sum(const _LeftType_ &a, const _RightType_ &b) noexcept : _a(a), _b(b)
+            {
+                static_assert(_LeftType_::rowsNum == _RightType_::rowsNum &&
+                              _LeftType_::colsNum == _RightType_::colsNum, "size mismatch");
+            }
+            public : value_type operator () (const int rowIndex, const int colIndex) const noexcept {
+                return _a(rowIndex, colIndex) + _sign_ * _b(rowIndex, colIndex);}
+
+            public : template <typename _OutType_>
+            void addTo(_OutType_ &out, const value_type scale) const noexcept
+            {
+                _a.addTo(out, scale);
+                _b.addTo(out, _sign_ * scale);
+            }
+        };
+
+        template <typename _LeftType_, typename _RightType_> class Product
+        {
+            public : typedef typename _LeftType_::value_type value_type;
+            public : static const int rowsNum = _LeftType_::rowsNum;
+            public : static const int colsNum = _RightType_::colsNum;
+            public : static const bool isMatrix = false;
+            public : static const bool isDirect = false;
+
+            private: typename Nested<_LeftType_>::type _a;
+            private: typename Nested<_RightType_>::type _b;
+
+            public : Product(const _LeftType_ &a, const _RightType_ &b) noexcept :
+                _a(Nested<_LeftType_>::make(a)), _b(Nested<_RightType_>::make(b))
+            {
+                static_assert(_LeftType_::colsNum == _RightType_::rowsNum, "size mismatch");
+            }
+            public : typename Nested<_LeftType_>::type const & left() const noexcept {return _a;}
+            public : typename Nested<_RightType_>::type const & right() const noexcept {return _b;}
+
+            /// Row i of the result is a sum of rows k of B, so the inner loop is contiguous.
+            /// Local matrices are sparse ([B] has 3/4 of zeros), zeros of A are skipped
+            public : template <typename _OutType_>
+            void addTo(_OutType_ &out, const value_type scale) const noexcept
+            {
+                for(int i=0; i<rowsNum; ++i)
+                    for(int k=0; k<_LeftType_::colsNum; ++k)
+                    {
+                        const value_type _aik = _a(i,k);
+                        if(_aik == value_type()) continue;
+                        const value_type _s = scale * _aik;
+                        for(int j=0; j<colsNum; ++j)
+                            out(i,j) += _s * _b(k,j);
+                    }
+            }
+        };
+
+        /// A^T * D * C, [K] = [B]^T[D][B] of the local stiffness matrices.
+        /// Sum of outer products of rows k of A and rows k of D*C, the last is calculated
+        /// row by row into a local array, so there are no intermediate matrices
+        template <typename _LeftType_, typename _MiddleType_, typename _RightType_>
+        class TransposedTripleProduct
+        {
+            public : typedef typename _RightType_::value_type value_type;
+            public : static const int rowsNum = _LeftType_::colsNum;
+            public : static const int colsNum = _RightType_::colsNum;
+            public : static const bool isMatrix = false;
+            public : static const bool isDirect = false;
+
+            private: typename Nested<_LeftType_>::type _a;
+            private: typename Nested<_MiddleType_>::type _d;
+            private: typename Nested<_RightType_>::type _c;
+
+            public : TransposedTripleProduct(
+                    const _LeftType_ &a, const _MiddleType_ &d, const _RightType_ &c) noexcept :
+                _a(Nested<_LeftType_>::make(a)),
+                _d(Nested<_MiddleType_>::make(d)),
+                _c(Nested<_RightType_>::make(c))
+            {
+                static_assert(_LeftType_::rowsNum == _MiddleType_::rowsNum &&
+                              _MiddleType_::colsNum == _RightType_::rowsNum, "size mismatch");
+            }
+
+            public : template <typename _OutType_>
+            void addTo(_OutType_ &out, const value_type scale) const noexcept
+            {
+                for(int k=0; k<_LeftType_::rowsNum; ++k)
+                {
+                    // Row k of scale * D * C
+                    value_type _dc[colsNum];
+                    for(int j=0; j<colsNum; ++j)
+                        _dc[j] = value_type();
+                    for(int l=0; l<_MiddleType_::colsNum; ++l)
+                    {
+                        const value_type _dkl = _d(k,l);
+                        if(_dkl == value_type()) continue;
+                        const value_type _s = scale * _dkl;
+                        for(int j=0; j<colsNum; ++j)
+                            _dc[j] += _s * _c(l,j);
+                    }
+                    for(int i=0; i<rowsNum; ++i)
+                    {
+                        const value_type _aki = _a(k,i);
+                        if(_aki == value_type()) continue;
+                        for(int j=0; j<colsNum; ++j)
+                            out(i,j) += _aki * _dc[j];
+                    }
+                }
+            }
+        };
+
+        template <typename _LeftType_, typename _RightType_>
+        typename std::enable_if<IsExpression<_LeftType_>::value && IsExpression<_RightType_>::value,
+        Product<_LeftType_, _RightType_>>::type operator * (
+                const _LeftType_ &a, const _RightType_ &b) noexcept
+        {
+            return Product<_LeftType_, _RightType_>(a, b);
+        }
+
+        /// A.T() * D * C
+        template <typename _MatrixType_, typename _MiddleType_, typename _RightType_>
+        typename std::enable_if<IsExpression<_RightType_>::value,
+        TransposedTripleProduct<_MatrixType_,
+            typename std::decay<typename Nested<_MiddleType_>::type>::type, _RightType_>>::type
+        operator * (
+                const Product<Transposed<_MatrixType_>, _MiddleType_> &ad,
+                const _RightType_ &c) noexcept
+        {
+            return TransposedTripleProduct<_MatrixType_,
+                    typename std::decay<typename Nested<_MiddleType_>::type>::type, _RightType_>(
+                        ad.left().matrix(), ad.right(), c);
+        }
+
+        template <typename _ExpressionType_>
+        typename std::enable_if<IsExpression<_ExpressionType_>::value,
+        Scaled<_ExpressionType_>>::type operator * (
+                const typename _ExpressionType_::value_type scale,
+                const _ExpressionType_ &e) noexcept
+        {
+            return Scaled<_ExpressionType_>(scale, e);
+        }
+
+        template <typename _LeftType_, typename _RightType_>
+        typename std::enable_if<IsExpression<_LeftType_>::value && IsExpression<_RightType_>::value,
+        Sum<_LeftType_, _RightType_, 1>>::type operator + (
+                const _LeftType_ &a, const _RightType_ &b) noexcept
+        {
+            return Sum<_LeftType_, _RightType_, 1>(a, b);
+        }
+
+        template <typename _LeftType_, typename _RightType_>
+        typename std::enable_if<IsExpression<_LeftType_>::value && IsExpression<_RightType_>::value,
+        Sum<_LeftType_, _RightType_, -1>>::type operator - (
+                const _LeftType_ &a, const _RightType_ &b) noexcept
+        {
+            return Sum<_LeftType_, _RightType_, -1>(a, b);
+        }
+    }
+}
+#endif // FIXEDMATRIX_H
@@ -13,6 +13,7 @@
 #include "CLMANAGER/viennaclmanager.h"
 
 #include "TESTS/tests_runner.h"
+#include "TESTS/benchmarks_runner.h"
 
 #include "timer.h"
 
@@ -694,6 +695,7 @@ int main(int argc, char *argv[])
 //    ///////////////////////////////////////////////////////////////////////////////////////
 //    run_tests_all();
 //    _consoleRunner.writeToOutput("Tests done\n");
+//    run_benchmarks_all();
 
 //    //                          h       E       v       LCTE    unused
 //    FEM::Characteristics Al{     210.0,   68.0, 0.36,   25.50,  0};
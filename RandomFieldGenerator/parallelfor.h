@@ -0,0 +1,73 @@
+#ifndef PARALLELFOR
+#define PARALLELFOR
+
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/// Parallel loops over the flat range [0,n), e.g. voxels of RepresentativeVolumeElement.
+/// The range is split into one contiguous block per thread and the body gets [begin,end),
+/// so its inner loop is plain and contiguous and the compiler can vectorize it.
+/// Blocks don't depend on scheduling, so reductions are reproducible
+/// for the same number of threads.
+namespace Parallel
+{
+    inline int threadsNum() noexcept
+    {
+#ifdef _OPENMP
+        return omp_get_max_threads();
+#else
+        return 1;
+#endif
+    }
+
+    /// body(begin, end)
+    template<typename _Body_> inline void forRange(const long n, const _Body_ &body)
+    {
+        #pragma omp parallel
+        {
+#ifdef _OPENMP
+            const long _part = omp_get_thread_num();
+            const long _partsNum = omp_get_num_threads();
+#else
+            const long _part = 0;
+            const long _partsNum = 1;
+#endif
+            body(n * _part / _partsNum, n * (_part + 1) / _partsNum);
+        }
+    }
+
+    /// partial(begin, end) -> _Value_, partial values are joined in the order of blocks
+    /// by join(a, b) -> _Value_, starting from init
+    template<typename _Value_, typename _Partial_, typename _Join_> inline _Value_ reduce(
+            const long n,
+            const _Value_ &init,
+            const _Partial_ &partial,
+            const _Join_ &join)
+    {
+        std::vector<_Value_> _partials;
+        #pragma omp parallel
+        {
+#ifdef _OPENMP
+            const long _part = omp_get_thread_num();
+            const long _partsNum = omp_get_num_threads();
+#else
+            const long _part = 0;
+            const long _partsNum = 1;
+#endif
+            #pragma omp single
+            _partials.resize(_partsNum, init);
+
+            _partials[_part] = partial(n * _part / _partsNum, n * (_part + 1) / _partsNum);
+        }
+
+        _Value_ _result = init;
+        for(const _Value_ &_value : _partials)
+            _result = join(_result, _value);
+        return _result;
+    }
+}
+
+#endif // PARALLELFOR
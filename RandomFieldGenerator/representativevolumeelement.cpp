@@ -1,9 +1,17 @@
 #include "representativevolumeelement.h"
 
 #include "constants.h"
+#include "parallelfor.h"
+#include "fft.h"
+#include "bucketgrid.h"
+#include "distancetransform.h"
+#include "rvefile.h"
 
 #include <sstream>
 #include <fstream>
+#include <limits>
+#include <atomic>
+#include <unordered_set>
 
 cl::Program *RepresentativeVolumeElement::_programPtr = nullptr;
 cl::Kernel *RepresentativeVolumeElement::_kernelXPtr = nullptr;
@@ -13,24 +21,39 @@ cl::Kernel *RepresentativeVolumeElement::_kernelXYZPtr = nullptr;
 cl::Kernel *RepresentativeVolumeElement::_kernelRandomEllipsoidsPtr = nullptr;
 cl::Kernel *RepresentativeVolumeElement::_kernelRandomBezierCurvesPtr = nullptr;
 cl::Kernel *RepresentativeVolumeElement::_kernelVoronoiPtr = nullptr;
+cl::Kernel *RepresentativeVolumeElement::_kernelRandomNoisePtr = nullptr;
+cl::Kernel *RepresentativeVolumeElement::_kernelUnmaskedRangePtr = nullptr;
+cl::Kernel *RepresentativeVolumeElement::_kernelNormalizePtr = nullptr;
+cl::Kernel *RepresentativeVolumeElement::_kernelTwoCutMaskPtr = nullptr;
+std::atomic<uint32_t> RepresentativeVolumeElement::_instancesNum(0);
 
 #define _MASK_EPS_ 1.0f
 
 long RepresentativeVolumeElement::getRangeCellsNum(
         float minIntensity, float maxIntensity) const noexcept
 {
-    long sum = 0;
-    for( long i = 0; i < _size; ++i)
-        for( long j = 0; j < _size; ++j)
-            for( long k = 0; k < _size; ++k)
-             if(_data[(i * _size * _size) + (j * _size) + k] >= minIntensity &&
-                     _data[(i * _size * _size) + (j * _size) + k] < maxIntensity)
-                 ++sum;
-    return sum;
+    _syncHost();
+    return Parallel::reduce(
+                (long)_size * _size * _size, 0L,
+                [&](const long begin, const long end) -> long {
+                    long sum = 0;
+                    for(long i = begin; i < end; ++i)
+                        sum += (_data[i] >= minIntensity && _data[i] < maxIntensity);
+                    return sum;},
+                [](const long a, const long b) -> long {return a + b;});
 }
 
-void RepresentativeVolumeElement::saveRVEToFile(const std::string &fileName) const
+void RepresentativeVolumeElement::saveRVEToFile(
+        const std::string &fileName,
+        const bool legacyFormat) const
 {
+    _syncHost();
+    if(!legacyFormat)
+    {
+        RVEFile::write(fileName, _size, _representationSize, _data);
+        return;
+    }
+
     std::ofstream _RVEFileStream;
     try
     {
@@ -62,67 +85,39 @@ void RepresentativeVolumeElement::saveRVEToFile(const std::string &fileName) con
 
 void RepresentativeVolumeElement::loadRVEFromFile(const std::string &fileName)
 {
-    std::ifstream _RVEFileStream;
+    _useHostData();
     try
     {
-        _RVEFileStream.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        _RVEFileStream.open(fileName, std::ios::in | std::ios::binary);
-        if (_RVEFileStream.is_open())
-        {
-            _RVEFileStream.seekg(0, std::ios::beg);
-            int _newSize;
-            _RVEFileStream.read((char*)&_newSize, sizeof(int));
-
-            if(!((_newSize >= 2) && ((_newSize & (_newSize - 1)) == 0))) // check power o two
-                throw(std::runtime_error("loadRVEFromFile():"
-                                         "Cant load Representative Volume Element, "
-                                         "bad size"));
-
-            float _newRepresentationSize;
-            _RVEFileStream.read((char*)&_newRepresentationSize, sizeof(float));
-
-            float *_newData = new float[_newSize * _newSize * _newSize];
-
-            if(!_newData)
-                throw(std::runtime_error("loadRVEFromFile():"
-                                         "can't allocate memory for RVE"));
-            try
-            {
-                _RVEFileStream.read((char*)_newData, _newSize*_newSize*_newSize*sizeof(float));
-            }
-            catch(std::exception &e)
-            {
-                delete [] _newData;
-                _RVEFileStream.close();
-                throw(e);
-            }
-
-            _size = _newSize;
-            _representationSize = _newRepresentationSize;
-            delete [] _data;
-            _data = _newData;
-            _RVEFileStream.close();
-        }
+        RVEFile::Reader _reader(fileName);
+        const int _newSize = _reader.size();
+        BackingStore _newStorage((long)_newSize * _newSize * _newSize, _backingDirectory);
+        _reader.read(_newStorage.data());
+
+        _size = _newSize;
+        _representationSize = _reader.representationSize();
+        _storage = std::move(_newStorage);
+        _data = _storage.data();
+        // Device buffers can be of the other size
+        _deviceBuffers[0] = cl::Buffer();
+        _deviceBuffers[1] = cl::Buffer();
+        _deviceAllocated = false;
     }
     catch(std::exception &e)
     {
-        if(_RVEFileStream.is_open())
-            _RVEFileStream.close();
-        std::stringstream _str;
-        _str << e.what() << "\n";
-        if(_RVEFileStream.fail() || _RVEFileStream.eof() || _RVEFileStream.bad())
-            _str << "  failbit: " << _RVEFileStream.fail() <<"\n"
-                 << "  eofbit: " << _RVEFileStream.eof() <<"\n"
-                 << "  badbit: " << _RVEFileStream.bad() <<"\n";
-        throw(std::runtime_error(_str.str()));
+        throw(std::runtime_error(std::string("loadRVEFromFile(): "
+                                             "Cant load Representative Volume Element\n") +
+                                 e.what()));
     }
 }
 
 RepresentativeVolumeElement::RepresentativeVolumeElement(
         const int discreteSize,
-        const float representationSize) throw (std::runtime_error) :
+        const float representationSize,
+        const std::string &backingDirectory) throw (std::runtime_error) :
     _size(discreteSize),
-    _representationSize(representationSize)
+    _backingDirectory(backingDirectory),
+    _representationSize(representationSize),
+    _randomSeed(_instancesNum++)
 {
     if(!((_size >= 2) && ((_size & (_size - 1)) == 0))) // check power o two
         throw(std::runtime_error("RepresentativeVolumeElement():"
@@ -130,7 +125,8 @@ RepresentativeVolumeElement::RepresentativeVolumeElement(
                                  "with given size.\n"));
 
     // Prepare memory
-    _data = new float[_size * _size * _size];
+    _storage = BackingStore((long)_size * _size * _size, _backingDirectory);
+    _data = _storage.data();
 
     if(!_data)
         throw(std::runtime_error("RepresentativeVolumeElement():"
@@ -162,6 +158,66 @@ RepresentativeVolumeElement::RepresentativeVolumeElement(
         {\
             return exp(-(x*x/fx/fx + y*y/fy/fy + z*z/fz/fz) / ((r/2.0f) * (r/2.0f)));\
         }\
+        __kernel void randomNoise(\
+                    __global float *_data,\
+                    uint _seed,\
+                    uint _stream,\
+                    int _size)\
+        {\
+            int i = get_global_id(0);\
+            int j = get_global_id(1);\
+            int k = get_global_id(2);\
+            ulong _index = ((ulong)i * _size * _size) + (j * _size) + k;\
+            _data[_index] = _randomUniform(_seed, _stream, _index);\
+        }\
+        inline float _unmasked(float val)\
+        {\
+            return val >= 0 ? val : -val - 1.0f;\
+        }\
+        __kernel void unmaskedRange(\
+                    __global float *_data,\
+                    ulong _n,\
+                    __global float *_range)\
+        {\
+            size_t g = get_global_id(0);\
+            float _min = _unmasked(_data[0]);\
+            float _max = _min;\
+            for(ulong i = g; i < _n; i += get_global_size(0))\
+            {\
+                float _val = _unmasked(_data[i]);\
+                _min = _val < _min ? _val : _min;\
+                _max = _val > _max ? _val : _max;\
+            }\
+            _range[g*2] = _min;\
+            _range[g*2+1] = _max;\
+        }\
+        __kernel void normalizeData(\
+                    __global float *_data,\
+                    float _min,\
+                    float _delta,\
+                    int _size)\
+        {\
+            ulong _index = ((ulong)get_global_id(0) * _size * _size) +\
+                    (get_global_id(1) * _size) + get_global_id(2);\
+            float _val = _data[_index];\
+            float _umaskedVal = (_unmasked(_val) - _min) / _delta;\
+            _data[_index] = _val >= 0 ? _umaskedVal : -_umaskedVal - 1.0f;\
+        }\
+        __kernel void twoCutMask(\
+                    __global float *_data,\
+                    float cutLevelA,\
+                    float cutLevelB,\
+                    int inside,\
+                    int _size)\
+        {\
+            ulong _index = ((ulong)get_global_id(0) * _size * _size) +\
+                    (get_global_id(1) * _size) + get_global_id(2);\
+            float _val = _unmasked(_data[_index]);\
+            int _cut = inside ?\
+                        (_val >= cutLevelA && _val <= cutLevelB) :\
+                        (_val < cutLevelA || _val > cutLevelB);\
+            _data[_index] = _cut ? -_val - 1.0f : _val;\
+        }\
         __kernel void applyGaussianFilterX(\
                     int discreteRadius,\
                     float ellipsoidScaleFactorX,\
@@ -174,8 +230,9 @@ RepresentativeVolumeElement::RepresentativeVolumeElement(
             int i = get_global_id(0);\
             int j = get_global_id(1);\
             int k = get_global_id(2);\
+            float _sum = 0.0f;\
             for( int p = -discreteRadius; p <= discreteRadius; ++p)\
-                _buffer[(i * _size * _size) + (j * _size) + k] +=\
+                _sum +=\
                         _data[(((i+p)&(_size-1)) * _size * _size) +\
                         (j * _size) + k] *\
                         _GaussianFilter(\
@@ -184,6 +241,7 @@ RepresentativeVolumeElement::RepresentativeVolumeElement(
                             ellipsoidScaleFactorX,\
                             ellipsoidScaleFactorY,\
                             ellipsoidScaleFactorZ);\
+            _buffer[(i * _size * _size) + (j * _size) + k] = _sum;\
         }\
         __kernel void applyGaussianFilterY(\
                     int discreteRadius,\
@@ -197,8 +255,9 @@ RepresentativeVolumeElement::RepresentativeVolumeElement(
             int i = get_global_id(0);\
             int j = get_global_id(1);\
             int k = get_global_id(2);\
+            float _sum = 0.0f;\
             for( int q = -discreteRadius; q <= discreteRadius; ++q)\
-                _buffer[(i * _size * _size) + (j * _size) + k] +=\
+                _sum +=\
                         _data[(i * _size * _size) +\
                         (((j+q)&(_size-1)) * _size) + k] *\
                         _GaussianFilter(\
@@ -207,6 +266,7 @@ RepresentativeVolumeElement::RepresentativeVolumeElement(
                             ellipsoidScaleFactorX,\
                             ellipsoidScaleFactorY,\
                             ellipsoidScaleFactorZ);\
+            _buffer[(i * _size * _size) + (j * _size) + k] = _sum;\
         }\
         __kernel void applyGaussianFilterZ(\
                     int discreteRadius,\
@@ -220,8 +280,9 @@ RepresentativeVolumeElement::RepresentativeVolumeElement(
             int i = get_global_id(0);\
             int j = get_global_id(1);\
             int k = get_global_id(2);\
+            float _sum = 0.0f;\
             for( int r = -discreteRadius; r <= discreteRadius; ++r)\
-                _buffer[(i * _size * _size) + (j * _size) + k] +=\
+                _sum +=\
                         _data[(i * _size * _size) + (j * _size) +\
                         ((k+r)&(_size-1))] *\
                         _GaussianFilter(\
@@ -230,6 +291,7 @@ RepresentativeVolumeElement::RepresentativeVolumeElement(
                             ellipsoidScaleFactorX,\
                             ellipsoidScaleFactorY,\
                             ellipsoidScaleFactorZ);\
+            _buffer[(i * _size * _size) + (j * _size) + k] = _sum;\
         }\
         __kernel void applyGaussianFilterXYZ(\
                     int discreteRadius,\
@@ -246,6 +308,7 @@ RepresentativeVolumeElement::RepresentativeVolumeElement(
             int i = get_global_id(0);\
             int j = get_global_id(1);\
             int k = get_global_id(2);\
+            float _sum = 0.0f;\
             for( int p = -discreteRadius; p <= discreteRadius; ++p)\
                 for( int q = -discreteRadius; q <= discreteRadius; ++q)\
                     for( int r = -discreteRadius; r <= discreteRadius; ++r)\
@@ -254,7 +317,7 @@ RepresentativeVolumeElement::RepresentativeVolumeElement(
                         float _qq = q;\
                         float _rr = r;\
                         _rotateXYZ(&_pp, &_qq, &_rr, rotationOX, rotationOY, rotationOZ);\
-                        _buffer[(i * _size * _size) + (j * _size) + k] +=\
+                        _sum +=\
                                 _data[(((i+p)&(_size-1)) * _size * _size) +\
                                 (((j+q)&(_size-1)) * _size) + ((k+r)&(_size-1))] *\
                                 _GaussianFilter(\
@@ -264,6 +327,7 @@ RepresentativeVolumeElement::RepresentativeVolumeElement(
                                     ellipsoidScaleFactorY,\
                                     ellipsoidScaleFactorZ);\
                     }\
+            _buffer[(i * _size * _size) + (j * _size) + k] = _sum;\
         }\
         void _distanceOnRepeatedSides(\
                     float ax, float ay, float az,\
@@ -296,15 +360,22 @@ RepresentativeVolumeElement::RepresentativeVolumeElement(
                     float ellipsoidScaleFactorY,\
                     float ellipsoidScaleFactorZ,\
                     float coreValue,\
-                    int _size)\
+                    int _size,\
+                    __global int *_cellStart,\
+                    __global int *_cellObjects,\
+                    int _cellsPerAxis)\
         {\
             int i = get_global_id(0);\
             int j = get_global_id(1);\
             int k = get_global_id(2);\
+            int _cell = (k * _cellsPerAxis / _size) +\
+                    (j * _cellsPerAxis / _size) * _cellsPerAxis +\
+                    (i * _cellsPerAxis / _size) * _cellsPerAxis * _cellsPerAxis;\
             if(_data[(i * _size * _size) + (j * _size) + k] >= 0)\
             {\
-                for( int c = 0; c<ellipsoidNum; ++c)\
+                for( int p = _cellStart[_cell]; p<_cellStart[_cell+1]; ++p)\
                 {\
+                    int c = _cellObjects[p];\
                     float _kk, _jj, _ii;\
                     _distanceOnRepeatedSides(\
                                 _initialPoints[c*7+0], \
@@ -336,50 +407,57 @@ RepresentativeVolumeElement::RepresentativeVolumeElement(
                     int cellNum,\
                     __global float *_data,\
                     int _size,\
-                    float squeezeFactorZ)\
+                    float squeezeFactorZ,\
+                    __global int *_cellStart,\
+                    __global int *_cellObjects,\
+                    int _cellsPerAxis,\
+                    float _ringFactor)\
         {\
             int i = get_global_id(0);\
             int j = get_global_id(1);\
             int k = get_global_id(2);\
             if(_data[(i * _size * _size) + (j * _size) + k] >= 0)\
             {\
-                float _kk, _jj, _ii;\
-                _distanceOnRepeatedSides(\
-                            _initialPoints[0],\
-                        _initialPoints[1],\
-                        _initialPoints[2],\
-                        k, j, i, &_kk, &_jj, &_ii, _size);\
-                _kk *= _kk; _jj *= _jj; _ii *= _ii;\
-                float _minDist1 = sqrt(_kk + _jj + _ii/squeezeFactorZ);\
-                _distanceOnRepeatedSides(\
-                            _initialPoints[3+0],\
-                        _initialPoints[3+1],\
-                        _initialPoints[3+2],\
-                        k, j, i, &_kk, &_jj, &_ii, _size);\
-                _kk *= _kk; _jj *= _jj; _ii *= _ii;\
-                float _minDist2 = sqrt(_kk + _jj + _ii/squeezeFactorZ);\
-                if(_minDist1 > _minDist2)\
+                int _cx = k * _cellsPerAxis / _size;\
+                int _cy = j * _cellsPerAxis / _size;\
+                int _cz = i * _cellsPerAxis / _size;\
+                float _cellSize = (float)_size / _cellsPerAxis;\
+                float _minDist1 = MAXFLOAT;\
+                float _minDist2 = MAXFLOAT;\
+                for(int r = 0; r <= _cellsPerAxis/2; ++r)\
                 {\
-                    float tmp = _minDist1;\
-                    _minDist1 = _minDist2;\
-                    _minDist2 = tmp;\
-                }\
-                for(int c=2; c<cellNum; ++c)\
-                {\
-                    _distanceOnRepeatedSides(\
-                                _initialPoints[c*3+0],\
-                            _initialPoints[c*3+1],\
-                            _initialPoints[c*3+2],\
-                            k, j, i, &_kk, &_jj, &_ii, _size);\
-                    _kk *= _kk; _jj *= _jj; _ii *= _ii;\
-                    float _curDist = sqrt(_kk + _jj + _ii/squeezeFactorZ);\
-                    if(_curDist < _minDist1)\
-                    {\
-                        _minDist2 = _minDist1;\
-                        _minDist1 = _curDist;\
-                    }\
-                    else if(_curDist < _minDist2)\
-                        _minDist2 = _curDist;\
+                    int _last = (2*r+1 > _cellsPerAxis) ? r-1 : r;\
+                    for(int dz = -r; dz <= _last; ++dz)\
+                        for(int dy = -r; dy <= _last; ++dy)\
+                            for(int dx = -r; dx <= _last; ++dx)\
+                            {\
+                                if(dx > -r && dx < r && dy > -r && dy < r && dz > -r && dz < r)\
+                                    continue;\
+                                int _cell = ((_cx+dx)&(_cellsPerAxis-1)) +\
+                                        ((_cy+dy)&(_cellsPerAxis-1)) * _cellsPerAxis +\
+                                        ((_cz+dz)&(_cellsPerAxis-1)) * _cellsPerAxis * _cellsPerAxis;\
+                                for(int p = _cellStart[_cell]; p < _cellStart[_cell+1]; ++p)\
+                                {\
+                                    int c = _cellObjects[p];\
+                                    float _kk, _jj, _ii;\
+                                    _distanceOnRepeatedSides(\
+                                                _initialPoints[c*3+0],\
+                                            _initialPoints[c*3+1],\
+                                            _initialPoints[c*3+2],\
+                                            k, j, i, &_kk, &_jj, &_ii, _size);\
+                                    _kk *= _kk; _jj *= _jj; _ii *= _ii;\
+                                    float _curDist = sqrt(_kk + _jj + _ii/squeezeFactorZ);\
+                                    if(_curDist < _minDist1)\
+                                    {\
+                                        _minDist2 = _minDist1;\
+                                        _minDist1 = _curDist;\
+                                    }\
+                                    else if(_curDist < _minDist2)\
+                                        _minDist2 = _curDist;\
+                                }\
+                            }\
+                    if(_minDist2 <= _ringFactor * r * _cellSize)\
+                        break;\
                 }\
                 _data[(i * _size * _size) + (j * _size) + k] = _minDist2-_minDist1;\
             }\
@@ -432,15 +510,22 @@ RepresentativeVolumeElement::RepresentativeVolumeElement(
                     int curveApproximationPoints,\
                     float transitionLayerSize,\
                     float coreValue,\
-                    int _size)\
+                    int _size,\
+                    __global int *_cellStart,\
+                    __global int *_cellObjects,\
+                    int _cellsPerAxis)\
         {\
             int i = get_global_id(0);\
             int j = get_global_id(1);\
             int k = get_global_id(2);\
+            int _cell = (k * _cellsPerAxis / _size) +\
+                    (j * _cellsPerAxis / _size) * _cellsPerAxis +\
+                    (i * _cellsPerAxis / _size) * _cellsPerAxis * _cellsPerAxis;\
             if(_data[(i * _size * _size) + (j * _size) + k] >= 0)\
             {\
-                for( int c = 0; c<curveNum; ++c)\
+                for( int p = _cellStart[_cell]; p<_cellStart[_cell+1]; ++p)\
                 {\
+                    int c = _cellObjects[p];\
                     long offset = c*curveApproximationPoints*3;\
                     float _kk, _jj, _ii;\
                     _distanceOnRepeatedSides(\
@@ -516,7 +601,7 @@ RepresentativeVolumeElement::RepresentativeVolumeElement(
         /// Don't worry, CLManager will destroy this objects at the end of application
         /// \todo different platforms
         _programPtr = &OpenCL::CLManager::instance().createProgram(
-                    _CLSource_applyGaussianFilter,
+                    MathUtils::philoxCLSource() + _CLSource_applyGaussianFilter,
                     OpenCL::CLManager::instance().getCurrentContext(),
                     OpenCL::CLManager::instance().getCurrentDevices());
 
@@ -540,49 +625,98 @@ RepresentativeVolumeElement::RepresentativeVolumeElement(
 
         _kernelVoronoiPtr = &OpenCL::CLManager::instance().createKernel(
                     *_programPtr, "voronoi");
+
+        _kernelRandomNoisePtr = &OpenCL::CLManager::instance().createKernel(
+                    *_programPtr, "randomNoise");
+
+        _kernelUnmaskedRangePtr = &OpenCL::CLManager::instance().createKernel(
+                    *_programPtr, "unmaskedRange");
+
+        _kernelNormalizePtr = &OpenCL::CLManager::instance().createKernel(
+                    *_programPtr, "normalizeData");
+
+        _kernelTwoCutMaskPtr = &OpenCL::CLManager::instance().createKernel(
+                    *_programPtr, "twoCutMask");
     }
 }
 
+cl::Buffer & RepresentativeVolumeElement::_deviceData(const bool keep)
+{
+    if(!_deviceAllocated)
+    {
+        for(cl::Buffer &_buffer : _deviceBuffers)
+            _buffer = cl::Buffer(
+                        OpenCL::CLManager::instance().getCurrentContext(),
+                        CL_MEM_READ_WRITE,
+                        sizeof(float) * _size * _size * _size);
+        _deviceAllocated = true;
+    }
+    if(!_deviceValid && keep)
+        OpenCL::CLManager::instance().getCurrentCommandQueue().enqueueWriteBuffer(
+                    _deviceBuffers[_deviceCurrent],
+                    CL_TRUE,
+                    0,
+                    sizeof(float) * _size * _size * _size,
+                    _data);
+    _deviceValid = true;
+    return _deviceBuffers[_deviceCurrent];
+}
+
+void RepresentativeVolumeElement::_syncHost() const noexcept
+{
+    if(_hostValid)
+        return;
+    std::lock_guard<std::mutex> _lock(_hostSyncMutex);
+    if(_hostValid)
+        return;
+    OpenCL::CLManager::instance().getCurrentCommandQueue().enqueueReadBuffer(
+                _deviceBuffers[_deviceCurrent],
+                CL_TRUE,
+                0,
+                sizeof(float) * _size * _size * _size,
+                _data);
+    _hostValid = true;
+}
+
 void RepresentativeVolumeElement::cleanUnMaskedData(float filler) noexcept
 {
-    for( long i = 0; i<_size; ++i)
-        for( long j = 0; j<_size; ++j)
-            for( long k = 0; k<_size; ++k)
-            {
-                float &_val = _data[(i * _size * _size) + (j * _size) + k];
-                if(_val >= 0)
-                    _val = filler;
-            }
+    _useHostData();
+    Parallel::forRange((long)_size * _size * _size, [&](const long begin, const long end){
+        for(long i = begin; i < end; ++i)
+            _data[i] = (_data[i] >= 0) ? filler : _data[i];});
 }
 
 void RepresentativeVolumeElement::cleanMask() noexcept
 {
-    for( long i = 0; i<_size; ++i)
-        for( long j = 0; j<_size; ++j)
-            for( long k = 0; k<_size; ++k)
-            {
-                float &_val = _data[(i * _size * _size) + (j * _size) + k];
-                if(_val < 0)
-                    _val = -_val - _MASK_EPS_;
-            }
+    _useHostData();
+    Parallel::forRange((long)_size * _size * _size, [&](const long begin, const long end){
+        for(long i = begin; i < end; ++i)
+            _data[i] = (_data[i] < 0) ? (-_data[i] - _MASK_EPS_) : _data[i];});
 }
 
 void RepresentativeVolumeElement::addRandomNoise() noexcept
 {
-    for( long i = 0; i<_size; ++i)
-        for( long j = 0; j<_size; ++j)
-            for( long k = 0; k<_size; ++k)
-            {
-                float &_val = _data[(i * _size * _size) + (j * _size) + k];
-                if(_val >= 0)
-                    _val += MathUtils::rand<float>(0.0, 1.0);
-            }
+    _useHostData();
+    const uint32_t _stream = _nextRandomStream();
+    Parallel::forRange((long)_size * _size * _size, [&](const long begin, const long end){
+        for(long i = begin; i < end; ++i)
+            if(_data[i] >= 0)
+                _data[i] += _random(_stream, i, 0.0f, 1.0f);});
+}
+
+void RepresentativeVolumeElement::_fillRandomNoise(float *data) noexcept
+{
+    const uint32_t _stream = _nextRandomStream();
+    Parallel::forRange((long)_size * _size * _size, [&](const long begin, const long end){
+        for(long i = begin; i < end; ++i)
+            data[i] = _random(_stream, i, 0.0f, 1.0f);});
 }
 
 void RepresentativeVolumeElement::applyRelativeRandomNoise(
         const float distrCoefBottom,
         const float distrCoefTop) throw (std::runtime_error)
 {
+    _useHostData();
     if(distrCoefBottom < 0.0f || distrCoefTop < 0.0f)
         throw(std::runtime_error(
                 "applyRelativeRandomNoise(): distrCoefTop < 0.0f || "
@@ -593,49 +727,51 @@ void RepresentativeVolumeElement::applyRelativeRandomNoise(
     findUnMaskedMinAndMax(_min,_max);
     float _delta = _max-_min;
 
-    for( long i = 0; i<_size; ++i)
-        for( long j = 0; j<_size; ++j)
-            for( long k = 0; k<_size; ++k)
+    const uint32_t _stream = _nextRandomStream();
+    Parallel::forRange((long)_size * _size * _size, [&](const long begin, const long end){
+        for(long i = begin; i < end; ++i)
+        {
+            float &_val = _data[i];
+            if(_val >= 0)
             {
-                float &_val = _data[(i * _size * _size) + (j * _size) + k];
-                if(_val >= 0)
-                {
-                    _val = MathUtils::rand<float>(
-                                (1.0f-std::pow(std::fabs((_val-_min)/_delta-1.0f),
-                                              distrCoefBottom))*_delta+_min,
-                                std::pow((_val-_min)/_delta,distrCoefTop)*_delta+_min);
-//                    _val = MathUtils::rand<float>(
-//                                _val*deviationCoefficient,
-//                                _val*deviationCoefficient+(1.0f-deviationCoefficient));
-                }
+                _val = _random(
+                            _stream, i,
+                            (1.0f-std::pow(std::fabs((_val-_min)/_delta-1.0f),
+                                          distrCoefBottom))*_delta+_min,
+                            std::pow((_val-_min)/_delta,distrCoefTop)*_delta+_min);
+//                _val = MathUtils::rand<float>(
+//                            _val*deviationCoefficient,
+//                            _val*deviationCoefficient+(1.0f-deviationCoefficient));
             }
+        }});
 }
 
 void RepresentativeVolumeElement::findUnMaskedMinAndMax(float &min, float &max) noexcept
 {
-    bool isFirstFound = false;
-
-    for( long i = 0; i < _size; ++i)
-        for( long j = 0; j < _size; ++j)
-            for( long k = 0; k < _size; ++k)
-            {
-                float _val = _data[(i * _size * _size) + (j * _size) + k];
-                if(_val >= 0)
-                {
-                    if(!isFirstFound)
+    _syncHost();
+    // Masked values are negative, so they never win
+    struct MinMax{float min; float max;};
+    const MinMax _init{std::numeric_limits<float>::max(), -1.0f};
+    MinMax _minMax = Parallel::reduce(
+                (long)_size * _size * _size, _init,
+                [&](const long begin, const long end) -> MinMax {
+                    float _min = _init.min;
+                    float _max = _init.max;
+                    for(long i = begin; i < end; ++i)
                     {
-                       min = max = _val;
-                       isFirstFound = true;
+                        _min = (_data[i] >= 0 && _data[i] < _min) ? _data[i] : _min;
+                        _max = (_data[i] > _max) ? _data[i] : _max;
                     }
-                    else
-                    {
-                        if(_val < min)
-                            min = _val;
-                        if(_val > max)
-                            max = _val;
-                    }
-                }
-            }
+                    return MinMax{_min, _max};},
+                [](const MinMax &a, const MinMax &b) -> MinMax {
+                    return MinMax{std::min(a.min, b.min), std::max(a.max, b.max)};});
+
+    // Nothing is found, if everything is masked
+    if(_minMax.max >= 0)
+    {
+        min = _minMax.min;
+        max = _minMax.max;
+    }
 }
 
 /// \todo refactor find min and max
@@ -643,6 +779,7 @@ void RepresentativeVolumeElement::scaleUnMasked(
         const float levelA,
         const float levelB) throw (std::runtime_error)
 {
+    _useHostData();
     if(levelA < 0.0f || levelA >= levelB)
         throw(std::runtime_error(
                 "scaleUnMasked(): levelA < 0.0f || levelA >= levelB.\n"));
@@ -655,78 +792,70 @@ void RepresentativeVolumeElement::scaleUnMasked(
     findUnMaskedMinAndMax(_min,_max);
 
     float _delta = (_max - _min);
-    for( long i = 0; i < _size; ++i)
-        for( long j = 0; j < _size; ++j)
-            for( long k = 0; k < _size; ++k)
-            {
-                float &_val = _data[(i * _size * _size) + (j * _size) + k];
-                if(_val >= 0)
-                    _val =
-                            levelA +
-                            (_data[(i * _size * _size) + (j * _size) + k] - _min) /
-                            _delta * (levelB - levelA);
-            }
-
+    Parallel::forRange((long)_size * _size * _size, [&](const long begin, const long end){
+        for(long i = begin; i < end; ++i)
+            _data[i] = (_data[i] >= 0) ?
+                        levelA + (_data[i] - _min) / _delta * (levelB - levelA) :
+                        _data[i];});
 }
 
 void RepresentativeVolumeElement::normalize() noexcept
 {
-    float _min = 0;
-    float _max = 0;
-    _min = _max = (_data[0] >= 0) ? (_data[0]) :
-        (-_data[0] - _MASK_EPS_);   // data can be masked (<0)
-
-    for( long i = 0; i < _size; ++i)
-        for( long j = 0; j < _size; ++j)
-            for( long k = 0; k < _size; ++k)
-            {
-                float &_val = _data[(i * _size * _size) + (j * _size) + k];
-                float _umaskedVal = (_val >= 0) ? (_val) : (-_val - _MASK_EPS_);
-                if(_umaskedVal < _min)
-                    _min = _umaskedVal;
-                if(_umaskedVal > _max)
-                    _max = _umaskedVal;
-            }
+    if(isOnDevice())
+    {
+        _normalizeCL();
+        return;
+    }
 
-    float _delta = _max - _min;
-    for( long i = 0; i < _size; ++i)
-        for( long j = 0; j < _size; ++j)
-            for( long k = 0; k < _size; ++k)
-            {
-                float &_val = _data[(i * _size * _size) + (j * _size) + k];
-                float _umaskedVal = (((_val >= 0) ? (_val) : (-_val - _MASK_EPS_)) -
-                                                   _min) / _delta;
-                _val = (_val >= 0) ? (_umaskedVal) : (-_umaskedVal - _MASK_EPS_);
-            }
+    _useHostData();
+    struct MinMax{float min; float max;};
+    const float _first = (_data[0] >= 0) ? (_data[0]) :
+        (-_data[0] - _MASK_EPS_);   // data can be masked (<0)
+    MinMax _minMax = Parallel::reduce(
+                (long)_size * _size * _size, MinMax{_first, _first},
+                [&](const long begin, const long end) -> MinMax {
+                    float _min = _first;
+                    float _max = _first;
+                    for(long i = begin; i < end; ++i)
+                    {
+                        float _umaskedVal = (_data[i] >= 0) ? (_data[i]) : (-_data[i] - _MASK_EPS_);
+                        _min = (_umaskedVal < _min) ? _umaskedVal : _min;
+                        _max = (_umaskedVal > _max) ? _umaskedVal : _max;
+                    }
+                    return MinMax{_min, _max};},
+                [](const MinMax &a, const MinMax &b) -> MinMax {
+                    return MinMax{std::min(a.min, b.min), std::max(a.max, b.max)};});
+
+    const float _min = _minMax.min;
+    const float _delta = _minMax.max - _minMax.min;
+    Parallel::forRange((long)_size * _size * _size, [&](const long begin, const long end){
+        for(long i = begin; i < end; ++i)
+        {
+            float _umaskedVal = (((_data[i] >= 0) ? (_data[i]) : (-_data[i] - _MASK_EPS_)) -
+                                 _min) / _delta;
+            _data[i] = (_data[i] >= 0) ? (_umaskedVal) : (-_umaskedVal - _MASK_EPS_);
+        }});
 }
 
 void RepresentativeVolumeElement::normalizeUnMasked() noexcept
 {
+    _useHostData();
     float _min = 0;
     float _max = 0;
     findUnMaskedMinAndMax(_min,_max);
 
     float _delta = _max - _min;
-    for( long i = 0; i < _size; ++i)
-        for( long j = 0; j < _size; ++j)
-            for( long k = 0; k < _size; ++k)
-            {
-                float &_val = _data[(i * _size * _size) + (j * _size) + k];
-                if(_val >= 0)
-                    _val = (_val - _min) / _delta;
-            }
+    Parallel::forRange((long)_size * _size * _size, [&](const long begin, const long end){
+        for(long i = begin; i < end; ++i)
+            _data[i] = (_data[i] >= 0) ? (_data[i] - _min) / _delta : _data[i];});
 }
 
 void RepresentativeVolumeElement::invertUnMasked() noexcept
 {
-    for( long i = 0; i < _size; ++i)
-        for( long j = 0; j < _size; ++j)
-            for( long k = 0; k < _size; ++k)
-            {
-                float &_val = _data[(i * _size * _size) + (j * _size) + k];
-                if(_val >= 0)
-                    _val = 1.0f - _val;
-            }
+    _useHostData();
+    Parallel::forRange((long)_size * _size * _size, [&](const long begin, const long end){
+        for(long i = begin; i < end; ++i)
+            _data[i] = (_data[i] >= 0) ? 1.0f - _data[i] : _data[i];});
 }
 
 void RepresentativeVolumeElement::applyGaussianFilter(
@@ -741,6 +870,7 @@ void RepresentativeVolumeElement::applyGaussianFilter(
         float rotationOY,
         float rotationOZ) throw (std::runtime_error)
 {
+    _useHostData();
     std::cout << "applyGaussianFilter() call:" << std::endl;
     if(discreteRadius <= 0)
         throw(std::runtime_error("applyGaussianFilter(): radius <= 0.\n"));
@@ -763,115 +893,94 @@ void RepresentativeVolumeElement::applyGaussianFilter(
         throw(std::runtime_error("applyGaussianFilter(): rotationOZ "
                                  "< 0 or > 2*pi.\n"));
 
-    float *_buffer = nullptr;
-    _buffer = new float[_size * _size * _size];
-    if(!_buffer)
-        throw(std::runtime_error("applyGaussianFilterCL():"
-                                 "can't allocate memory for temporary storage.\n"));
+    BackingStore _bufferBacking = _temporaryStorage();
+    float *_buffer = _bufferBacking.data();
 
-    float *_dataTmpStorage = nullptr; 
+    BackingStore _dataTmpBacking;
+    float *_dataTmpStorage = nullptr;
     if(useDataAsIntensity)
     {
-        _dataTmpStorage = new float[_size * _size * _size];
-        if(!_dataTmpStorage)
-            throw(std::runtime_error("applyGaussianFilterCL():"
-                                     "can't allocate memory for temporary storage.\n"));
+        _dataTmpBacking = _temporaryStorage();
+        _dataTmpStorage = _dataTmpBacking.data();
 
         memcpy(_dataTmpStorage,_data,sizeof(float) * _size * _size * _size);
 
-        for( long i = 0; i<_size; ++i)
-            for( long j = 0; j<_size; ++j)
-                for( long k = 0; k<_size; ++k)
-                {
-                    _data[(i * _size * _size) + (j * _size) + k] =
-                            MathUtils::rand<float>(0.0f, 1.0f);
-                }
+        _fillRandomNoise(_data);
     }
 
     memset(_buffer, 0, sizeof(float) * _size * _size * _size);
 
     if(!useRotations)
     {
-        std::cout << "  Applying filter, phase 1...\n";
-        for( long i = 0; i < _size; ++i)
+        // 1D kernels are computed once, the offsets are wrapped on the period,
+        // so the radius can be greater than _size
+        std::vector<long> _offsets[3];
+        std::vector<float> _weights[3];
+        for(int _axis = 0; _axis < 3; ++_axis)
         {
-            std::cout
-                    << "\b\b\b\b"
-                    << (int)(i * 100.0 / (_size-1))
-                    << "%";
-            for( long j = 0; j < _size; ++j)
-                for( long k = 0; k < _size; ++k)
+            std::vector<float> _wrappedWeights(_size, 0.0f);
+            std::vector<bool> _isUsed(_size, false);
+            for(int p = -discreteRadius; p <= discreteRadius; ++p)
+            {
+                _wrappedWeights[p&(_size-1)] += GaussianBlurFilter(
+                            discreteRadius,
+                            _axis == 0 ? p : 0,
+                            _axis == 1 ? p : 0,
+                            _axis == 2 ? p : 0,
+                            ellipsoidScaleFactorZ,
+                            ellipsoidScaleFactorY,
+                            ellipsoidScaleFactorX);
+                _isUsed[p&(_size-1)] = true;
+            }
+            for(long d = 0; d < _size; ++d)
+                if(_isUsed[d])
                 {
-                    for( int p = -discreteRadius; p <= discreteRadius; ++p)
-                    {
-                        _buffer[(i * _size * _size) + (j * _size) + k] +=
-                                _data[(((i+p)&(_size-1)) * _size * _size) +
-                                (j * _size) + k] *
-                                GaussianBlurFilter(
-                                    discreteRadius,
-                                    p, 0, 0,
-                                    ellipsoidScaleFactorZ,
-                                    ellipsoidScaleFactorY,
-                                    ellipsoidScaleFactorX);
-                    }
+                    _offsets[_axis].push_back(d);
+                    _weights[_axis].push_back(_wrappedWeights[d]);
                 }
         }
-        memcpy(_data, _buffer, sizeof(float) * _size * _size * _size);
-        std::cout << " Done" << std::endl;
 
-        std::cout << "                ...phase 2...\n";
-        memset(_buffer, 0, sizeof(float) * _size * _size * _size);
-        for( long i = 0; i < _size; ++i)
-        {
-            std::cout
-                    << "\b\b\b\b"
-                    << (int)(i * 100.0 / (_size-1))
-                    << "%";
-            for( long j = 0; j < _size; ++j)
-                for( long k = 0; k < _size; ++k)
+        // Each pass computes rows of _size contiguous voxels (along k),
+        // the taps of the strided axes are whole shifted rows, so the inner loops
+        // read contiguous memory and are vectorized.
+        auto _pass = [&](const float *source, float *destination, const int axis){
+            Parallel::forRange((long)_size * _size, [&](const long begin, const long end){
+                std::vector<float> _line(2 * _size);
+                for(long _row = begin; _row < end; ++_row)
                 {
-                    for( int q = -discreteRadius; q <= discreteRadius; ++q)
+                    const long i = _row / _size;
+                    const long j = _row % _size;
+                    float *_out = destination + _row * _size;
+                    for(long k = 0; k < _size; ++k)
+                        _out[k] = 0.0f;
+                    if(axis == 2)
                     {
-                        _buffer[(i * _size * _size) + (j * _size) + k] +=
-                                _data[(i * _size * _size) +
-                                (((j+q)&(_size-1)) * _size) + k] *
-                                GaussianBlurFilter(
-                                    discreteRadius,
-                                    0, q, 0,
-                                    ellipsoidScaleFactorZ,
-                                    ellipsoidScaleFactorY,
-                                    ellipsoidScaleFactorX);
+                        const float *_in = source + _row * _size;
+                        for(long k = 0; k < 2 * _size; ++k)
+                            _line[k] = _in[k&(_size-1)];
                     }
-                }
-        }
-        memcpy(_data, _buffer, sizeof(float) * _size * _size * _size);
-        std::cout << " Done" << std::endl;
-
-        std::cout << "                ...phase 3...\n";
-        memset(_buffer, 0, sizeof(float) * _size * _size * _size);
-        for( long i = 0; i < _size; ++i)
-        {
-            std::cout
-                    << "\b\b\b\b"
-                    << (int)(i * 100.0 / (_size-1))
-                    << "%";
-            for( long j = 0; j < _size; ++j)
-                for( long k = 0; k < _size; ++k)
-                {
-                    for( int r = -discreteRadius; r <= discreteRadius; ++r)
+                    for(unsigned t = 0; t < _offsets[axis].size(); ++t)
                     {
-                        _buffer[(i * _size * _size) + (j * _size) + k] +=
-                                _data[(i * _size * _size) + (j * _size) +
-                                ((k+r)&(_size-1))] *
-                                GaussianBlurFilter(
-                                    discreteRadius,
-                                    0, 0, r,
-                                    ellipsoidScaleFactorZ,
-                                    ellipsoidScaleFactorY,
-                                    ellipsoidScaleFactorX);
+                        const long d = _offsets[axis][t];
+                        const float _weight = _weights[axis][t];
+                        const float *_in =
+                                axis == 0 ? source + (((i+d)&(_size-1)) * _size * _size) + (j * _size) :
+                                axis == 1 ? source + (i * _size * _size) + (((j+d)&(_size-1)) * _size) :
+                                            _line.data() + d;
+                        for(long k = 0; k < _size; ++k)
+                            _out[k] += _weight * _in[k];
                     }
-                }
-        }
+                }});
+        };
+
+        std::cout << "  Applying filter, phase 1...";
+        _pass(_data, _buffer, 0);
+        std::cout << " Done" << std::endl;
+        std::cout << "                ...phase 2...";
+        _pass(_buffer, _data, 1);
+        std::cout << " Done" << std::endl;
+        std::cout << "                ...phase 3...";
+        _pass(_data, _buffer, 2);
     }
     else
     {
@@ -909,8 +1018,6 @@ void RepresentativeVolumeElement::applyGaussianFilter(
     memcpy(_data, _buffer, sizeof(float) * _size * _size * _size);
     std::cout << " Done" << std::endl;
 
-    delete [] _buffer;
-
     if(useDataAsIntensity)
     {
         normalize();
@@ -930,45 +1037,233 @@ void RepresentativeVolumeElement::applyGaussianFilter(
                     if(_dataTmpStorage[_index] < 0)
                         _data[_index] = _dataTmpStorage[_index];
                 }
-        delete [] _dataTmpStorage;
     }
 
     std::cout << " applyGaussianFilter() Done" << std::endl;
 }
 
+void RepresentativeVolumeElement::applyGaussianFilterFFT(
+        int discreteRadius,
+        float ellipsoidScaleFactorX,
+        float ellipsoidScaleFactorY,
+        float ellipsoidScaleFactorZ,
+        bool useDataAsIntensity,
+        float intensityFactor,
+        bool useRotations,
+        float rotationOX,
+        float rotationOY,
+        float rotationOZ) throw (std::runtime_error)
+{
+    _useHostData();
+    std::cout << "applyGaussianFilterFFT() call:" << std::endl;
+    if(discreteRadius <= 0)
+        throw(std::runtime_error("applyGaussianFilterFFT(): radius <= 0.\n"));
+    if(ellipsoidScaleFactorX <= 0.0f || ellipsoidScaleFactorX > 1.0f)
+        throw(std::runtime_error("applyGaussianFilterFFT(): ellipsoidScaleFactorX "
+                                 "<= 0 or > 1.\n"));
+    if(ellipsoidScaleFactorY <= 0.0f || ellipsoidScaleFactorY > 1.0f)
+        throw(std::runtime_error("applyGaussianFilterFFT(): ellipsoidScaleFactorY "
+                                 "<= 0 or > 1.\n"));
+    if(ellipsoidScaleFactorZ <= 0.0f || ellipsoidScaleFactorZ > 1.0f)
+        throw(std::runtime_error("applyGaussianFilterFFT(): ellipsoidScaleFactorZ "
+                                 "<= 0 or > 1.\n"));
+    if(rotationOX < 0.0f || rotationOX > M_PI*2)
+        throw(std::runtime_error("applyGaussianFilterFFT(): rotationOX "
+                                 "< 0 or > 2*pi.\n"));
+    if(rotationOY < 0.0f || rotationOY > M_PI*2)
+        throw(std::runtime_error("applyGaussianFilterFFT(): rotationOY "
+                                 "< 0 or > 2*pi.\n"));
+    if(rotationOZ < 0.0f || rotationOZ > M_PI*2)
+        throw(std::runtime_error("applyGaussianFilterFFT(): rotationOZ "
+                                 "< 0 or > 2*pi.\n"));
+    if(_size < 2 || (_size & (_size-1)))
+        throw(std::runtime_error("applyGaussianFilterFFT(): size is not the power of 2.\n"));
+
+    const long _volume = (long)_size * _size * _size;
+    BackingStore _dataTmpBacking;
+    float *_dataTmpStorage = nullptr;
+    if(useDataAsIntensity)
+    {
+        _dataTmpBacking = _temporaryStorage();
+        _dataTmpStorage = _dataTmpBacking.data();
+        memcpy(_dataTmpStorage, _data, sizeof(float) * _volume);
+        _fillRandomNoise(_data);
+    }
+
+    // Kernel on the same grid, offsets are wrapped on the period as in applyGaussianFilter()
+    std::cout << "  Sampling kernel...";
+    std::vector<float> _kernel(_volume, 0.0f);
+    if(!useRotations)
+    {
+        std::vector<float> _kernelP(_size, 0.0f), _kernelQ(_size, 0.0f), _kernelR(_size, 0.0f);
+        for(int p = -discreteRadius; p <= discreteRadius; ++p)
+        {
+            _kernelP[p&(_size-1)] += GaussianBlurFilter(
+                        discreteRadius, p, 0, 0,
+                        ellipsoidScaleFactorZ, ellipsoidScaleFactorY, ellipsoidScaleFactorX);
+            _kernelQ[p&(_size-1)] += GaussianBlurFilter(
+                        discreteRadius, 0, p, 0,
+                        ellipsoidScaleFactorZ, ellipsoidScaleFactorY, ellipsoidScaleFactorX);
+            _kernelR[p&(_size-1)] += GaussianBlurFilter(
+                        discreteRadius, 0, 0, p,
+                        ellipsoidScaleFactorZ, ellipsoidScaleFactorY, ellipsoidScaleFactorX);
+        }
+        for(long i = 0; i < _size; ++i)
+            for(long j = 0; j < _size; ++j)
+                for(long k = 0; k < _size; ++k)
+                    _kernel[(i * _size * _size) + (j * _size) + k] =
+                            _kernelP[i] * _kernelQ[j] * _kernelR[k];
+    }
+    else
+    {
+        for(int p = -discreteRadius; p <= discreteRadius; ++p)
+            for(int q = -discreteRadius; q <= discreteRadius; ++q)
+                for(int r = -discreteRadius; r <= discreteRadius; ++r)
+                {
+                    float _pp = p;
+                    float _qq = q;
+                    float _rr = r;
+                    rotateXYZ(_pp, _qq, _rr, -rotationOZ, -rotationOY, -rotationOX);
+                    _kernel[((p&(_size-1)) * _size * _size) + ((q&(_size-1)) * _size) +
+                            (r&(_size-1))] +=
+                            GaussianBlurFilter(
+                                discreteRadius,
+                                _pp, _qq, _rr,
+                                ellipsoidScaleFactorZ,
+                                ellipsoidScaleFactorY,
+                                ellipsoidScaleFactorX);
+                }
+    }
+    std::cout << " Done" << std::endl;
+
+    // Filter is the correlation with the kernel: buffer(x) = sum data(x+p) * kernel(p),
+    // so the data spectrum is multiplied by the conjugated kernel spectrum
+    std::cout << "  Applying filter in the frequency domain...";
+    std::vector<FastFourierTransform::Complex> _dataSpectrum;
+    std::vector<FastFourierTransform::Complex> _kernelSpectrum;
+    FastFourierTransform::forward3D(_data, _size, _dataSpectrum);
+    FastFourierTransform::forward3D(_kernel.data(), _size, _kernelSpectrum);
+    _kernel.clear();
+    _kernel.shrink_to_fit();
+    Parallel::forRange(_dataSpectrum.size(), [&](const long begin, const long end){
+        for(long i = begin; i < end; ++i)
+            _dataSpectrum[i] *= std::conj(_kernelSpectrum[i]);});
+    _kernelSpectrum.clear();
+    _kernelSpectrum.shrink_to_fit();
+    FastFourierTransform::inverse3D(_dataSpectrum, _size, _data);
+    std::cout << " Done" << std::endl;
+
+    if(useDataAsIntensity)
+    {
+        normalize();
+        _add(_data, _dataTmpStorage, intensityFactor);
+    }
+
+    normalize();
+
+    if(useDataAsIntensity)
+        for(long i = 0; i < _volume; ++i)
+            if(_dataTmpStorage[i] < 0)
+                _data[i] = _dataTmpStorage[i];
+
+    std::cout << " applyGaussianFilterFFT() Done" << std::endl;
+}
+
 void RepresentativeVolumeElement::_CLGaussianBlurFilterPhase(
-        cl::Buffer &_dataBuffer,
-        cl::Buffer &_bufferBuffer,
         cl::CommandQueue &_queue,
         cl::NDRange &_localThreads,
         cl::Event &_event,
-        cl::Kernel &_phaseKernel)
+        cl::Kernel &_phaseKernel,
+        const int dataArgIndex)
 {
-    _queue.enqueueFillBuffer<cl_float>(
-                _bufferBuffer,
-                0,
-                0,
-                sizeof(float) * _size * _size * _size,
+    // Every element of the spare buffer is written, so it isn't cleaned.
+    // Arguments are taken at enqueue, and the queue is in-order,
+    // so the next phase doesn't wait for this one on the host
+    _phaseKernel.setArg(dataArgIndex, _deviceData());
+    _phaseKernel.setArg(dataArgIndex + 1, _deviceSpare());
+    _queue.enqueueNDRangeKernel(
+                _phaseKernel,
+                cl::NullRange,
+                cl::NDRange(_size, _size, _size),
+                _localThreads,
                 NULL,
                 &_event);
-    _event.wait();
+    _swapDeviceBuffers();
+}
+
+void RepresentativeVolumeElement::_normalizeCL()
+{
+    // Partial min and max of unmasked values, as normalize()
+    const int _partsNum = 1024;
+    std::vector<float> _range(_partsNum * 2);
+    cl::Buffer _rangeBuffer(
+                OpenCL::CLManager::instance().getCurrentContext(),
+                CL_MEM_WRITE_ONLY,
+                sizeof(float) * _range.size());
+    cl::CommandQueue &_queue = OpenCL::CLManager::instance().getCurrentCommandQueue();
+    cl::NDRange _localThreads = OpenCL::CLManager::instance().getMaxLocalThreads(_size);
+
+    _kernelUnmaskedRangePtr->setArg(0, _deviceData());
+    _kernelUnmaskedRangePtr->setArg(1, (cl_ulong)_size * _size * _size);
+    _kernelUnmaskedRangePtr->setArg(2, _rangeBuffer);
     _queue.enqueueNDRangeKernel(
-                _phaseKernel,
+                *_kernelUnmaskedRangePtr,
+                cl::NullRange,
+                cl::NDRange(_partsNum),
+                cl::NullRange);
+    _queue.enqueueReadBuffer(
+                _rangeBuffer,
+                CL_TRUE,
+                0,
+                sizeof(float) * _range.size(),
+                _range.data());
+
+    float _min = _range[0];
+    float _max = _range[1];
+    for(int g=1; g<_partsNum; ++g)
+    {
+        _min = std::min(_min, _range[g*2]);
+        _max = std::max(_max, _range[g*2+1]);
+    }
+
+    cl::Event _event;
+    _kernelNormalizePtr->setArg(0, _deviceData());
+    _kernelNormalizePtr->setArg(1, _min);
+    _kernelNormalizePtr->setArg(2, _max - _min);
+    _kernelNormalizePtr->setArg(3, _size);
+    _queue.enqueueNDRangeKernel(
+                *_kernelNormalizePtr,
                 cl::NullRange,
                 cl::NDRange(_size, _size, _size),
                 _localThreads,
                 NULL,
                 &_event);
     _event.wait();
-    _queue.enqueueCopyBuffer(
-                _bufferBuffer,
-                _dataBuffer,
-                0,
-                0,
-                sizeof(float) * _size * _size * _size,
+    _deviceDataChanged();
+}
+
+void RepresentativeVolumeElement::_applyTwoCutMaskCL(
+        const float cutLevelA,
+        const float cutLevelB,
+        const bool inside)
+{
+    cl::CommandQueue &_queue = OpenCL::CLManager::instance().getCurrentCommandQueue();
+    cl::NDRange _localThreads = OpenCL::CLManager::instance().getMaxLocalThreads(_size);
+    cl::Event _event;
+    _kernelTwoCutMaskPtr->setArg(0, _deviceData());
+    _kernelTwoCutMaskPtr->setArg(1, cutLevelA);
+    _kernelTwoCutMaskPtr->setArg(2, cutLevelB);
+    _kernelTwoCutMaskPtr->setArg(3, (int)inside);
+    _kernelTwoCutMaskPtr->setArg(4, _size);
+    _queue.enqueueNDRangeKernel(
+                *_kernelTwoCutMaskPtr,
+                cl::NullRange,
+                cl::NDRange(_size, _size, _size),
+                _localThreads,
                 NULL,
                 &_event);
     _event.wait();
+    _deviceDataChanged();
 }
 
 void RepresentativeVolumeElement::applyGaussianFilterCL(
@@ -1005,139 +1300,90 @@ void RepresentativeVolumeElement::applyGaussianFilterCL(
         throw(std::runtime_error("applyGaussianFilterCL(): rotationOZ "
                                  "< 0 or > 2*pi.\n"));
 
+    BackingStore _dataTmpBacking;
     float *_dataTmpStorage = nullptr;
     if(useDataAsIntensity)
     {
-        _dataTmpStorage = new float[_size * _size * _size];
-        if(!_dataTmpStorage)
-            throw(std::runtime_error("applyGaussianFilterCL():"
-                                     "can't allocate memory for temporary storage.\n"));
+        _dataTmpBacking = _temporaryStorage();
+        _dataTmpStorage = _dataTmpBacking.data();
 
+        _syncHost();
         memcpy(_dataTmpStorage,_data,sizeof(float) * _size * _size * _size);
-
-        for( long i = 0; i<_size; ++i)
-            for( long j = 0; j<_size; ++j)
-                for( long k = 0; k<_size; ++k)
-                {
-                    _data[(i * _size * _size) + (j * _size) + k] =
-                            MathUtils::rand<float>(0.0f, 1.0f);
-                }
     }
 
     std::cout << "  Preparing OpenCL...";
 
-    cl::Buffer _dataBuffer(
-                OpenCL::CLManager::instance().getCurrentContext(),
-                CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
-                sizeof(float) * _size * _size * _size,
-                _data);
-    cl::Buffer _bufferBuffer(
-                OpenCL::CLManager::instance().getCurrentContext(),
-                CL_MEM_READ_WRITE,
-                sizeof(float) * _size * _size * _size);
+    cl::CommandQueue &_queue = OpenCL::CLManager::instance().getCurrentCommandQueue();
+    cl::Event _event;
 
-    if(!useRotations)
-    {
-        /// \todo X and Z are replaced
-        _kernelXPtr->setArg(0, discreteRadius);
-        _kernelXPtr->setArg(1, ellipsoidScaleFactorZ);
-        _kernelXPtr->setArg(2, ellipsoidScaleFactorY);
-        _kernelXPtr->setArg(3, ellipsoidScaleFactorX);
-        _kernelXPtr->setArg(4, _dataBuffer);
-        _kernelXPtr->setArg(5, _bufferBuffer);
-        _kernelXPtr->setArg(6, _size);
-
-        _kernelYPtr->setArg(0, discreteRadius);
-        _kernelYPtr->setArg(1, ellipsoidScaleFactorZ);
-        _kernelYPtr->setArg(2, ellipsoidScaleFactorY);
-        _kernelYPtr->setArg(3, ellipsoidScaleFactorX);
-        _kernelYPtr->setArg(4, _dataBuffer);
-        _kernelYPtr->setArg(5, _bufferBuffer);
-        _kernelYPtr->setArg(6, _size);
-
-        _kernelZPtr->setArg(0, discreteRadius);
-        _kernelZPtr->setArg(1, ellipsoidScaleFactorZ);
-        _kernelZPtr->setArg(2, ellipsoidScaleFactorY);
-        _kernelZPtr->setArg(3, ellipsoidScaleFactorX);
-        _kernelZPtr->setArg(4, _dataBuffer);
-        _kernelZPtr->setArg(5, _bufferBuffer);
-        _kernelZPtr->setArg(6, _size);
-    }
-    else
+    cl::NDRange _localThreads = OpenCL::CLManager::instance().getMaxLocalThreads(_size);
+    std::cout << " Done" << std::endl;
+    std::cout << "  WorkGroupSize: "
+              << _localThreads[0] << "x" << _localThreads[1] << "x" << _localThreads[2] << std::endl;
+
+    if(useDataAsIntensity)
     {
-        _kernelXYZPtr->setArg(0, discreteRadius);
-        _kernelXYZPtr->setArg(1, ellipsoidScaleFactorZ);
-        _kernelXYZPtr->setArg(2, ellipsoidScaleFactorY);
-        _kernelXYZPtr->setArg(3, ellipsoidScaleFactorX);
-        _kernelXYZPtr->setArg(4, -rotationOZ);
-        _kernelXYZPtr->setArg(5, -rotationOY);
-        _kernelXYZPtr->setArg(6, -rotationOX);
-        _kernelXYZPtr->setArg(7, _dataBuffer);
-        _kernelXYZPtr->setArg(8, _bufferBuffer);
-        _kernelXYZPtr->setArg(9, _size);
+        // Noise is generated on the device, it is the same as _fillRandomNoise()
+        _kernelRandomNoisePtr->setArg(0, _deviceData(false));
+        _kernelRandomNoisePtr->setArg(1, (cl_uint)_randomSeed);
+        _kernelRandomNoisePtr->setArg(2, (cl_uint)_nextRandomStream());
+        _kernelRandomNoisePtr->setArg(3, _size);
+        _queue.enqueueNDRangeKernel(
+                    *_kernelRandomNoisePtr,
+                    cl::NullRange,
+                    cl::NDRange(_size, _size, _size),
+                    _localThreads,
+                    NULL,
+                    &_event);
     }
 
-    cl::CommandQueue &_queue = OpenCL::CLManager::instance().getCurrentCommandQueue();
-    cl::Event _event;
-
-    cl::NDRange _localThreads = OpenCL::CLManager::instance().getMaxLocalThreads(_size);
-    std::cout << " Done" << std::endl;
-    std::cout << "  WorkGroupSize: "
-              << _localThreads[0] << "x" << _localThreads[1] << "x" << _localThreads[2] << std::endl;
-
     if(!useRotations)
     {
+        /// \todo X and Z are replaced
+        for(cl::Kernel *_kernel : {_kernelXPtr, _kernelYPtr, _kernelZPtr})
+        {
+            _kernel->setArg(0, discreteRadius);
+            _kernel->setArg(1, ellipsoidScaleFactorZ);
+            _kernel->setArg(2, ellipsoidScaleFactorY);
+            _kernel->setArg(3, ellipsoidScaleFactorX);
+            _kernel->setArg(6, _size);
+        }
+
         std::cout << "  Applying filter, phase 1...";
-        _CLGaussianBlurFilterPhase(_dataBuffer, _bufferBuffer, _queue,
-                                   _localThreads, _event, *_kernelXPtr);
+        _CLGaussianBlurFilterPhase(_queue, _localThreads, _event, *_kernelXPtr, 4);
         std::cout << " Done" << std::endl;
 
         std::cout << "                ...phase 2...";
-        _CLGaussianBlurFilterPhase(_dataBuffer, _bufferBuffer, _queue,
-                                   _localThreads, _event, *_kernelYPtr);
+        _CLGaussianBlurFilterPhase(_queue, _localThreads, _event, *_kernelYPtr, 4);
         std::cout << " Done" << std::endl;
 
         std::cout << "                ...phase 3...";
-        _CLGaussianBlurFilterPhase(_dataBuffer, _bufferBuffer, _queue,
-                                   _localThreads, _event, *_kernelZPtr);
+        _CLGaussianBlurFilterPhase(_queue, _localThreads, _event, *_kernelZPtr, 4);
         std::cout << " Done" << std::endl;
     }
     else
     {
         std::cout << "  Applying non separable filter ...\n";
 
-        _queue.enqueueFillBuffer<cl_float>(
-                    _bufferBuffer,
-                    0,
-                    0,
-                    sizeof(float) * _size * _size * _size,
-                    NULL,
-                    &_event);
-        _event.wait();
-        _queue.enqueueNDRangeKernel(
-                    *_kernelXYZPtr,
-                    cl::NullRange,
-                    cl::NDRange(_size, _size, _size),
-                    _localThreads,
-                    NULL,
-                    &_event);
-        _event.wait();
+        _kernelXYZPtr->setArg(0, discreteRadius);
+        _kernelXYZPtr->setArg(1, ellipsoidScaleFactorZ);
+        _kernelXYZPtr->setArg(2, ellipsoidScaleFactorY);
+        _kernelXYZPtr->setArg(3, ellipsoidScaleFactorX);
+        _kernelXYZPtr->setArg(4, -rotationOZ);
+        _kernelXYZPtr->setArg(5, -rotationOY);
+        _kernelXYZPtr->setArg(6, -rotationOX);
+        _kernelXYZPtr->setArg(9, _size);
+        _CLGaussianBlurFilterPhase(_queue, _localThreads, _event, *_kernelXYZPtr, 7);
         std::cout << " Done" << std::endl;
     }
-
-    _queue.enqueueReadBuffer(
-                _bufferBuffer,
-                CL_FALSE,
-                0,
-                sizeof(float) * _size * _size * _size,
-                _data,
-                NULL,
-                &_event);
     _event.wait();
+    _deviceDataChanged();
 
+    // Without intensity the result stays on the device
     if(useDataAsIntensity)
     {
         normalize();
+        _useHostData();
         _add(_data, _dataTmpStorage, intensityFactor);
     }
 
@@ -1154,7 +1400,6 @@ void RepresentativeVolumeElement::applyGaussianFilterCL(
                     if(_dataTmpStorage[_index] < 0)
                         _data[_index] = _dataTmpStorage[_index];
                 }
-        delete [] _dataTmpStorage;
     }
 
     std::cout << " applyGaussianFilterCL() Done" << std::endl;
@@ -1171,15 +1416,17 @@ void RepresentativeVolumeElement::applyTwoCutMaskInside(
         throw(std::runtime_error(
                 "applyTwoCutMaskInside(): cutLevelB < cutLevelA || cutLevelB > 1.0f.\n"));
 
+    if(isOnDevice())
+    {
+        _applyTwoCutMaskCL(cutLevelA, cutLevelB, true);
+        return;
+    }
+
     cleanMask();
-    for(long i = 0; i < _size; ++i)
-        for(long j = 0; j < _size; ++j)
-            for(long k = 0; k < _size; ++k)
-            {
-                float &_val = _data[(i * _size * _size) + (j * _size) + k];
-                if(_val >= cutLevelA && _val <= cutLevelB)
-                    _val = -_val - _MASK_EPS_;
-            }
+    Parallel::forRange((long)_size * _size * _size, [&](const long begin, const long end){
+        for(long i = begin; i < end; ++i)
+            _data[i] = (_data[i] >= cutLevelA && _data[i] <= cutLevelB) ?
+                        -_data[i] - _MASK_EPS_ : _data[i];});
 }
 
 void RepresentativeVolumeElement::applyTwoCutMaskOutside(
@@ -1193,15 +1440,17 @@ void RepresentativeVolumeElement::applyTwoCutMaskOutside(
         throw(std::runtime_error(
                 "applyTwoCutMaskOutside(): cutLevelB <= cutLevelA || cutLevelB > 1.0f.\n"));
 
+    if(isOnDevice())
+    {
+        _applyTwoCutMaskCL(cutLevelA, cutLevelB, false);
+        return;
+    }
+
     cleanMask();
-    for(long i = 0; i < _size; ++i)
-        for(long j = 0; j < _size; ++j)
-            for(long k = 0; k < _size; ++k)
-            {
-                float &_val = _data[(i * _size * _size) + (j * _size) + k];
-                if(_val < cutLevelA || _val > cutLevelB)
-                    _val = -_val - _MASK_EPS_;
-            }
+    Parallel::forRange((long)_size * _size * _size, [&](const long begin, const long end){
+        for(long i = begin; i < end; ++i)
+            _data[i] = (_data[i] < cutLevelA || _data[i] > cutLevelB) ?
+                        -_data[i] - _MASK_EPS_ : _data[i];});
 }
 
 void RepresentativeVolumeElement::generateRandomEllipsoidIntense(
@@ -1219,7 +1468,10 @@ void RepresentativeVolumeElement::generateRandomEllipsoidIntense(
         const float rotationOZ,
         const float coreValue) throw (std::runtime_error)
 {
-    float _sphereRadius = MathUtils::rand<float>(minRadius, maxRadius);
+    _useHostData();
+    const uint32_t _stream = _nextRandomStream();
+    uint64_t _draw = 0;
+    float _sphereRadius = _random(_stream, _draw++, minRadius, maxRadius);
 
     for( long i = 0; i<_size; ++i)
         for( long j = 0; j<_size; ++j)
@@ -1268,6 +1520,7 @@ void RepresentativeVolumeElement::generateOverlappingRandomEllipsoidsIntense(
         float rotationOZ,
         const float coreValue) throw (std::runtime_error)
 {
+    _useHostData();
     if(ellipsoidNum <= 0)
         throw(std::runtime_error("generateOverlappingRandomEllipsoidsIntense(): "
                                  "ellopsoidNum <= 0.\n"));
@@ -1311,60 +1564,226 @@ void RepresentativeVolumeElement::generateOverlappingRandomEllipsoidsIntense(
         throw(std::runtime_error("generateOverlappingRandomEllipsoidsIntense(): rotationOZ "
                                  "< 0 or > 2*pi.\n"));
 
-    for(int i=0; i<ellipsoidNum; ++i)
-    {
-        std::cout
-                << "\b\b\b\b"
-                << (int)(i * 100.0 / (ellipsoidNum-1))
-                << "%";
-
-        float _x = MathUtils::rand<int>(0, _size-1);
-        float _y = MathUtils::rand<int>(0, _size-1);
-        float _z = MathUtils::rand<int>(0, _size-1);
+    std::vector<float> _ellipsoids = _randomEllipsoidsParameters(
+                ellipsoidNum, minRadius, maxRadius, useRandomRotations,
+                rotationOX, rotationOY, rotationOZ);
+    const float _maxScaleFactor = std::max(
+                ellipsoidScaleFactorX, std::max(ellipsoidScaleFactorY, ellipsoidScaleFactorZ));
+    std::vector<float> _halfExtents(ellipsoidNum);
+    for(int c=0; c<ellipsoidNum; ++c)
+        _halfExtents[c] = _ellipsoids[c*7+6] * _maxScaleFactor;
+    BucketGrid _grid = _objectsBucketGrid(_ellipsoids.data(), 7, _halfExtents);
 
-        if(useRandomRotations)
+    Parallel::forRange((long)_size * _size * _size, [&](const long begin, const long end){
+        for(long _index = begin; _index < end; ++_index)
         {
-            rotationOX = MathUtils::rand<float>(0.0f, M_PI);
-            rotationOY = MathUtils::rand<float>(0.0f, M_PI);
-            rotationOZ = MathUtils::rand<float>(0.0f, M_PI);
-        }
+            float &_val = _data[_index];
+            if(_val < 0)
+                continue;
+            const long i = _index / (_size * _size);
+            const long j = (_index / _size) % _size;
+            const long k = _index % _size;
+            const int _cell = _grid.cellIndex(k, j, i);
+            for(int p = _grid.cellStart()[_cell]; p < _grid.cellStart()[_cell+1]; ++p)
+                _applyEllipsoidIntense(
+                            &_ellipsoids[_grid.objects()[p]*7], k, j, i,
+                            transitionLayerSize,
+                            ellipsoidScaleFactorX, ellipsoidScaleFactorY, ellipsoidScaleFactorZ,
+                            coreValue, _val);
+        }});
+}
+
+void RepresentativeVolumeElement::_applyEllipsoidIntense(
+        const float *ellipsoid,
+        const long k,
+        const long j,
+        const long i,
+        const float transitionLayerSize,
+        const float ellipsoidScaleFactorX,
+        const float ellipsoidScaleFactorY,
+        const float ellipsoidScaleFactorZ,
+        const float coreValue,
+        float &val) noexcept
+{
+    // Also check from other side of RVE, to get identical opposite sides
+    float _kk, _jj, _ii;
+    _distanceOnRepeatedSides(
+            ellipsoid[0], ellipsoid[1], ellipsoid[2],
+            k, j, i, _kk, _jj, _ii);
+    rotateXYZ(_kk, _jj, _ii, ellipsoid[3], ellipsoid[4], ellipsoid[5]);
+    _kk *= _kk; _jj *= _jj; _ii *= _ii;
+
+    float _curRadius = _kk/ellipsoidScaleFactorX/ellipsoidScaleFactorX +
+            _jj/ellipsoidScaleFactorY/ellipsoidScaleFactorY +
+            _ii/ellipsoidScaleFactorZ/ellipsoidScaleFactorZ;
+
+    float _sphereRadius = ellipsoid[6];
+    if( _curRadius <= _sphereRadius*(1.0f-transitionLayerSize)*
+            _sphereRadius*(1.0f-transitionLayerSize))
+        val = coreValue;
+    else if(_curRadius <= _sphereRadius*_sphereRadius)
+    {
+        float _newVal = (_sphereRadius - std::sqrt(_curRadius))/
+                _sphereRadius / transitionLayerSize * coreValue;
+        if(val < _newVal)
+            val = _newVal;
+    }
+}
 
-        float _sphereRadius = MathUtils::rand<float>(minRadius, maxRadius);
+void RepresentativeVolumeElement::startPackingSession(
+        const std::vector<std::pair<float,float>> &intervals)
+{
+    _packingIntervals = intervals;
+    _packingCellsNum.resize(intervals.size());
+    for(unsigned p=0; p<intervals.size(); ++p)
+        _packingCellsNum[p] = getRangeCellsNum(intervals[p].first, intervals[p].second);
+}
 
-        for( long i = 0; i<_size; ++i)
-            for( long j = 0; j<_size; ++j)
-                for( long k = 0; k<_size; ++k)
-                {
-                    float &_val = _data[(i * _size * _size) + (j * _size) + k];
-                    if(_val >= 0)
+void RepresentativeVolumeElement::addPackedRandomEllipsoidIntense(
+        const int minRadius,
+        const int maxRadius,
+        const float transitionLayerSize,
+        const float ellipsoidScaleFactorX,
+        const float ellipsoidScaleFactorY,
+        const float ellipsoidScaleFactorZ,
+        const bool useRandomRotations,
+        float rotationOX,
+        float rotationOY,
+        float rotationOZ,
+        const float coreValue) throw (std::runtime_error)
+{
+    _useHostData();
+    if(minRadius <= 0 || maxRadius < minRadius)
+        throw(std::runtime_error("addPackedRandomEllipsoidIntense(): "
+                                 "minRadius <= 0 or maxRadius < minRadius.\n"));
+    if(transitionLayerSize < 0.0f || transitionLayerSize > 1.0f)
+        throw(std::runtime_error("addPackedRandomEllipsoidIntense(): "
+                                 "transitionLayerSize < 0.0f || transitionLayerSize > 1.0f.\n"));
+    if(ellipsoidScaleFactorX <= 0.0f || ellipsoidScaleFactorX > 1.0f ||
+            ellipsoidScaleFactorY <= 0.0f || ellipsoidScaleFactorY > 1.0f ||
+            ellipsoidScaleFactorZ <= 0.0f || ellipsoidScaleFactorZ > 1.0f)
+        throw(std::runtime_error("addPackedRandomEllipsoidIntense(): "
+                                 "ellipsoidScaleFactor <= 0 or > 1.\n"));
+    if(coreValue < 0.0f || coreValue > 1.0f)
+        throw(std::runtime_error("addPackedRandomEllipsoidIntense(): "
+                                 "coreValue < 0.0f || coreValue > 1.0f.\n"));
+    if(rotationOX < 0.0f || rotationOX > M_PI*2 ||
+            rotationOY < 0.0f || rotationOY > M_PI*2 ||
+            rotationOZ < 0.0f || rotationOZ > M_PI*2)
+        throw(std::runtime_error("addPackedRandomEllipsoidIntense(): rotation "
+                                 "< 0 or > 2*pi.\n"));
+
+    const std::vector<float> _ellipsoid = _randomEllipsoidsParameters(
+                1, minRadius, maxRadius, useRandomRotations,
+                rotationOX, rotationOY, rotationOZ);
+    const float _maxScaleFactor = std::max(
+                ellipsoidScaleFactorX, std::max(ellipsoidScaleFactorY, ellipsoidScaleFactorZ));
+
+    // Rotation keeps the distance, so the ellipsoid is inside the cube of half extent
+    // radius * _maxScaleFactor around the centre, the cube is wrapped at RVE sides
+    const long _halfExtent = (long)(_ellipsoid[6] * _maxScaleFactor) + 1;
+    const long _boxSize = std::min(2 * _halfExtent + 1, (long)_size);
+    long _boxBegin[3];
+    for(int a=0; a<3; ++a)
+        _boxBegin[a] = _boxSize == _size ? 0 : (long)_ellipsoid[a] - _halfExtent + _size;
+
+    const unsigned _intervalsNum = _packingIntervals.size();
+    typedef std::vector<long> _Counts;
+    const _Counts _delta = Parallel::reduce(
+                _boxSize, _Counts(_intervalsNum, 0),
+                [&](const long begin, const long end) -> _Counts {
+                    _Counts _partDelta(_intervalsNum, 0);
+                    for(long bi = begin; bi < end; ++bi)
                     {
-                        // Also check from other side of RVE, to get identical opposite sides
-                        float _kk, _jj, _ii;
-                        _distanceOnRepeatedSides(
-                                _x, _y, _z,
-                                k, j, i, _kk, _jj, _ii);
-                        rotateXYZ(_kk, _jj, _ii, rotationOX, rotationOY, rotationOZ);
-                        _kk *= _kk; _jj *= _jj; _ii *= _ii;
-
-                        float _curRadius = _kk/ellipsoidScaleFactorX/ellipsoidScaleFactorX +
-                                _jj/ellipsoidScaleFactorY/ellipsoidScaleFactorY +
-                                _ii/ellipsoidScaleFactorZ/ellipsoidScaleFactorZ;
-
-                        if( _curRadius <= _sphereRadius*(1.0f-transitionLayerSize)*
-                                _sphereRadius*(1.0f-transitionLayerSize))
-                            _val = coreValue;
-                        else if(_curRadius <= _sphereRadius*_sphereRadius &&
-                                _curRadius > _sphereRadius*(1.0f-transitionLayerSize)*
-                                _sphereRadius*(1.0f-transitionLayerSize))
+                        const long i = (_boxBegin[2] + bi) % _size;
+                        for(long bj = 0; bj < _boxSize; ++bj)
                         {
-                            float _newVal = (_sphereRadius - std::sqrt(_curRadius))/
-                                    _sphereRadius / transitionLayerSize * coreValue;
-                            if(_val < _newVal)
-                                _val = _newVal;
+                            const long j = (_boxBegin[1] + bj) % _size;
+                            for(long bk = 0; bk < _boxSize; ++bk)
+                            {
+                                const long k = (_boxBegin[0] + bk) % _size;
+                                float &_val = _data[i * _size * _size + j * _size + k];
+                                if(_val < 0)
+                                    continue;
+                                const float _oldVal = _val;
+                                _applyEllipsoidIntense(
+                                            _ellipsoid.data(), k, j, i,
+                                            transitionLayerSize,
+                                            ellipsoidScaleFactorX,
+                                            ellipsoidScaleFactorY,
+                                            ellipsoidScaleFactorZ,
+                                            coreValue, _val);
+                                if(_val == _oldVal)
+                                    continue;
+                                for(unsigned p=0; p<_intervalsNum; ++p)
+                                    _partDelta[p] +=
+                                            (_val >= _packingIntervals[p].first &&
+                                             _val < _packingIntervals[p].second) -
+                                            (_oldVal >= _packingIntervals[p].first &&
+                                             _oldVal < _packingIntervals[p].second);
+                            }
                         }
                     }
-                }
+                    return _partDelta;},
+                [](const _Counts &a, const _Counts &b) -> _Counts {
+                    _Counts _sum(a);
+                    for(unsigned p=0; p<_sum.size(); ++p)
+                        _sum[p] += b[p];
+                    return _sum;});
+    for(unsigned p=0; p<_intervalsNum; ++p)
+        _packingCellsNum[p] += _delta[p];
+}
+
+std::vector<float> RepresentativeVolumeElement::_randomEllipsoidsParameters(
+        const int ellipsoidNum,
+        const int minRadius,
+        const int maxRadius,
+        const bool useRandomRotations,
+        const float rotationOX,
+        const float rotationOY,
+        const float rotationOZ) noexcept
+{
+    const uint32_t _stream = _nextRandomStream();
+    uint64_t _draw = 0;
+    std::vector<float> _ellipsoids(ellipsoidNum*7);
+    for(int c=0; c<ellipsoidNum; ++c)
+    {
+        _ellipsoids[c*7+0] = _randomInt(_stream, _draw++, 0,_size-1);
+        _ellipsoids[c*7+1] = _randomInt(_stream, _draw++, 0,_size-1);
+        _ellipsoids[c*7+2] = _randomInt(_stream, _draw++, 0,_size-1);
+        if(useRandomRotations)
+        {
+            _ellipsoids[c*7+3] = _random(_stream, _draw++, 0.0f, M_PI);
+            _ellipsoids[c*7+4] = _random(_stream, _draw++, 0.0f, M_PI);
+            _ellipsoids[c*7+5] = _random(_stream, _draw++, 0.0f, M_PI);
+        }
+        else
+        {
+            _ellipsoids[c*7+3] = rotationOX;
+            _ellipsoids[c*7+4] = rotationOY;
+            _ellipsoids[c*7+5] = rotationOZ;
+        }
+        _ellipsoids[c*7+6] = _random(_stream, _draw++, minRadius, maxRadius);
+    }
+    return _ellipsoids;
+}
+
+BucketGrid RepresentativeVolumeElement::_objectsBucketGrid(
+        const float *parameters,
+        const int stride,
+        const std::vector<float> &halfExtents) const
+{
+    std::vector<float> _centres(halfExtents.size()*3);
+    for(unsigned c=0; c<halfExtents.size(); ++c)
+    {
+        _centres[c*3+0] = parameters[c*stride+0];
+        _centres[c*3+1] = parameters[c*stride+1];
+        _centres[c*3+2] = parameters[c*stride+2];
     }
+    const float _maxHalfExtent = *std::max_element(halfExtents.begin(), halfExtents.end());
+    BucketGrid _grid(_size, BucketGrid::cellsPerAxisFor(_size, 2.0f * _maxHalfExtent));
+    _grid.build(_centres, halfExtents);
+    return _grid;
 }
 
 void RepresentativeVolumeElement::generateOverlappingRandomEllipsoidsIntenseCL(
@@ -1425,42 +1844,35 @@ void RepresentativeVolumeElement::generateOverlappingRandomEllipsoidsIntenseCL(
         throw(std::runtime_error("generateOverlappingRandomEllipsoidsIntenseCL(): rotationOZ "
                                  "< 0 or > 2*pi.\n"));
 
-    // Generate initial points
-    float *_initialPoints = new float[ellipsoidNum*7]; // x,y,z,rOX,rOY,rOZ,radius
-    if(!_initialPoints)
-        throw(std::runtime_error("generateOverlappingRandomEllipsoidsIntenseCL():"
-                                 "can't allocate memory for temporary storage.\n"));
+    std::vector<float> _initialPoints = _randomEllipsoidsParameters(
+                ellipsoidNum, minRadius, maxRadius, useRandomRotations,
+                rotationOX, rotationOY, rotationOZ); // x,y,z,rOX,rOY,rOZ,radius
+    const float _maxScaleFactor = std::max(
+                ellipsoidScaleFactorX, std::max(ellipsoidScaleFactorY, ellipsoidScaleFactorZ));
+    std::vector<float> _halfExtents(ellipsoidNum);
     for(int c=0; c<ellipsoidNum; ++c)
-    {
-        _initialPoints[c*7+0] = MathUtils::rand<int>(0,_size-1);
-        _initialPoints[c*7+1] = MathUtils::rand<int>(0,_size-1);
-        _initialPoints[c*7+2] = MathUtils::rand<int>(0,_size-1);
-        if(useRandomRotations)
-        {
-            _initialPoints[c*7+3] = MathUtils::rand<float>(0.0f, M_PI);
-            _initialPoints[c*7+4] = MathUtils::rand<float>(0.0f, M_PI);
-            _initialPoints[c*7+5] = MathUtils::rand<float>(0.0f, M_PI);
-        }
-        else
-        {
-            _initialPoints[c*7+3] = rotationOX;
-            _initialPoints[c*7+4] = rotationOY;
-            _initialPoints[c*7+5] = rotationOZ;
-        }
-        _initialPoints[c*7+6] = MathUtils::rand<float>(minRadius, maxRadius);
-    }
+        _halfExtents[c] = _initialPoints[c*7+6] * _maxScaleFactor;
+    BucketGrid _grid = _objectsBucketGrid(_initialPoints.data(), 7, _halfExtents);
 
-    cl::Buffer _dataBuffer(
-                OpenCL::CLManager::instance().getCurrentContext(),
-                CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
-                sizeof(float) * _size * _size * _size,
-                _data);
+    cl::Buffer &_dataBuffer = _deviceData();
 
     cl::Buffer _initialPointsBuffer(
                 OpenCL::CLManager::instance().getCurrentContext(),
                 CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
                 sizeof(float) * ellipsoidNum * 7,
-                _initialPoints);
+                _initialPoints.data());
+
+    cl::Buffer _cellStartBuffer(
+                OpenCL::CLManager::instance().getCurrentContext(),
+                CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                sizeof(int) * _grid.cellStart().size(),
+                const_cast<int *>(_grid.cellStart().data()));
+
+    cl::Buffer _cellObjectsBuffer(
+                OpenCL::CLManager::instance().getCurrentContext(),
+                CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                sizeof(int) * _grid.objects().size(),
+                const_cast<int *>(_grid.objects().data()));
 
     _kernelRandomEllipsoidsPtr->setArg(0, _initialPointsBuffer);
     _kernelRandomEllipsoidsPtr->setArg(1, ellipsoidNum);
@@ -1471,6 +1883,9 @@ void RepresentativeVolumeElement::generateOverlappingRandomEllipsoidsIntenseCL(
     _kernelRandomEllipsoidsPtr->setArg(6, ellipsoidScaleFactorZ);
     _kernelRandomEllipsoidsPtr->setArg(7, coreValue);
     _kernelRandomEllipsoidsPtr->setArg(8, _size);
+    _kernelRandomEllipsoidsPtr->setArg(9, _cellStartBuffer);
+    _kernelRandomEllipsoidsPtr->setArg(10, _cellObjectsBuffer);
+    _kernelRandomEllipsoidsPtr->setArg(11, _grid.cellsPerAxis());
 
     cl::CommandQueue &_queue = OpenCL::CLManager::instance().getCurrentCommandQueue();
     cl::Event _event;
@@ -1486,17 +1901,7 @@ void RepresentativeVolumeElement::generateOverlappingRandomEllipsoidsIntenseCL(
                 &_event);
     _event.wait();
 
-    _queue.enqueueReadBuffer(
-                _dataBuffer,
-                CL_FALSE,
-                0,
-                sizeof(float) * _size * _size * _size,
-                _data,
-                NULL,
-                &_event);
-    _event.wait();
-
-    delete [] _initialPoints;
+    _deviceDataChanged();
 }
 
 void RepresentativeVolumeElement::generateBezierCurveIntense(
@@ -1514,6 +1919,9 @@ void RepresentativeVolumeElement::generateBezierCurveIntense(
         float rotationOZ,
         float coreValue) throw (std::runtime_error)
 {
+    _useHostData();
+    const uint32_t _stream = _nextRandomStream();
+    uint64_t _draw = 0;
     float *_controlPolygonPoints = new float[curveOrder*3];
     if(!_controlPolygonPoints)
         throw(std::runtime_error("generateBezierCurveIntense():"
@@ -1521,9 +1929,9 @@ void RepresentativeVolumeElement::generateBezierCurveIntense(
     for(int k=0; k<curveOrder; ++k)
     {
         _controlPolygonPoints[k*3+0] = (-0.5f + k/(curveOrder-1.0f)) * discreteLength;
-        _controlPolygonPoints[k*3+1] = MathUtils::rand<float>(
+        _controlPolygonPoints[k*3+1] = _random(_stream, _draw++,
                     -pathDeviation, pathDeviation) * discreteLength;
-        _controlPolygonPoints[k*3+2] = MathUtils::rand<float>(
+        _controlPolygonPoints[k*3+2] = _random(_stream, _draw++,
                     -pathDeviation, pathDeviation) * discreteLength;
     }
 
@@ -1554,58 +1962,10 @@ void RepresentativeVolumeElement::generateBezierCurveIntense(
                             k, j, i, _kk, _jj, _ii);
                     rotateXYZ(_kk, _jj, _ii, rotationOX, rotationOY, rotationOZ);
 
-                    float _newVal = 0.0f;
-                    float _minDist = _distanceToBezierSamplePoint(
-                                _kk, _jj, _ii, 0, _curveAproximation);
-                    int _sampleIndexA = 0;
-                    int _sampleIndexB = 1;
-                    for(int s=1; s<curveApproximationPoints; ++s)
-                    {
-                        float _curDist = _distanceToBezierSamplePoint(
-                                    _kk, _jj, _ii, s, _curveAproximation);
-                        if(_curDist < _minDist)
-                        {
-                            _minDist = _curDist;
-                            _sampleIndexA = s;
-                        }
-                    }
-                    if(_sampleIndexA != 0 && _sampleIndexA != curveApproximationPoints-1)
-                    {
-                        float _minDistLeft = _distanceToBezierSamplePoint(
-                                    _kk, _jj, _ii, _sampleIndexA-1, _curveAproximation);
-                        float _minDistRight = _distanceToBezierSamplePoint(
-                                    _kk, _jj, _ii, _sampleIndexA+1, _curveAproximation);
-                        if(_minDistLeft < _minDistRight)
-                            _sampleIndexB = _sampleIndexA-1;
-                        else _sampleIndexB = _sampleIndexA+1;
-                    }
-                    else if(_sampleIndexA == 0) _sampleIndexB = 1;
-                    else  _sampleIndexB = _sampleIndexA-1;
-                    if(!((_sampleIndexA == 0 || _sampleIndexA == curveApproximationPoints-1) &&
-                         _projectionLength(
-                             _kk, _jj, _ii,
-                             _curveAproximation[_sampleIndexA*3 + 0],
-                             _curveAproximation[_sampleIndexA*3 + 1],
-                             _curveAproximation[_sampleIndexA*3 + 2],
-                             _curveAproximation[_sampleIndexB*3 + 0],
-                             _curveAproximation[_sampleIndexB*3 + 1],
-                             _curveAproximation[_sampleIndexB*3 + 2]) < 0.0f))
-                    {
-                        _minDist = _distanceToLine(
-                                    _kk, _jj, _ii,
-                                    _curveAproximation[_sampleIndexA*3 + 0],
-                                _curveAproximation[_sampleIndexA*3 + 1],
-                                _curveAproximation[_sampleIndexA*3 + 2],
-                                _curveAproximation[_sampleIndexB*3 + 0],
-                                _curveAproximation[_sampleIndexB*3 + 1],
-                                _curveAproximation[_sampleIndexB*3 + 2]);
-                    }
-                    if(_minDist <= curveRadius*(1.0f-transitionLayerSize)*
-                            curveRadius*(1.0f-transitionLayerSize))
-                        _newVal = coreValue;
-                    else if(_minDist <= curveRadius*curveRadius)
-                        _newVal = (curveRadius - std::sqrt(_minDist))/curveRadius
-                                / transitionLayerSize * coreValue;
+                    float _newVal = _BezierCurveIntensity(
+                                _kk, _jj, _ii,
+                                _curveAproximation, curveApproximationPoints,
+                                curveRadius, transitionLayerSize, coreValue);
                     if(_val < _newVal)
                         _val = _newVal;
                 }
@@ -1629,6 +1989,9 @@ void RepresentativeVolumeElement::generateOverlappingRandomBezierCurveIntense(
         float rotationOZ,
         float coreValue) throw (std::runtime_error)
 {
+    _useHostData();
+    const uint32_t _stream = _nextRandomStream();
+    uint64_t _draw = 0;
     if(curveNum <= 0)
         throw(std::runtime_error("generateOverlappingRandomBezierCurveIntense(): "
                                  "curveNum <= 0.\n"));
@@ -1670,34 +2033,160 @@ void RepresentativeVolumeElement::generateOverlappingRandomBezierCurveIntense(
         throw(std::runtime_error("generateOverlappingRandomBezierCurveIntense(): rotationOZ "
                                  "< 0 or > 2*pi.\n"));
 
-    for(int i=0; i<curveNum; ++i)
+    // All curves are generated first, random numbers are taken from the single stream
+    std::vector<float> _curveParameters(curveNum*7); // x,y,z,rox,roy,roz,radius
+    std::vector<float> _curveAproximation(curveNum*curveApproximationPoints*3);
+    std::vector<float> _controlPolygonPoints(curveOrder*3);
+    std::vector<float> _halfExtents(curveNum);
+    for(int c=0; c<curveNum; ++c)
     {
-        std::cout
-                << "\b\b\b\b"
-                << (int)(i * 100.0 / (curveNum-1))
-                << "%";
-
-        float _x = MathUtils::rand<int>(0, _size-1);
-        float _y = MathUtils::rand<int>(0, _size-1);
-        float _z = MathUtils::rand<int>(0, _size-1);
+        _curveParameters[c*7 + 0] = _randomInt(_stream, _draw++, 0, _size-1);
+        _curveParameters[c*7 + 1] = _randomInt(_stream, _draw++, 0, _size-1);
+        _curveParameters[c*7 + 2] = _randomInt(_stream, _draw++, 0, _size-1);
 
         if(useRandomRotations)
         {
-            rotationOX = MathUtils::rand<float>(0.0f, M_PI);
-            rotationOY = MathUtils::rand<float>(0.0f, M_PI);
-            rotationOZ = MathUtils::rand<float>(0.0f, M_PI);
+            rotationOX = _random(_stream, _draw++, 0.0f, M_PI);
+            rotationOY = _random(_stream, _draw++, 0.0f, M_PI);
+            rotationOZ = _random(_stream, _draw++, 0.0f, M_PI);
+        }
+        _curveParameters[c*7 + 3] = rotationOX;
+        _curveParameters[c*7 + 4] = rotationOY;
+        _curveParameters[c*7 + 5] = rotationOZ;
+
+        float _curveScale = _random(_stream, _draw++, minScale, 1.0f);
+        int _discreteLength = discreteLength * _curveScale;
+        _curveParameters[c*7 + 6] = (int)(curveRadius * _curveScale);
+
+        for(int k=0; k<curveOrder; ++k)
+        {
+            _controlPolygonPoints[k*3+0] = (-0.5f + k/(curveOrder-1.0f)) * _discreteLength;
+            _controlPolygonPoints[k*3+1] = _random(_stream, _draw++,
+                        -pathDeviation, pathDeviation) * _discreteLength;
+            _controlPolygonPoints[k*3+2] = _random(_stream, _draw++,
+                        -pathDeviation, pathDeviation) * _discreteLength;
         }
+        float *_curve = &_curveAproximation[c*curveApproximationPoints*3];
+        for(int k=0; k<curveApproximationPoints; ++k)
+            for(int coordinate=0; coordinate<3; ++coordinate)
+                _curve[k*3 + coordinate] = _BezierCurve(
+                            coordinate, curveOrder, _controlPolygonPoints.data(),
+                            k, curveApproximationPoints);
+        _halfExtents[c] = _BezierCurveBoundingRadius(
+                    _curve, curveApproximationPoints, _curveParameters[c*7 + 6]);
+    }
+    BucketGrid _grid = _objectsBucketGrid(_curveParameters.data(), 7, _halfExtents);
 
-        float _curveScale = MathUtils::rand<float>(minScale, 1.0f);
+    Parallel::forRange((long)_size * _size * _size, [&](const long begin, const long end){
+        for(long _index = begin; _index < end; ++_index)
+        {
+            float &_val = _data[_index];
+            if(_val < 0)
+                continue;
+            const long i = _index / (_size * _size);
+            const long j = (_index / _size) % _size;
+            const long k = _index % _size;
+            const int _cell = _grid.cellIndex(k, j, i);
+            for(int p = _grid.cellStart()[_cell]; p < _grid.cellStart()[_cell+1]; ++p)
+            {
+                const int c = _grid.objects()[p];
+                float _kk, _jj, _ii;
+                _distanceOnRepeatedSides(
+                        _curveParameters[c*7 + 0],
+                        _curveParameters[c*7 + 1],
+                        _curveParameters[c*7 + 2],
+                        k, j, i, _kk, _jj, _ii);
+                rotateXYZ(_kk, _jj, _ii,
+                          _curveParameters[c*7 + 3],
+                          _curveParameters[c*7 + 4],
+                          _curveParameters[c*7 + 5]);
+                float _newVal = _BezierCurveIntensity(
+                            _kk, _jj, _ii,
+                            &_curveAproximation[c*curveApproximationPoints*3],
+                            curveApproximationPoints,
+                            _curveParameters[c*7 + 6],
+                            transitionLayerSize, coreValue);
+                if(_val < _newVal)
+                    _val = _newVal;
+            }
+        }});
+}
 
-        generateBezierCurveIntense(
-                    _x, _y, _z,
-                    curveOrder, curveApproximationPoints,
-                    discreteLength * _curveScale,
-                    curveRadius * _curveScale,
-                    pathDeviation, transitionLayerSize,
-                    rotationOX, rotationOY, rotationOZ, coreValue);
+float RepresentativeVolumeElement::_BezierCurveIntensity(
+        const float x,
+        const float y,
+        const float z,
+        const float *curveAproximation,
+        const int curveApproximationPoints,
+        const float curveRadius,
+        const float transitionLayerSize,
+        const float coreValue) noexcept
+{
+    float _newVal = 0.0f;
+    float _minDist = _distanceToBezierSamplePoint(
+                x, y, z, 0, curveAproximation);
+    int _sampleIndexA = 0;
+    int _sampleIndexB = 1;
+    for(int s=1; s<curveApproximationPoints; ++s)
+    {
+        float _curDist = _distanceToBezierSamplePoint(
+                    x, y, z, s, curveAproximation);
+        if(_curDist < _minDist)
+        {
+            _minDist = _curDist;
+            _sampleIndexA = s;
+        }
     }
+    if(_sampleIndexA != 0 && _sampleIndexA != curveApproximationPoints-1)
+    {
+        float _minDistLeft = _distanceToBezierSamplePoint(
+                    x, y, z, _sampleIndexA-1, curveAproximation);
+        float _minDistRight = _distanceToBezierSamplePoint(
+                    x, y, z, _sampleIndexA+1, curveAproximation);
+        if(_minDistLeft < _minDistRight)
+            _sampleIndexB = _sampleIndexA-1;
+        else _sampleIndexB = _sampleIndexA+1;
+    }
+    else if(_sampleIndexA == 0) _sampleIndexB = 1;
+    else  _sampleIndexB = _sampleIndexA-1;
+    if(!((_sampleIndexA == 0 || _sampleIndexA == curveApproximationPoints-1) &&
+         _projectionLength(
+             x, y, z,
+             curveAproximation[_sampleIndexA*3 + 0],
+             curveAproximation[_sampleIndexA*3 + 1],
+             curveAproximation[_sampleIndexA*3 + 2],
+             curveAproximation[_sampleIndexB*3 + 0],
+             curveAproximation[_sampleIndexB*3 + 1],
+             curveAproximation[_sampleIndexB*3 + 2]) < 0.0f))
+    {
+        _minDist = _distanceToLine(
+                    x, y, z,
+                    curveAproximation[_sampleIndexA*3 + 0],
+                curveAproximation[_sampleIndexA*3 + 1],
+                curveAproximation[_sampleIndexA*3 + 2],
+                curveAproximation[_sampleIndexB*3 + 0],
+                curveAproximation[_sampleIndexB*3 + 1],
+                curveAproximation[_sampleIndexB*3 + 2]);
+    }
+    if(_minDist <= curveRadius*(1.0f-transitionLayerSize)*
+            curveRadius*(1.0f-transitionLayerSize))
+        _newVal = coreValue;
+    else if(_minDist <= curveRadius*curveRadius)
+        _newVal = (curveRadius - std::sqrt(_minDist))/curveRadius
+                / transitionLayerSize * coreValue;
+    return _newVal;
+}
+
+float RepresentativeVolumeElement::_BezierCurveBoundingRadius(
+        const float *curveAproximation,
+        const int curveApproximationPoints,
+        const float curveRadius) noexcept
+{
+    float _maxDist = 0.0f;
+    for(int s=0; s<curveApproximationPoints; ++s)
+        _maxDist = std::max(_maxDist, _distanceToBezierSamplePoint(
+                                0.0f, 0.0f, 0.0f, s, curveAproximation));
+    return std::sqrt(_maxDist) + curveRadius;
 }
 
 void RepresentativeVolumeElement::generateOverlappingRandomBezierCurveIntenseCL(
@@ -1716,6 +2205,8 @@ void RepresentativeVolumeElement::generateOverlappingRandomBezierCurveIntenseCL(
         float coreValue,
         const std::vector<MathUtils::Node<3,float>> *_initialPointsPtr) throw (std::runtime_error)
 {
+    const uint32_t _stream = _nextRandomStream();
+    uint64_t _draw = 0;
     if(curveNum <= 0)
         throw(std::runtime_error("generateOverlappingRandomBezierCurveIntenseCL(): "
                                  "curveNum <= 0.\n"));
@@ -1778,14 +2269,16 @@ void RepresentativeVolumeElement::generateOverlappingRandomBezierCurveIntenseCL(
                                      "curveNum!=_initialPointsPtr->size\n"));
     }
 
+    std::vector<float> _halfExtents(curveNum);
+
     for(int c=0; c<curveNum; ++c)
     {
         for(int k=0; k<curveOrder; ++k)
         {
             _controlPolygonPoints[k*3+0] = (-0.5f + k/(curveOrder-1.0f)) * discreteLength;
-            _controlPolygonPoints[k*3+1] = MathUtils::rand<float>(
+            _controlPolygonPoints[k*3+1] = _random(_stream, _draw++,
                         -pathDeviation, pathDeviation) * discreteLength;
-            _controlPolygonPoints[k*3+2] = MathUtils::rand<float>(
+            _controlPolygonPoints[k*3+2] = _random(_stream, _draw++,
                         -pathDeviation, pathDeviation) * discreteLength;
         }
 
@@ -1807,15 +2300,15 @@ void RepresentativeVolumeElement::generateOverlappingRandomBezierCurveIntenseCL(
         }
         else
         {
-            _curveParameters[c*7 + 0] = MathUtils::rand<int>(0, _size-1);
-            _curveParameters[c*7 + 1] = MathUtils::rand<int>(0, _size-1);
-            _curveParameters[c*7 + 2] = MathUtils::rand<int>(0, _size-1);
+            _curveParameters[c*7 + 0] = _randomInt(_stream, _draw++, 0, _size-1);
+            _curveParameters[c*7 + 1] = _randomInt(_stream, _draw++, 0, _size-1);
+            _curveParameters[c*7 + 2] = _randomInt(_stream, _draw++, 0, _size-1);
         }
         if(useRandomRotations)
         {
-            _curveParameters[c*7 + 3] = MathUtils::rand<float>(0.0f, M_PI);
-            _curveParameters[c*7 + 4] = MathUtils::rand<float>(0.0f, M_PI);
-            _curveParameters[c*7 + 5] = MathUtils::rand<float>(0.0f, M_PI);
+            _curveParameters[c*7 + 3] = _random(_stream, _draw++, 0.0f, M_PI);
+            _curveParameters[c*7 + 4] = _random(_stream, _draw++, 0.0f, M_PI);
+            _curveParameters[c*7 + 5] = _random(_stream, _draw++, 0.0f, M_PI);
         }
         else
         {
@@ -1823,14 +2316,15 @@ void RepresentativeVolumeElement::generateOverlappingRandomBezierCurveIntenseCL(
             _curveParameters[c*7 + 4] = rotationOY;
             _curveParameters[c*7 + 5] = rotationOZ;
         }
-        _curveParameters[c*7 + 6] = curveRadius * MathUtils::rand<float>(minScale, 1.0f);
+        _curveParameters[c*7 + 6] = curveRadius * _random(_stream, _draw++, minScale, 1.0f);
+        _halfExtents[c] = _BezierCurveBoundingRadius(
+                    &_curveAproximation[c*curveApproximationPoints*3],
+                    curveApproximationPoints,
+                    _curveParameters[c*7 + 6]);
     }
+    BucketGrid _grid = _objectsBucketGrid(_curveParameters, 7, _halfExtents);
 
-    cl::Buffer _dataBuffer(
-                OpenCL::CLManager::instance().getCurrentContext(),
-                CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
-                sizeof(float) * _size * _size * _size,
-                _data);
+    cl::Buffer &_dataBuffer = _deviceData();
 
     cl::Buffer _curveAproximationBuffer(
                 OpenCL::CLManager::instance().getCurrentContext(),
@@ -1844,6 +2338,18 @@ void RepresentativeVolumeElement::generateOverlappingRandomBezierCurveIntenseCL(
                 sizeof(float) * curveNum * 7,
                 _curveParameters);
 
+    cl::Buffer _cellStartBuffer(
+                OpenCL::CLManager::instance().getCurrentContext(),
+                CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                sizeof(int) * _grid.cellStart().size(),
+                const_cast<int *>(_grid.cellStart().data()));
+
+    cl::Buffer _cellObjectsBuffer(
+                OpenCL::CLManager::instance().getCurrentContext(),
+                CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                sizeof(int) * _grid.objects().size(),
+                const_cast<int *>(_grid.objects().data()));
+
     _kernelRandomBezierCurvesPtr->setArg(0, _curveAproximationBuffer);
     _kernelRandomBezierCurvesPtr->setArg(1, _curveParametersBuffer);
     _kernelRandomBezierCurvesPtr->setArg(2, _dataBuffer);
@@ -1852,6 +2358,9 @@ void RepresentativeVolumeElement::generateOverlappingRandomBezierCurveIntenseCL(
     _kernelRandomBezierCurvesPtr->setArg(5, transitionLayerSize);
     _kernelRandomBezierCurvesPtr->setArg(6, coreValue);
     _kernelRandomBezierCurvesPtr->setArg(7, _size);
+    _kernelRandomBezierCurvesPtr->setArg(8, _cellStartBuffer);
+    _kernelRandomBezierCurvesPtr->setArg(9, _cellObjectsBuffer);
+    _kernelRandomBezierCurvesPtr->setArg(10, _grid.cellsPerAxis());
 
     cl::CommandQueue &_queue = OpenCL::CLManager::instance().getCurrentCommandQueue();
     cl::Event _event;
@@ -1867,15 +2376,7 @@ void RepresentativeVolumeElement::generateOverlappingRandomBezierCurveIntenseCL(
                 &_event);
     _event.wait();
 
-    _queue.enqueueReadBuffer(
-                _dataBuffer,
-                CL_FALSE,
-                0,
-                sizeof(float) * _size * _size * _size,
-                _data,
-                NULL,
-                &_event);
-    _event.wait();
+    _deviceDataChanged();
 
     delete [] _controlPolygonPoints;
     delete [] _curveParameters;
@@ -1888,6 +2389,8 @@ void RepresentativeVolumeElement::generateVoronoiRandomCells(
         const std::vector<MathUtils::Node<3,float>> *_initialPointsPtr)
 throw (std::runtime_error)
 {
+    _useHostData();
+    const uint32_t _stream = _nextRandomStream();
     if(squeezeFactorZ == 0)
         throw(std::runtime_error("generateVoronoiRandomCells(): "
                                  "squeezeFactorZ = 0\n"));
@@ -1909,70 +2412,239 @@ throw (std::runtime_error)
     {
         for(int c=0; c<cellNum; ++c)
             _initialPoints.push_back(MathUtils::Node<3,float>(
-                MathUtils::rand<int>(0,_size-1),
-                MathUtils::rand<int>(0,_size-1),
-                MathUtils::rand<int>(0,_size-1)));
+                _randomInt(_stream, c*3+0, 0,_size-1),
+                _randomInt(_stream, c*3+1, 0,_size-1),
+                _randomInt(_stream, c*3+2, 0,_size-1)));
     }
 
-    for( long i = 0; i<_size; ++i)
-        for( long j = 0; j<_size; ++j)
-            for( long k = 0; k<_size; ++k)
-                if(_data[(i * _size * _size) + (j * _size) + k] >= 0)
+    std::vector<float> _points(cellNum*3);
+    for(int c=0; c<cellNum; ++c)
+    {
+        _points[c*3+0] = _initialPoints[c][0];
+        _points[c*3+1] = _initialPoints[c][1];
+        _points[c*3+2] = _initialPoints[c][2];
+    }
+    BucketGrid _grid = _pointsBucketGrid(_points);
+    const int _cellsPerAxis = _grid.cellsPerAxis();
+    const float _ringFactor = _VoronoiRingFactor(squeezeFactorZ);
+
+    // Two nearest seeds are searched in rings of buckets around the voxel,
+    // until the rest of seeds can't be nearer, than the second one
+    Parallel::forRange((long)_size * _size * _size, [&](const long begin, const long end){
+        for(long _index = begin; _index < end; ++_index)
+        {
+            if(_data[_index] < 0)
+                continue;
+            const long i = _index / (_size * _size);
+            const long j = (_index / _size) % _size;
+            const long k = _index % _size;
+            const int _cx = _grid.cellCoordinate(k);
+            const int _cy = _grid.cellCoordinate(j);
+            const int _cz = _grid.cellCoordinate(i);
+            float _minDist1 = std::numeric_limits<float>::max();
+            float _minDist2 = std::numeric_limits<float>::max();
+            for(int r = 0; r <= _cellsPerAxis/2; ++r)
             {
-                float _kk, _jj, _ii;
+                // Opposite sides of the last ring are the same buckets
+                const int _last = (2*r+1 > _cellsPerAxis) ? r-1 : r;
+                for(int dz = -r; dz <= _last; ++dz)
+                    for(int dy = -r; dy <= _last; ++dy)
+                        for(int dx = -r; dx <= _last; ++dx)
+                        {
+                            if(dx > -r && dx < r && dy > -r && dy < r && dz > -r && dz < r)
+                                continue;
+                            const int _cell = ((_cx+dx)&(_cellsPerAxis-1)) +
+                                    ((_cy+dy)&(_cellsPerAxis-1)) * _cellsPerAxis +
+                                    ((_cz+dz)&(_cellsPerAxis-1)) * _cellsPerAxis * _cellsPerAxis;
+                            for(int p = _grid.cellStart()[_cell]; p < _grid.cellStart()[_cell+1]; ++p)
+                            {
+                                const int c = _grid.objects()[p];
+                                float _kk, _jj, _ii;
+                                _distanceOnRepeatedSides(
+                                            _points[c*3+0],
+                                        _points[c*3+1],
+                                        _points[c*3+2],
+                                        k,j,i,_kk, _jj, _ii);
+                                _kk *= _kk;
+                                _jj *= _jj;
+                                _ii *= _ii;
+                                float _curDist = std::sqrt(_kk + _jj + _ii/squeezeFactorZ);
+
+                                if(_curDist < _minDist1)
+                                {
+                                    _minDist2 = _minDist1;
+                                    _minDist1 = _curDist;
+                                }
+                                else if(_curDist < _minDist2)
+                                    _minDist2 = _curDist;
+                            }
+                        }
+                if(_minDist2 <= _ringFactor * r * _grid.cellSize())
+                    break;
+            }
+            _data[_index] = _minDist2-_minDist1;
+        }});
 
-                _distanceOnRepeatedSides(
-                            _initialPoints[0][0],
-                        _initialPoints[0][1],
-                        _initialPoints[0][2],
-                        k,j,i,_kk, _jj, _ii);
-                _kk *= _kk;
-                _jj *= _jj;
-                _ii *= _ii;
-                float _minDist1 = std::sqrt(_kk + _jj + _ii/squeezeFactorZ);
+    normalizeUnMasked();
+}
 
-                _distanceOnRepeatedSides(
-                            _initialPoints[1][0],
-                        _initialPoints[1][1],
-                        _initialPoints[1][2],
-                        k,j,i,_kk, _jj, _ii);
-                _kk *= _kk;
-                _jj *= _jj;
-                _ii *= _ii;
-                float _minDist2 = std::sqrt(_kk + _jj + _ii/squeezeFactorZ);
-
-                if(_minDist1 > _minDist2)
-                {
-                    float tmp = _minDist1;
-                    _minDist1 = _minDist2;
-                    _minDist2 = tmp;
-                }
+BucketGrid RepresentativeVolumeElement::_pointsBucketGrid(
+        const std::vector<float> &points) const
+{
+    // About one seed per bucket
+    BucketGrid _grid(_size, BucketGrid::cellsPerAxisFor(
+                         _size, _size / std::cbrt((float)points.size() / 3)));
+    _grid.build(points);
+    return _grid;
+}
 
-                for(int c=2; c<cellNum; ++c)
-                {
-                    _distanceOnRepeatedSides(
-                                _initialPoints[c][0],
-                            _initialPoints[c][1],
-                            _initialPoints[c][2],
-                            k,j,i,_kk, _jj, _ii);
-                    _kk *= _kk;
-                    _jj *= _jj;
-                    _ii *= _ii;
-                    float _curDist = std::sqrt(_kk + _jj + _ii/squeezeFactorZ);
-
-                    if(_curDist < _minDist1)
+float RepresentativeVolumeElement::_VoronoiRingFactor(const float squeezeFactorZ) noexcept
+{
+    // Distance is not less than _ringFactor * (the largest coordinate difference),
+    // negative squeezeFactorZ gives no bound, so all seeds are checked
+    if(squeezeFactorZ < 0.0f)
+        return 0.0f;
+    return squeezeFactorZ > 1.0f ? 1.0f / std::sqrt(squeezeFactorZ) : 1.0f;
+}
+
+void RepresentativeVolumeElement::getMaskDistances(std::vector<float> &distances) const
+{
+    _syncHost();
+    const long _voxelsNum = (long)_size * _size * _size;
+    distances.resize(_voxelsNum);
+    Parallel::forRange(_voxelsNum, [&](const long begin, const long end){
+        for(long _index = begin; _index < end; ++_index)
+            distances[_index] = _data[_index] < 0 ? 0.0f : DistanceTransform::infinity();
+        });
+
+    DistanceTransform::squaredPeriodic(distances, nullptr, _size);
+
+    Parallel::forRange(_voxelsNum, [&](const long begin, const long end){
+        for(long _index = begin; _index < end; ++_index)
+            distances[_index] = std::sqrt(distances[_index]);
+        });
+}
+
+void RepresentativeVolumeElement::getNearestSeeds(
+        const std::vector<MathUtils::Node<3,float>> &seeds,
+        std::vector<int> &nearest,
+        std::vector<int> &secondNearest,
+        const float squeezeFactorZ) const
+{
+    if(squeezeFactorZ <= 0.0f)
+        throw(std::runtime_error("getNearestSeeds(): squeezeFactorZ <= 0.\n"));
+    if(seeds.empty())
+        throw(std::runtime_error("getNearestSeeds(): there are no seeds.\n"));
+
+    const long _voxelsNum = (long)_size * _size * _size;
+    const int _seedsNum = seeds.size();
+    std::vector<long> _seedVoxels(_seedsNum);
+    for(int c = 0; c < _seedsNum; ++c)
+    {
+        // Seeds coordinates are (x,y,z) = (k,j,i)
+        long _kji[3];
+        for(int a = 0; a < 3; ++a)
+            _kji[a] = (long)std::floor(seeds[c][a] + 0.5f) & (_size-1);
+        _seedVoxels[c] = _kji[2] * _size * _size + _kji[1] * _size + _kji[0];
+    }
+
+    // Nearest seed is exact, the first of seeds in the same voxel is taken
+    std::vector<float> _distances(_voxelsNum, DistanceTransform::infinity());
+    nearest.assign(_voxelsNum, -1);
+    for(int c = _seedsNum-1; c >= 0; --c)
+    {
+        _distances[_seedVoxels[c]] = 0.0f;
+        nearest[_seedVoxels[c]] = c;
+    }
+    DistanceTransform::squaredPeriodic(
+                _distances, &nearest, _size, 1.0f, 1.0f, 1.0f / squeezeFactorZ);
+
+    // Adjacent cells: 26-connected voxels with different nearest seeds,
+    // and the seeds in the same voxel
+    std::vector<std::vector<int>> _neighbours(_seedsNum);
+    for(int c = 0; c < _seedsNum; ++c)
+        if(nearest[_seedVoxels[c]] != c)
+        {
+            _neighbours[c].push_back(nearest[_seedVoxels[c]]);
+            _neighbours[nearest[_seedVoxels[c]]].push_back(c);
+        }
+    typedef std::unordered_set<long> _Pairs_;
+    const _Pairs_ _pairs = Parallel::reduce(_size, _Pairs_(),
+        [&](const long begin, const long end){
+            _Pairs_ _local;
+            // Neighbouring voxels mostly give the same pair
+            long _lastPair = -1;
+            for(long i = begin; i < end; ++i)
+                for(long j = 0; j < _size; ++j)
+                    for(long k = 0; k < _size; ++k)
                     {
-                        _minDist2 = _minDist1;
-                        _minDist1 = _curDist;
+                        const int _a = nearest[i * _size * _size + j * _size + k];
+                        // Half of the neighbourhood, the other half is symmetric
+                        for(int n = 14; n < 27; ++n)
+                        {
+                            const long _ii = (i + n / 9 - 1) & (_size-1);
+                            const long _jj = (j + (n / 3) % 3 - 1) & (_size-1);
+                            const long _kk = (k + n % 3 - 1) & (_size-1);
+                            const int _b = nearest[_ii * _size * _size + _jj * _size + _kk];
+                            if(_a == _b)
+                                continue;
+                            const long _pair = (long)std::min(_a, _b) * _seedsNum + std::max(_a, _b);
+                            if(_pair != _lastPair)
+                                _local.insert(_lastPair = _pair);
+                        }
                     }
-                    else if(_curDist < _minDist2)
-                        _minDist2 = _curDist;
+            return _local;
+        },
+        [](_Pairs_ a, const _Pairs_ &b){
+            a.insert(b.begin(), b.end());
+            return a;
+        });
+    for(const long _pair : _pairs)
+    {
+        _neighbours[_pair / _seedsNum].push_back(_pair % _seedsNum);
+        _neighbours[_pair % _seedsNum].push_back(_pair / _seedsNum);
+    }
+    for(std::vector<int> &_cellNeighbours : _neighbours)
+    {
+        std::sort(_cellNeighbours.begin(), _cellNeighbours.end());
+        _cellNeighbours.erase(std::unique(_cellNeighbours.begin(), _cellNeighbours.end()),
+                              _cellNeighbours.end());
+    }
 
+    // Second nearest seed is the nearest of the adjacent ones,
+    // seeds are wrapped on the period, so the difference is in (-size, size)
+    const float _size_f = _size;
+    std::vector<float> _wrapped(_seedsNum*3);
+    for(int c = 0; c < _seedsNum; ++c)
+        for(int a = 0; a < 3; ++a)
+            _wrapped[c*3 + a] = seeds[c][a] - _size_f * std::floor(seeds[c][a] / _size_f);
+    const float _weightZ = 1.0f / squeezeFactorZ;
+    secondNearest.resize(_voxelsNum);
+    Parallel::forRange(_voxelsNum, [&](const long begin, const long end){
+        for(long _index = begin; _index < end; ++_index)
+        {
+            const float _k = _index % _size;
+            const float _j = (_index / _size) % _size;
+            const float _i = _index / (_size * _size);
+            float _minDist = std::numeric_limits<float>::max();
+            int _second = -1;
+            for(int c : _neighbours[nearest[_index]])
+            {
+                float _dk = std::fabs(_wrapped[c*3 + 0] - _k);
+                float _dj = std::fabs(_wrapped[c*3 + 1] - _j);
+                float _di = std::fabs(_wrapped[c*3 + 2] - _i);
+                _dk = std::min(_dk, _size_f - _dk);
+                _dj = std::min(_dj, _size_f - _dj);
+                _di = std::min(_di, _size_f - _di);
+                const float _dist = _dk*_dk + _dj*_dj + _weightZ*_di*_di;
+                if(_dist < _minDist)
+                {
+                    _minDist = _dist;
+                    _second = c;
                 }
-                _data[(i * _size * _size) + (j * _size) + k] = _minDist2-_minDist1;
             }
-
-    normalizeUnMasked();
+            secondNearest[_index] = _second;
+        }});
 }
 
 void RepresentativeVolumeElement::generateVoronoiRandomCellsCL(
@@ -1981,6 +2653,7 @@ void RepresentativeVolumeElement::generateVoronoiRandomCellsCL(
         const std::vector<MathUtils::Node<3,float>> *_initialPointsPtr)
 throw (std::runtime_error)
 {
+    const uint32_t _stream = _nextRandomStream();
     if(squeezeFactorZ == 0)
         throw(std::runtime_error("generateVoronoiRandomCells(): "
                                  "squeezeFactorZ = 0\n"));
@@ -2010,17 +2683,15 @@ throw (std::runtime_error)
     {
         for(int c=0; c<cellNum; ++c)
         {
-            _initialPoints[c*3+0] = MathUtils::rand<int>(0,_size-1);
-            _initialPoints[c*3+1] = MathUtils::rand<int>(0,_size-1);
-            _initialPoints[c*3+2] = MathUtils::rand<int>(0,_size-1);
+            _initialPoints[c*3+0] = _randomInt(_stream, c*3+0, 0,_size-1);
+            _initialPoints[c*3+1] = _randomInt(_stream, c*3+1, 0,_size-1);
+            _initialPoints[c*3+2] = _randomInt(_stream, c*3+2, 0,_size-1);
         }
     }
+    BucketGrid _grid = _pointsBucketGrid(
+                std::vector<float>(_initialPoints, _initialPoints + cellNum*3));
 
-    cl::Buffer _dataBuffer(
-                OpenCL::CLManager::instance().getCurrentContext(),
-                CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
-                sizeof(float) * _size * _size * _size,
-                _data);
+    cl::Buffer &_dataBuffer = _deviceData();
 
     cl::Buffer _initialPointsBuffer(
                 OpenCL::CLManager::instance().getCurrentContext(),
@@ -2028,11 +2699,27 @@ throw (std::runtime_error)
                 sizeof(float) * cellNum * 3,
                 _initialPoints);
 
+    cl::Buffer _cellStartBuffer(
+                OpenCL::CLManager::instance().getCurrentContext(),
+                CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                sizeof(int) * _grid.cellStart().size(),
+                const_cast<int *>(_grid.cellStart().data()));
+
+    cl::Buffer _cellObjectsBuffer(
+                OpenCL::CLManager::instance().getCurrentContext(),
+                CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                sizeof(int) * _grid.objects().size(),
+                const_cast<int *>(_grid.objects().data()));
+
     _kernelVoronoiPtr->setArg(0, _initialPointsBuffer);
     _kernelVoronoiPtr->setArg(1, cellNum);
     _kernelVoronoiPtr->setArg(2, _dataBuffer);
     _kernelVoronoiPtr->setArg(3, _size);
     _kernelVoronoiPtr->setArg(4, squeezeFactorZ);
+    _kernelVoronoiPtr->setArg(5, _cellStartBuffer);
+    _kernelVoronoiPtr->setArg(6, _cellObjectsBuffer);
+    _kernelVoronoiPtr->setArg(7, _grid.cellsPerAxis());
+    _kernelVoronoiPtr->setArg(8, _VoronoiRingFactor(squeezeFactorZ));
 
     cl::CommandQueue &_queue = OpenCL::CLManager::instance().getCurrentCommandQueue();
     cl::Event _event;
@@ -2048,15 +2735,7 @@ throw (std::runtime_error)
                 &_event);
     _event.wait();
 
-    _queue.enqueueReadBuffer(
-                _dataBuffer,
-                CL_FALSE,
-                0,
-                sizeof(float) * _size * _size * _size,
-                _data,
-                NULL,
-                &_event);
-    _event.wait();
+    _deviceDataChanged();
 
     normalizeUnMasked();
 
@@ -2068,16 +2747,9 @@ void RepresentativeVolumeElement::_add(
         const float *value,
         const float factor) noexcept
 {
-    for( long i = 0; i<_size; ++i)
-        for( long j = 0; j<_size; ++j)
-            for( long k = 0; k<_size; ++k)
-            {
-                long _index = (i * _size * _size) + (j * _size) + k;
-                if(value[_index] >= 0)
-                    recipient[_index] += factor * value[_index];
-                else
-                    recipient[_index] += factor * (- value[_index] - _MASK_EPS_);
-            }
+    Parallel::forRange((long)_size * _size * _size, [&](const long begin, const long end){
+        for(long i = begin; i < end; ++i)
+            recipient[i] += factor * ((value[i] >= 0) ? value[i] : (- value[i] - _MASK_EPS_));});
 }
 
 void RepresentativeVolumeElement::_distanceOnRepeatedSides(
@@ -2115,6 +2787,7 @@ void RepresentativeVolumeElement::generateLayerY(
         const int top,
         float coreValue)  throw (std::runtime_error)
 {
+    _useHostData();
     if(top < bottom)
         throw(std::runtime_error("generateLayerY(): layer top index <= layer bottom index.\n"));
     if(top >= _size)
@@ -2135,6 +2808,7 @@ void RepresentativeVolumeElement::generateLayerY(
 void RepresentativeVolumeElement::cloneLayerYFull(
         const int layerIndex) throw (std::runtime_error)
 {
+    _useHostData();
     if(layerIndex >= _size)
         throw(std::runtime_error("cloneLayerYFull(): layer index >= RVE size.\n"));
     if(layerIndex < 0)
@@ -2153,6 +2827,7 @@ void RepresentativeVolumeElement::cloneLayerY(
         const int srcLayerIndex,
         const int dstLayerIndex) throw (std::runtime_error)
 {
+    _useHostData();
     if(srcLayerIndex >= _size || dstLayerIndex >= _size)
         throw(std::runtime_error("cloneLayerY(): layer index >= RVE size.\n"));
     if(srcLayerIndex < 0 || dstLayerIndex < 0)
@@ -2169,6 +2844,7 @@ void RepresentativeVolumeElement::cloneLayerY(
 void RepresentativeVolumeElement::squeezeLayersY(
         const float squeezeFactorY) throw (std::runtime_error)
 {
+    _useHostData();
     if(squeezeFactorY <= 0)
         throw(std::runtime_error("squeezeLayersY(): "
                                  "squeezeFactorY <= 0\n"));
@@ -2201,6 +2877,7 @@ void RepresentativeVolumeElement::useLayerYAsHeightMap(
         const float coreValue,
         const float transitionLayerSize) throw (std::runtime_error)
 {
+    _useHostData();
     if(layerIndex >= _size)
         throw(std::runtime_error("useLayerYAsHeightMap(): layer index >= RVE size.\n"));
     if(layerIndex < 0)
@@ -2239,6 +2916,7 @@ void RepresentativeVolumeElement::useLayerYAsHeightMap(
 
 void RepresentativeVolumeElement::TESTLayerAsHeight()
 {
+    _useHostData();
     for( long i = 0; i<_size; ++i)
         for( long j = 0; j<_size; ++j)
             for( long k = 0; k<_size; ++k)
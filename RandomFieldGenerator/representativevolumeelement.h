@@ -4,10 +4,19 @@
 #include <stdexcept>
 #include <cmath>
 #include <iostream>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <vector>
+#include <utility>
 
 #include "CLMANAGER/clmanager.h"
+#include "bucketgrid.h"
+#include "backingstore.h"
 
 #include <FUNCTIONS/rand.h>
+#include <FUNCTIONS/philox.h>
 #include <FUNCTIONS/factorial.h>
 #include <node.h>
 
@@ -15,18 +24,60 @@
 /// Mask is _data < 0;
 /// \warning for correct usage of OpenCL functionality, the _size
 /// should be equal to some power of two.
-/// \warning it uses 3 * _size * _size * _size * sizeof(float) bytes of RAM memory
+/// \warning it uses 3 * _size * _size * _size * sizeof(float) bytes of RAM memory,
+/// unless the backing directory is given: then data and temporary storages of filters
+/// are files, mapped into memory (see BackingStore), and the RVE can be larger than RAM
+/// (except applyGaussianFilterFFT(), its spectra are in RAM).
+/// \warning OpenCL methods keep the result on the device, it is read back only when host
+/// methods or getData() need it, so the pointer of getData() is valid until
+/// the next OpenCL method.
 class RepresentativeVolumeElement
 {
     private: int _size;
     public : int getSize() const noexcept {return _size;}
+    private: std::string _backingDirectory;
+    public : const std::string & getBackingDirectory() const noexcept {return _backingDirectory;}
+    public : bool isOutOfCore() const noexcept {return !_backingDirectory.empty();}
+    private: BackingStore _storage;
     private: float * _data = nullptr;
-    public : float * getData() noexcept {return _data;}
-    public : const float * getData() const noexcept {return _data;}
+    /// Temporary storage of the RVE size, in the same backing store as data
+    private: BackingStore _temporaryStorage() const {
+        return BackingStore((long)_size * _size * _size, _backingDirectory);}
+    public : float * getData() noexcept {_useHostData(); return _data;}
+    public : const float * getData() const noexcept {_syncHost(); return _data;}
     public : float getData(int i, int j, int k) const noexcept{
+        _syncHost();
         return _data[i + (j * _size) + (k * _size * _size)];}
     public : void setData(float * newData) noexcept {
+        _discardDeviceData();
         memcpy(_data, newData, sizeof(float) * _size * _size * _size);}
+
+    /// Persistent device copy of _data and the spare buffer of the same size,
+    /// filters write to the spare one and swap them (ping-pong).
+    /// Only the newer copy is valid: OpenCL methods make the host copy stale
+    /// and host methods make the device copy stale, each side is synchronized
+    /// when it is used. Host data can be read back by any thread (e.g. by getData(i,j,k)
+    /// in parallel loops), so it is guarded.
+    private: cl::Buffer _deviceBuffers[2];
+    private: bool _deviceAllocated = false;
+    private: int _deviceCurrent = 0;
+    private: mutable std::atomic<bool> _hostValid{true};
+    private: mutable std::mutex _hostSyncMutex;
+    private: bool _deviceValid = false;
+    /// Is the result of the last operation on the device only
+    public : bool isOnDevice() const noexcept {return !_hostValid;}
+    /// Device copy of the data, written from host if it is stale and keep
+    private: cl::Buffer & _deviceData(const bool keep = true);
+    private: cl::Buffer & _deviceSpare() noexcept {return _deviceBuffers[1 - _deviceCurrent];}
+    private: void _swapDeviceBuffers() noexcept {_deviceCurrent = 1 - _deviceCurrent;}
+    /// Device copy is changed, host one is stale
+    private: void _deviceDataChanged() noexcept {_hostValid = false; _deviceValid = true;}
+    /// Read device copy, if host one is stale
+    private: void _syncHost() const noexcept;
+    /// Host copy will be changed, device one becomes stale
+    private: void _useHostData() noexcept {_syncHost(); _deviceValid = false;}
+    /// Host copy will be overwritten
+    private: void _discardDeviceData() noexcept {_hostValid = true; _deviceValid = false;}
     private: float _representationSize = 1.0f;
     public : float getRepresentationSize() const noexcept {return _representationSize;}
     public : void setRepresentationSize(const float newRepresentationSize) noexcept {
@@ -34,9 +85,13 @@ class RepresentativeVolumeElement
     public : long getRangeCellsNum(float minIntensity, float maxIntensity) const noexcept;
 
     /// Save current RVE to file (recommended extension *.RVE)
-    public : void saveRVEToFile(const std::string &fileName) const;
+    /// in chunked compressed format (see RVEFile), or in legacy raw format
+    public : void saveRVEToFile(
+            const std::string &fileName,
+            const bool legacyFormat = false) const;
 
-    /// Load RVE from file (recommended extension *.RVE)
+    /// Load RVE from file (recommended extension *.RVE), chunked or legacy one.
+    /// To read the part of the huge RVE without loading it, use RVEFile::Reader
     public : void loadRVEFromFile(const std::string &fileName);
 
     /// OpenCL pointers, should be created oly once
@@ -49,15 +104,55 @@ class RepresentativeVolumeElement
     private: static cl::Kernel *_kernelRandomEllipsoidsPtr;
     private: static cl::Kernel *_kernelRandomBezierCurvesPtr;
     private: static cl::Kernel *_kernelVoronoiPtr;
+    private: static cl::Kernel *_kernelRandomNoisePtr;
+    private: static cl::Kernel *_kernelUnmaskedRangePtr;
+    private: static cl::Kernel *_kernelNormalizePtr;
+    private: static cl::Kernel *_kernelTwoCutMaskPtr;
+
+    /// Seed of pseudo-random numbers (see MathUtils::philox4x32()).
+    /// Each random operation takes the next stream of the seed and numbers of the stream
+    /// are indexed (e.g. by voxel), so the same seed and the same sequence of operations
+    /// give the same RVE for any number of threads and on OpenCL devices.
+    /// Default seed is the number of RVEs created before.
+    private: static std::atomic<uint32_t> _instancesNum;
+    private: uint32_t _randomSeed;
+    private: uint32_t _randomStream = 0;
+    public : uint32_t getRandomSeed() const noexcept {return _randomSeed;}
+    public : void setRandomSeed(const uint32_t seed) noexcept {
+        _randomSeed = seed; _randomStream = 0;}
+    private: uint32_t _nextRandomStream() noexcept {return _randomStream++;}
+
+    /// Number index of the stream in [a,b)
+    private: float _random(
+            const uint32_t stream,
+            const uint64_t index,
+            const float a,
+            const float b) const noexcept {
+        return a + (b - a) * MathUtils::randomUniform(_randomSeed, stream, index);}
+
+    /// Number index of the stream in [a,b]
+    private: int _randomInt(
+            const uint32_t stream,
+            const uint64_t index,
+            const int a,
+            const int b) const noexcept {
+        return std::min(a + (int)((b - a + 1) * MathUtils::randomUniform(_randomSeed, stream, index)), b);}
+
+    /// Fill data with uniform noise in [0,1), the same as randomNoise OpenCL kernel
+    private: void _fillRandomNoise(float *data) noexcept;
 
     /// Constructor
     /// \todo all OpenCL uses only first system defined platform
+    /// backingDirectory - empty to keep data in RAM, or the directory of out-of-core
+    /// storage (see BackingStore)
     public : RepresentativeVolumeElement(
             const int discreteSize,
-            const float representationSize = 1.0) throw (std::runtime_error);
+            const float representationSize = 1.0,
+            const std::string &backingDirectory = "") throw (std::runtime_error);
 
     /// Clean _data storage, by set it elements to 0
     public : inline void cleanData() noexcept {
+        _discardDeviceData();
         memset(_data, 0, sizeof(float) * _size * _size * _size);}
 
     /// Clean masked _data storage, by set it elements to 0
@@ -140,7 +235,8 @@ class RepresentativeVolumeElement
     /// see (2002) Torguato - Random Heterogeneous Materials Microstructure
     ///                       and Macroscopic Properties
     /// data will hold normalized GRF after this call
-    /// \todo it simple CPU usage for now, use GPU!
+    /// Without rotations it is separated: three passes of 1D kernels over rows of
+    /// contiguous voxels, in parallel (see also applyGaussianFilterFFT() for large radius)
     /// \todo add ellipsoid rotation
     /// \todo fix borders calculations
     /// \todo X and Z are replaced
@@ -157,13 +253,23 @@ class RepresentativeVolumeElement
             float rotationOY = 0.0f,
             float rotationOZ = 0.0f) throw (std::runtime_error);
 
+    /// Filter device data into the spare buffer and swap them,
+    /// data and spare buffers are kernel arguments dataArgIndex and dataArgIndex+1
     private: inline void _CLGaussianBlurFilterPhase(
-            cl::Buffer &_dataBuffer,
-            cl::Buffer &_cuttedDataBuffer,
             cl::CommandQueue &_queue,
             cl::NDRange &_localThreads,
             cl::Event &_event,
-            cl::Kernel &_phaseKernel);
+            cl::Kernel &_phaseKernel,
+            const int dataArgIndex);
+
+    /// normalize() of device data
+    private: void _normalizeCL();
+
+    /// applyTwoCutMaskInside() or applyTwoCutMaskOutside() of device data
+    private: void _applyTwoCutMaskCL(
+            const float cutLevelA,
+            const float cutLevelB,
+            const bool inside);
 
     /// Apply Gaussian blur filter to _data
     /// _data will hold normalized GRF after this call
@@ -199,6 +305,25 @@ class RepresentativeVolumeElement
             float rotationOY = 0.0f,
             float rotationOZ = 0.0f) throw (std::runtime_error);
 
+    /// Apply the same Gaussian filter as applyGaussianFilter() does, but by the
+    /// periodic convolution in the frequency domain (see FastFourierTransform),
+    /// it costs O(N^3*log(N)) for any discreteRadius, instead of O(N^3*R) (separated filter)
+    /// and O(N^3*R^3) (rotations).
+    /// The kernel is sampled on the same offsets [-R,R]^3 and wrapped on the
+    /// period, so the result is equal to applyGaussianFilter() up to round-off errors.
+    /// It uses additional 8 * _size * _size * _size bytes of RAM memory.
+    public : void applyGaussianFilterFFT(
+            int discreteRadius,
+            float ellipsoidScaleFactorX = 1.0f,
+            float ellipsoidScaleFactorY = 1.0f,
+            float ellipsoidScaleFactorZ = 1.0f,
+            bool useDataAsIntensity = false,
+            float intensityFactor = 1.0f,
+            bool useRotations = false,
+            float rotationOX = 0.0f,
+            float rotationOY = 0.0f,
+            float rotationOZ = 0.0f) throw (std::runtime_error);
+
     /// Apply two-cut to mask (inside)
     /// (i.e. set all _data elements, that are within cut levels, equal to (-_data elements)).
     /// 0.0f <= cutlevelA < cutLevelB <= 1.0f;
@@ -239,6 +364,7 @@ class RepresentativeVolumeElement
 
     /// Generate overlapping random ellipsoids at unmasked _data elements
     /// (i.e. where _data elements >=0),
+    /// voxel is tested only against ellipsoids of its bucket (see BucketGrid)
     public : void generateOverlappingRandomEllipsoidsIntense(
             const int ellipsoidNum,
             const int minRadius,
@@ -255,6 +381,7 @@ class RepresentativeVolumeElement
 
     /// Generate overlapping random ellipsoids at unmasked _data elements
     /// (i.e. where _data elements >=0),
+    /// voxel is tested only against ellipsoids of its bucket (see BucketGrid)
     public : void generateOverlappingRandomEllipsoidsIntenseCL(
             const int ellipsoidNum,
             const int minRadius,
@@ -269,6 +396,70 @@ class RepresentativeVolumeElement
             float rotationOZ = 0.0f,
             const float coreValue = 1.0f) throw (std::runtime_error);
 
+    /// Packing session: inclusions are added one at a time (e.g. until the target volume
+    /// concentration), each one updates only voxels of its bounding box, and voxels number
+    /// of each intensity interval [first, second) is updated by the changed voxels,
+    /// so the step costs the inclusion volume instead of the whole RVE.
+    /// Other methods don't update numbers, start the session again after them.
+    private: std::vector<std::pair<float,float>> _packingIntervals;
+    private: std::vector<long> _packingCellsNum;
+    /// Count voxels of intervals once, as getRangeCellsNum()
+    public : void startPackingSession(const std::vector<std::pair<float,float>> &intervals);
+    /// Voxels number of the interval of the packing session
+    public : long getPackingCellsNum(const int interval) const noexcept {
+        return _packingCellsNum[interval];}
+
+    /// Add one random ellipsoid in the packing session, the result is the same
+    /// as generateOverlappingRandomEllipsoidsIntense(1, ...)
+    public : void addPackedRandomEllipsoidIntense(
+            const int minRadius,
+            const int maxRadius,
+            const float transitionLayerSize = 1.0f,
+            const float ellipsoidScaleFactorX = 1.0f,
+            const float ellipsoidScaleFactorY = 1.0f,
+            const float ellipsoidScaleFactorZ = 1.0f,
+            const bool useRandomRotations = false,
+            float rotationOX = 0.0f,
+            float rotationOY = 0.0f,
+            float rotationOZ = 0.0f,
+            const float coreValue = 1.0f) throw (std::runtime_error);
+
+    /// Apply ellipsoid x,y,z,rOX,rOY,rOZ,radius to unmasked value of the voxel (k,j,i)
+    private: void _applyEllipsoidIntense(
+            const float *ellipsoid,
+            const long k,
+            const long j,
+            const long i,
+            const float transitionLayerSize,
+            const float ellipsoidScaleFactorX,
+            const float ellipsoidScaleFactorY,
+            const float ellipsoidScaleFactorZ,
+            const float coreValue,
+            float &val) noexcept;
+
+    /// Random x,y,z,rOX,rOY,rOZ,radius of each ellipsoid
+    private: std::vector<float> _randomEllipsoidsParameters(
+            const int ellipsoidNum,
+            const int minRadius,
+            const int maxRadius,
+            const bool useRandomRotations,
+            const float rotationOX,
+            const float rotationOY,
+            const float rotationOZ) noexcept;
+
+    /// Bucket grid over bounding cubes of objects, parameters of each object
+    /// start with x,y,z of its centre
+    private: BucketGrid _objectsBucketGrid(
+            const float *parameters,
+            const int stride,
+            const std::vector<float> &halfExtents) const;
+
+    /// Bucket grid of Voronoi seeds (x,y,z)
+    private: BucketGrid _pointsBucketGrid(const std::vector<float> &points) const;
+
+    /// Lower bound of the Voronoi distance, divided by the largest coordinate difference
+    private: static float _VoronoiRingFactor(const float squeezeFactorZ) noexcept;
+
     private : static inline float _BernsteinBasis(int n, int i, float t)
     {
         return MathUtils::factorial(n)*std::pow(t,i)*std::pow(1.0f-t,n-i)/
@@ -296,7 +487,7 @@ class RepresentativeVolumeElement
             float y,
             float z,
             int currentPoint,
-            float *curveAproximation)
+            const float *curveAproximation)
     {
         return
                 (x-curveAproximation[currentPoint*3 + 0]) *
@@ -329,6 +520,23 @@ class RepresentativeVolumeElement
                     ((Ax-Bx)*(Ax-Bx) + (Ay-By)*(Ay-By) + (Az-Bz)*(Az-Bz));
     }
 
+    /// Intensity of the Bezier curve at the point x,y,z relative to the curve centre
+    private: static float _BezierCurveIntensity(
+            const float x,
+            const float y,
+            const float z,
+            const float *curveAproximation,
+            const int curveApproximationPoints,
+            const float curveRadius,
+            const float transitionLayerSize,
+            const float coreValue) noexcept;
+
+    /// Radius of the sphere around the curve centre, which holds the curve with its radius
+    private: static float _BezierCurveBoundingRadius(
+            const float *curveAproximation,
+            const int curveApproximationPoints,
+            const float curveRadius) noexcept;
+
     /// Generate Bezier curve at unmasked _data elements
     /// (i.e. where _data elements >=0),
     public : void generateBezierCurveIntense(
@@ -347,6 +555,7 @@ class RepresentativeVolumeElement
             float coreValue = 1.0f) throw (std::runtime_error);
 
     /// Generate overlapping random ellipsoids at unmasked _data elements
+    /// voxel is tested only against curves of its bucket (see BucketGrid)
     public : void generateOverlappingRandomBezierCurveIntense(int curveNum,
             int curveOrder,
             int curveApproximationPoints,
@@ -362,6 +571,7 @@ class RepresentativeVolumeElement
             float coreValue = 1.0f) throw (std::runtime_error);
 
     /// Generate overlapping random ellipsoids at unmasked _data elements OpenCL version
+    /// voxel is tested only against curves of its bucket (see BucketGrid)
     public : void generateOverlappingRandomBezierCurveIntenseCL(
             int curveNum,
             int curveOrder,
@@ -379,6 +589,7 @@ class RepresentativeVolumeElement
             const std::vector<MathUtils::Node<3,float>> *_initialPointsPtr= nullptr) throw (std::runtime_error);
 
     /// Generate Voronoi diagram random cells
+    /// two nearest seeds are searched in rings of buckets around the voxel (see BucketGrid)
     public : void generateVoronoiRandomCells(
             const int cellNum,
             const float squeezeFactorZ = 1.0f,
@@ -386,11 +597,30 @@ class RepresentativeVolumeElement
     throw (std::runtime_error);
 
     /// Generate Voronoi diagram random cells OpenCL version
+    /// two nearest seeds are searched in rings of buckets around the voxel (see BucketGrid)
     public : void generateVoronoiRandomCellsCL(const int cellNum,
             const float squeezeFactorZ = 1.0f,
             const std::vector<MathUtils::Node<3,float>> *_initialPointsPtr = nullptr)
     throw (std::runtime_error);
 
+    /// Euclidean distance from each voxel to the nearest masked voxel (_data < 0)
+    /// on the periodic RVE, 0 for masked voxels and +inf if there are no masked voxels.
+    /// It is exact and linear in the number of voxels (see DistanceTransform),
+    /// e.g. for skins and transition layers around the mask.
+    public : void getMaskDistances(std::vector<float> &distances) const;
+
+    /// Nearest and second nearest Voronoi seeds (indices in seeds) of each voxel,
+    /// distance^2 is dx^2 + dy^2 + dz^2/squeezeFactorZ, as in generateVoronoiRandomCells().
+    /// Nearest seed is exact for seeds, rounded to voxels (see DistanceTransform),
+    /// second nearest one is searched among the adjacent cells only, so it can be
+    /// missed, if the common face of cells is thinner than voxel.
+    /// secondNearest is -1, if there is the single cell.
+    public : void getNearestSeeds(
+            const std::vector<MathUtils::Node<3,float>> &seeds,
+            std::vector<int> &nearest,
+            std::vector<int> &secondNearest,
+            const float squeezeFactorZ = 1.0f) const;
+
     private: void _add(
             float *recipient,
             const float *value,
@@ -432,10 +662,7 @@ class RepresentativeVolumeElement
 
     public : void TESTLayerAsHeight();
 
-    public : ~RepresentativeVolumeElement()
-    {
-        delete [] _data;
-    }
+    public : ~RepresentativeVolumeElement() {}
 };
 
 #endif // REPRESENTATIVEVOLUMEELEMENT_H
@@ -0,0 +1,435 @@
+#ifndef RVEFILE
+#define RVEFILE
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "parallelfor.h"
+
+/// RepresentativeVolumeElement files.
+/// Chunked format:
+///   "RVECHNK1", int size, float representationSize, int chunkSize, int 0,
+///   uint64 chunk offsets[chunksNum+1] (from the beginning of the file),
+///   chunks: uint8 codec, payload.
+/// The RVE is split into chunkSize^3 bricks, chunk index is ci*n^2 + cj*n + ck,
+/// n = size/chunkSize, as the voxel index i*size^2 + j*size + k.
+/// Each chunk is compressed separately (see Codec), so any chunk can be read alone.
+/// Legacy format: int size, float representationSize, size^3 floats.
+namespace RVEFile
+{
+    /// Chunk compression, lossless.
+    /// Most RVEs have few different values (phases, mask), so values are run-length
+    /// encoded, as indices of the palette if there are <= 256 of them.
+    enum Codec : uint8_t
+    {
+        RAW = 0,            ///< floats
+        RUN_LENGTH = 1,     ///< (uint32 run, float value) pairs
+        PALETTE = 2         ///< uint16 paletteSize, floats palette, (uint16 run, uint8 index) pairs
+    };
+
+    const char MAGIC[8] = {'R','V','E','C','H','N','K','1'};
+    const int HEADER_SIZE = 8 + 4*sizeof(int32_t);
+
+    inline void _put(std::vector<char> &out, const void *value, const size_t bytes)
+    {
+        out.insert(out.end(), (const char *)value, (const char *)value + bytes);
+    }
+
+    inline void encodeChunk(const float *values, const long n, std::vector<char> &out)
+    {
+        out.clear();
+        // Bitwise comparison, so -0.0f and NaNs are kept
+        std::vector<uint32_t> _words(n);
+        std::memcpy(_words.data(), values, n*sizeof(float));
+
+        std::vector<uint32_t> _palette;
+        for(long i = 0; i < n && _palette.size() <= 256; ++i)
+            if(std::find(_palette.begin(), _palette.end(), _words[i]) == _palette.end())
+                _palette.push_back(_words[i]);
+
+        if(_palette.size() <= 256)
+        {
+            out.push_back((char)PALETTE);
+            const uint16_t _paletteSize = _palette.size();
+            _put(out, &_paletteSize, sizeof(uint16_t));
+            _put(out, _palette.data(), _paletteSize*sizeof(uint32_t));
+            for(long i = 0; i < n;)
+            {
+                long _end = i + 1;
+                while(_end < n && _end - i < 65535 && _words[_end] == _words[i])
+                    ++_end;
+                const uint16_t _run = _end - i;
+                const uint8_t _index =
+                        std::find(_palette.begin(), _palette.end(), _words[i]) - _palette.begin();
+                _put(out, &_run, sizeof(uint16_t));
+                _put(out, &_index, sizeof(uint8_t));
+                i = _end;
+            }
+        }
+        else
+        {
+            out.push_back((char)RUN_LENGTH);
+            for(long i = 0; i < n;)
+            {
+                long _end = i + 1;
+                while(_end < n && _words[_end] == _words[i])
+                    ++_end;
+                const uint32_t _run = _end - i;
+                _put(out, &_run, sizeof(uint32_t));
+                _put(out, &_words[i], sizeof(uint32_t));
+                i = _end;
+            }
+        }
+
+        if(out.size() >= 1 + n*sizeof(float))
+        {
+            out.assign(1, (char)RAW);
+            _put(out, values, n*sizeof(float));
+        }
+    }
+
+    inline void decodeChunk(const char *in, const size_t bytes, float *values, const long n)
+    {
+        const char *_end = in + bytes;
+        if(bytes < 1)
+            throw(std::runtime_error("RVEFile::decodeChunk(): empty chunk.\n"));
+        const uint8_t _codec = *in++;
+        long _filled = 0;
+        if(_codec == RAW)
+        {
+            if((size_t)(_end - in) != n*sizeof(float))
+                throw(std::runtime_error("RVEFile::decodeChunk(): bad raw chunk.\n"));
+            std::memcpy(values, in, n*sizeof(float));
+            return;
+        }
+        else if(_codec == RUN_LENGTH)
+        {
+            while(in + 2*sizeof(uint32_t) <= _end)
+            {
+                uint32_t _run;
+                float _value;
+                std::memcpy(&_run, in, sizeof(uint32_t));
+                std::memcpy(&_value, in + sizeof(uint32_t), sizeof(float));
+                in += 2*sizeof(uint32_t);
+                if(_filled + _run > n)
+                    break;
+                std::fill(values + _filled, values + _filled + _run, _value);
+                _filled += _run;
+            }
+        }
+        else if(_codec == PALETTE && in + sizeof(uint16_t) <= _end)
+        {
+            uint16_t _paletteSize;
+            std::memcpy(&_paletteSize, in, sizeof(uint16_t));
+            in += sizeof(uint16_t);
+            std::vector<float> _palette(_paletteSize);
+            if(in + _paletteSize*sizeof(float) <= _end)
+            {
+                std::memcpy(_palette.data(), in, _paletteSize*sizeof(float));
+                in += _paletteSize*sizeof(float);
+                while(in + sizeof(uint16_t) + sizeof(uint8_t) <= _end)
+                {
+                    uint16_t _run;
+                    std::memcpy(&_run, in, sizeof(uint16_t));
+                    const uint8_t _index = in[sizeof(uint16_t)];
+                    in += sizeof(uint16_t) + sizeof(uint8_t);
+                    if(_filled + _run > n || _index >= _paletteSize)
+                        break;
+                    std::fill(values + _filled, values + _filled + _run, _palette[_index]);
+                    _filled += _run;
+                }
+            }
+        }
+        if(_filled != n || in != _end)
+            throw(std::runtime_error("RVEFile::decodeChunk(): corrupted chunk.\n"));
+    }
+
+    /// Write RVE in chunked format, chunks are compressed in parallel
+    inline void write(
+            const std::string &fileName,
+            const int size,
+            const float representationSize,
+            const float *data,
+            const int chunkSize = 32)
+    {
+        const int _chunkSize = std::min(chunkSize, size);
+        if(_chunkSize < 1 || size % _chunkSize)
+            throw(std::runtime_error("RVEFile::write(): size is not divisible by chunkSize.\n"));
+        const long _n = size / _chunkSize;
+        const long _chunkVolume = (long)_chunkSize * _chunkSize * _chunkSize;
+
+        std::vector<std::vector<char>> _chunks(_n*_n*_n);
+        Parallel::forRange(_n*_n*_n, [&](const long begin, const long end){
+            std::vector<float> _values(_chunkVolume);
+            for(long c = begin; c < end; ++c)
+            {
+                const long _ci = c / (_n*_n), _cj = (c / _n) % _n, _ck = c % _n;
+                for(long i = 0; i < _chunkSize; ++i)
+                    for(long j = 0; j < _chunkSize; ++j)
+                        std::memcpy(&_values[(i*_chunkSize + j)*_chunkSize],
+                                    &data[((_ci*_chunkSize + i)*size + _cj*_chunkSize + j)*size
+                                          + _ck*_chunkSize],
+                                    _chunkSize*sizeof(float));
+                encodeChunk(_values.data(), _chunkVolume, _chunks[c]);
+            }});
+
+        std::vector<uint64_t> _offsets(_chunks.size() + 1);
+        _offsets[0] = HEADER_SIZE + _offsets.size()*sizeof(uint64_t);
+        for(size_t c = 0; c < _chunks.size(); ++c)
+            _offsets[c+1] = _offsets[c] + _chunks[c].size();
+
+        std::ofstream _file;
+        _file.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+        try
+        {
+            _file.open(fileName, std::ios::out | std::ios::trunc | std::ios::binary);
+            const int32_t _header[4] = {size, 0, _chunkSize, 0};
+            _file.write(MAGIC, sizeof(MAGIC));
+            _file.write((const char*)&_header[0], sizeof(int32_t));
+            _file.write((const char*)&representationSize, sizeof(float));
+            _file.write((const char*)&_header[2], 2*sizeof(int32_t));
+            _file.write((const char*)_offsets.data(), _offsets.size()*sizeof(uint64_t));
+            for(const std::vector<char> &_chunk : _chunks)
+                _file.write(_chunk.data(), _chunk.size());
+            _file.close();
+        }
+        catch(std::exception &e)
+        {
+            throw(std::runtime_error("RVEFile::write(): can't write " + fileName +
+                                     ": " + e.what() + "\n"));
+        }
+    }
+
+    /// Read-only memory mapping of the whole file
+    class MappedFile
+    {
+        private: const char *_begin = nullptr;
+        private: size_t _bytes = 0;
+#ifdef _WIN32
+        private: HANDLE _file = INVALID_HANDLE_VALUE;
+        private: HANDLE _mapping = NULL;
+#endif
+
+        public : const char * data() const noexcept {return _begin;}
+        public : size_t size() const noexcept {return _bytes;}
+
+        public : MappedFile(const std::string &fileName)
+        {
+#ifdef _WIN32
+            _file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            LARGE_INTEGER _fileSize;
+            if(_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(_file, &_fileSize))
+            {
+                if(_file != INVALID_HANDLE_VALUE)
+                    CloseHandle(_file);
+                throw(std::runtime_error("MappedFile(): can't open " + fileName + "\n"));
+            }
+            _bytes = _fileSize.QuadPart;
+            if(_bytes)
+            {
+                _mapping = CreateFileMappingA(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+                if(_mapping)
+                    _begin = (const char *)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+                if(!_begin)
+                {
+                    if(_mapping)
+                        CloseHandle(_mapping);
+                    CloseHandle(_file);
+                    throw(std::runtime_error("MappedFile(): can't map " + fileName + "\n"));
+                }
+            }
+#else
+            const int _fd = open(fileName.c_str(), O_RDONLY);
+            struct stat _stat;
+            if(_fd < 0 || fstat(_fd, &_stat) != 0)
+            {
+                if(_fd >= 0)
+                    close(_fd);
+                throw(std::runtime_error("MappedFile(): can't open " + fileName + "\n"));
+            }
+            _bytes = _stat.st_size;
+            if(_bytes)
+            {
+                void *_map = mmap(nullptr, _bytes, PROT_READ, MAP_SHARED, _fd, 0);
+                if(_map == MAP_FAILED)
+                {
+                    close(_fd);
+                    throw(std::runtime_error("MappedFile(): can't map " + fileName + "\n"));
+                }
+                _begin = (const char *)_map;
+            }
+            // Mapping stays valid after the descriptor is closed
+            close(_fd);
+#endif
+        }
+
+        public : MappedFile(const MappedFile &) = delete;
+        public : MappedFile & operator = (const MappedFile &) = delete;
+
+        public : ~MappedFile()
+        {
+#ifdef _WIN32
+            if(_begin)
+                UnmapViewOfFile(_begin);
+            if(_mapping)
+                CloseHandle(_mapping);
+            CloseHandle(_file);
+#else
+            if(_begin)
+                munmap((void *)_begin, _bytes);
+#endif
+        }
+    };
+
+    /// Memory mapped reader of chunked and legacy files,
+    /// only the requested part of the file is read and decompressed
+    class Reader
+    {
+        private: MappedFile _file;
+        private: bool _legacy = false;
+        private: int _size = 0;
+        private: float _representationSize = 0.0f;
+        private: int _chunkSize = 0;
+        private: long _chunksPerAxis = 0;
+        private: const char *_offsets = nullptr;
+
+        public : int size() const noexcept {return _size;}
+        public : float representationSize() const noexcept {return _representationSize;}
+        public : bool isLegacy() const noexcept {return _legacy;}
+        public : int chunkSize() const noexcept {return _chunkSize;}
+        public : long chunksPerAxis() const noexcept {return _chunksPerAxis;}
+
+        public : Reader(const std::string &fileName) : _file(fileName)
+        {
+            const char *_data = _file.data();
+            if(_file.size() >= (size_t)HEADER_SIZE && std::memcmp(_data, MAGIC, sizeof(MAGIC)) == 0)
+            {
+                int32_t _header[4];
+                std::memcpy(_header, _data + sizeof(MAGIC), sizeof(_header));
+                _size = _header[0];
+                std::memcpy(&_representationSize, &_header[1], sizeof(float));
+                _chunkSize = _header[2];
+                if(_size < 2 || (_size & (_size-1)) ||
+                        _chunkSize < 1 || _chunkSize > _size || _size % _chunkSize)
+                    throw(std::runtime_error("RVEFile::Reader(): bad header.\n"));
+                _chunksPerAxis = _size / _chunkSize;
+                _offsets = _data + HEADER_SIZE;
+                const long _chunksNum = _chunksPerAxis * _chunksPerAxis * _chunksPerAxis;
+                if(_file.size() < HEADER_SIZE + (_chunksNum + 1)*sizeof(uint64_t) ||
+                        _offset(_chunksNum) != _file.size())
+                    throw(std::runtime_error("RVEFile::Reader(): bad chunk index.\n"));
+            }
+            else
+            {
+                _legacy = true;
+                if(_file.size() >= sizeof(int) + sizeof(float))
+                {
+                    std::memcpy(&_size, _data, sizeof(int));
+                    std::memcpy(&_representationSize, _data + sizeof(int), sizeof(float));
+                }
+                if(!((_size >= 2) && ((_size & (_size - 1)) == 0)) ||
+                        _file.size() < sizeof(int) + sizeof(float) +
+                        (size_t)_size*_size*_size*sizeof(float))
+                    throw(std::runtime_error("RVEFile::Reader(): bad size.\n"));
+                _chunkSize = _size;
+                _chunksPerAxis = 1;
+            }
+        }
+
+        private: uint64_t _offset(const long chunk) const noexcept
+        {
+            uint64_t _value;
+            std::memcpy(&_value, _offsets + chunk*sizeof(uint64_t), sizeof(uint64_t));
+            return _value;
+        }
+
+        /// Chunk (ci,cj,ck) to values[chunkSize^3], index (i*chunkSize + j)*chunkSize + k
+        public : void readChunk(const long ci, const long cj, const long ck, float *values) const
+        {
+            if(ci < 0 || cj < 0 || ck < 0 ||
+                    ci >= _chunksPerAxis || cj >= _chunksPerAxis || ck >= _chunksPerAxis)
+                throw(std::runtime_error("RVEFile::Reader::readChunk(): wrong chunk.\n"));
+            if(_legacy)
+            {
+                std::memcpy(values, _file.data() + sizeof(int) + sizeof(float),
+                            (size_t)_size*_size*_size*sizeof(float));
+                return;
+            }
+            const long _chunk = (ci*_chunksPerAxis + cj)*_chunksPerAxis + ck;
+            const uint64_t _begin = _offset(_chunk);
+            const uint64_t _end = _offset(_chunk+1);
+            if(_begin > _end || _end > _file.size())
+                throw(std::runtime_error("RVEFile::Reader::readChunk(): bad chunk index.\n"));
+            decodeChunk(_file.data() + _begin, _end - _begin, values,
+                        (long)_chunkSize*_chunkSize*_chunkSize);
+        }
+
+        /// Layers i in [iBegin,iEnd) to data[(iEnd-iBegin)*size^2], index as in RVE
+        public : void readSlab(const int iBegin, const int iEnd, float *data) const
+        {
+            if(iBegin < 0 || iEnd > _size || iBegin >= iEnd)
+                throw(std::runtime_error("RVEFile::Reader::readSlab(): wrong range.\n"));
+            const long _layer = (long)_size*_size;
+            if(_legacy)
+            {
+                std::memcpy(data, _file.data() + sizeof(int) + sizeof(float) +
+                            iBegin*_layer*sizeof(float),
+                            (iEnd - iBegin)*_layer*sizeof(float));
+                return;
+            }
+            const long _ciBegin = iBegin / _chunkSize;
+            const long _ciEnd = (iEnd - 1) / _chunkSize + 1;
+            const long _chunksNum = (_ciEnd - _ciBegin)*_chunksPerAxis*_chunksPerAxis;
+            const long _chunkVolume = (long)_chunkSize*_chunkSize*_chunkSize;
+            // Exceptions can't leave the parallel region, they are rethrown after it
+            std::vector<char> _failed(_chunksNum, 0);
+            Parallel::forRange(_chunksNum, [&](const long begin, const long end){
+                std::vector<float> _values(_chunkVolume);
+                for(long c = begin; c < end; ++c)
+                {
+                    const long _ci = _ciBegin + c / (_chunksPerAxis*_chunksPerAxis);
+                    const long _cj = (c / _chunksPerAxis) % _chunksPerAxis;
+                    const long _ck = c % _chunksPerAxis;
+                    try
+                    {
+                        readChunk(_ci, _cj, _ck, _values.data());
+                    }
+                    catch(std::exception &)
+                    {
+                        _failed[c] = 1;
+                        continue;
+                    }
+                    const long _iFirst = std::max<long>(iBegin, _ci*_chunkSize);
+                    const long _iLast = std::min<long>(iEnd, (_ci + 1)*_chunkSize);
+                    for(long i = _iFirst; i < _iLast; ++i)
+                        for(long j = 0; j < _chunkSize; ++j)
+                            std::memcpy(&data[(i - iBegin)*_layer +
+                                              (_cj*_chunkSize + j)*_size + _ck*_chunkSize],
+                                        &_values[((i - _ci*_chunkSize)*_chunkSize + j)*_chunkSize],
+                                        _chunkSize*sizeof(float));
+                }});
+            if(std::find(_failed.begin(), _failed.end(), 1) != _failed.end())
+                throw(std::runtime_error("RVEFile::Reader::readSlab(): corrupted chunk.\n"));
+        }
+
+        /// Whole RVE to data[size^3]
+        public : void read(float *data) const {readSlab(0, _size, data);}
+    };
+}
+
+#endif // RVEFILE
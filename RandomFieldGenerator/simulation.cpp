@@ -182,7 +182,8 @@ void FEM::Simulation::applyLocalNeumannConditions(
     }
 }
 
-void FEM::Simulation::assembleSiffnessMatrix(
+void FEM::Simulation::_assembleSiffnessMatrixPart(
+        const SlabPartition &part,
         const float RVEPhysicalLength,
         const int RVEDiscreteSize,
         const float *ptrToRVEData,
@@ -199,7 +200,7 @@ void FEM::Simulation::assembleSiffnessMatrix(
     float _step = RVEPhysicalLength / (RVEDiscreteSize-1);
     float _q = flux * _step * _step / 2.0f / 3.0f;
 
-    for(int k=0; k<RVEDiscreteSize-1; ++k)
+    for(int k=part.firstCubeLayer; k<part.lastCubeLayer; ++k)
         for(int j=0; j<RVEDiscreteSize-1; ++j)
             for(int i=0; i<RVEDiscreteSize-1; ++i)
             {
@@ -262,6 +263,7 @@ void FEM::Simulation::assembleSiffnessMatrix(
                     long _element[] = {_v0, _v1, _v6, _v4};
                     for(long ii=0; ii<4; ++ii)
                     {
+                        if(!part.owns(_element[ii])) continue;
                         for(long jj=0; jj<4; ++jj)
                             cpu_sparse_matrix[_element[ii]][_element[jj]] += _K[ii][jj];
                         cpu_loads[_element[ii]] += _f[ii];
@@ -311,6 +313,7 @@ void FEM::Simulation::assembleSiffnessMatrix(
                     long _element[] = {_v0, _v1, _v2, _v6};
                     for(long ii=0; ii<4; ++ii)
                     {
+                        if(!part.owns(_element[ii])) continue;
                         for(long jj=0; jj<4; ++jj)
                             cpu_sparse_matrix[_element[ii]][_element[jj]] += _K[ii][jj];
                         cpu_loads[_element[ii]] += _f[ii];
@@ -357,6 +360,7 @@ void FEM::Simulation::assembleSiffnessMatrix(
                     long _element[] = {_v1, _v5, _v7, _v6};
                     for(long ii=0; ii<4; ++ii)
                     {
+                        if(!part.owns(_element[ii])) continue;
                         for(long jj=0; jj<4; ++jj)
                             cpu_sparse_matrix[_element[ii]][_element[jj]] += _K[ii][jj];
                         cpu_loads[_element[ii]] += _f[ii];
@@ -403,6 +407,7 @@ void FEM::Simulation::assembleSiffnessMatrix(
                     long _element[] = {_v1, _v3, _v6, _v7};
                     for(long ii=0; ii<4; ++ii)
                     {
+                        if(!part.owns(_element[ii])) continue;
                         for(long jj=0; jj<4; ++jj)
                             cpu_sparse_matrix[_element[ii]][_element[jj]] += _K[ii][jj];
                         cpu_loads[_element[ii]] += _f[ii];
@@ -449,6 +454,7 @@ void FEM::Simulation::assembleSiffnessMatrix(
                     long _element[] = {_v1, _v3, _v2, _v6};
                     for(long ii=0; ii<4; ++ii)
                     {
+                        if(!part.owns(_element[ii])) continue;
                         for(long jj=0; jj<4; ++jj)
                             cpu_sparse_matrix[_element[ii]][_element[jj]] += _K[ii][jj];
                         cpu_loads[_element[ii]] += _f[ii];
@@ -495,6 +501,7 @@ void FEM::Simulation::assembleSiffnessMatrix(
                     long _element[] = {_v1, _v4, _v5, _v6};
                     for(long ii=0; ii<4; ++ii)
                     {
+                        if(!part.owns(_element[ii])) continue;
                         for(long jj=0; jj<4; ++jj)
                             cpu_sparse_matrix[_element[ii]][_element[jj]] += _K[ii][jj];
                         cpu_loads[_element[ii]] += _f[ii];
@@ -503,6 +510,36 @@ void FEM::Simulation::assembleSiffnessMatrix(
             }
 }
 
+void FEM::Simulation::assembleSiffnessMatrix(
+        const float RVEPhysicalLength,
+        const int RVEDiscreteSize,
+        const float *ptrToRVEData,
+        const float conductionMatrix,
+        const float conductionPhase,
+        //char maskNeumannConditions,
+        const float T0,
+        //char maskDirichletConditions,
+        const float flux,
+        const float cuttingPlane,
+        std::vector<std::map<long, float> > &cpu_sparse_matrix,
+        std::vector<float> &cpu_loads) noexcept
+{
+    // Elements are processed in parallel, see SlabPartition
+    #pragma omp parallel
+    _assembleSiffnessMatrixPart(
+                SlabPartition::currentThread(RVEDiscreteSize),
+                RVEPhysicalLength,
+                RVEDiscreteSize,
+                ptrToRVEData,
+                conductionMatrix,
+                conductionPhase,
+                T0,
+                flux,
+                cuttingPlane,
+                cpu_sparse_matrix,
+                cpu_loads);
+}
+
 void FEM::Simulation::calculateConductionCoefficient(
         const float RVEPhysicalLength,
         const int RVEDiscreteSize,
@@ -4,6 +4,7 @@
 #include <map>
 
 #include "representativevolumeelement.h"
+#include "FEM/slabpartition.h"
 
 namespace FEM
 {
@@ -82,6 +83,22 @@ namespace FEM
                 std::vector< float > &cpu_loads
                 ) noexcept;
 
+        /// Part of assembleSiffnessMatrix(): elements of the voxel layers of the part,
+        /// only rows of its own nodes are written
+        private: static void _assembleSiffnessMatrixPart(
+                const SlabPartition &part,
+                const float RVEPhysicalLength,
+                const int RVEDiscreteSize,
+                const float *ptrToRVEData,
+                const float conductionMatrix,
+                const float conductionPhase,
+                const float T0,
+                const float flux,
+                const float cuttingPlane,
+                std::vector< std::map<long, float> > &cpu_sparse_matrix,
+                std::vector< float > &cpu_loads
+                ) noexcept;
+
         public: static void calculateConductionCoefficient(
                 const float RVEPhysicalLength,
                 const int RVEDiscreteSize,